@@ -11,6 +11,10 @@
 #include "ModeSelect_UI.hpp"
 #include "BLE_Driver.hpp"
 #include "DragRace_UI.hpp"
+#include "Diag_UI.hpp"
+#include "UI_Task.hpp"
+#include "UI_Bind.hpp"
+#include "Telemetry.hpp"
 
 // 引用外部对象
 extern LGFX tft;
@@ -19,11 +23,17 @@ extern bool sd_connected;
 extern BLE_Driver ble;
 
 // --- LVGL 缓冲 ---
+// 内部 RAM 条带缓冲 (小区域刷新用)；大面积重绘时 uiTask 会临时换成 PSRAM 整屏缓冲
 static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf[240 * 40];
-static lv_color_t buf2[240 * 40];
+static lv_color_t buf[UI_BAND_PX];
+static lv_color_t buf2[UI_BAND_PX];
 static bool is_boot_anim_active = false; // [新增] 动画状态标志
 
+// [新增] 主界面控件的绑定缓存 (值不变就不写 LVGL，见 UI_Bind.hpp)
+static BoundLabel bind_speed, bind_sat, bind_time, bind_sd, bind_ble, bind_imu;
+static BoundArc bind_arc;
+static BoundAlign bind_gball;
+
 // --- 全局 UI 对象 (全部声明为全局变量) ---
 lv_obj_t *ui_ScreenMain = NULL;
 lv_obj_t *ui_ScreenBoot = NULL;
@@ -56,15 +66,34 @@ void start_dashboard_sweep(void);
 void build_drag_page(void);
 
 // 屏幕刷新回调
+// [修改] 只启动 DMA 传输就返回，传输完成后由 uiTask 调用 lv_disp_flush_ready()
+// LV_COLOR_16_SWAP = 1，缓冲里已经是屏幕要的大端 RGB565，DMA 直接发送，不需要逐像素转换
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p)
 {
     uint32_t w = (area->x2 - area->x1 + 1);
     uint32_t h = (area->y2 - area->y1 + 1);
-    tft.startWrite();
-    tft.setAddrWindow(area->x1, area->y1, w, h);
-    tft.writePixels((uint16_t *)&color_p->full, w * h, true);
-    tft.endWrite();
-    lv_disp_flush_ready(disp);
+    uiTask.prepareDma(color_p, w * h * sizeof(lv_color_t));
+    tft.startWrite(); // 传输完成后才 endWrite()，保证不会在这里等 DMA
+    tft.pushImageDMA(area->x1, area->y1, w, h, (lgfx::swap565_t *)&color_p->full);
+    uiTask.flushStarted(disp, area);
+}
+
+// [新增] 每次重绘开始前：合并脏区，选择条带 / 整屏缓冲
+void my_disp_render_start(lv_disp_drv_t *disp)
+{
+    uiTask.renderStart(disp);
+}
+
+// [新增] LVGL 需要复用正在传输的缓冲时调用
+void my_disp_wait(lv_disp_drv_t *disp)
+{
+    uiTask.waitFlush();
+}
+
+// [新增] 一次重绘结束 (time 为渲染耗时 ms，px 为刷新的像素数)
+void my_disp_monitor(lv_disp_drv_t *disp, uint32_t time, uint32_t px)
+{
+    uiTask.frameDone();
 }
 
 // 触摸读取回调
@@ -112,6 +141,12 @@ void screen_gesture_event_cb(lv_event_t *e)
                 // 修改点：动画改为 NONE，时间改为 0
                 lv_scr_load_anim(ui_ScreenSettings, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
             }
+            // [新增] 上滑 -> 诊断页
+            else if (dir == LV_DIR_TOP)
+            {
+                build_diag_page();
+                lv_scr_load_anim(ui_ScreenDiag, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
+            }
         }
 
         // 2. 如果当前在 [模式选择页] (第2屏)
@@ -151,6 +186,17 @@ void screen_gesture_event_cb(lv_event_t *e)
             // 修改点：动画改为 NONE，时间改为 0
             lv_scr_load_anim(ui_ScreenMain, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
         }
+
+        // 5. [新增] 诊断页 (列表上下滚动，所以用横滑返回)
+        else if (current_scr == ui_ScreenDiag && (dir == LV_DIR_RIGHT || dir == LV_DIR_LEFT))
+        {
+            if (timer_diag_refresh)
+            {
+                lv_timer_del(timer_diag_refresh);
+                timer_diag_refresh = NULL;
+            }
+            lv_scr_load_anim(ui_ScreenMain, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
+        }
     }
 }
 // ================= 开机动画逻辑 =================
@@ -459,14 +505,17 @@ void build_dashboard()
 void init_ui()
 {
     lv_init();
-    lv_disp_draw_buf_init(&draw_buf, buf, buf2, 240 * 40);
+    lv_disp_draw_buf_init(&draw_buf, buf, buf2, UI_BAND_PX);
     static lv_disp_drv_t disp_drv;
     lv_disp_drv_init(&disp_drv);
     disp_drv.hor_res = 320;
     disp_drv.ver_res = 240;
     disp_drv.flush_cb = my_disp_flush;
+    disp_drv.wait_cb = my_disp_wait;
+    disp_drv.monitor_cb = my_disp_monitor;
+    disp_drv.render_start_cb = my_disp_render_start;
     disp_drv.draw_buf = &draw_buf;
-    lv_disp_drv_register(&disp_drv);
+    uiTask.attachDisplay(lv_disp_drv_register(&disp_drv), &draw_buf);
 
     static lv_indev_drv_t indev_drv;
     lv_indev_drv_init(&indev_drv);
@@ -489,23 +538,20 @@ void update_dev_status()
     // SD 卡状态
     if (ui_LabelSD)
     {
-        lv_color_t color = sd_connected ? lv_color_hex(0x00FF00) : lv_color_hex(0x555555);
-        lv_obj_set_style_text_color(ui_LabelSD, color, LV_PART_MAIN);
+        bind_sd.setColor(ui_LabelSD, sd_connected ? 0x00FF00 : 0x555555);
     }
 
     // [修改] BLE 状态
     if (ui_LabelBLE)
     {
         // 如果连接：显示青色(蓝牙色)；未连接：显示灰色
-        lv_color_t color = ble.isConnected() ? lv_color_hex(0x00AEEF) : lv_color_hex(0x555555);
-        lv_obj_set_style_text_color(ui_LabelBLE, color, LV_PART_MAIN);
+        bind_ble.setColor(ui_LabelBLE, ble.isConnected() ? 0x00AEEF : 0x555555);
     }
 
     // IMU 状态
     if (ui_LabelIMU)
     {
-        lv_color_t color = imu.isConnected ? lv_color_hex(0x00FF00) : lv_color_hex(0x555555);
-        lv_obj_set_style_text_color(ui_LabelIMU, color, LV_PART_MAIN);
+        bind_imu.setColor(ui_LabelIMU, imu.isConnected ? 0x00FF00 : 0x555555);
     }
 }
 // UI 循环更新
@@ -559,8 +605,10 @@ void update_ui_loop()
 
         if (ui_ObjGball)
         {
-            float gx = imu.lat_g; // 横向 G (对应原来的 ax)
-            float gy = imu.lon_g; // 纵向 G (对应原来的 ay)
+            TelemetrySnapshot t;
+            telemetry.read(t);
+            float gx = t.lat_g; // 横向 G (对应原来的 ax)
+            float gy = t.lon_g; // 纵向 G (对应原来的 ay)
             // 应用配置交换
             // if (sys_cfg.imu_swap_axis)
             // {
@@ -583,7 +631,7 @@ void update_ui_loop()
                 gy = -1.5;
             int offset_x = (int)(gx * 30);
             int offset_y = (int)(gy * 30);
-            lv_obj_align(ui_ObjGball, LV_ALIGN_CENTER, offset_x, offset_y - 10);
+            bind_gball.align(ui_ObjGball, LV_ALIGN_CENTER, offset_x, offset_y - 10); // 同一像素不重复对齐
         }
     }
 }
@@ -596,15 +644,19 @@ void ui_refresh_data()
     if (is_boot_anim_active)
         return;
 
+    // [新增] 一次读出完整的遥测快照 (FusionTask 发布)，下面的速度/卫星都来自同一份
+    TelemetrySnapshot t;
+    telemetry.read(t);
+
     // --- [修改] 速度与圆弧联动逻辑 ---
     if (ui_LabelSpeed)
     {
         float display_speed = 0.0;
 
         // 1. 获取有效速度
-        if (gps.tgps.location.isValid() && gps.getSatellites() >= 5)
+        if (t.fix && t.sats >= 5)
         {
-            float raw_speed = gps.getSpeed();
+            float raw_speed = t.speed_kmh;
             if (raw_speed < 3.0)
                 display_speed = 0.0;
             else
@@ -615,10 +667,9 @@ void ui_refresh_data()
             display_speed = 0.0;
         }
 
-        // 2. 更新数字显示 (使用 snprintf 修复 f 问题)
-        char spd_buf[16];
-        snprintf(spd_buf, sizeof(spd_buf), "%.1f", display_speed);
-        lv_label_set_text(ui_LabelSpeed, spd_buf);
+        // 2. 更新数字显示 (按 0.1km/h 量化，显示值不变就不重绘)
+        int32_t speed_q = lroundf(display_speed * 10);
+        bind_speed.setValue(ui_LabelSpeed, speed_q, "%.1f", speed_q / 10.0);
 
         // 3. [新增] 更新圆弧动画 (联动)
         if (ui_ArcSpeed)
@@ -635,42 +686,28 @@ void ui_refresh_data()
                 arc_val = 0;
 
             // 设置圆弧值 (LVGL 会自动处理平滑过渡，如果开启了动画的话)
-            lv_arc_set_value(ui_ArcSpeed, arc_val);
+            bind_arc.setValue(ui_ArcSpeed, arc_val);
 
             // [可选] 如果你想让圆弧颜色也随速度变化（比如超过200变红）
-            if (display_speed > 200)
-            {
-                lv_obj_set_style_arc_color(ui_ArcSpeed, lv_color_hex(0xFF0000), LV_PART_INDICATOR);
-            }
-            else
-            {
-                lv_obj_set_style_arc_color(ui_ArcSpeed, lv_color_hex(0xFFFFFF), LV_PART_INDICATOR);
-            }
+            bind_arc.setColor(ui_ArcSpeed, display_speed > 200 ? 0xFF0000 : 0xFFFFFF);
         }
 
         // 4. [新增] 文字动态变色 (超过 200km/h 变红)
-        if (display_speed > 200)
-        {
-            lv_obj_set_style_text_color(ui_LabelSpeed, lv_color_hex(0xFF0000), LV_PART_MAIN);
-        }
-        else
-        {
-            lv_obj_set_style_text_color(ui_LabelSpeed, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
-        }
+        bind_speed.setColor(ui_LabelSpeed, display_speed > 200 ? 0xFF0000 : 0xFFFFFF);
     }
 
     // --- 卫星状态显示 ---
     if (ui_LabelSatVal)
     {
-        int sats = gps.getSatellites();
-        lv_label_set_text_fmt(ui_LabelSatVal, "%d SAT", sats);
+        int sats = t.sats;
+        bind_sat.setValue(ui_LabelSatVal, sats, "%d SAT", sats);
 
         if (sats == 0)
-            lv_obj_set_style_text_color(ui_LabelSatVal, lv_color_hex(0xFF0000), LV_PART_MAIN);
-        else if (!gps.tgps.location.isValid() || sats < 5)
-            lv_obj_set_style_text_color(ui_LabelSatVal, lv_color_hex(0xFFFF00), LV_PART_MAIN);
+            bind_sat.setColor(ui_LabelSatVal, 0xFF0000);
+        else if (!t.fix || sats < 5)
+            bind_sat.setColor(ui_LabelSatVal, 0xFFFF00);
         else
-            lv_obj_set_style_text_color(ui_LabelSatVal, lv_color_hex(0x00FF00), LV_PART_MAIN);
+            bind_sat.setColor(ui_LabelSatVal, 0x00FF00);
     }
 
     // --- 设备状态 ---
@@ -679,19 +716,30 @@ void ui_refresh_data()
     // --- 时间显示 ---
     if (ui_LabelTimeVal)
     {
-        if (sys_cfg.is_running)
+        // [新增] 赛道模式有参考圈时，显示与最佳圈的实时差值 (绿色更快，红色更慢)
+        if (trackMgr.hasLiveDelta())
+        {
+            int32_t delta = trackMgr.getLiveDelta();
+            char delta_buf[16];
+            snprintf(delta_buf, sizeof(delta_buf), "%+.2f", delta / 1000.0);
+            bind_time.setText(ui_LabelTimeVal, delta_buf);
+            bind_time.setColor(ui_LabelTimeVal, delta <= 0 ? 0x00FF00 : 0xFF0000);
+        }
+        else if (sys_cfg.is_running)
         {
             uint32_t elapsed = millis() - sys_cfg.session_start_ms;
             uint32_t total_seconds = elapsed / 1000;
             uint32_t mm = (total_seconds / 60) % 60;
             uint32_t ss = total_seconds % 60;
-            lv_label_set_text_fmt(ui_LabelTimeVal, "%02d:%02d", mm, ss);
-            lv_obj_set_style_text_color(ui_LabelTimeVal, lv_color_hex(0x00FF00), LV_PART_MAIN);
+            char time_buf[16];
+            snprintf(time_buf, sizeof(time_buf), "%02d:%02d", mm, ss);
+            bind_time.setText(ui_LabelTimeVal, time_buf);
+            bind_time.setColor(ui_LabelTimeVal, 0x00FF00);
         }
         else
         {
-            lv_label_set_text(ui_LabelTimeVal, "00:00");
-            lv_obj_set_style_text_color(ui_LabelTimeVal, lv_color_hex(0x00AEEF), LV_PART_MAIN);
+            bind_time.setText(ui_LabelTimeVal, "00:00");
+            bind_time.setColor(ui_LabelTimeVal, 0x00AEEF);
         }
     }
 }
@@ -770,6 +818,8 @@ void dashboard_sweep_cb(lv_timer_t *timer)
             val = 0;
             // 动画结束
             is_boot_anim_active = false; // 释放控制权
+            bind_speed.invalidate();     // 动画直接改过速度和圆弧，绑定缓存作废
+            bind_arc.invalidate();
 
             // 重置状态，以便下次还能跑
             phase = 0;
@@ -4,7 +4,12 @@
 #include "Audio.h"
 #include "SD_MMC.h"
 #include "FS.h"
-#include <vector> // 引入向量容器
+#include "driver/i2s.h"
+#include "Audio_Queue.hpp"
+#include "Voice_Cache.hpp"
+#include "Latency_Histogram.hpp"
+#include "Task_Monitor.hpp"
+#include "Trace.hpp"
 
 // ==========================================
 // ⚡️ 防卡顿配置：多线程 + 黄金参数
@@ -19,11 +24,32 @@
 #define IIC_SCL 15
 #define ES8311_ADDR 0x18
 
+#define AUDIO_I2S_PORT I2S_NUM_0 // Audio 库默认使用的 I2S 端口
+#define PCM_CHUNK_FRAMES 256     // 每次写 I2S 的帧数 (立体声)
+#define PCM_TAIL_MS 20           // 播报结束后补一段静音，把 DMA 里最后一块推出去
+
 class Audio_Driver
 {
 private:
-    SemaphoreHandle_t _mutex;      // 互斥锁，保护播放列表
-    std::vector<String> _playlist; // 播放队列
+    // [修改] 播放队列: 每个优先级一条定长无锁队列 (见 Audio_Queue.hpp)，取代 vector<String> + 互斥锁
+    SpscQueue<AudioCmd, AUDIO_QUEUE_LEN> _queues[AUDIO_NUM_PRIO];
+    std::atomic<bool> _stopReq{false}; // stop() 只置位，由 AudioTask 清队列
+    TaskHandle_t _task = NULL;
+
+    // 当前指令 (只在 AudioTask 里读写)
+    AudioCmd _cur;
+    bool _curActive = false;
+    bool _curPcm = false;   // true: 语音缓存 PCM 直接写 I2S；false: Audio 库逐个播放文件
+    uint8_t _curIdx = 0;    // 序列里下一个要播的片段/文件
+    uint32_t _pcmPos = 0;   // 当前片段里的采样位置
+    uint32_t _pcmPrevRate = 0; // 播报前 Audio 库的采样率，结束后恢复
+    uint32_t _pcmGainQ15 = 32767;
+    bool _firstWritten = false;
+    int16_t _pcmBuf[PCM_CHUNK_FRAMES * 2]; // 放在对象里，不占 AudioTask 的栈
+
+    // 统计
+    uint32_t _coalesced = 0; // 合并掉的重复/过时指令
+    uint32_t _preempted = 0; // 被高优先级打断的次数
 
     void writeReg(uint8_t reg, uint8_t data)
     {
@@ -74,9 +100,213 @@ private:
         writeReg(0x37, 0x08);
     }
 
-    // ---------------------------------------------------------
-    // 🧵 独立音频任务 (运行在 Core 0)
-    // ---------------------------------------------------------
+    // 有待播指令的最高优先级，没有返回 -1
+    int8_t topPending()
+    {
+        for (int8_t p = AUDIO_NUM_PRIO - 1; p >= 0; p--)
+        {
+            if (!_queues[p].empty())
+                return p;
+        }
+        return -1;
+    }
+
+    // 从队列取下一条指令，顺带合并:
+    //   报圈: 只播最新的圈速，排在前面还没播的旧圈速直接丢掉
+    //   其他: 紧挨着的完全相同的指令只播一次
+    bool takeNext(uint8_t prio, AudioCmd &out)
+    {
+        SpscQueue<AudioCmd, AUDIO_QUEUE_LEN> &q = _queues[prio];
+        const AudioCmd *c;
+        while ((c = q.peek()) != NULL)
+        {
+            if (prio == AUDIO_PRIO_LAP && q.size() > 1)
+            {
+                q.pop();
+                _coalesced++;
+                continue;
+            }
+            out = *c;
+            q.pop();
+            while ((c = q.peek()) != NULL && c->sameAs(out))
+            {
+                q.pop();
+                _coalesced++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void startCmd(const AudioCmd &cmd)
+    {
+        _cur = cmd;
+        _curActive = true;
+        _curIdx = 0;
+        _pcmPos = 0;
+        _firstWritten = false;
+
+        // 序列里每个片段都在语音缓存里才走 PCM
+        _curPcm = (cmd.n_clips > 0);
+        for (uint8_t i = 0; i < cmd.n_clips && _curPcm; i++)
+            _curPcm = (voiceCache.get(cmd.clips[i]) != NULL);
+
+        if (_curPcm)
+        {
+            _pcmPrevRate = audio.getSampleRate();
+            if (_pcmPrevRate != voiceCache.sampleRate())
+                i2s_set_clk(AUDIO_I2S_PORT, voiceCache.sampleRate(), I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO);
+        }
+    }
+
+    void endCmd(bool aborted)
+    {
+        if (_curPcm)
+        {
+            if (aborted)
+            {
+                i2s_zero_dma_buffer(AUDIO_I2S_PORT); // 立即静音
+            }
+            else
+            {
+                memset(_pcmBuf, 0, sizeof(_pcmBuf));
+                uint32_t tail = voiceCache.sampleRate() * PCM_TAIL_MS / 1000;
+                size_t written;
+                while (tail > 0)
+                {
+                    uint32_t n = min((uint32_t)PCM_CHUNK_FRAMES, tail);
+                    i2s_write(AUDIO_I2S_PORT, _pcmBuf, n * 2 * sizeof(int16_t), &written, portMAX_DELAY);
+                    tail -= n;
+                }
+                totalTime.record(micros() - _cur.req_us);
+            }
+            if (_pcmPrevRate != 0 && _pcmPrevRate != voiceCache.sampleRate())
+                i2s_set_clk(AUDIO_I2S_PORT, _pcmPrevRate, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO);
+        }
+        else if (aborted)
+        {
+            audio.stopSong();
+        }
+        _curActive = false;
+    }
+
+    // 写一块 PCM 到 I2S (单声道 -> 立体声，乘音量)
+    // i2s_write 会阻塞到 DMA 有空位，所以这里的节奏就是播放节奏，片段之间没有空档
+    void pumpPcm()
+    {
+        const VoiceClip *clip = voiceCache.get(_cur.clips[_curIdx]);
+        if (_pcmPos == 0)
+            TRACE_MARK(TRACE_AUDIO_CLIP, _cur.clips[_curIdx]);
+        int16_t *out = _pcmBuf;
+        uint32_t n = min((uint32_t)PCM_CHUNK_FRAMES, clip->samples - _pcmPos);
+        const int16_t *src = clip->pcm + _pcmPos;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            int16_t s = (int16_t)(((int32_t)src[i] * (int32_t)_pcmGainQ15) >> 15);
+            out[2 * i] = s;
+            out[2 * i + 1] = s;
+        }
+        size_t written;
+        i2s_write(AUDIO_I2S_PORT, out, n * 2 * sizeof(int16_t), &written, portMAX_DELAY);
+        if (!_firstWritten)
+        {
+            _firstWritten = true;
+            startLatency.record(micros() - _cur.req_us);
+        }
+
+        _pcmPos += n;
+        if (_pcmPos >= clip->samples)
+        {
+            _pcmPos = 0;
+            if (++_curIdx >= _cur.n_clips)
+                endCmd(false);
+        }
+    }
+
+    // 文件方式: Audio 库播完一个就接着开下一个 (语音序列退回 /mp3/num/<name>.mp3)
+    void pumpFile()
+    {
+        if (audio.isRunning())
+            return;
+        uint8_t count = _cur.n_clips ? _cur.n_clips : 1;
+        if (_curIdx >= count)
+        {
+            endCmd(false);
+            return;
+        }
+
+        char path[AUDIO_MAX_PATH];
+        if (_cur.n_clips)
+            snprintf(path, sizeof(path), "/mp3/num/%s.mp3", VoiceCache::name(_cur.clips[_curIdx]));
+        else
+            strlcpy(path, _cur.path, sizeof(path));
+        _curIdx++;
+
+        // ❌ 不要在这里 Serial.print，它会严重阻塞 CPU！
+        uint32_t t0 = micros();
+        if (SD_MMC.exists(path))
+        {
+            // ⚡️ 核心优化：直接连接，不打印日志
+            audio.connecttoFS(SD_MMC, path);
+            TRACE_MARK(TRACE_AUDIO_CLIP, _cur.n_clips ? _cur.clips[_curIdx - 1] : 0xFF);
+            mp3OpenTime.record(micros() - t0); // 每个片段前的空档 (开文件 + 解析头)
+            if (!_firstWritten)
+            {
+                _firstWritten = true;
+                startLatency.record(micros() - _cur.req_us);
+            }
+        }
+    }
+
+    // AudioTask 每圈调用一次: 处理停止请求、抢占、取下一条、推进当前指令
+    void service()
+    {
+        if (_stopReq.exchange(false))
+        {
+            for (uint8_t p = 0; p < AUDIO_NUM_PRIO; p++)
+                while (_queues[p].peek())
+                    _queues[p].pop();
+            if (_curActive)
+                endCmd(true);
+        }
+
+        // 和正在播放的完全相同的指令 (比如连续触发的提示音) 直接丢掉
+        if (_curActive)
+        {
+            SpscQueue<AudioCmd, AUDIO_QUEUE_LEN> &q = _queues[_cur.prio];
+            const AudioCmd *c;
+            while ((c = q.peek()) != NULL && c->sameAs(_cur))
+            {
+                q.pop();
+                _coalesced++;
+            }
+        }
+
+        int8_t top = topPending();
+        if (_curActive && top > (int8_t)_cur.prio)
+        {
+            endCmd(true);
+            _preempted++;
+        }
+
+        if (!_curActive && top >= 0)
+        {
+            AudioCmd next;
+            if (takeNext(top, next))
+                startCmd(next);
+        }
+
+        if (_curActive)
+        {
+            if (_curPcm)
+                pumpPcm();
+            else
+                pumpFile();
+        }
+
+        isPlaying = _curActive || audio.isRunning() || topPending() >= 0;
+    }
+
     // ---------------------------------------------------------
     // 🧵 独立音频任务 (运行在 Core 0) - 极速版
     // ---------------------------------------------------------
@@ -89,62 +319,41 @@ private:
             // 1. 核心循环：驱动音频库
             driver->audio.loop();
 
-            // 2. 队列管理逻辑
-            // 只有当音乐停止时，才去检查队列
-            if (!driver->audio.isRunning())
-            {
-                // 尝试获取锁 (不等待，能拿就拿，拿不到下一圈再试，保证 loop 不卡顿)
-                if (xSemaphoreTake(driver->_mutex, 0) == pdTRUE)
-                {
-                    if (!driver->_playlist.empty())
-                    {
-                        // 取出第一首
-                        String nextFile = driver->_playlist.front();
-                        driver->_playlist.erase(driver->_playlist.begin());
-
-                        // ❌ 删除这里的 Serial.print，它会严重阻塞 CPU！
-
-                        if (SD_MMC.exists(nextFile))
-                        {
-                            // ⚡️ 核心优化：直接连接，不打印日志
-                            driver->audio.connecttoFS(SD_MMC, nextFile.c_str());
-                            driver->isPlaying = true;
-                        }
-                    }
-                    else
-                    {
-                        driver->isPlaying = false;
-                    }
-
-                    xSemaphoreGive(driver->_mutex);
-                }
+            // 2. 队列管理 + PCM 写入
+            driver->service();
 
-                // 空闲状态：没有在播放，也没歌了，可以休息久一点省电
-                if (!driver->isPlaying)
-                {
-                    vTaskDelay(10);
-                }
+            if (!driver->isPlaying)
+            {
+                // 空闲状态：没有在播放，也没有待播指令，可以休息久一点省电
+                vTaskDelay(10);
             }
             else
             {
                 // ⚡️ 播放状态：全速运行！
-                // 移除 vTaskDelay(1)，给音频库最大的 CPU 时间片
-                // 只有在 ESP32 只有单核时才需要 delay，双核 Core 0 独占时不需要
-                // 这里的 yield 是为了防止看门狗复位，但比 delay 快得多
+                // PCM 播放时 i2s_write 本身会阻塞让出 CPU；文件播放时这里的 yield 防止看门狗复位
                 taskYIELD();
             }
         }
     }
 
+    bool enqueue(AudioCmd &cmd, AudioPriority prio)
+    {
+        cmd.prio = prio;
+        cmd.req_us = micros();
+        if (!_queues[prio].push(cmd))
+            return false;
+        isPlaying = true; // 标记为正在播放状态 (实际上可能还没开始，但在排队了)
+        return true;
+    }
+
 public:
     Audio audio;
-    bool isPlaying = false; // 指示是否有任务正在进行（包括队列中）
+    volatile bool isPlaying = false; // 指示是否有任务正在进行（包括队列中）
 
-    Audio_Driver()
-    {
-        // 创建互斥锁
-        _mutex = xSemaphoreCreateMutex();
-    }
+    // [新增] 播报延迟统计
+    LatencyHistogram startLatency; // 请求 -> 第一块采样写进 I2S (PCM) / 第一个文件打开 (MP3)
+    LatencyHistogram totalTime;    // PCM 报圈: 请求 -> 最后一个片段写完
+    LatencyHistogram mp3OpenTime;  // MP3 播放: 每个文件 exists + connecttoFS 的耗时
 
     void begin()
     {
@@ -169,43 +378,56 @@ public:
             4096,
             this,
             20,
-            NULL,
+            &_task,
             0);
+        taskMon.add("AudioTask", &_task, false);
 
         Serial.println("[Audio] Running on Core 0 (Queue Enabled)");
     }
 
-    // 修改后的 play：只负责加入队列
-    void play(String filename)
+    // [修改] play：拷贝路径进队列就返回，不加锁、不分配内存；队列满返回 false
+    bool play(const char *filename, AudioPriority prio = AUDIO_PRIO_UI)
     {
-        // 获取互斥锁 (无限等待直到获取到锁)
-        xSemaphoreTake(_mutex, portMAX_DELAY);
-
-        // 加入队列
-        _playlist.push_back(filename);
+        AudioCmd cmd;
+        cmd.n_clips = 0;
+        strlcpy(cmd.path, filename, sizeof(cmd.path));
+        return enqueue(cmd, prio);
+    }
 
-        // 标记为正在播放状态 (实际上可能还没开始，但在排队了)
-        isPlaying = true;
+    // 兼容旧的 String 调用
+    bool play(const String &filename, AudioPriority prio = AUDIO_PRIO_UI)
+    {
+        return play(filename.c_str(), prio);
+    }
 
-        // 释放锁
-        xSemaphoreGive(_mutex);
+    // [新增] 播放一串语音片段 (编号见 Voice_Cache.hpp)
+    // 语音缓存里都有时整串拼接成 PCM 直接写 I2S；否则逐个播放 /mp3/num/<name>.mp3
+    bool playClips(const ClipList &clips, AudioPriority prio = AUDIO_PRIO_LAP)
+    {
+        if (clips.n == 0)
+            return false;
+        AudioCmd cmd;
+        cmd.n_clips = clips.n;
+        memcpy(cmd.clips, clips.ids, clips.n);
+        cmd.path[0] = 0;
+        return enqueue(cmd, prio);
     }
 
-    // 兼容旧的 const char* 调用
-    void play(const char *filename)
+    void printStats()
     {
-        play(String(filename));
+        Serial.printf("[AUDIO] voice cache %s\n", voiceCache.isReady() ? "ready" : "not loaded (MP3 fallback)");
+        Serial.printf("[AUDIO] dropped ui=%lu lap=%lu alert=%lu coalesced=%lu preempted=%lu\n",
+                      _queues[AUDIO_PRIO_UI].getDropped(), _queues[AUDIO_PRIO_LAP].getDropped(),
+                      _queues[AUDIO_PRIO_ALERT].getDropped(), _coalesced, _preempted);
+        startLatency.print("voice start");
+        totalTime.print("voice total");
+        mp3OpenTime.print("mp3 open");
     }
 
-    // 紧急停止 (清空队列并停止当前播放)
+    // 紧急停止 (清空队列并停止当前播放)。只置位，由 AudioTask 在下一圈处理
     void stop()
     {
-        xSemaphoreTake(_mutex, portMAX_DELAY);
-        _playlist.clear(); // 清空队列
-        xSemaphoreGive(_mutex);
-
-        audio.stopSong(); // 停止当前
-        isPlaying = false;
+        _stopReq = true;
     }
 
     // 主循环接口 (保留但留空)
@@ -219,6 +441,7 @@ public:
         if (vol > 21)
             vol = 21;
         audio.setVolume(vol);
+        _pcmGainQ15 = (uint32_t)vol * vol * 32767 / (21 * 21); // PCM 片段的软件音量，近似 Audio 库的曲线
         uint8_t chip_vol = ::map(vol, 0, 21, 0, 255);
         writeReg(0x32, chip_vol);
     }
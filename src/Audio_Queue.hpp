@@ -0,0 +1,105 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ==========================================
+// 音频指令队列 (定长、无锁、无堆分配)
+// ==========================================
+// 每个优先级一条 SPSC 环形队列，元素是定长的 AudioCmd (文件路径或语音片段编号序列)。
+// 生产者 play()/playClips() 只拷贝一个结构体、移动 _head，队列满时直接丢弃并计数，从不等待。
+// 消费者是 AudioTask: 总是先取高优先级队列；高优先级指令到达时打断正在播放的低优先级声音。
+// 注意 SPSC: 每条队列只能有一个生产者任务。目前:
+//   ALERT: FusionTask (TrackManager 起跑回调 handleRaceStart 里的起跑提示)
+//   LAP / UI: loop() 所在的任务 (setup 开机音、串口测试指令)
+// 以后从别的任务 (BLE 回调、UiTask) 发声音要另开一个优先级队列。
+
+#define AUDIO_QUEUE_LEN 8   // 每个优先级的队列长度 (2 的幂)
+#define AUDIO_MAX_CLIPS 16  // 一条语音最多的片段数 (报圈最长约 10 个)
+#define AUDIO_MAX_PATH 48
+
+enum AudioPriority : uint8_t
+{
+    AUDIO_PRIO_UI = 0, // 开机音、按键音
+    AUDIO_PRIO_LAP,    // 报圈 (新的圈速会顶掉还没播的旧圈速)
+    AUDIO_PRIO_ALERT,  // 起跑等提示，打断一切
+    AUDIO_NUM_PRIO
+};
+
+struct AudioCmd
+{
+    uint32_t req_us;  // 请求时刻 (统计播报延迟)
+    uint8_t prio;
+    uint8_t n_clips;  // > 0: 语音片段序列；0: 播放 path
+    uint8_t clips[AUDIO_MAX_CLIPS];
+    char path[AUDIO_MAX_PATH];
+
+    bool sameAs(const AudioCmd &o) const
+    {
+        if (n_clips != o.n_clips)
+            return false;
+        return n_clips ? memcmp(clips, o.clips, n_clips) == 0 : strcmp(path, o.path) == 0;
+    }
+};
+
+// 报圈时拼语音片段用
+struct ClipList
+{
+    uint8_t ids[AUDIO_MAX_CLIPS];
+    uint8_t n = 0;
+
+    void add(uint8_t id)
+    {
+        if (n < AUDIO_MAX_CLIPS)
+            ids[n++] = id;
+    }
+};
+
+// 定长 SPSC 队列 (与 ByteRing 同样的下标约定: 自由增长的 uint32_t + 掩码)
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+private:
+    T _buf[CAPACITY];
+    std::atomic<uint32_t> _head{0}; // 生产者写入位置
+    std::atomic<uint32_t> _tail{0}; // 消费者读取位置
+    uint32_t _dropped = 0;          // 队列满被丢弃的个数 (生产者维护)
+
+public:
+    // --- 生产者侧 ---
+    bool push(const T &item)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= CAPACITY)
+        {
+            _dropped++;
+            return false;
+        }
+        _buf[head & (CAPACITY - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // --- 消费者侧 ---
+    // 队首元素 (不出队)，空队列返回 NULL
+    const T *peek()
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) == tail)
+            return NULL;
+        return &_buf[tail & (CAPACITY - 1)];
+    }
+
+    void pop()
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) != tail)
+            _tail.store(tail + 1, std::memory_order_release);
+    }
+
+    // --- 状态查询 (任一侧均可调用，结果是瞬时快照) ---
+    size_t size() { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    bool empty() { return size() == 0; }
+    uint32_t getDropped() { return _dropped; }
+};
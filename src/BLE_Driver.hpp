@@ -5,6 +5,9 @@
 #include <NimBLEUtils.h>
 #include <NimBLECharacteristic.h>
 #include <TinyGPS++.h> // 必须引入，用于解析 GPS 对象
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "Hal.hpp"
 
 // ==========================================
 // 1. 模式定义
@@ -80,6 +83,21 @@ class MyServerCallbacks : public NimBLEServerCallbacks
     }
 };
 
+// [新增] notify 结果统计 (协议栈在每次 notify 之后回调)
+static MetricCounter _ble_notifies;
+static MetricCounter _ble_notify_fail;
+
+class TxStatusCallbacks : public NimBLECharacteristicCallbacks
+{
+    void onStatus(NimBLECharacteristic *pCharacteristic, Status s, int code)
+    {
+        if (s == SUCCESS_NOTIFY || s == SUCCESS_INDICATE)
+            _ble_notifies.add();
+        else
+            _ble_notify_fail.add();
+    }
+};
+
 // 接收回调
 class RxCallbacks : public NimBLECharacteristicCallbacks
 {
@@ -125,6 +143,10 @@ public:
         NimBLEDevice::init(deviceName.c_str());
         NimBLEDevice::setMTU(185);
 
+        metrics.addCounter("ble.notify", &_ble_notifies);
+        metrics.addCounter("ble.notify_fail", &_ble_notify_fail);
+        static TxStatusCallbacks txStatus;
+
         pServer = NimBLEDevice::createServer();
         pServer->setCallbacks(new MyServerCallbacks());
 
@@ -133,6 +155,7 @@ public:
             // === 模式 A: 你的 APP (NUS) ===
             pService = pServer->createService(UUID_APP_SERVICE);
             pTxCharacteristic = pService->createCharacteristic(UUID_APP_TX, NIMBLE_PROPERTY::NOTIFY);
+            pTxCharacteristic->setCallbacks(&txStatus);
             pRxCharacteristic = pService->createCharacteristic(UUID_APP_RX, NIMBLE_PROPERTY::WRITE);
             pRxCharacteristic->setCallbacks(new RxCallbacks());
             pService->start();
@@ -155,6 +178,8 @@ public:
             // 0x0004: GPS Time Data (1 Hz)
             pTxTime = pService->createCharacteristic(
                 UUID_RC_TIME, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY);
+            pTxMain->setCallbacks(&txStatus);
+            pTxTime->setCallbacks(&txStatus);
 
             pService->start();
 
@@ -172,6 +197,7 @@ public:
         if (_ble_connected && _currentMode == BLE_MODE_APP)
         {
             pTxCharacteristic->setValue((uint8_t *)text.c_str(), text.length());
+            TRACE_MARK(TRACE_BLE_NOTIFY, text.length());
             pTxCharacteristic->notify();
         }
     }
@@ -179,6 +205,12 @@ public:
     // --- [新增] 发送 RaceChrono 原生二进制数据 ---
     // 替代之前的 sendNMEA / sendRC3
     void sendRaceChronoBinary(TinyGPSPlus &gps)
+    {
+        sendRaceChronoBinary(gps, gps.location.lat(), gps.location.lng(), gps.speed.kmph(), gps.course.deg());
+    }
+
+    // [新增] 位置/速度/航向由调用者给出 (GPS/IMU 融合结果)，时间、卫星数、海拔等仍取自 GPS
+    void sendRaceChronoBinary(TinyGPSPlus &gps, double lat, double lon, float spd, float bearing)
     {
         if (!_ble_connected || _currentMode != BLE_MODE_RACECHRONO)
             return;
@@ -208,8 +240,8 @@ public:
         p.fix_satellites = (1 << 6) | (sats & 0x3F); // Bit 6=1 (GPS Fix)
 
         // Lat / Lon (deg * 1e7)
-        p.latitude = (int32_t)(gps.location.lat() * 10000000.0);
-        p.longitude = (int32_t)(gps.location.lng() * 10000000.0);
+        p.latitude = (int32_t)(lat * 10000000.0);
+        p.longitude = (int32_t)(lon * 10000000.0);
 
         // Altitude (encoded)
         float alt = gps.altitude.meters();
@@ -219,14 +251,13 @@ public:
             p.altitude = ((uint16_t)(alt + 500) & 0x7FFF) | 0x8000;
 
         // Speed (encoded)
-        float spd = gps.speed.kmph();
         if (spd <= 655.35)
             p.speed = (uint16_t)(spd * 100) & 0x7FFF;
         else
             p.speed = ((uint16_t)(spd * 10) & 0x7FFF) | 0x8000;
 
         // Bearing (deg * 100)
-        p.bearing = (uint16_t)(gps.course.deg() * 100);
+        p.bearing = (uint16_t)(bearing * 100);
 
         // DOP
         p.hdop = (uint8_t)(gps.hdop.value() / 10.0); // TinyGPS returns value*100, we need value*10
@@ -234,6 +265,7 @@ public:
 
         // 发送主包
         pTxMain->setValue((uint8_t *)&p, sizeof(p));
+        TRACE_MARK(TRACE_BLE_NOTIFY, sizeof(p));
         pTxMain->notify();
 
         // ==========================================
@@ -252,6 +284,7 @@ public:
         d.date_2 = (d_comb >> 16) & 0xFF;
 
         pTxTime->setValue((uint8_t *)&d, sizeof(d));
+        TRACE_MARK(TRACE_BLE_NOTIFY, sizeof(d));
         pTxTime->notify();
     }
 
@@ -274,4 +307,8 @@ public:
     BLERunMode getMode() { return _currentMode; }
 };
 
-extern BLE_Driver ble;
\ No newline at end of file
+extern BLE_Driver ble;
+
+// [新增] HAL 的 BLE 发送接口 (Hal_Esp32.hpp) 由本驱动实现
+bool HalBleTransport::isConnected() { return ble.isConnected(); }
+void HalBleTransport::send(const char *text) { ble.send(text); }
@@ -0,0 +1,109 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// BNO055 UART 应答解析器 (逐字节状态机)
+// ==========================================
+// 读成功: 0xBB | Len | Data[Len]
+// 错误/写应答: 0xEE | Status   (Status 0x01 = 写成功，其余为错误码)
+// 协议没有校验和，只能靠同步头 + 长度 (必须等于请求的长度) 判断帧边界。
+// 帧外的字节、长度不对的帧都会被丢弃并计一次重同步，解析器从下一个字节重新找同步头。
+
+#define BNO_RESP_READ 0xBB
+#define BNO_RESP_STATUS 0xEE
+#define BNO_STATUS_WRITE_OK 0x01
+#define BNO_MAX_PAYLOAD 32
+
+enum BNOFeedResult
+{
+    BNO_NONE = 0,  // 帧未结束 (或字节被丢弃)
+    BNO_FRAME_OK,  // 一帧读应答接收完毕，数据在 payload()
+    BNO_STATUS     // 收到 0xEE 状态应答，状态码在 status()
+};
+
+class BNOParser
+{
+private:
+    enum State
+    {
+        ST_SYNC,
+        ST_LEN,
+        ST_PAYLOAD,
+        ST_STATUS
+    };
+
+    State _state = ST_SYNC;
+    uint8_t _expectLen = 0; // 期望的读应答长度 (等于读请求的长度)
+    uint8_t _pos = 0;
+    uint8_t _status = 0;
+    uint8_t _payload[BNO_MAX_PAYLOAD];
+
+    uint32_t _frames = 0;
+    uint32_t _resyncs = 0; // 丢弃一段帧外字节或一个坏帧头，计一次
+    bool _hunting = false; // 正在丢弃帧外字节 (连续的垃圾字节只计一次重同步)
+
+    void resync()
+    {
+        if (!_hunting)
+            _resyncs++;
+        _hunting = true;
+        _state = ST_SYNC;
+    }
+
+public:
+    explicit BNOParser(uint8_t expectLen = 0) : _expectLen(expectLen) {}
+
+    void setExpectedLength(uint8_t len) { _expectLen = len; }
+
+    // 丢弃半帧 (请求超时后调用)
+    void reset() { _state = ST_SYNC; }
+
+    BNOFeedResult feed(uint8_t c)
+    {
+        switch (_state)
+        {
+        case ST_SYNC:
+            if (c == BNO_RESP_READ)
+                _state = ST_LEN;
+            else if (c == BNO_RESP_STATUS)
+                _state = ST_STATUS;
+            else
+                resync();
+            return BNO_NONE;
+
+        case ST_LEN:
+            if (c == 0 || c != _expectLen || c > BNO_MAX_PAYLOAD)
+            {
+                // 假同步头：这个字节重新按帧外处理 (它可能就是真正的同步头)
+                resync();
+                return feed(c);
+            }
+            _pos = 0;
+            _state = ST_PAYLOAD;
+            return BNO_NONE;
+
+        case ST_PAYLOAD:
+            _payload[_pos++] = c;
+            if (_pos < _expectLen)
+                return BNO_NONE;
+            _state = ST_SYNC;
+            _hunting = false;
+            _frames++;
+            return BNO_FRAME_OK;
+
+        case ST_STATUS:
+            _state = ST_SYNC;
+            _hunting = false;
+            _status = c;
+            return BNO_STATUS;
+        }
+        _state = ST_SYNC;
+        return BNO_NONE;
+    }
+
+    bool inFrame() { return _state != ST_SYNC; }
+    const uint8_t *payload() { return _payload; }
+    uint8_t status() { return _status; }
+    uint32_t getFrames() { return _frames; }
+    uint32_t getResyncs() { return _resyncs; }
+};
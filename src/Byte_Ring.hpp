@@ -0,0 +1,98 @@
+#pragma once
+#include "Hal.hpp"
+#include <atomic>
+
+// ==========================================
+// 定长无锁单生产者/单消费者 (SPSC) 字节环形缓冲
+// ==========================================
+// - 容量必须是 2 的幂，下标用自由增长的 uint32_t，取模靠掩码
+// - 生产者写 _head，消费者写 _tail，无需互斥锁
+// - 消费者通过 readableSpan() 直接拿到连续内存的指针，不做任何拷贝
+// - [修改] 满了之后覆盖最旧的数据 (与原来 String 缓冲一样始终保留最近的一段)，覆盖的字节数计入 getDropped()。
+//   覆盖时生产者把 _tail 往前推；消费者 consume() 时发现 _tail 被推过，说明刚读的那段可能已被改写，返回 false
+template <size_t CAPACITY>
+class ByteRing
+{
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "ByteRing capacity must be a power of 2");
+
+private:
+    uint8_t _buf[CAPACITY];
+    std::atomic<uint32_t> _head{0};    // 生产者写入位置
+    std::atomic<uint32_t> _tail{0};    // 最旧的未读字节 (消费者读完推进，生产者覆盖时也推进)
+    std::atomic<uint32_t> _dropped{0}; // 未被读走就被覆盖的字节数
+    uint32_t _spanTail = 0;            // 消费者: 上次 readableSpan() 时的读指针
+
+public:
+    // --- 生产者侧 ---
+
+    // 写入一段数据 (总是全部写入，必要时覆盖最旧的数据)，返回 len
+    size_t write(const uint8_t *data, size_t len)
+    {
+        size_t total = len;
+        if (len > CAPACITY)
+        {
+            // 比整个缓冲还长：只有最后 CAPACITY 字节能留下
+            _dropped.fetch_add(len - CAPACITY, std::memory_order_relaxed);
+            data += len - CAPACITY;
+            len = CAPACITY;
+        }
+
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        // 空间不够时先把读指针推过将被覆盖的部分 (消费者可能同时在推进，用 CAS)
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        while (head + len - tail > CAPACITY)
+        {
+            uint32_t newTail = head + len - CAPACITY;
+            if (_tail.compare_exchange_weak(tail, newTail, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                _dropped.fetch_add(newTail - tail, std::memory_order_relaxed);
+                break;
+            }
+        }
+
+        // 最多分两段拷贝 (绕回到数组开头)
+        size_t idx = head & (CAPACITY - 1);
+        size_t first = CAPACITY - idx;
+        if (first > len)
+            first = len;
+        memcpy(_buf + idx, data, first);
+        memcpy(_buf, data + first, len - first);
+
+        _head.store(head + len, std::memory_order_release);
+        return total;
+    }
+
+    bool push(uint8_t c) { return write(&c, 1) == 1; }
+
+    // --- 消费者侧 ---
+
+    // 返回从读指针开始的一段连续可读内存 (不拷贝)
+    // 数据绕回时只返回到数组末尾的那一段，consume() 之后再调用即可拿到剩下的
+    size_t readableSpan(const uint8_t **ptr)
+    {
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        uint32_t head = _head.load(std::memory_order_acquire);
+        _spanTail = tail;
+        size_t used = head - tail;
+        size_t idx = tail & (CAPACITY - 1);
+        size_t contiguous = CAPACITY - idx;
+        *ptr = _buf + idx;
+        return (used < contiguous) ? used : contiguous;
+    }
+
+    // 标记上次 readableSpan() 拿到的前 n 个字节已读完。
+    // 返回 false 表示读的过程中生产者覆盖了这段 (读指针已被推走)，刚读到的数据不可信，重新 readableSpan() 即可
+    bool consume(size_t n)
+    {
+        uint32_t expected = _spanTail;
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (n > head - expected)
+            n = head - expected;
+        return _tail.compare_exchange_strong(expected, expected + n, std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+
+    // --- 状态查询 (任一侧均可调用，结果是瞬时快照) ---
+    size_t available() { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    size_t capacity() { return CAPACITY; }
+    uint32_t getDropped() { return _dropped.load(std::memory_order_relaxed); }
+};
@@ -2,11 +2,16 @@
 #include <Arduino.h>
 #include "System_Config.hpp"
 #include "IMU_Driver.hpp"
+#include "IMU_Calibration.hpp"
 #include "Audio_Driver.hpp"
 #include "BLE_Driver.hpp"
 #include "GPS_Driver.hpp"
 #include "Track_Manager.hpp"
+#include "Cmd_Protocol.hpp"
 #include "APP_UI.hpp" // 确保能访问 ui_ScreenMain
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "Sensor_Task.hpp"
 // 或者如果引用链太复杂，至少要加上这一行：
 extern lv_obj_t *ui_ScreenMain;
 extern lv_obj_t *ui_ScreenMode; // 如果有停止命令，可能需要切回来
@@ -19,7 +24,7 @@ extern bool sd_connected;
 class CommandParser
 {
 public:
-    // 处理接收到的字符串
+    // 处理接收到的字符串 (拆分见 Cmd_Protocol.hpp)
     void parse(String input)
     {
         input.trim(); // 去掉首尾空格和换行
@@ -29,195 +34,212 @@ public:
         Serial.print("[CMD] Recv: ");
         Serial.println(input);
 
-        // 1. 处理 SET 指令 (设置参数)
-        // 格式: SET:VOL=50
-        if (input.startsWith("SET:"))
+        CmdMessage m;
+        if (!cmdParseLine(input.c_str(), m))
+            return;
+
+        switch (m.group)
         {
-            int splitIndex = input.indexOf('=');
-            if (splitIndex == -1)
-                return; // 格式错误
+        case CMD_GROUP_SET:
+            handleSet(m);
+            break;
+        case CMD_GROUP_CMD:
+            handleAction(m);
+            break;
+        case CMD_GROUP_RM:
+            handleRoam(m);
+            break;
+        case CMD_GROUP_TRACK:
+            cmdHandleTrack(m, trackMgr);
+            break;
+        default:
+            break;
+        }
+    }
 
-            String key = input.substring(4, splitIndex);
-            String valStr = input.substring(splitIndex + 1);
-            int val = valStr.toInt(); // 转成数字
+    // 1. 处理 SET 指令 (设置参数)
+    // 格式: SET:VOL=50
+    void handleSet(const CmdMessage &m)
+    {
+        if (!m.hasArg)
+            return; // 格式错误
 
-            if (key == "VOL")
-            {
-                sys_cfg.volume = constrain(val, 0, 21); // 限制范围
-                audioDriver.setVolume(sys_cfg.volume);
-                ble.send("OK:VOL=" + String(sys_cfg.volume));
-            }
-            else if (key == "SWAP")
-            {
-                sys_cfg.imu_swap_axis = (val == 1);
-                imu.applyConfig(); // 立即生效
-                ble.send("OK:SWAP=" + String(val));
-            }
-            else if (key == "INV_X")
-            {
-                sys_cfg.imu_invert_x = (val == 1);
-                imu.applyConfig();
-                ble.send("OK:INV_X=" + String(val));
-            }
-            else if (key == "INV_Y")
+        String key = m.name;
+        int val = m.argInt(); // 转成数字
+
+        if (key == "VOL")
+        {
+            sys_cfg.volume = constrain(val, 0, 21); // 限制范围
+            audioDriver.setVolume(sys_cfg.volume);
+            ble.send("OK:VOL=" + String(sys_cfg.volume));
+        }
+        else if (key == "SWAP")
+        {
+            sys_cfg.imu_swap_axis = (val == 1);
+            imu.applyConfig(); // 立即生效
+            ble.send("OK:SWAP=" + String(val));
+        }
+        else if (key == "INV_X")
+        {
+            sys_cfg.imu_invert_x = (val == 1);
+            imu.applyConfig();
+            ble.send("OK:INV_X=" + String(val));
+        }
+        else if (key == "INV_Y")
+        {
+            sys_cfg.imu_invert_y = (val == 1);
+            imu.applyConfig();
+            ble.send("OK:INV_Y=" + String(val));
+        }
+        else if (key == "GPS10")
+        {
+            sys_cfg.gps_10hz_mode = (val == 1);
+            ble.send("OK:GPS10=" + String(val));
+            // 注意：GPS设置可能需要重启或发送指令给GPS模块才能生效
+        }
+        else if (key == "UBX")
+        {
+            sys_cfg.gps_ubx_mode = (val == 1);
+            ble.send("OK:UBX=" + String(val));
+            // 注意：需要保存并重启后才会向 GPS 模块发送 NAV-PVT 配置
+        }
+        else if (key == "LOGBIN")
+        {
+            sys_cfg.log_binary = (val == 1);
+            ble.send("OK:LOGBIN=" + String(val));
+            // 下一次开始记录时生效
+        }
+        else if (key == "IMUQUAT")
+        {
+            sys_cfg.imu_quat_mode = (val == 1);
+            imu.applyConfig();
+            ble.send("OK:IMUQUAT=" + String(val));
+        }
+        else if (key == "FUSION")
+        {
+            sys_cfg.fusion_enabled = (val == 1);
+            ble.send("OK:FUSION=" + String(val));
+            // 下一次定位时生效
+        }
+        else
+        {
+            ble.send("ERR:Unknown Key");
+        }
+    }
+
+    // 2. 处理 CMD 指令 (执行动作)
+    // 格式: CMD:SAVE
+    void handleAction(const CmdMessage &m)
+    {
+        if (m.is("SAVE"))
+        {
+            sys_cfg.save();
+            ble.send("OK:SAVED");
+        }
+        else if (m.is("CAL"))
+        {
+            // [修改] 启动非阻塞校准，进度 (MSG:CAL=xx%) 和结果 (OK:CAL_DONE / ERR:CAL_MOVING)
+            // 由 imuCal.poll() 异步发回
+            imuCal.start(true);
+        }
+        else if (m.is("SYNC"))
+        {
+            // 手机刚连上时，把所有当前状态发给手机，以便同步 UI
+            reportStatus();
+        }
+        else if (m.is("REPORT"))
+        {
+            reportHardwareStatus();
+        }
+        else if (m.is("TRACE"))
+        {
+            // [新增] 导出事件追踪: TRACE:START、若干行 TRC:<hex>、TRACE:END (格式见 Trace.hpp)
+            ble.stopHealthPack();
+            ble.send("TRACE:START");
+            delay(20);
+            tracer.dump([](const char *line)
+                        { ble.send(line);
+                          delay(10); });
+            ble.send("TRACE:END");
+            ble.startHealthPack();
+        }
+        else if (m.is("STATS"))
+        {
+            // [新增] 运行指标: STATS:START、每项一行 STAT:<name>=...、STATS:END (格式见 Metrics.hpp)
+            char line[128];
+            ble.stopHealthPack();
+            ble.send("STATS:START");
+            delay(20);
+            for (uint8_t i = 0; i < metrics.count(); i++)
             {
-                sys_cfg.imu_invert_y = (val == 1);
-                imu.applyConfig();
-                ble.send("OK:INV_Y=" + String(val));
+                metrics.format(i, line, sizeof(line));
+                ble.send(String("STAT:") + line);
+                delay(10);
             }
-            else if (key == "GPS10")
+            ble.send("STATS:END");
+            ble.startHealthPack();
+        }
+        else if (m.is("DEMO") && m.hasArg)
+        {
+            // [新增] 演示模式: CMD:DEMO=/session/xxx.rtl 按日志时间回放 (代替 GPS/IMU 输入)，
+            // 播完发 MSG:DEMO=END；CMD:DEMO=STOP 提前结束
+            String arg = m.arg;
+            if (arg == "STOP")
             {
-                sys_cfg.gps_10hz_mode = (val == 1);
-                ble.send("OK:GPS10=" + String(val));
-                // 注意：GPS设置可能需要重启或发送指令给GPS模块才能生效
+                sensorTask.stopDemo();
+                ble.send("OK:DEMO=STOP");
             }
+            else if (sensorTask.startDemo(arg.c_str()))
+                ble.send("OK:DEMO=" + arg);
             else
-            {
-                ble.send("ERR:Unknown Key");
-            }
+                ble.send("ERR:DEMO");
         }
+    }
 
-        // 2. 处理 CMD 指令 (执行动作)
-        // 格式: CMD:SAVE
-        else if (input.startsWith("CMD:"))
+    // 3. 漫游记录
+    // 格式: RM:START / RM:STOP
+    void handleRoam(const CmdMessage &m)
+    {
+        if (m.is("START"))
         {
-            String action = input.substring(4);
-
-            if (action == "SAVE")
-            {
-                sys_cfg.save();
-                ble.send("OK:SAVED");
-            }
-            else if (action == "CAL")
+            // 1. 安全检查：如果没有 GPS 定位，是否允许强行开始？
+            // 建议：为了防止录制空数据，检查一下 GPS
+            if (!gps.tgps.location.isValid())
             {
-                // 执行复杂的校准逻辑 (这里简化，实际最好调用 Settings_UI 里的逻辑或封装 IMU 方法)
-                // 这里我们假设我们在 IMU Driver 里加一个 calibrateZero() 方法
-                // 或者简单的触发标志位
-                ble.send("MSG:Calibrating...");
-                // imu.calibrateZero(); // 你需要在 IMU Driver 里实现这个
-                // 目前先模拟
-                delay(1000);
-                ble.send("OK:CAL_DONE");
-            }
-            else if (action == "SYNC")
-            {
-                // 手机刚连上时，把所有当前状态发给手机，以便同步 UI
-                reportStatus();
-            }
-            else if(action == "REPORT"){
-                reportHardwareStatus();
+                ble.send("ERR:GPS_NO_FIX");
+                Serial.println("[CMD] GPS not fixed, aborting.");
+                return;
             }
 
-        }
-        else if (input.startsWith("RM:"))
-        {
-            String cmd = input.substring(3); // 去掉 "RM:"
+            // 2. 修改系统状态
+            sys_cfg.current_mode = MODE_ROAM;
+            sys_cfg.session_start_ms = millis(); // 记录开始时间
+            sys_cfg.is_running = true;           // 这会触发 DataLogger 开始录制
 
-            if (cmd == "START")
+            // 3. [关键] UI 切换到仪表盘
+            // 就像用户点击了屏幕一样，自动跳到主界面
+            if (ui_ScreenMain != NULL)
             {
-                // 1. 安全检查：如果没有 GPS 定位，是否允许强行开始？
-                // 建议：为了防止录制空数据，检查一下 GPS
-                if (!gps.tgps.location.isValid())
-                {
-                    ble.send("ERR:GPS_NO_FIX");
-                    Serial.println("[CMD] GPS not fixed, aborting.");
-                    return;
-                }
-
-                // 2. 修改系统状态
-                sys_cfg.current_mode = MODE_ROAM;
-                sys_cfg.session_start_ms = millis(); // 记录开始时间
-                sys_cfg.is_running = true;           // 这会触发 DataLogger 开始录制
-
-                // 3. [关键] UI 切换到仪表盘
-                // 就像用户点击了屏幕一样，自动跳到主界面
-                if (ui_ScreenMain != NULL)
-                {
-                    lv_scr_load_anim(ui_ScreenMain, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
-                }
-
-                // 4. 回复手机
-                ble.send("OK:RM_STARTED");
+                // [修改] BLE 回调不在 LVGL 任务里，操作 UI 前要加锁
+                uiTask.lock();
+                lv_scr_load_anim(ui_ScreenMain, LV_SCR_LOAD_ANIM_NONE, 0, 0, false);
+                uiTask.unlock();
             }
-            else if (cmd == "STOP")
-            {
-                // 停止录制
-                sys_cfg.is_running = false;
 
-                // 可选：停止后是否要自动切回菜单页？
-                // if (ui_ScreenMode != NULL) {
-                //    lv_scr_load_anim(ui_ScreenMode, LV_SCR_LOAD_ANIM_MOVE_RIGHT, 300, 0, false);
-                // }
-
-                ble.send("OK:RM_STOPPED");
-            }
+            // 4. 回复手机
+            ble.send("OK:RM_STARTED");
         }
-        else if (input.startsWith("TRACK:"))
+        else if (m.is("STOP"))
         {
-            String cmd = input.substring(6); // 去掉 "TRACK:" 前缀
-
-            // 指令 A: 设置赛道参数
-            // 格式: TRACK:SETUP=Type,Radius,StartLat,StartLon,EndLat,EndLon
-            if (cmd.startsWith("SETUP="))
-            {
-                String params = cmd.substring(6); // 去掉 "SETUP="
-
-                // 解析 6 个参数
-                // 使用 double 保证经纬度精度 (float 在 ESP32 上只有 7 位有效数字，不够精确)
-                double p[6] = {0};
-                int pIndex = 0;
-                int lastIndex = 0;
-
-                for (int i = 0; i <= params.length(); i++)
-                {
-                    // 检测逗号或字符串结束
-                    if (i == params.length() || params.charAt(i) == ',')
-                    {
-                        if (pIndex < 6)
-                        {
-                            String val = params.substring(lastIndex, i);
-                            // 注意：ESP32 的 String.toDouble() 精度比 toFloat 高
-                            p[pIndex] = val.toDouble();
-                            pIndex++;
-                        }
-                        lastIndex = i + 1;
-                    }
-                }
-
-                if (pIndex >= 4) // 至少需要 4 个参数 (模式, 半径, 起点Lat, 起点Lon)
-                {
-                    // 强制类型转换
-                    TrackType mode = (TrackType)((int)p[0]);
-                    float radius = (float)p[1];
-                    double sLat = p[2];
-                    double sLon = p[3];
-                    double eLat = p[4];
-                    double eLon = p[5];
-
-                    // 执行设置
-                    trackMgr.setupTrack(mode, radius, sLat, sLon, eLat, eLon);
-
-                    // 回复手机
-                    ble.send("OK:TRACK_UPDATED");
-                }
-                else
-                {
-                    ble.send("ERR:TRACK_ARGS");
-                }
-            }
+            // 停止录制
+            sys_cfg.is_running = false;
 
-            // 指令 B: 重置比赛 (用户手动点“重置”按钮)
-            // 格式: TRACK:RESET
-            else if (cmd == "RESET")
-            {
-                trackMgr.resetSession();
-                ble.send("OK:TRACK_RESET");
-            }
+            // 可选：停止后是否要自动切回菜单页？
+            // if (ui_ScreenMode != NULL) {
+            //    lv_scr_load_anim(ui_ScreenMode, LV_SCR_LOAD_ANIM_MOVE_RIGHT, 300, 0, false);
+            // }
 
-            else
-            {
-                ble.send("ERR:UNKNOWN_TRACK_CMD");
-            }
+            ble.send("OK:RM_STOPPED");
         }
     }
 
@@ -254,7 +276,8 @@ public:
         if (!ble.isConnected() || ble.isTxBusy)
             return;
 
-        // 格式: TLM:速度,卫星,运行状态,模式类型,本圈时间/漫游时间,纬度,经度
+        // 格式: TLM:速度,卫星,运行状态,模式类型,本圈时间/漫游时间,纬度,经度,当前分段,上一分段,上一分段时间,分段差,理论最佳,实时圈差,预测圈速
+        // 分段/圈差相关字段没有数据时为 -1 (时间) / 0 (差值)
         String packet = "TLM:";
         packet += String(gps.getSpeed(), 1); // 速度 (保留1位小数)
         packet += ",";
@@ -303,6 +326,27 @@ public:
         packet += ",";
         packet += String(gps.tgps.location.lng(), 6);
 
+        // --- [新增] 分段计时 (直接读 TrackManager 的缓存值) ---
+        uint32_t lastSecTime = trackMgr.getLastSectorTime();
+        uint32_t tb = trackMgr.getTheoreticalBest();
+        packet += ",";
+        packet += String(trackMgr.getCurrentSector());
+        packet += ",";
+        packet += String(trackMgr.getLastSectorIndex());
+        packet += ",";
+        packet += (lastSecTime == TRACK_NO_TIME) ? String(-1) : String(lastSecTime);
+        packet += ",";
+        packet += String(trackMgr.getLastSectorDelta());
+        packet += ",";
+        packet += (tb == TRACK_NO_TIME) ? String(-1) : String(tb);
+
+        // --- [新增] 与最佳参考圈的实时差值 ---
+        bool hasDelta = trackMgr.hasLiveDelta();
+        packet += ",";
+        packet += hasDelta ? String(trackMgr.getLiveDelta()) : String(0);
+        packet += ",";
+        packet += hasDelta ? String(trackMgr.getPredictedLap()) : String(-1);
+
         ble.send(packet.c_str());
     }
     // 向手机汇报当前所有状态
@@ -330,6 +374,18 @@ public:
         ble.send("GPS10:" + String(sys_cfg.gps_10hz_mode));
         delay(10);
 
+        ble.send("UBX:" + String(sys_cfg.gps_ubx_mode));
+        delay(10);
+
+        ble.send("LOGBIN:" + String(sys_cfg.log_binary));
+        delay(10);
+
+        ble.send("FUSION:" + String(sys_cfg.fusion_enabled));
+        delay(10);
+
+        ble.send("IMUQUAT:" + String(sys_cfg.imu_quat_mode));
+        delay(10);
+
         // 3. 以后这里加几十个都没问题，只是同步时间变长几百毫秒而已
 
         // 4. 结束标志
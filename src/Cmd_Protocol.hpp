@@ -0,0 +1,167 @@
+#pragma once
+#include <ctype.h>
+#include "Hal.hpp"
+#include "Track_Manager.hpp"
+
+// ==========================================
+// APP 文本指令协议 (只依赖 HAL，主机端可测)
+// ==========================================
+// 一行一条指令:  <组>:<名>[=<参数>]
+//   SET:VOL=50            设置参数
+//   CMD:SAVE / CMD:DEMO=/session/x.rtl   执行动作
+//   RM:START / RM:STOP    漫游记录
+//   TRACK:SETUP=...       赛道设置 (处理函数 cmdHandleTrack 也在这里，只依赖 TrackManager)
+// 解析不做任何堆分配；SET/CMD/RM 的执行在 CMD_Parser.hpp (要操作音频、IMU、UI 等设备模块)。
+
+#define CMD_MAX_NAME 24
+#define CMD_MAX_ARG 128
+
+enum CmdGroup : uint8_t
+{
+    CMD_GROUP_NONE = 0, // 空行或未知前缀
+    CMD_GROUP_SET,
+    CMD_GROUP_CMD,
+    CMD_GROUP_RM,
+    CMD_GROUP_TRACK
+};
+
+struct CmdMessage
+{
+    CmdGroup group;
+    char name[CMD_MAX_NAME]; // '=' 之前的部分 (SET 的键 / CMD 的动作 / RM、TRACK 的子命令)
+    char arg[CMD_MAX_ARG];   // '=' 之后的部分，没有 '=' 时为空串
+    bool hasArg;
+
+    bool is(const char *n) const { return strcmp(name, n) == 0; }
+    int argInt() const { return atoi(arg); }
+};
+
+// 去掉首尾空白后拆成 组/名/参数。空行或未知前缀返回 false
+inline bool cmdParseLine(const char *line, CmdMessage &m)
+{
+    static const struct
+    {
+        const char *prefix;
+        CmdGroup group;
+    } groups[] = {{"SET:", CMD_GROUP_SET}, {"CMD:", CMD_GROUP_CMD}, {"RM:", CMD_GROUP_RM}, {"TRACK:", CMD_GROUP_TRACK}};
+
+    m.group = CMD_GROUP_NONE;
+    m.name[0] = m.arg[0] = 0;
+    m.hasArg = false;
+
+    while (*line && isspace((unsigned char)*line))
+        line++;
+    size_t len = strlen(line);
+    while (len > 0 && isspace((unsigned char)line[len - 1]))
+        len--;
+    if (len == 0)
+        return false;
+
+    const char *p = NULL;
+    for (const auto &g : groups)
+    {
+        size_t n = strlen(g.prefix);
+        if (len >= n && strncmp(line, g.prefix, n) == 0)
+        {
+            m.group = g.group;
+            p = line + n;
+            break;
+        }
+    }
+    if (!p)
+        return false;
+
+    const char *end = line + len;
+    const char *eq = (const char *)memchr(p, '=', end - p);
+    const char *nameEnd = eq ? eq : end;
+    size_t n = min((size_t)(nameEnd - p), (size_t)CMD_MAX_NAME - 1);
+    memcpy(m.name, p, n);
+    m.name[n] = 0;
+    if (eq)
+    {
+        size_t a = min((size_t)(end - eq - 1), (size_t)CMD_MAX_ARG - 1);
+        memcpy(m.arg, eq + 1, a);
+        m.arg[a] = 0;
+        m.hasArg = true;
+    }
+    return true;
+}
+
+// 逗号分隔的数字，最多取 maxCount 个 (多出的忽略，空字段按 0)。返回字段数 (不超过 maxCount)
+// 经纬度用 double 解析 (float 只有 7 位有效数字，不够精确)
+inline int cmdParseNumbers(const char *s, double *out, int maxCount)
+{
+    int count = 0;
+    while (count < maxCount)
+    {
+        out[count++] = strtod(s, NULL);
+        const char *comma = strchr(s, ',');
+        if (!comma)
+            break;
+        s = comma + 1;
+    }
+    return count;
+}
+
+// TRACK: 指令 (APP 的赛道页)。回复通过 halBle 发送
+// [修改] 在 BLE 回调里执行，只提交请求，由 FusionTask 在下一轮帧处理之前套用 (见 TrackManager::applyRequests)
+inline void cmdHandleTrack(const CmdMessage &m, TrackManager &trk)
+{
+    char reply[32];
+
+    // 指令 A: 设置赛道参数
+    // 格式: TRACK:SETUP=Type,Radius,StartLat,StartLon,EndLat,EndLon[,StartHeading]
+    // Radius 为计时线半宽 (m)；StartHeading 为起点线通过方向 (度)，省略或 < 0 表示首次过线时自动确定
+    if (m.is("SETUP"))
+    {
+        double p[7] = {0, 0, 0, 0, 0, 0, -1};
+        int n = m.hasArg ? cmdParseNumbers(m.arg, p, 7) : 0;
+        if (n < 4) // 至少需要 4 个参数 (模式, 半径, 起点Lat, 起点Lon)
+        {
+            halBle.send("ERR:TRACK_ARGS");
+            return;
+        }
+        trk.requestSetup((TrackType)((int)p[0]), (float)p[1], p[2], p[3], p[4], p[5], (float)p[6]);
+        halBle.send("OK:TRACK_UPDATED");
+    }
+
+    // 指令 C: 追加分段线 (按行驶顺序逐条发送，须在 SETUP 之后)
+    // 格式: TRACK:SECTOR=Lat,Lon[,Heading]
+    else if (m.is("SECTOR"))
+    {
+        double p[3] = {0, 0, -1};
+        if (!m.hasArg || cmdParseNumbers(m.arg, p, 3) < 2)
+        {
+            halBle.send("ERR:SECTOR_ARGS");
+            return;
+        }
+        int sectors = trk.requestAddSector(p[0], p[1], (float)p[2]);
+        if (sectors > 0)
+        {
+            snprintf(reply, sizeof(reply), "OK:SECTORS=%d", sectors);
+            halBle.send(reply);
+        }
+        else
+            halBle.send("ERR:SECTOR_FULL");
+    }
+
+    // 格式: TRACK:SECTORS_CLEAR
+    else if (m.is("SECTORS_CLEAR"))
+    {
+        trk.requestClearSectors();
+        halBle.send("OK:SECTORS=1");
+    }
+
+    // 指令 B: 重置比赛 (用户手动点“重置”按钮)
+    // 格式: TRACK:RESET
+    else if (m.is("RESET"))
+    {
+        trk.requestReset();
+        halBle.send("OK:TRACK_RESET");
+    }
+
+    else
+    {
+        halBle.send("ERR:UNKNOWN_TRACK_CMD");
+    }
+}
@@ -1,20 +1,49 @@
 #pragma once
 #include <Arduino.h>
-#include "FS.h"
-#include "SD_MMC.h"
 #include "GPS_Driver.hpp"
 #include "IMU_Driver.hpp"
 #include <time.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include "Audio_Driver.hpp"
+#include "System_Config.hpp"
+#include "Log_Format.hpp"
+#include "Log_Writer.hpp"
+#include "Sensor_Task.hpp"
+#include "Task_Monitor.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
 
 extern GPS_Driver gps;
 extern IMU_Driver imu;
 
+// [新增] 二进制日志的块缓冲池：采集侧填满一块就交给写卡任务，写完再还回来
+// (GPS/IMU 两个流各占一块在填，同步时未写满的块还要各复制一份交出去)
+#define LOG_POOL_BLOCKS 8
+#define LOG_FLUSH_MARK 0xFF // 写卡队列里的特殊值：之前的块全部写完后通知 stop()
+#define LOG_SYNC_MARK 0xFE  // 写卡队列里的特殊值：之前的块全部写完后 flush 并更新 journal
+// [修改] IMU 记录从 FusionTask 经队列交给 loop()，块缓冲池只由 loop() 一个任务操作
+#define LOG_IMU_QUEUE_LEN 64 // 100Hz 下可容纳 loop() 卡住 640ms
+
+// [新增] 掉电保护
+#define LOG_SYNC_MS 5000                      // 每 5 秒同步一次 (原来是每写 4KB 就 flush 一次)
+#define LOG_PREALLOC_BYTES (4 * 1024 * 1024)  // 二进制文件按 4MB 一段预分配，写数据时不再改 FAT 表
+
+// 块缓冲池的 FreeRTOS 队列 (RtlBlockBuilder 的 Port)
+struct LogQueuePort
+{
+    QueueHandle_t freeQ = NULL; // 空闲块下标
+    QueueHandle_t fullQ = NULL; // 待写块下标
+
+    bool takeFree(uint8_t &idx) { return xQueueReceive(freeQ, &idx, 0) == pdTRUE; }
+    uint32_t freeCount() { return uxQueueMessagesWaiting(freeQ); }
+    void submit(uint8_t idx) { xQueueSend(fullQ, &idx, portMAX_DELAY); }
+};
+
 class DataLogger
 {
 private:
-    File logFile;
+    HalFile logFile;
     bool isRecording = false;
 
     // --- 缓冲策略 ---
@@ -22,6 +51,25 @@ private:
     char buffer[BUF_SIZE];
     size_t bufOffset = 0;
 
+    // --- [新增] 二进制模式 (Core 0 写卡任务 + 块缓冲池) ---
+    bool binaryMode = false;
+    RtlBlock *pool = NULL;          // LOG_POOL_BLOCKS 个 4KB 块
+    LogQueuePort queues;
+    RtlBlockBuilder<LogQueuePort> blocks;
+    SemaphoreHandle_t flushDone = NULL;
+    TaskHandle_t writerTask = NULL;
+    uint32_t sessionId = 0;
+    uint32_t startMillis = 0;
+    QueueHandle_t imuQ = NULL;      // FusionTask -> loop()，记录的 t_ms 先存帧到达时刻 (绝对 millis)
+    volatile bool acceptImu = false; // start() 最后打开、stop() 最先关闭
+
+    // --- [新增] 掉电保护 ---
+    String filePath;                // 当前 session 文件路径
+    HalFile journalFile;
+    uint32_t allocatedBytes = 0;    // 文件已预分配的长度
+    uint32_t lastSyncMs = 0;
+    volatile uint32_t syncSeq = 0;  // 同步标记对应的已提交块数 (采集侧写，写卡任务读)
+
     // --- 时间同步逻辑 (保持原样) ---
     void syncSystemTime()
     {
@@ -69,8 +117,9 @@ private:
 
     String generateFileName()
     {
+        const char *ext = binaryMode ? "rtl" : "csv";
         if (!gps.tgps.date.isValid())
-            return "/session/session_no_gps.csv";
+            return String("/session/session_no_gps.") + ext;
 
         struct timeval tv;
         gettimeofday(&tv, NULL);
@@ -78,54 +127,214 @@ private:
         struct tm *local = gmtime(&now);
 
         char buf[64];
-        snprintf(buf, sizeof(buf), "/session/session_%04d%02d%02d_%02d%02d.csv",
+        snprintf(buf, sizeof(buf), "/session/session_%04d%02d%02d_%02d%02d.%s",
                  local->tm_year + 1900, local->tm_mon + 1, local->tm_mday,
-                 local->tm_hour, local->tm_min);
+                 local->tm_hour, local->tm_min, ext);
 
         return String(buf);
     }
 
+    // [修改] 只写不 flush，FAT 元数据改为每 LOG_SYNC_MS 同步一次
     void flushBuffer()
     {
         if (!logFile || bufOffset == 0)
             return;
         logFile.write((uint8_t *)buffer, bufOffset);
-        logFile.flush();
+        mBytes.add(bufOffset);
         bufOffset = 0;
     }
 
+    // [修改] 当前 GPS/IMU 值 (CSV 行和二进制记录共用，编码在 Log_Writer.hpp)
+    void readSample(LogSample &s)
+    {
+        s.lat = gps.tgps.location.lat();
+        s.lon = gps.tgps.location.lng();
+        s.alt_m = gps.tgps.altitude.meters();
+        s.speed_kmh = gps.getSpeed();
+        s.sats = gps.getSatellites();
+        s.fix = gps.tgps.location.isValid();
+        s.dateValid = gps.tgps.date.isValid();
+        // 注意：Heading 现在优先使用 IMU 的数据(刷新率高)，如果 IMU 没初始化可以用 GPS 的顶替
+        // 这里默认全部使用 IMU 算出来的数据
+        s.heading = imu.heading;
+        s.roll = imu.roll;
+        s.pitch = imu.pitch;
+        s.lon_g = imu.lon_g;
+        s.lat_g = imu.lat_g;
+    }
+
+    int formatCsvRow(char *line, size_t size)
+    {
+        LogSample s;
+        readSample(s);
+        return logFormatCsv(line, size, getTimestampString().c_str(), s);
+    }
+
+    void fillGpsRecord(RtlGpsRecord &r)
+    {
+        LogSample s;
+        readSample(s);
+        rtlEncodeGps(s, millis() - startMillis, r);
+    }
+
+    // --- [新增] 块缓冲池 ---
+
+    bool initPool()
+    {
+        if (pool)
+            return true;
+        pool = (RtlBlock *)malloc(LOG_POOL_BLOCKS * sizeof(RtlBlock));
+        queues.freeQ = xQueueCreate(LOG_POOL_BLOCKS, sizeof(uint8_t));
+        queues.fullQ = xQueueCreate(LOG_POOL_BLOCKS + 2, sizeof(uint8_t)); // 多留给同步/结束标记
+        flushDone = xSemaphoreCreateBinary();
+        if (!pool || !queues.freeQ || !queues.fullQ || !flushDone)
+        {
+            Serial.println("❌ [LOG] Block pool alloc failed");
+            return false;
+        }
+        for (uint8_t i = 0; i < LOG_POOL_BLOCKS; i++)
+            xQueueSend(queues.freeQ, &i, 0);
+        blocks.begin(pool, &queues);
+
+        // 写卡放在 Core 0，SD 卡的阻塞不会影响 Core 1 上的采集和 UI
+        xTaskCreatePinnedToCore(writerLoop, "LogWriter", 4096, this, 2, &writerTask, 0);
+        taskMon.add("LogWriter", &writerTask, false);
+        return true;
+    }
+
+    static void writerLoop(void *param)
+    {
+        DataLogger *self = (DataLogger *)param;
+        uint8_t idx;
+        while (true)
+        {
+            if (xQueueReceive(self->queues.fullQ, &idx, portMAX_DELAY) != pdTRUE)
+                continue;
+            if (idx == LOG_FLUSH_MARK)
+            {
+                xSemaphoreGive(self->flushDone);
+                continue;
+            }
+            if (idx == LOG_SYNC_MARK)
+            {
+                // 前面的块都已写入：先把数据落盘，再提交 journal
+                TRACE_BEGIN(TRACE_LOG_FLUSH, 0xFFFFFFFF);
+                uint32_t t0 = micros();
+                self->logFile.flush();
+                self->writeJournal(RTL_JOURNAL_OPEN, self->syncSeq);
+                self->flushTime.record(micros() - t0);
+                TRACE_END(TRACE_LOG_FLUSH, 0xFFFFFFFF);
+                continue;
+            }
+            TRACE_BEGIN(TRACE_LOG_FLUSH, self->pool[idx].h.seq);
+            self->mBytes.add(rtlWriteBlock(self->logFile, self->pool[idx], self->allocatedBytes, LOG_PREALLOC_BYTES));
+            TRACE_END(TRACE_LOG_FLUSH, self->pool[idx].h.seq);
+            xQueueSend(self->queues.freeQ, &idx, portMAX_DELAY);
+        }
+    }
+
+    void writeJournal(RtlJournalState state, uint32_t committed)
+    {
+        rtlWriteJournal(journalFile, state, sessionId, committed, filePath.c_str());
+    }
+
+    // 截掉预分配但没用到的部分
+    void truncateFile(const String &path, uint32_t size)
+    {
+        if (!halFs.truncate(path.c_str(), size))
+            Serial.printf("❌ [LOG] truncate %s failed\n", path.c_str());
+    }
+
+    // 定时同步：未写满的块也封口交给写卡任务 (之后的记录开新块)，然后发同步标记。
+    // [修改] 原来是复制一份、原块写满后在同一位置重写，重写时断电会把已提交的块写坏
+    void syncBinary()
+    {
+        blocks.submitAll();
+        syncSeq = blocks.blockCount();
+        uint8_t mark = LOG_SYNC_MARK;
+        xQueueSend(queues.fullQ, &mark, portMAX_DELAY);
+        lastSyncMs = millis();
+    }
+
+    bool writeFileHeader()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return rtlWriteFileHeader(logFile, sessionId, (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+    }
+
 public:
+    // [新增] 运行指标 (诊断页 / CMD:STATS)
+    MetricCounter mBytes;       // 写进日志文件的字节数
+    MetricCounter mImuDrops;    // IMU 队列满 (loop() 跟不上) 丢弃的记录数
+    LatencyHistogram flushTime; // 定时同步 (落盘 + journal) 的耗时
+
+    void begin()
+    {
+        imuQ = xQueueCreate(LOG_IMU_QUEUE_LEN, sizeof(RtlImuRecord));
+        metrics.addCounter("log.bytes", &mBytes, "B");
+        metrics.addCounter("log.imu_drop", &mImuDrops, "");
+        metrics.addHistogram("log.flush", &flushTime);
+    }
+
     bool start()
     {
         if (isRecording)
             return true;
 
         syncSystemTime();
+        binaryMode = sys_cfg.log_binary && initPool();
 
-        if (!SD_MMC.exists("/session"))
+        if (!halFs.exists("/session"))
         {
-            SD_MMC.mkdir("/session");
+            halFs.mkdir("/session");
         }
 
         String fileName = generateFileName();
         Serial.printf("Creating Log: %s\n", fileName.c_str());
+        filePath = fileName;
+        lastSyncMs = millis();
 
-        logFile = SD_MMC.open(fileName, FILE_WRITE);
+        logFile = halFs.open(fileName.c_str(), FILE_WRITE);
         if (!logFile)
         {
             Serial.println("❌ Failed to create file!");
             return false;
         }
 
-        isRecording = true;
         bufOffset = 0;
 
+        if (binaryMode)
+        {
+            // [新增] 二进制模式：文件头占第 0 块，之后的数据块由写卡任务写入
+            sessionId = esp_random();
+            blocks.reset(sessionId);
+            startMillis = millis();
+            allocatedBytes = 0;
+            if (!writeFileHeader())
+            {
+                Serial.println("❌ Failed to write log header!");
+                logFile.close();
+                return false;
+            }
+
+            // [新增] 提交记录：从这里开始，掉电后开机可以恢复
+            journalFile = halFs.open(RTL_JOURNAL_PATH, FILE_WRITE);
+            writeJournal(RTL_JOURNAL_OPEN, 0);
+
+            // [修改] 状态全部就绪后才开始接收记录 (IMU 记录来自另一个任务)
+            isRecording = true;
+            acceptImu = true;
+            return true;
+        }
+
         // [修改] 表头：
         // 1. 保留了前面的 GPS 数据 (Time, Lat, Lon, Alt, Speed, Sats, Fix)
         // 2. 删除了原来的 Acc_X, Acc_Y, Acc_Z, Gyro...
         // 3. 替换为你要求的 5 个值: Heading, Roll, Pitch, Lon_G, Lat_G
         logFile.println("Time,Lat,Lon,Alt,Speed_kmh,Sats,Fix,Heading,Roll,Pitch,Lon_G,Lat_G");
 
+        isRecording = true;
         return true;
     }
 
@@ -134,28 +343,18 @@ public:
         if (!isRecording)
             return;
 
-        char line[256];
+        if (binaryMode)
+        {
+            RtlGpsRecord r;
+            fillGpsRecord(r);
+            blocks.append(RTL_BLOCK_GPS, &r, sizeof(r));
+            if (millis() - lastSyncMs >= LOG_SYNC_MS)
+                syncBinary();
+            return;
+        }
 
-        // [修改] 数据填充：
-        // 注意：Heading 现在优先使用 IMU 的数据(刷新率高)，如果 IMU 没初始化可以用 GPS 的顶替
-        // 这里默认全部使用 IMU 算出来的数据
-        int len = snprintf(line, sizeof(line),
-                           "%s,%.8f,%.8f,%.2f,%.2f,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f\n",
-                           getTimestampString().c_str(),        // 1. Time
-                           gps.tgps.location.lat(),             // 2. Lat
-                           gps.tgps.location.lng(),             // 3. Lon
-                           gps.tgps.altitude.meters(),          // 4. Alt
-                           gps.getSpeed(),                      // 5. Speed
-                           gps.getSatellites(),                 // 6. Sats
-                           gps.tgps.location.isValid() ? 1 : 0, // 7. Fix
-
-                           // --- 这里开始是你要求的 5 个新参数 ---
-                           imu.heading, // 8. Heading (来自 IMU)
-                           imu.roll,    // 9. Roll
-                           imu.pitch,   // 10. Pitch
-                           imu.lon_g,   // 11. Lon_G (纵向 G)
-                           imu.lat_g    // 12. Lat_G (横向 G)
-        );
+        char line[256];
+        int len = formatCsvRow(line, sizeof(line));
 
         if (bufOffset + len >= BUF_SIZE)
         {
@@ -164,19 +363,124 @@ public:
 
         memcpy(buffer + bufOffset, line, len);
         bufOffset += len;
+
+        // [新增] CSV 模式也改为定时同步
+        if (millis() - lastSyncMs >= LOG_SYNC_MS)
+        {
+            uint32_t t0 = micros();
+            flushBuffer();
+            logFile.flush();
+            flushTime.record(micros() - t0);
+            lastSyncMs = millis();
+        }
     }
 
     void stop()
     {
         if (!isRecording)
             return;
-        flushBuffer();
-        logFile.close();
+        if (binaryMode)
+        {
+            // [修改] 先停止接收 IMU 记录，把队列里剩下的记完
+            acceptImu = false;
+            pollImu();
+
+            // 交出未满的块，等写卡任务把队列里的块全部写完再关文件
+            blocks.submitAll();
+            uint8_t mark = LOG_FLUSH_MARK;
+            xQueueSend(queues.fullQ, &mark, portMAX_DELAY);
+            xSemaphoreTake(flushDone, portMAX_DELAY);
+            if (blocks.getDropped())
+                Serial.printf("[LOG] %lu records dropped (SD too slow)\n", blocks.getDropped());
+
+            // 关闭后截掉预分配的尾巴，最后再把 journal 标记为已关闭
+            logFile.close();
+            truncateFile(filePath, (blocks.blockCount() + 1) * RTL_BLOCK_SIZE);
+            writeJournal(RTL_JOURNAL_CLOSED, blocks.blockCount());
+            journalFile.close();
+        }
+        else
+        {
+            flushBuffer();
+            logFile.close();
+        }
         isRecording = false;
         Serial.println("Log Saved & Closed.");
     }
 
+    // [新增] 开机恢复：上一个二进制 session 没有正常关闭 (掉电) 时，
+    // 从提交点往后扫描仍然有效的块，截掉预分配的尾巴和写了一半的块
+    void recover()
+    {
+        // [修改] 扫描/截断/改写 journal 移到 Log_Writer.hpp (主机端有断电注入测试)
+        RtlJournal j;
+        uint32_t valid;
+        if (!rtlRecoverSession(RTL_JOURNAL_PATH, j, valid))
+            return;
+        Serial.printf("[LOG] Recovered %s: %lu blocks (committed %lu)\n", j.path, valid, j.committedBlocks);
+    }
+
+    // [新增] 100Hz IMU 原始帧 (仅二进制模式；CSV 仍然只有 10Hz 主记录)
+    // [修改] 在 FusionTask 里调用：只编码入队，不碰块缓冲池，由 loop() 里的 pollImu() 写进块
+    void logImu(const SensorFrame &f)
+    {
+        if (!acceptImu)
+            return;
+        RtlImuRecord r;
+        rtlEncodeImu(f.arrival_ms, f.lat_g_raw, f.lon_g_raw, f.vert_g, f.roll, f.pitch, r);
+        if (xQueueSend(imuQ, &r, 0) != pdTRUE)
+            mImuDrops.add(1);
+    }
+
+    // [新增] 在 loop() 里调用 (与 log() / start() / stop() 同一任务)：把排队的 IMU 记录写进块
+    void pollImu()
+    {
+        if (!imuQ)
+            return;
+        RtlImuRecord r;
+        while (xQueueReceive(imuQ, &r, 0) == pdTRUE)
+        {
+            if (!isRecording || !binaryMode)
+                continue; // 上一个 session 结束时残留的
+            // 帧到达早于 start() 的 (入队时 start() 还没完成) 丢掉，避免 t_ms 下溢
+            int32_t t = (int32_t)(r.t_ms - startMillis);
+            if (t < 0)
+                continue;
+            r.t_ms = (uint32_t)t;
+            blocks.append(RTL_BLOCK_IMU, &r, sizeof(r));
+        }
+    }
+
     bool isActive() { return isRecording; }
+    uint32_t getDroppedRecords() { return blocks.getDropped(); }
+
+    // [新增] 单行编码耗时和数据量对比 (不写卡)
+    void benchmark(uint32_t n)
+    {
+        char line[256];
+        RtlGpsRecord r;
+        uint32_t csvBytes = 0;
+
+        uint32_t t0 = micros();
+        for (uint32_t i = 0; i < n; i++)
+            csvBytes += formatCsvRow(line, sizeof(line));
+        uint32_t csvUs = micros() - t0;
+
+        t0 = micros();
+        for (uint32_t i = 0; i < n; i++)
+            fillGpsRecord(r);
+        uint32_t binUs = micros() - t0;
+
+        // 二进制每块只能放下整数条记录，再加块头，按实际占用折算
+        const uint32_t perBlock = RTL_BLOCK_PAYLOAD / sizeof(RtlGpsRecord);
+        float binBytesPerRow = (float)RTL_BLOCK_SIZE / perBlock;
+        float csvBytesPerRow = (float)csvBytes / n;
+
+        Serial.printf("[LOG] CSV: %.2f us/row, %.1f B/row, %.2f MB/h @10Hz\n",
+                      (float)csvUs / n, csvBytesPerRow, csvBytesPerRow * 36000 / 1e6);
+        Serial.printf("[LOG] BIN: %.2f us/row, %.1f B/row, %.2f MB/h @10Hz\n",
+                      (float)binUs / n, binBytesPerRow, binBytesPerRow * 36000 / 1e6);
+    }
 };
 
 DataLogger logger;
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <lvgl.h>
+#include "Metrics.hpp"
+
+// ==========================================
+// 诊断页 (主页上滑进入，左右滑返回)
+// ==========================================
+// 逐行显示 metrics 里登记的全部指标: 左栏名称，右栏数值 (计数器带每秒增量)。
+// 只在本页显示时开 500ms 刷新定时器，离开时删除。
+
+extern void screen_gesture_event_cb(lv_event_t *e);
+
+#define DIAG_REFRESH_MS 500
+
+lv_obj_t *ui_ScreenDiag = NULL;
+lv_obj_t *ui_LblDiagNames = NULL;
+lv_obj_t *ui_LblDiagValues = NULL;
+lv_timer_t *timer_diag_refresh = NULL;
+
+void diag_timer_cb(lv_timer_t *timer)
+{
+    if (lv_scr_act() != ui_ScreenDiag)
+        return;
+
+    static char names[METRICS_MAX * 20];
+    static char values[METRICS_MAX * 32];
+    size_t n1 = 0, n2 = 0;
+    names[0] = values[0] = 0;
+    for (uint8_t i = 0; i < metrics.count(); i++)
+    {
+        char v[32];
+        metrics.formatValue(i, v, sizeof(v));
+        n1 += snprintf(names + n1, sizeof(names) - n1, i ? "\n%s" : "%s", metrics.name(i));
+        n2 += snprintf(values + n2, sizeof(values) - n2, i ? "\n%s" : "%s", v);
+        if (n1 >= sizeof(names) || n2 >= sizeof(values))
+            break;
+    }
+    lv_label_set_text(ui_LblDiagNames, names);
+    lv_label_set_text(ui_LblDiagValues, values);
+}
+
+void build_diag_page()
+{
+    if (ui_ScreenDiag)
+    {
+        if (!timer_diag_refresh)
+            timer_diag_refresh = lv_timer_create(diag_timer_cb, DIAG_REFRESH_MS, NULL);
+        return;
+    }
+
+    ui_ScreenDiag = lv_obj_create(NULL);
+    lv_obj_set_style_bg_color(ui_ScreenDiag, lv_color_hex(0x000000), LV_PART_MAIN);
+    lv_obj_clear_flag(ui_ScreenDiag, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(ui_ScreenDiag, screen_gesture_event_cb, LV_EVENT_GESTURE, NULL);
+
+    // 标题
+    lv_obj_t *title = lv_label_create(ui_ScreenDiag);
+    lv_label_set_text(title, "DIAGNOSTICS");
+    lv_obj_set_style_text_font(title, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_set_style_text_color(title, lv_color_hex(0x00AEEF), LV_PART_MAIN);
+    lv_obj_set_style_text_letter_space(title, 2, LV_PART_MAIN);
+    lv_obj_align(title, LV_ALIGN_TOP_MID, 0, 4);
+
+    // 列表区 (指标多于一屏时上下滚动)
+    lv_obj_t *list = lv_obj_create(ui_ScreenDiag);
+    lv_obj_set_size(list, 320, 214);
+    lv_obj_align(list, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_bg_opa(list, 0, LV_PART_MAIN);
+    lv_obj_set_style_border_width(list, 0, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(list, 6, LV_PART_MAIN);
+    lv_obj_set_scroll_dir(list, LV_DIR_VER);
+    lv_obj_set_scrollbar_mode(list, LV_SCROLLBAR_MODE_OFF);
+
+    ui_LblDiagNames = lv_label_create(list);
+    lv_obj_set_style_text_font(ui_LblDiagNames, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_set_style_text_color(ui_LblDiagNames, lv_color_hex(0x888888), LV_PART_MAIN);
+    lv_obj_align(ui_LblDiagNames, LV_ALIGN_TOP_LEFT, 0, 0);
+
+    ui_LblDiagValues = lv_label_create(list);
+    lv_obj_set_style_text_font(ui_LblDiagValues, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_set_style_text_color(ui_LblDiagValues, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+    lv_obj_set_style_text_align(ui_LblDiagValues, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
+    lv_obj_align(ui_LblDiagValues, LV_ALIGN_TOP_RIGHT, 0, 0);
+
+    lv_label_set_text(ui_LblDiagNames, "");
+    lv_label_set_text(ui_LblDiagValues, "");
+    timer_diag_refresh = lv_timer_create(diag_timer_cb, DIAG_REFRESH_MS, NULL);
+}
@@ -1,5 +1,12 @@
 #pragma once
-#include <Arduino.h>
+#include "Hal.hpp"
+
+// [新增] 状态切换日志。主机端 bench / 回放一次要跑成千上万次起步，默认不打印 (编译时定义 DRAG_LOG_ENABLE 打开)
+#if defined(HAL_NATIVE) && !defined(DRAG_LOG_ENABLE)
+#define DRAG_LOG(...) ((void)0)
+#else
+#define DRAG_LOG(...) Serial.printf(__VA_ARGS__)
+#endif
 
 // 状态定义
 enum DragState
@@ -10,6 +17,16 @@ enum DragState
     DRAG_FINISHED // 完成 (显示成绩)
 };
 
+// [新增] 触发阈值 (原来是类里写死的常量)，回放日志调参时可以整体替换
+struct DragTuning
+{
+    float stopKmh = 1.5;     // 低于 1.5km/h 认为静止
+    uint32_t readyMs = 2000; // 连续静止这么久才进入 READY
+    float triggerG = 0.15;   // 纵向 G 值触发阈值 (0.15G 意味着明显的推背感)
+    float triggerKmh = 5.0;  // GPS 速度备用触发阈值
+    float targetKmh = 100.0; // 目标速度
+};
+
 class DragRaceManager
 {
 private:
@@ -20,10 +37,7 @@ private:
     float _resultTime = 0.0; // 秒
 
     // 配置参数
-    const float SPEED_STOP_THRESHOLD = 1.5;    // 低于 1.5km/h 认为静止
-    const float G_TRIGGER_THRESHOLD = 0.15;    // 纵向 G 值触发阈值 (0.15G 意味着明显的推背感)
-    const float SPEED_TRIGGER_THRESHOLD = 5.0; // GPS 速度备用触发阈值
-    const float TARGET_SPEED = 100.0;          // 目标速度
+    DragTuning _cfg;
 
     // 防抖变量
     uint32_t _stopSince = 0; // 记录停下来的时刻
@@ -43,18 +57,18 @@ public:
         case DRAG_IDLE:
         case DRAG_READY:
             // 检测是否静止 (速度 < 1.5 且 G 值波动不大)
-            if (gpsSpeed < SPEED_STOP_THRESHOLD)
+            if (gpsSpeed < _cfg.stopKmh)
             {
                 if (_stopSince == 0)
-                    _stopSince = millis();
+                    _stopSince = halClock.millis();
 
                 // 连续静止 2 秒以上，才进入 READY 状态 (防止急刹车未停稳就重置)
-                if (millis() - _stopSince > 2000)
+                if (halClock.millis() - _stopSince > _cfg.readyMs)
                 {
                     if (_state != DRAG_READY)
                     {
                         _state = DRAG_READY;
-                        Serial.println("[DRAG] READY TO LAUNCH!");
+                        DRAG_LOG("[DRAG] READY TO LAUNCH!\n");
                     }
                 }
             }
@@ -75,22 +89,21 @@ public:
         // --- 2. RUNNING 状态：计时 & 测速 ---
         case DRAG_RUNNING:
             // A. 提前终止检查：如果起步后速度反而降到 0 (比如误触发)，重置
-            if (gpsSpeed < 1.0 && (millis() - _startTime > 2000))
+            if (gpsSpeed < 1.0 && (halClock.millis() - _startTime > 2000))
             {
                 _state = DRAG_IDLE;
-                Serial.println("[DRAG] False Start detected. Reset.");
+                DRAG_LOG("[DRAG] False Start detected. Reset.\n");
                 return;
             }
 
             // B. 完成检查：破百！
-            if (gpsSpeed >= TARGET_SPEED)
+            if (gpsSpeed >= _cfg.targetKmh)
             {
-                _endTime = millis();
+                _endTime = halClock.millis();
                 _resultTime = (_endTime - _startTime) / 1000.0;
                 _state = DRAG_FINISHED;
 
-                Serial.print("[DRAG] FINISH! Time: ");
-                Serial.println(_resultTime);
+                DRAG_LOG("[DRAG] FINISH! Time: %.2f\n", _resultTime);
             }
             break;
 
@@ -101,7 +114,7 @@ public:
             {
                 _state = DRAG_IDLE;
                 _resultTime = 0;
-                Serial.println("[DRAG] Resetting for next run...");
+                DRAG_LOG("[DRAG] Resetting for next run...\n");
             }
             break;
         }
@@ -114,29 +127,32 @@ public:
 
         // 判定 1: G 值突变 (最准)
         // 只有当速度很低时，才允许 G 值触发，防止行驶中误触
-        if (gForce > G_TRIGGER_THRESHOLD)
+        if (gForce > _cfg.triggerG)
         {
             triggered = true;
-            Serial.printf("[DRAG] Triggered by G-Force: %.2f G\n", gForce);
+            DRAG_LOG("[DRAG] Triggered by G-Force: %.2f G\n", gForce);
         }
 
         // 判定 2: GPS 速度突变 (备用，防止 G 值传感器故障或起步太肉)
         // 如果 G 值没触发，但速度已经 5km/h 了，说明已经跑起来了
-        else if (speed > SPEED_TRIGGER_THRESHOLD)
+        else if (speed > _cfg.triggerKmh)
         {
             triggered = true;
-            Serial.printf("[DRAG] Triggered by GPS: %.1f km/h\n", speed);
+            DRAG_LOG("[DRAG] Triggered by GPS: %.1f km/h\n", speed);
             // 补偿机制：如果是 GPS 触发的，说明已经晚了，扣除 200ms (经验值)
             // _startTime -= 200;
         }
 
         if (triggered)
         {
-            _startTime = millis();
+            _startTime = halClock.millis();
             _state = DRAG_RUNNING;
         }
     }
 
+    void setTuning(const DragTuning &cfg) { _cfg = cfg; }
+    const DragTuning &getTuning() { return _cfg; }
+
     // --- Getters 用于 UI 显示 ---
 
     DragState getState() { return _state; }
@@ -148,7 +164,7 @@ public:
             return 0.0;
         if (_state == DRAG_FINISHED)
             return _resultTime;
-        return (millis() - _startTime) / 1000.0;
+        return (halClock.millis() - _startTime) / 1000.0;
     }
 
     // 获取最终成绩
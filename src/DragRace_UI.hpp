@@ -5,6 +5,8 @@
 #include "GPS_Driver.hpp"
 #include "IMU_Driver.hpp"
 #include "DragRace_Manager.hpp"
+#include "Fusion_Estimator.hpp"
+#include "Telemetry.hpp"
 
 // 引用外部
 extern void screen_gesture_event_cb(lv_event_t *e);
@@ -49,10 +51,13 @@ void drag_timer_cb(lv_timer_t *timer)
         return;
 
     // 1. 获取数据
-    float spd = gps.getSpeed();
+    // [修改] 速度优先用融合结果 (100Hz)，没有 IMU 时就是原始 GPS 速度 (都从遥测快照读)
+    TelemetrySnapshot t;
+    telemetry.read(t);
+    float spd = t.speed_kmh;
     if (spd < 0)
         spd = 0;
-    float g_val = imu.lon_g;
+    float g_val = t.lon_g;
 
     dragMgr.update(spd, g_val);
     DragState state = dragMgr.getState();
@@ -0,0 +1,294 @@
+#pragma once
+#include "Hal.hpp"
+#include "Sensor_Frame.hpp"
+#include "Track_Manager.hpp"
+
+// ==========================================
+// GPS / IMU 融合 (互补滤波)
+// ==========================================
+// GPS 只有 10Hz，IMU 有 100Hz。两次定位之间用 IMU 推算:
+//   航向 = IMU 航向 - 航向偏差 (IMU 安装角 + 磁航向误差，每次定位时用 GPS 航向慢慢修正)
+//   速度 += (纵向 G - 零偏) * g * dt
+//   位置 += 速度 * dt * (sin 航向, cos 航向)     (局部平面坐标，东 x / 北 y)
+// 每次定位时把推算值往 GPS 拉回一部分 (固定增益)，速度误差同时用来估计纵向 G 的零偏。
+// 状态只有几个 float，每次更新是固定的几十次浮点运算，不分配内存。
+// 没有 IMU 数据、GPS 超时或者关闭了融合时，输出直接退回原始 GPS。
+// [修改] 只依赖 HAL (主机端有合成数据测试和日志回放)；融合开关由 FusionTask 从 sys_cfg 同步 (setEnabled)。
+
+#define FUSION_GRAVITY 9.80665f
+#define FUSION_IMU_MAX_DT_US 100000  // 两帧 IMU 间隔超过 100ms 不做积分 (只重新对时)
+#define FUSION_IMU_TIMEOUT_MS 200    // 这么久没有 IMU 帧就认为 IMU 不可用，退回 GPS
+#define FUSION_GPS_TIMEOUT_MS 1000   // 丢星后最多推算 1 秒
+#define FUSION_MAX_LEAD_MS 200       // GPS 定位时刻到当前状态时刻的最大补偿
+#define FUSION_K_POS 0.5f            // 每次定位的位置修正比例
+#define FUSION_K_VEL 0.5f            // 每次定位的速度修正比例
+#define FUSION_K_BIAS 0.05f          // 纵向 G 零偏修正增益
+#define FUSION_K_HEADING 0.05f       // 航向偏差修正增益
+#define FUSION_MAX_BIAS_G 0.2f
+#define FUSION_MIN_HEADING_KMH 10.0f // 低于此速度 GPS 航向不可信，不修正航向偏差
+#define FUSION_STOP_KMH 1.0f         // GPS 速度低于此值直接认为静止 (防止停车时积分漂移)
+
+struct FusedState
+{
+    bool valid;      // 有可用的位置 (融合或原始 GPS)
+    bool fused;      // true: IMU 推算 + GPS 修正；false: 原始 GPS
+    double lat;
+    double lon;
+    float speed_kmh;
+    float heading;   // 0~360 度 (与 GPS 航向同一参考)
+    uint32_t t_ms;   // 状态对应的时刻 (millis 时间轴)
+};
+
+class FusionEstimator
+{
+private:
+    LocalFrame _frame;
+    bool _frameSet = false;
+
+    // 滤波状态 (局部平面坐标)
+    float _x = 0, _y = 0;  // m
+    float _v = 0;          // m/s
+    float _heading = 0;    // 度
+    float _biasG = 0;      // 纵向 G 零偏
+    float _headingOffset = 0; // IMU 航向 - GPS 航向
+    bool _offsetValid = false;
+    bool _tracking = false;   // 状态已由 GPS 初始化，可以推算
+    bool _enabled = true;     // 融合开关 (关闭时输出原始 GPS)
+
+    uint32_t _gpsMs = 0;      // 最近一次定位的 GPS 周期时间
+    uint32_t _stateMs = 0;    // 当前状态对应的时刻
+    uint32_t _imuUs = 0;      // 上一帧 IMU 到达时刻 (micros)
+    uint32_t _imuMs = 0;      // 上一帧 IMU 到达时刻 (millis)
+    float _imuHeading = 0;
+
+    FusedState _out = {false, false, 0, 0, 0, 0, 0};
+
+    // 统计: 推算误差 (定位到来时，推算值与 GPS 的差) 和每次更新的耗时
+    uint32_t _corrections = 0;
+    double _sumPosErr2 = 0;
+    double _sumSpdErr2 = 0;
+    uint32_t _updates = 0;
+    uint32_t _sumUs = 0;
+    uint32_t _maxUs = 0;
+
+    static float wrap360(float a)
+    {
+        while (a >= 360.0f)
+            a -= 360.0f;
+        while (a < 0)
+            a += 360.0f;
+        return a;
+    }
+
+    static float wrap180(float a)
+    {
+        while (a > 180.0f)
+            a -= 360.0f;
+        while (a <= -180.0f)
+            a += 360.0f;
+        return a;
+    }
+
+    bool imuAlive(uint32_t now) { return _imuMs != 0 && now - _imuMs < FUSION_IMU_TIMEOUT_MS; }
+
+    void publishFused()
+    {
+        _frame.toGeo(_x, _y, _out.lat, _out.lon);
+        _out.speed_kmh = _v * 3.6f;
+        _out.heading = _heading;
+        _out.t_ms = _stateMs;
+        _out.valid = true;
+        _out.fused = true;
+    }
+
+    void publishGps(const SensorFrame &f)
+    {
+        _out.lat = f.lat;
+        _out.lon = f.lon;
+        _out.speed_kmh = f.speed_kmh;
+        _out.heading = f.course;
+        _out.t_ms = f.epoch_ms;
+        _out.valid = true;
+        _out.fused = false;
+    }
+
+    void recordTime(uint32_t t0)
+    {
+        uint32_t dt = hal_real_micros() - t0;
+        _updates++;
+        _sumUs += dt;
+        if (dt > _maxUs)
+            _maxUs = dt;
+    }
+
+public:
+    // GPS 帧：修正 (或初始化) 状态
+    void correctGps(const SensorFrame &f)
+    {
+        uint32_t t0 = hal_real_micros();
+
+        if (!f.fix)
+        {
+            _tracking = false;
+            _out.valid = false;
+            _out.fused = false;
+            return;
+        }
+
+        // 局部坐标原点跟着车走 (离原点 5km 以上时重建)，保证 float 精度
+        float gx, gy;
+        if (_frameSet)
+            _frame.toLocal(f.lat, f.lon, gx, gy);
+        if (!_frameSet || fabsf(gx) > 5000.0f || fabsf(gy) > 5000.0f)
+        {
+            _frame.setup(f.lat, f.lon);
+            _frameSet = true;
+            _tracking = false;
+            gx = gy = 0;
+        }
+
+        float gv = f.speed_kmh / 3.6f;
+        float gc = f.course * DEG_TO_RAD;
+
+        if (!_enabled || !imuAlive(f.arrival_ms))
+        {
+            _tracking = false;
+            publishGps(f);
+        }
+        else if (!_tracking || f.epoch_ms - _gpsMs > FUSION_GPS_TIMEOUT_MS)
+        {
+            // 首次定位或丢星后重新开始：直接用 GPS 初始化
+            _x = gx;
+            _y = gy;
+            _v = gv;
+            _heading = f.course;
+            _stateMs = f.epoch_ms;
+            _tracking = true;
+            publishGps(f);
+        }
+        else
+        {
+            // GPS 定位时刻早于当前状态 (状态已被 IMU 推到更晚的时刻)，
+            // 先按 GPS 速度/航向把观测值外推到状态时刻再比较
+            int32_t lead = (int32_t)(_stateMs - f.epoch_ms);
+            lead = constrain(lead, 0, FUSION_MAX_LEAD_MS);
+            float mx = gx + gv * (lead / 1000.0f) * sinf(gc);
+            float my = gy + gv * (lead / 1000.0f) * cosf(gc);
+
+            float ex = mx - _x;
+            float ey = my - _y;
+            float ev = gv - _v;
+            _corrections++;
+            _sumPosErr2 += ex * ex + ey * ey;
+            _sumSpdErr2 += ev * ev;
+
+            _x += FUSION_K_POS * ex;
+            _y += FUSION_K_POS * ey;
+            _v += FUSION_K_VEL * ev;
+
+            // 速度总是推算偏高 -> 零偏偏小，反之亦然
+            float dtFix = (f.epoch_ms - _gpsMs) / 1000.0f;
+            if (dtFix > 0)
+                _biasG = constrain(_biasG - FUSION_K_BIAS * ev / (dtFix * FUSION_GRAVITY), -FUSION_MAX_BIAS_G, FUSION_MAX_BIAS_G);
+
+            if (f.speed_kmh < FUSION_STOP_KMH)
+                _v = 0;
+
+            // 车速足够时用 GPS 航向标定 IMU 航向偏差
+            if (f.speed_kmh > FUSION_MIN_HEADING_KMH)
+            {
+                float offset = wrap180(_imuHeading - f.course);
+                if (!_offsetValid)
+                {
+                    _headingOffset = offset;
+                    _offsetValid = true;
+                }
+                else
+                {
+                    _headingOffset = wrap180(_headingOffset + FUSION_K_HEADING * wrap180(offset - _headingOffset));
+                }
+            }
+            if (!_offsetValid)
+                _heading = f.course;
+
+            publishFused();
+        }
+
+        _gpsMs = f.epoch_ms;
+        recordTime(t0);
+    }
+
+    // IMU 帧：推算到这一帧的时刻。返回 true 表示产生了新的融合状态
+    bool predictImu(const SensorFrame &f)
+    {
+        uint32_t t0 = hal_real_micros();
+        uint32_t dtUs = f.arrival_us - _imuUs;
+        bool first = (_imuMs == 0);
+        _imuUs = f.arrival_us;
+        _imuMs = f.arrival_ms;
+        _imuHeading = f.heading;
+
+        if (!_enabled || !_tracking || first || dtUs == 0 || dtUs > FUSION_IMU_MAX_DT_US)
+            return false;
+
+        // 丢星太久，停止推算 (输出标记为无效，等下一次定位重新初始化)
+        if (f.arrival_ms - _gpsMs > FUSION_GPS_TIMEOUT_MS)
+        {
+            _tracking = false;
+            _out.valid = false;
+            _out.fused = false;
+            return false;
+        }
+
+        float dt = dtUs / 1e6f;
+        if (_offsetValid)
+            _heading = wrap360(f.heading - _headingOffset);
+
+        _v += (f.lon_g_raw - _biasG) * FUSION_GRAVITY * dt;
+        if (_v < 0)
+            _v = 0;
+
+        float h = _heading * DEG_TO_RAD;
+        _x += _v * dt * sinf(h);
+        _y += _v * dt * cosf(h);
+        _stateMs = f.arrival_ms;
+
+        publishFused();
+        recordTime(t0);
+        return true;
+    }
+
+    const FusedState &getState() { return _out; }
+    bool isFused() { return _out.valid && _out.fused; }
+
+    // 下一次定位时生效
+    void setEnabled(bool on) { _enabled = on; }
+
+    // 推算误差: 每次定位时推算位置 / 速度与 GPS 的差 (RMS，m 和 m/s)
+    uint32_t getCorrections() { return _corrections; }
+    double getPosRms() { return _corrections ? sqrt(_sumPosErr2 / _corrections) : 0.0; }
+    double getSpdRms() { return _corrections ? sqrt(_sumSpdErr2 / _corrections) : 0.0; }
+    float getBiasG() { return _biasG; }
+    float getHeadingOffset() { return _headingOffset; }
+
+    // 推算误差 (RMS) 和耗时统计
+    void printStats()
+    {
+        Serial.printf("[FUSION] %s, corrections=%lu posRMS=%.2fm spdRMS=%.2fkm/h bias=%.3fg hdgOff=%.1f%s\n",
+                      _enabled ? (_tracking ? "tracking" : "waiting") : "disabled",
+                      (unsigned long)_corrections,
+                      getPosRms(), getSpdRms() * 3.6,
+                      _biasG, _headingOffset, _offsetValid ? "" : "(unset)");
+        Serial.printf("[FUSION] updates=%lu avg=%luus max=%luus\n",
+                      (unsigned long)_updates, (unsigned long)(_updates ? _sumUs / _updates : 0), (unsigned long)_maxUs);
+    }
+
+    void resetStats()
+    {
+        _corrections = 0;
+        _sumPosErr2 = _sumSpdErr2 = 0;
+        _updates = _sumUs = _maxUs = 0;
+    }
+};
+
+FusionEstimator fusion;
@@ -3,9 +3,15 @@
 #include <TinyGPS++.h>
 #include "BLE_Driver.hpp"
 #include "GPSAutoBaud.hpp"
+#include "UBX_Parser.hpp"
+#include "Byte_Ring.hpp"
+#include "GPS_Epoch_Clock.hpp"
+#include "Metrics.hpp"
 // #include "System_Config.hpp"
-// 定义全局日志缓冲区
-extern String gps_log_buffer;
+// [修改] 全局日志缓冲区：String 改为定长无锁环形缓冲 (不再在热循环里分配/拷贝堆内存)
+// 与原来一样始终保留最近收到的原始数据 (满了覆盖最旧的)，串口 'g' 指令导出
+#define GPS_LOG_RING_SIZE 2048
+extern ByteRing<GPS_LOG_RING_SIZE> gps_log_ring;
 // extern bool gps_10hz_mode;
 extern BLE_Driver ble;
 
@@ -14,12 +20,32 @@ class GPS_Driver
 private:
     HardwareSerial *serial;
     uint8_t rxPin, txPin;
-    const size_t MAX_LOG_SIZE = 1024;
+    static const size_t RX_CHUNK = 64; // 每次从 UART 批量读取的字节数
     bool _isConfigured = false; // [新增] 记录是否已配置
+    bool _ubxConfigured = false; // [新增] NAV-PVT 输出是否已开启
     uint32_t _bootTime = 0;
+    uint32_t _lastNmeaEpoch = 0xFFFFFFFF; // [新增] 上一个 NMEA 周期的 UTC 时间 (hhmmsscc)
+
+    // [新增] GPS 周期时间 -> millis 时间轴的映射 (最小偏移 + 频率漂移跟踪，见 GPS_Epoch_Clock.hpp)
+    GpsEpochClock _epochClock;
+
+    UBXParser ubx;
+
+    // [新增] UBX 数据是否可用 (开启了 UBX 模式，且最近 2 秒内收到过 NAV-PVT)
+    bool useUbx()
+    {
+        return sys_cfg.gps_ubx_mode && pvt.rxMs != 0 && (millis() - pvt.rxMs < 2000);
+    }
 
 public:
     TinyGPSPlus tgps;
+    UBXNavPvt pvt = {}; // [新增] UBX 模式下每个 epoch 填充一次
+
+    // [新增] 运行指标 (诊断页 / CMD:STATS)
+    MetricCounter mBytes;
+    MetricCounter mEpochs;
+    MetricCounter mChecksumFail; // NMEA 校验失败 + UBX 坏帧
+    MetricCounter mLogDropped;   // 原始数据缓冲里没被读走就被覆盖的字节数
 
     GPS_Driver(uint8_t rx, uint8_t tx) : rxPin(rx), txPin(tx)
     {
@@ -28,6 +54,11 @@ public:
 
     void begin()
     {
+        metrics.addCounter("gps.bytes", &mBytes, "B");
+        metrics.addCounter("gps.epochs", &mEpochs);
+        metrics.addCounter("gps.cksum_fail", &mChecksumFail);
+        metrics.addCounter("gps.log_drop", &mLogDropped, "B");
+
                 // 1. 实例化自动检测器
                 GPSAutoBaud autobaud(serial, rxPin, txPin);
 
@@ -63,27 +94,61 @@ public:
         // Serial.println(">>> 配置指令已发送，准备监测刷新率...");
     }
 
-    void update()
+    // [修改] 返回值：本次调用是否完成了一个新的导航周期 (epoch)
+    bool update()
     {
-        while (serial->available())
+        bool newEpoch = false;
+        uint8_t chunk[RX_CHUNK];
+        size_t n;
+        // [修改] 按块读取，减少逐字节 available()/read() 的调用开销
+        while ((n = serial->available()) > 0)
         {
             // 1. 读取原始字节
-            char c = serial->read();
-            // Serial.write(c);
-
-            // 2. [原有逻辑] 喂给 TinyGPS++ 解析 (给屏幕UI和算法用)
-            tgps.encode(c);
+            if (n > RX_CHUNK)
+                n = RX_CHUNK;
+            n = serial->read(chunk, n);
+            mBytes.add(n);
 
-            // 3. [原有逻辑] 日志缓冲
-            if (gps_log_buffer.length() < MAX_LOG_SIZE)
-            {
-                gps_log_buffer += c;
-            }
-            else
+            for (size_t i = 0; i < n; i++)
             {
-                gps_log_buffer = gps_log_buffer.substring(MAX_LOG_SIZE / 2);
-                gps_log_buffer += c;
+                char c = (char)chunk[i];
+                // Serial.write(c);
+
+                // 2. 解析
+                if (sys_cfg.gps_ubx_mode)
+                {
+                    // [新增] UBX 模式：二进制帧交给 UBX 解析器，帧外的 NMEA 文本仍交给 TinyGPS++
+                    // (日期/海拔/HDOP 等低频信息继续走 NMEA)
+                    UBXFeedResult r = ubx.feed((uint8_t)c);
+                    if (r == UBX_NOT_MINE)
+                    {
+                        tgps.encode(c);
+                    }
+                    else if (r == UBX_FRAME_OK && ubx.decodeNavPvt(pvt))
+                    {
+                        pvt.rxMs = millis();
+                        newEpoch = true;
+                    }
+                }
+                else
+                {
+                    // [原有逻辑] 喂给 TinyGPS++ 解析 (给屏幕UI和算法用)
+                    tgps.encode(c);
+                }
             }
+
+            // 3. [修改] 日志缓冲：整块写入环形缓冲 (满了覆盖最旧的数据并计数)
+            gps_log_ring.write(chunk, n);
+            mLogDropped.set(gps_log_ring.getDropped());
+        }
+
+        // NMEA 模式：以 UTC 时间变化作为新周期的标志 (同一周期的 GGA/RMC 时间相同)
+        // [修改] 条件与取值函数一致用 useUbx()：开了 UBX 模式但收不到 NAV-PVT (模块不支持 / 配置没生效) 时，
+        // 位置已经回退到 NMEA，周期也要按 NMEA 判定，否则一帧都不会发布
+        if (!useUbx() && tgps.time.isValid() && tgps.time.value() != _lastNmeaEpoch)
+        {
+            _lastNmeaEpoch = tgps.time.value();
+            newEpoch = true;
         }
 
         // 配置逻辑保持不变
@@ -95,17 +160,87 @@ public:
             delay(100);
             _isConfigured = true;
         }
+
+        // [新增] UBX 模式：开启 NAV-PVT 输出，并关掉用不到的 NMEA 语句
+        if (sys_cfg.gps_ubx_mode && !_ubxConfigured && (millis() - _bootTime > 3500))
+        {
+            enableUbxNavPvt();
+            _ubxConfigured = true;
+        }
+
+        if (newEpoch)
+            mEpochs.add();
+        mChecksumFail.set(tgps.failedChecksum() + ubx.getFramesBad());
+        return newEpoch;
+    }
+
+    // [新增] 注册串口接收回调 (UART 空闲超时触发，相当于一段数据突发的结尾)
+    void onReceive(OnReceiveCb cb)
+    {
+        serial->onReceive(cb, true);
     }
 
     float getSpeed()
     {
+        if (useUbx())
+            return pvt.valid ? pvt.speed_kmh : 0.0;
         return tgps.speed.isValid() ? tgps.speed.kmph() : 0.0;
     }
 
     int getSatellites()
     {
+        if (useUbx())
+            return pvt.numSV;
         return tgps.satellites.isValid() ? tgps.satellites.value() : 0;
     }
+
+    // --- [新增] 热路径访问器：UBX 模式下直接读 NAV-PVT 结构体，否则回退到 TinyGPS++ ---
+    bool hasFix()
+    {
+        if (useUbx())
+            return pvt.valid;
+        return tgps.location.isValid();
+    }
+
+    double getLat() { return useUbx() ? pvt.lat : tgps.location.lat(); }
+    double getLng() { return useUbx() ? pvt.lon : tgps.location.lng(); }
+    double getCourse() { return useUbx() ? pvt.heading_deg : tgps.course.deg(); }
+
+    // [新增] 当前周期的 GPS 时间 (ms)：UBX 用 iTOW，NMEA 用 UTC 当日毫秒
+    uint32_t getGpsTimeMs()
+    {
+        if (useUbx())
+            return pvt.iTOW;
+        return ((tgps.time.hour() * 60UL + tgps.time.minute()) * 60UL + tgps.time.second()) * 1000UL +
+               tgps.time.centisecond() * 10UL;
+    }
+
+    // [新增] 把当前周期的 GPS 时间映射到 millis 时间轴 (rxMs 为该周期数据的到达时刻)
+    // 计时算法用这个时间插值，不受到达时刻抖动的影响
+    uint32_t mapEpochMs(uint32_t rxMs)
+    {
+        return _epochClock.map(getGpsTimeMs(), rxMs);
+    }
+
+    // 开启 UBX-NAV-PVT (每个导航周期输出一次)
+    // UBX-CFG-MSG 短格式 (3 字节): 只设置 "当前端口" 的输出速率
+    void enableUbxNavPvt()
+    {
+        const uint8_t navPvtOn[] = {0x06, 0x01, 0x03, 0x00, UBX_CLASS_NAV, UBX_ID_NAV_PVT, 0x01};
+        sendUBX(navPvtOn, sizeof(navPvtOn));
+        delay(50);
+
+        // 关掉 GLL / GSA / GSV / VTG，只保留 GGA (海拔/HDOP) 和 RMC (日期)
+        // GSV 是 NMEA 里最占带宽的语句，关掉后串口负载大幅下降
+        const uint8_t nmeaOff[] = {0x01, 0x02, 0x03, 0x05};
+        for (uint8_t i = 0; i < sizeof(nmeaOff); i++)
+        {
+            const uint8_t msgOff[] = {0x06, 0x01, 0x03, 0x00, 0xF0, nmeaOff[i], 0x00};
+            sendUBX(msgOff, sizeof(msgOff));
+            delay(50);
+        }
+        Serial.println("[GPS] UBX NAV-PVT enabled");
+    }
     // 发送 U-blox 10Hz 配置指令 (UBX-CFG-RATE)
     void setUblox10Hz()
     {
@@ -247,6 +382,74 @@ public:
         // 这个指令比较重，建议多给点时间处理
         delay(200);
     }
+
+    // [新增] 解析器对比测试 (串口 'p')：同样 n 个导航周期，NMEA (RMC+GGA) 喂 TinyGPS++ / NAV-PVT 喂 UBXParser，
+    // 比较每个周期的字节数和解析耗时。用独立的解析器实例，不影响正在运行的 GPS
+    void benchmark(uint32_t n)
+    {
+        static const uint32_t EPOCHS = 50; // 预先生成 50 个周期 (5 秒) 的数据，循环使用
+        static char nmea[EPOCHS * 180];
+        static uint8_t ubxBuf[EPOCHS * UBX_NAV_PVT_FRAME_LEN];
+        size_t nmeaLen = 0, ubxLen = 0;
+
+        for (uint32_t e = 0; e < EPOCHS; e++)
+        {
+            // 120km/h 向东行驶
+            UBXNavPvt p = {};
+            p.iTOW = 30959000 + e * 100;
+            p.lat = 31.1685575;
+            p.lon = 121.5090535 + e * 3.333 / 95300.0;
+            p.alt_m = 12.3f;
+            p.speed_kmh = 120.0f;
+            p.heading_deg = 90.0f;
+            p.fixType = 3;
+            p.numSV = 12;
+            p.valid = true;
+            ubxLen += ubxEncodeNavPvt(p, ubxBuf + ubxLen);
+
+            uint32_t cs = (8 * 3600 + 35 * 60 + 59) * 100 + e * 10; // hhmmss.ss 的 1/100 秒
+            char hms[16], lon[16], body[128];
+            snprintf(hms, sizeof(hms), "%02lu%02lu%02lu.%02lu", (unsigned long)(cs / 360000), (unsigned long)(cs / 6000 % 60),
+                     (unsigned long)(cs / 100 % 60), (unsigned long)(cs % 100));
+            snprintf(lon, sizeof(lon), "%03d%08.5f", (int)p.lon, (p.lon - (int)p.lon) * 60);
+            const char *fmt[2] = {"GNRMC,%s,A,3110.11345,N,%s,E,64.80,90.0,160626,,,A",
+                                  "GNGGA,%s,3110.11345,N,%s,E,1,12,0.8,12.3,M,8.1,M,,"};
+            for (uint8_t k = 0; k < 2; k++)
+            {
+                int len = snprintf(body, sizeof(body), fmt[k], hms, lon);
+                uint8_t x = 0;
+                for (int i = 0; i < len; i++)
+                    x ^= (uint8_t)body[i];
+                nmeaLen += snprintf(nmea + nmeaLen, sizeof(nmea) - nmeaLen, "$%s*%02X\r\n", body, x);
+            }
+        }
+
+        TinyGPSPlus t;
+        uint32_t c0 = ESP.getCycleCount();
+        for (uint32_t r = 0; r < n; r += EPOCHS)
+            for (size_t i = 0; i < nmeaLen; i++)
+                t.encode(nmea[i]);
+        uint32_t nmeaCycles = ESP.getCycleCount() - c0;
+
+        UBXParser u;
+        UBXNavPvt out;
+        uint32_t frames = 0;
+        c0 = ESP.getCycleCount();
+        for (uint32_t r = 0; r < n; r += EPOCHS)
+            for (size_t i = 0; i < ubxLen; i++)
+                if (u.feed(ubxBuf[i]) == UBX_FRAME_OK && u.decodeNavPvt(out))
+                    frames++;
+        uint32_t ubxCycles = ESP.getCycleCount() - c0;
+
+        uint32_t epochs = (n + EPOCHS - 1) / EPOCHS * EPOCHS;
+        float mhz = ESP.getCpuFreqMHz();
+        Serial.printf("[GPS] NMEA+TinyGPS++: %.0f B/epoch, %.2f us/epoch, %.2f MB/s (ok=%lu fail=%lu)\n",
+                      (float)nmeaLen / EPOCHS, nmeaCycles / mhz / epochs,
+                      (float)nmeaLen * epochs / EPOCHS / (nmeaCycles / mhz), t.passedChecksum(), t.failedChecksum());
+        Serial.printf("[GPS] UBX NAV-PVT:    %.0f B/epoch, %.2f us/epoch, %.2f MB/s (frames=%lu)\n",
+                      (float)ubxLen / EPOCHS, ubxCycles / mhz / epochs,
+                      (float)ubxLen * epochs / EPOCHS / (ubxCycles / mhz), frames);
+    }
 };
 
 // 声明外部对象 (main.cpp 中实例化)
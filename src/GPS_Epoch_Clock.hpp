@@ -0,0 +1,48 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// GPS 周期时间 -> millis 时间轴的映射 (GPS_Driver::mapEpochMs 用)
+// ==========================================
+// 偏移 = 到达时刻 - GPS 时间。传输延迟只会让偏移变大，所以取 "最小偏移" 即可滤掉串口/调度抖动；
+// 同时让偏移每秒最多上漂 1ms，跟踪两边晶振的频率误差 (GPS 时钟比 millis 慢时偏移会一直变大)。
+// 10Hz 下两次到达只隔 100ms，上漂量按毫秒累加，满 1000ms 才放出 1ms，不能每次整除后丢掉余数。
+
+class GpsEpochClock
+{
+private:
+    int32_t _offset = 0;
+    bool _valid = false;
+    uint32_t _lastRx = 0;
+    uint32_t _leakAcc = 0; // 还没换成上漂量的到达间隔 (ms)
+
+public:
+    // gpsMs: 周期的 GPS 时间；rxMs: 该周期数据的到达时刻 (millis)
+    uint32_t map(uint32_t gpsMs, uint32_t rxMs)
+    {
+        int32_t off = (int32_t)(rxMs - gpsMs);
+
+        // 首次 / 时间跳变 (周/日翻转、冷启动) 时直接重置
+        if (!_valid || abs(off - _offset) > 1000)
+        {
+            _offset = off;
+            _valid = true;
+            _leakAcc = 0;
+        }
+        else if (off < _offset)
+        {
+            _offset = off;
+        }
+        else
+        {
+            _leakAcc += rxMs - _lastRx;
+            int32_t leak = (int32_t)(_leakAcc / 1000);
+            _leakAcc %= 1000;
+            _offset += min(off - _offset, leak);
+        }
+        _lastRx = rxMs;
+        return gpsMs + _offset;
+    }
+
+    int32_t getOffset() { return _offset; }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+// ==========================================
+// 硬件抽象层 (时钟 / 串口 / 文件系统 / BLE 发送)
+// ==========================================
+// 纯逻辑模块 (TrackManager、DragRaceManager、LapReference、各协议解析器、日志格式) 只包含本文件，
+// 不直接包含 Arduino.h / SD_MMC.h，这样同一份代码可以在 PC 上编译 ([env:native]，定义 HAL_NATIVE)。
+// 各平台的实现接口相同，编译时二选一 (没有虚函数，设备上零开销):
+//   Hal_Esp32.hpp : millis/micros、Serial、SD_MMC、BLE_Driver
+//   Hal_Native.hpp: clock_gettime、stdout/文件描述符、本地目录、stdout
+//
+//   hal_real_millis() / hal_real_micros()   真实时钟
+//   hal_cycle_count()                       CPU 周期计数 (32 位，测短时间段)
+//   hal_alloc_large(bytes)                  大块内存 (设备上是 PSRAM)
+//   hal_yield()                             让出 CPU (自旋等待时用)
+//   HalSerialPort  Serial                   调试串口 (print / println / printf / available / read / write)
+//   HalFile / HalFS halFs                   文件 (read / write / seek / position / size / flush / close / truncate)
+//   HalBleTransport halBle                  文本发送 (isConnected / send)
+
+#ifdef HAL_NATIVE
+#include "Hal_Native.hpp"
+#else
+#include "Hal_Esp32.hpp"
+#endif
+
+// --- 时钟 ---
+// 平时就是真实时钟；回放日志时切到虚拟时间，由回放引擎按日志时间戳推进 (可以比实时快)。
+// 需要跟着回放走的模块用 halClock.millis()，不要直接调 millis()。
+class HalClock
+{
+private:
+    bool _virtual = false;
+    uint64_t _virtUs = 0;
+
+public:
+    uint32_t millis() { return _virtual ? (uint32_t)(_virtUs / 1000) : hal_real_millis(); }
+    uint32_t micros() { return _virtual ? (uint32_t)_virtUs : hal_real_micros(); }
+
+    // 进入虚拟时间并设为 ms (之后每次调用都可以往前设)
+    void setVirtual(uint32_t ms)
+    {
+        _virtual = true;
+        _virtUs = (uint64_t)ms * 1000;
+    }
+    void useRealTime() { _virtual = false; }
+    bool isVirtual() { return _virtual; }
+};
+
+HalClock halClock;
@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include <unistd.h>
+
+// ==========================================
+// HAL: ESP32 实现 (只是对 Arduino / SD_MMC / BLE_Driver 的薄包装)
+// ==========================================
+
+extern bool sd_connected;
+
+inline uint32_t hal_real_millis() { return millis(); }
+inline uint32_t hal_real_micros() { return micros(); }
+inline uint32_t hal_cycle_count() { return ESP.getCycleCount(); } // 240MHz 时约 17.9s 回绕
+
+// 大块缓冲放 PSRAM
+inline void *hal_alloc_large(size_t bytes) { return ps_malloc(bytes); }
+
+// 让出 CPU 一个 tick (低优先级任务持有自旋锁时，高优先级任务不能空转)
+inline void hal_yield() { vTaskDelay(1); }
+
+// 串口: Serial / Serial1 / Serial2 本身就是 Stream
+typedef Stream HalSerialPort;
+
+// 文件: fs::File 原样使用
+typedef fs::File HalFile;
+
+class HalFS
+{
+public:
+    bool isMounted() { return sd_connected; }
+    bool exists(const char *path) { return SD_MMC.exists(path); }
+    bool mkdir(const char *path) { return SD_MMC.mkdir(path); }
+    bool remove(const char *path) { return SD_MMC.remove(path); }
+    // 截断到 size 字节 (文件须已关闭)。SD_MMC 没有截断接口，走 VFS 的 POSIX truncate
+    bool truncate(const char *path, uint32_t size) { return ::truncate((String("/sdcard") + path).c_str(), size) == 0; }
+    HalFile open(const char *path, const char *mode = FILE_READ) { return SD_MMC.open(path, mode); }
+};
+
+HalFS halFs;
+
+// BLE 文本发送 (APP 模式的 NUS 通道)。实现在 BLE_Driver.hpp 末尾
+class HalBleTransport
+{
+public:
+    bool isConnected();
+    void send(const char *text);
+};
+
+HalBleTransport halBle;
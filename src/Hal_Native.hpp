@@ -0,0 +1,260 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// ==========================================
+// HAL: Linux 实现 ([env:native])
+// ==========================================
+// 时钟用 CLOCK_MONOTONIC；Serial 是 stdout/stdin；文件系统映射到本地目录
+// (环境变量 RACETRIX_SD_ROOT，默认 ./sd，相当于 SD 卡根目录)；BLE 发送打印到 stdout。
+
+// Arduino 里常用、逻辑模块直接用到的几个定义
+#ifndef DEG_TO_RAD
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#endif
+#ifndef RAD_TO_DEG
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#endif
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+using std::abs;
+using std::max;
+using std::min;
+
+inline uint64_t hal_monotonic_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 与设备一样从 "开机" (程序启动) 开始计时，32 位回绕
+static const uint64_t hal_boot_us = hal_monotonic_us();
+inline uint32_t hal_real_micros() { return (uint32_t)(hal_monotonic_us() - hal_boot_us); }
+inline uint32_t hal_real_millis() { return (uint32_t)((hal_monotonic_us() - hal_boot_us) / 1000); }
+
+// CPU 周期计数 (32 位回绕，只用来测短时间段)。x86 用 TSC，其他平台退化为纳秒
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint32_t hal_cycle_count() { return (uint32_t)__rdtsc(); }
+#else
+inline uint32_t hal_cycle_count()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
+
+inline void *hal_alloc_large(size_t bytes) { return malloc(bytes); }
+
+// 让出 CPU (等别的线程释放自旋锁)
+inline void hal_yield() { sched_yield(); }
+
+// --- 串口 (文件描述符) ---
+// 默认是控制台 (stdin/stdout)；open() 可以打开串口设备、管道或抓包文件
+class HalSerialPort
+{
+private:
+    int _in;
+    int _out;
+
+public:
+    HalSerialPort(int in = 0, int out = 1) : _in(in), _out(out) {}
+
+    bool open(const char *path)
+    {
+        int fd = ::open(path, O_RDWR | O_NOCTTY);
+        if (fd < 0)
+            return false;
+        _in = _out = fd;
+        return true;
+    }
+
+    int available()
+    {
+        int n = 0;
+        if (ioctl(_in, FIONREAD, &n) == 0)
+            return n;
+        // 普通文件不支持 FIONREAD: 用剩余长度
+        struct stat st;
+        if (fstat(_in, &st) != 0)
+            return 0;
+        off_t pos = lseek(_in, 0, SEEK_CUR);
+        return (pos >= 0 && st.st_size > pos) ? (int)std::min<off_t>(st.st_size - pos, 0x7FFFFFFF) : 0;
+    }
+
+    int read()
+    {
+        uint8_t c;
+        return (::read(_in, &c, 1) == 1) ? c : -1;
+    }
+    size_t read(uint8_t *buf, size_t len)
+    {
+        ssize_t n = ::read(_in, buf, len);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        ssize_t n = ::write(_out, buf, len);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    __attribute__((format(printf, 2, 3))) size_t printf(const char *fmt, ...)
+    {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return 0;
+        return write((const uint8_t *)buf, std::min((size_t)n, sizeof(buf) - 1));
+    }
+
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const std::string &s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+    template <typename T>
+    size_t println(const T &v) { return print(v) + println(); }
+    size_t println() { return print("\n"); }
+};
+
+HalSerialPort Serial;
+
+// --- 文件 ---
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class HalFile
+{
+private:
+    FILE *_f = NULL;
+
+public:
+    HalFile() {}
+    explicit HalFile(FILE *f) : _f(f) {}
+    // 与 fs::File 一样按句柄传递；只允许移动，避免两个对象关同一个 FILE
+    HalFile(const HalFile &) = delete;
+    HalFile &operator=(const HalFile &) = delete;
+    HalFile(HalFile &&o) : _f(o._f) { o._f = NULL; }
+    HalFile &operator=(HalFile &&o)
+    {
+        if (this != &o)
+        {
+            close();
+            _f = o._f;
+            o._f = NULL;
+        }
+        return *this;
+    }
+    ~HalFile() { close(); }
+
+    explicit operator bool() const { return _f != NULL; }
+
+    size_t read(uint8_t *buf, size_t len) { return _f ? fread(buf, 1, len, _f) : 0; }
+    int read() { return _f ? fgetc(_f) : -1; }
+    size_t write(const uint8_t *buf, size_t len) { return _f ? fwrite(buf, 1, len, _f) : 0; }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    bool seek(uint32_t pos) { return _f && fseek(_f, pos, SEEK_SET) == 0; }
+    size_t position() { return _f ? (size_t)ftell(_f) : 0; }
+    size_t size()
+    {
+        if (!_f)
+            return 0;
+        long cur = ftell(_f);
+        fseek(_f, 0, SEEK_END);
+        long end = ftell(_f);
+        fseek(_f, cur, SEEK_SET);
+        return (size_t)end;
+    }
+    int available() { return _f ? (int)(size() - position()) : 0; }
+    void flush()
+    {
+        if (_f)
+            fflush(_f);
+    }
+    void close()
+    {
+        FILE *f = _f;
+        _f = NULL;
+        if (f)
+            fclose(f);
+    }
+};
+
+class HalFS
+{
+private:
+    std::string full(const char *path)
+    {
+        const char *root = getenv("RACETRIX_SD_ROOT");
+        return std::string(root ? root : "./sd") + path;
+    }
+
+public:
+    bool isMounted() { return true; }
+    bool exists(const char *path)
+    {
+        struct stat st;
+        return stat(full(path).c_str(), &st) == 0;
+    }
+    bool mkdir(const char *path) { return ::mkdir(full(path).c_str(), 0755) == 0; }
+    bool remove(const char *path) { return ::remove(full(path).c_str()) == 0; }
+    // 截断到 size 字节 (文件须已关闭)
+    bool truncate(const char *path, uint32_t size) { return ::truncate(full(path).c_str(), size) == 0; }
+    // 与 SD_MMC 一样，FILE_WRITE 是截断重写；二进制模式打开 ("r+" 之类的读写模式原样保留)
+    HalFile open(const char *path, const char *mode = FILE_READ)
+    {
+        char m[4] = {mode[0], 'b', (char)(mode[0] && mode[1] == '+' ? '+' : 0), 0};
+        return HalFile(fopen(full(path).c_str(), m));
+    }
+};
+
+HalFS halFs;
+
+// --- BLE 发送: 打印到 stdout ---
+// 最近一条发送内容和发送条数留着给测试检查；quiet 时不打印
+class HalBleTransport
+{
+public:
+    bool connected = true;
+    bool quiet = false;
+    char last[256] = {0};
+    uint32_t sent = 0;
+
+    bool isConnected() { return connected; }
+    void send(const char *text)
+    {
+        strncpy(last, text, sizeof(last) - 1);
+        sent++;
+        if (!quiet)
+            Serial.printf("[BLE>] %s\n", text);
+    }
+};
+
+HalBleTransport halBle;
@@ -0,0 +1,228 @@
+#pragma once
+#include <Arduino.h>
+#include "System_Config.hpp"
+#include "IMU_Driver.hpp"
+#include "BLE_Driver.hpp"
+
+extern ConfigManager sys_cfg;
+extern IMU_Driver imu;
+extern BLE_Driver ble;
+
+// ==========================================
+// IMU 安装校准 (非阻塞状态机)
+// ==========================================
+// start() 之后先丢掉 0.5 秒 (按按钮时的抖动)，再采 2 秒静止数据:
+//   addSample() 在 SensorTask 里每帧调用一次，只做累加 (几十次浮点运算)
+//   poll()      在 loop() 里调用，采样结束后做方差检查、计算结果、保存到 ConfigManager
+// 计算结果:
+//   安装四元数 = 传感器坐标 -> 车身坐标。"上" 取平均重力方向，"前" 取当前轴向设置认定的前方
+//                (平放 Y / 竖立 Z，考虑交换/反转开关) 在水平面上的投影
+//   零偏       = 当前模式下静止时的平均 G 值 / 姿态角 (与原来按钮校准的含义相同)
+// 采样期间 G 值或姿态波动超过阈值 (车在动/有人碰) 则判定失败，不修改任何配置。
+
+#define IMU_CAL_SETTLE_SAMPLES 50  // 100Hz 下 0.5 秒
+#define IMU_CAL_SAMPLES 200        // 100Hz 下 2 秒
+#define IMU_CAL_MAX_ACC_STD 0.15f  // 线性加速度标准差上限 (m/s^2)
+#define IMU_CAL_MAX_TILT_STD 0.02f // 重力方向 (单位向量分量) 标准差上限，约 1 度
+
+enum ImuCalState : uint8_t
+{
+    IMU_CAL_IDLE = 0,
+    IMU_CAL_SETTLING, // 丢弃开始的一小段
+    IMU_CAL_SAMPLING, // 采样中
+    IMU_CAL_READY,    // 采样完成，等 poll() 计算
+    IMU_CAL_DONE,
+    IMU_CAL_FAILED
+};
+
+class ImuCalibrator
+{
+private:
+    volatile ImuCalState _state = IMU_CAL_IDLE;
+    volatile uint16_t _n = 0;
+    bool _fromBle = false;
+    uint8_t _lastReported = 0;
+
+    // 累加器
+    Vec3 _sumUp, _sumUp2;   // 传感器坐标下的 "上" 方向
+    Vec3 _sumLia, _sumLia2; // 传感器坐标下的线性加速度
+    float _sumHs, _sumHc;   // 航向 (按单位圆平均，避免 0/360 跳变)
+    float _sumR, _sumP, _sumLon, _sumLat;
+    Quat _lastQ;
+
+    static float stdOf(float sum, float sum2, uint16_t n)
+    {
+        float m = sum / n;
+        float v = sum2 / n - m * m;
+        return (v > 0) ? sqrtf(v) : 0;
+    }
+
+    // 当前轴向设置 (process_Flat / process_Vertical + 交换/反转) 认定的前方，传感器坐标
+    static Vec3 legacyForward()
+    {
+        bool vertical = (sys_cfg.mount_orientation == 1);
+        Vec3 lon = vertical ? Vec3{0, 0, 1} : Vec3{0, 1, 0};
+        Vec3 lat = vertical ? Vec3{0, 1, 0} : Vec3{1, 0, 0};
+        Vec3 fwd = sys_cfg.imu_swap_axis ? lat : lon;
+        return sys_cfg.imu_invert_y ? fwd * -1.0f : fwd;
+    }
+
+    // 由 "上" 方向和前方提示构造安装四元数 (传感器 -> 车身)
+    static Quat mountFrom(const Vec3 &up)
+    {
+        const Vec3 candidates[3] = {legacyForward(), {0, 1, 0}, {1, 0, 0}};
+        Vec3 fwd = {0, 0, 0};
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            // 前方提示几乎竖直时 (比如轴向设置和实际安装不符)，换下一个候选轴
+            Vec3 h = candidates[i] - up * candidates[i].dot(up);
+            if (h.norm() > 0.5f)
+            {
+                fwd = h.normalized();
+                break;
+            }
+        }
+        Vec3 right = fwd.cross(up);
+        return Quat::fromRows(right, fwd, up);
+    }
+
+    void report(const String &msg)
+    {
+        Serial.println("[CAL] " + msg);
+        if (_fromBle)
+            ble.send(msg);
+    }
+
+    void finish()
+    {
+        uint16_t n = _n;
+        Vec3 up = _sumUp * (1.0f / n);
+        Vec3 lia = _sumLia * (1.0f / n);
+        float tiltStd = max(stdOf(_sumUp.x, _sumUp2.x, n), max(stdOf(_sumUp.y, _sumUp2.y, n), stdOf(_sumUp.z, _sumUp2.z, n)));
+        float accStd = max(stdOf(_sumLia.x, _sumLia2.x, n), max(stdOf(_sumLia.y, _sumLia2.y, n), stdOf(_sumLia.z, _sumLia2.z, n)));
+
+        if (tiltStd > IMU_CAL_MAX_TILT_STD || accStd > IMU_CAL_MAX_ACC_STD)
+        {
+            Serial.printf("[CAL] Rejected: tilt std=%.3f acc std=%.3f\n", tiltStd, accStd);
+            _state = IMU_CAL_FAILED;
+            report("ERR:CAL_MOVING");
+            return;
+        }
+
+        // 1. 安装四元数
+        Quat mount = mountFrom(up.normalized());
+        sys_cfg.mount_qw = mount.w;
+        sys_cfg.mount_qx = mount.x;
+        sys_cfg.mount_qy = mount.y;
+        sys_cfg.mount_qz = mount.z;
+
+        // 2. 零偏
+        float head = atan2f(_sumHs, _sumHc) * RAD_TO_DEG;
+        if (sys_cfg.imu_quat_mode)
+        {
+            // 四元数模式: 零偏在新的车身坐标下计算，水平由安装四元数负责
+            Vec3 a = mount.rotate(lia);
+            sys_cfg.offset_lat = a.x / 9.80665f;
+            sys_cfg.offset_lon = a.y / 9.80665f;
+            Vec3 fwd = (_lastQ * mount.conj()).rotate({0, 1, 0});
+            head = atan2f(fwd.x, fwd.y) * RAD_TO_DEG;
+        }
+        else
+        {
+            sys_cfg.offset_roll = _sumR / n;
+            sys_cfg.offset_pitch = _sumP / n;
+            sys_cfg.offset_lon = _sumLon / n;
+            sys_cfg.offset_lat = _sumLat / n;
+        }
+        sys_cfg.offset_heading = (head < 0) ? head + 360.0f : head;
+
+        // 3. 保存并生效
+        // [修改] 安装四元数和零偏作为一组配置发布，SensorTask 在下一帧之前一起换上 (不在 loop() 里改正在解码的参数)
+        sys_cfg.save();
+        imu.applyConfig();
+
+        Serial.printf("[CAL] mount q=(%.4f %.4f %.4f %.4f) lon=%.3fg lat=%.3fg tilt std=%.3f acc std=%.3f\n",
+                      mount.w, mount.x, mount.y, mount.z, sys_cfg.offset_lon, sys_cfg.offset_lat, tiltStd, accStd);
+        _state = IMU_CAL_DONE;
+        report("OK:CAL_DONE");
+    }
+
+public:
+    // UI 按钮 / BLE CMD:CAL 调用 (loop 上下文)
+    void start(bool fromBle = false)
+    {
+        if (_state == IMU_CAL_SETTLING || _state == IMU_CAL_SAMPLING || _state == IMU_CAL_READY)
+            return;
+        _sumUp = _sumUp2 = _sumLia = _sumLia2 = {0, 0, 0};
+        _sumHs = _sumHc = _sumR = _sumP = _sumLon = _sumLat = 0;
+        _n = 0;
+        _fromBle = fromBle;
+        _lastReported = 0;
+        _state = IMU_CAL_SETTLING; // 最后切状态，SensorTask 看到这个状态才开始累加
+        report("MSG:Calibrating...");
+    }
+
+    // SensorTask 里每解析出一帧 IMU 数据调用一次
+    void addSample(IMU_Driver &d)
+    {
+        ImuCalState s = _state;
+        if (s != IMU_CAL_SETTLING && s != IMU_CAL_SAMPLING)
+            return;
+
+        if (s == IMU_CAL_SETTLING)
+        {
+            if (++_n >= IMU_CAL_SETTLE_SAMPLES)
+            {
+                _n = 0;
+                _state = IMU_CAL_SAMPLING;
+            }
+            return;
+        }
+
+        Vec3 up = d.raw_q.conj().rotate({0, 0, 1}); // 世界 "上" 在传感器坐标下的方向
+        const Vec3 &a = d.raw_lia;
+        _sumUp = _sumUp + up;
+        _sumUp2 = _sumUp2 + Vec3{up.x * up.x, up.y * up.y, up.z * up.z};
+        _sumLia = _sumLia + a;
+        _sumLia2 = _sumLia2 + Vec3{a.x * a.x, a.y * a.y, a.z * a.z};
+        _sumHs += sinf(d.raw_head * DEG_TO_RAD);
+        _sumHc += cosf(d.raw_head * DEG_TO_RAD);
+        _sumR += d.raw_roll;
+        _sumP += d.raw_pit;
+        _sumLon += d.raw_lon;
+        _sumLat += d.raw_lat;
+        _lastQ = d.raw_q;
+
+        if (++_n >= IMU_CAL_SAMPLES)
+            _state = IMU_CAL_READY;
+    }
+
+    // loop() 里调用 (不要放在 FusionTask：保存配置和 BLE 发送都可能阻塞)：汇报进度，采样完成后计算并保存
+    void poll()
+    {
+        if (_state == IMU_CAL_SAMPLING)
+        {
+            uint8_t p = getProgress();
+            if (p >= _lastReported + 25)
+            {
+                _lastReported = p - p % 25;
+                report("MSG:CAL=" + String(_lastReported) + "%");
+            }
+        }
+        else if (_state == IMU_CAL_READY)
+        {
+            finish();
+        }
+    }
+
+    ImuCalState getState() { return _state; }
+    bool isBusy() { return _state == IMU_CAL_SETTLING || _state == IMU_CAL_SAMPLING || _state == IMU_CAL_READY; }
+    uint8_t getProgress()
+    {
+        if (_state == IMU_CAL_SAMPLING)
+            return (uint8_t)(_n * 100 / IMU_CAL_SAMPLES);
+        return (_state == IMU_CAL_READY || _state == IMU_CAL_DONE) ? 100 : 0;
+    }
+};
+
+ImuCalibrator imuCal;
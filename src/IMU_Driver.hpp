@@ -1,6 +1,21 @@
 #pragma once
 #include <Arduino.h>
 #include "System_Config.hpp"
+#include "BNO_Parser.hpp"
+#include "Quaternion.hpp"
+#include "Metrics.hpp"
+#include <atomic>
+
+// [新增] 一组完整的 IMU 配置 (安装方式 + 安装四元数 + 零偏，都取自 sys_cfg)
+// 校准 (loop)、BLE 指令、设置页 (UiTask) 只发布，SensorTask 在两帧之间一次换上，
+// 解码时不会遇到新的安装四元数配旧的零偏这种半新半旧的组合
+struct ImuConfig
+{
+    bool vertical;
+    bool quatMode;
+    Quat mount;
+    float offHead, offRoll, offPit, offLon, offLat;
+};
 
 class IMU_Driver
 {
@@ -14,7 +29,7 @@ private:
     const uint8_t REG_DATA_START = 0x1A;
 
     // [修改] 增加长度以读取 Z 轴数据 (原20 -> 22)
-    // 假设 Z轴数据紧跟在 Y轴后面 (寄存器地址连续)
+    // 一次连续读出: EUL (0x1A, 6B) + QUA (0x20, 8B) + LIA (0x28, 6B，线性加速度，已去除重力) + 2B
     const uint8_t DATA_LEN = 22;
 
     const uint8_t REG_OPR_MODE = 0x3D;
@@ -22,9 +37,42 @@ private:
 
     const float ALPHA = 0.15;
 
+    // [修改] 请求间隔 20ms -> 10ms，跟上 BNO055 融合输出的 100Hz
+    // (115200 波特率下一次请求 + 应答共 28 字节，约 2.4ms)
+    const uint32_t REQ_INTERVAL_MS = 10;
+    // [新增] 发出读请求后这么久还没收到完整应答，就认为这一帧丢了，重新请求
+    const uint32_t REQ_TIMEOUT_MS = 30;
+
+    // [新增] 逐字节解析 + 请求流水线：任何时刻最多只有一个读请求在途，
+    // 应答一到 (或超时) 就按节拍发下一个，不再阻塞等待 readBytes()
+    BNOParser parser;
+    bool _reqInFlight = false;
+    uint32_t _lastReqMs = 0;
+
+    // [新增] 统计
+    uint32_t _dropped = 0;   // 请求超时没有应答
+    uint32_t _late = 0;      // 应答晚于一个请求间隔才到 (这一拍的数据已经晚了)
+    uint32_t _errors = 0;    // 0xEE 错误应答 (总线溢出等)
+    uint32_t _badFrames = 0; // 长度正确但数值明显错位的帧
+
     float _off_head = 0, _off_roll = 0, _off_pit = 0;
     float _off_lon = 0, _off_lat = 0;
 
+    // [新增] 四元数模式
+    bool _quatMode = false;
+    Quat _mount = {1, 0, 0, 0}; // 传感器坐标 -> 车身坐标 (车身: X 右, Y 前, Z 上)
+    Quat _mountInv = {1, 0, 0, 0};
+
+    // [新增] 发布的配置 (odd/even 版本号，奇数时有任务正在写，兼作写者之间的锁)
+    ImuConfig _cfgPending = {};
+    std::atomic<uint32_t> _cfgSeq{0};
+    uint32_t _cfgApplied = 0; // SensorTask 已换上的版本
+
+    // [新增] 每帧解析耗时 (CPU 周期)
+    uint32_t _cycFrames = 0;
+    uint64_t _cycSum = 0;
+    uint32_t _cycMax = 0;
+
     // --- [核心优化] 定义函数指针类型 ---
     // [修改] 增加 float az 参数，现在接收 6 个参数
     typedef void (IMU_Driver::*ProcessDataFunc)(float, float, float, float, float, float);
@@ -39,9 +87,18 @@ public:
     float lat_g = 0.0;
     float lon_g = 0.0;
 
+    // [新增] 校准后、未滤波的 G 值 (给 100Hz 日志用)
+    float lat_g_raw = 0.0;
+    float lon_g_raw = 0.0;
+    float vert_g = 0.0; // 垂直方向 (线性加速度，已去除重力)
+
     // 原始数据缓存
     float raw_head = 0, raw_roll = 0, raw_pit = 0;
     float raw_lon = 0, raw_lat = 0;
+    float raw_vert = 0;
+    // [新增] 传感器坐标下的原始四元数 (传感器 -> 世界) 和线性加速度 (m/s^2)，两种模式都会更新 (安装校准用)
+    Quat raw_q = {1, 0, 0, 0};
+    Vec3 raw_lia = {0, 0, 0};
 
     bool isConnected = false;
 
@@ -52,8 +109,11 @@ public:
 
     void begin()
     {
+        metrics.addCounter("imu.frames", &mFrames);
+        metrics.addCounter("imu.resyncs", &mResyncs);
+
         serial->begin(115200, SERIAL_8N1, rxPin, txPin);
-        serial->setTimeout(5);
+        parser.setExpectedLength(DATA_LEN);
         delay(100);
         uint8_t modeData = OPR_MODE_NDOF;
         sendCommand(WRITE_CMD, REG_OPR_MODE, 1, &modeData);
@@ -61,34 +121,37 @@ public:
         while (serial->available())
             serial->read();
 
-        // 初始化配置
+        // 初始化配置 (含零偏，第一次 update() 时生效)
         applyConfig();
 
         isConnected = true;
     }
 
-    // --- 当设置改变时调用 ---
+    // --- 当设置改变时调用 (任何任务) ---
+    // [修改] 只把 sys_cfg 里的安装方式、安装四元数和零偏打包发布，SensorTask 下一次 update() 时换上
     void applyConfig()
     {
-        // 根据 sys_cfg.mount_orientation 切换处理逻辑
+        ImuConfig c;
         // 0: Flat (平躺), 1: Vertical (竖立)
-        if (sys_cfg.mount_orientation == 1)
-        {
-            currentProcessor = &IMU_Driver::process_Vertical;
-        }
-        else
+        c.vertical = (sys_cfg.mount_orientation == 1);
+        // [新增] 四元数模式下不再使用平躺/竖立的处理函数和交换/反转开关
+        c.quatMode = sys_cfg.imu_quat_mode;
+        c.mount = Quat{sys_cfg.mount_qw, sys_cfg.mount_qx, sys_cfg.mount_qy, sys_cfg.mount_qz}.normalized();
+        c.offHead = sys_cfg.offset_heading;
+        c.offRoll = sys_cfg.offset_roll;
+        c.offPit = sys_cfg.offset_pitch;
+        c.offLon = sys_cfg.offset_lon;
+        c.offLat = sys_cfg.offset_lat;
+
+        uint32_t s = _cfgSeq.load(std::memory_order_relaxed);
+        while ((s & 1) || !_cfgSeq.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
         {
-            currentProcessor = &IMU_Driver::process_Flat;
+            vTaskDelay(1); // 另一个任务正在发布 (只是拷贝几十字节)
+            s = _cfgSeq.load(std::memory_order_relaxed);
         }
-    }
-
-    void setAllOffsets(float head, float roll, float pit, float lon, float lat)
-    {
-        _off_head = head;
-        _off_roll = roll;
-        _off_pit = pit;
-        _off_lon = lon;
-        _off_lat = lat;
+        std::atomic_thread_fence(std::memory_order_release);
+        _cfgPending = c;
+        _cfgSeq.store(s + 2, std::memory_order_release);
     }
 
     void getRawValues(float &h, float &r, float &p, float &lon, float &lat)
@@ -108,6 +171,7 @@ public:
     {
         raw_lat = ax;
         raw_lon = ay; // 使用 Y 轴作为纵向 G
+        raw_vert = az;
 
         raw_roll = r;
         raw_pit = p;
@@ -125,6 +189,7 @@ public:
         // 注意：根据安装方向（屏幕朝后还是朝前），这里可能需要 az 或 -az
         // 默认假设屏幕面向驾驶员，加速时 Z 轴感应到正向 G (视具体传感器坐标系而定，反了加负号即可)
         raw_lon = az;
+        raw_vert = ax;
 
         // 竖立时，Roll 和 Pitch 的物理意义也会交换，这里暂且保持原样或根据需求调整
         // 通常竖立时，原本的 Yaw 变成了 Roll，原本的 Pitch 还是 Pitch (视旋转轴而定)
@@ -135,6 +200,36 @@ public:
         finishProcessing(h);
     }
 
+    // [新增] 逻辑 C: 四元数模式
+    // qs: 传感器 -> 世界 (BNO 融合输出)，lia: 传感器坐标下的线性加速度 (m/s^2)
+    // 车身姿态 = qs * mount^-1 (车身 -> 世界)；G 值 = mount 旋转后的 lia，不做 EMA 滤波
+    void process_Quat(const Quat &qs, const Vec3 &lia)
+    {
+        const float G = 9.80665f;
+        Vec3 a = _mount.rotate(lia);
+        raw_lat = a.x / G;
+        raw_lon = a.y / G;
+        raw_vert = a.z / G;
+
+        // 航向顺时针为正 (与欧拉角模式一致)，抬头、右倾为正
+        quatToHeadingPitchRoll(qs * _mountInv, raw_head, raw_pit, raw_roll);
+
+        // 水平已由安装四元数校正，roll/pitch 不再减偏移；航向和 G 值零偏照旧
+        roll = raw_roll;
+        pitch = raw_pit;
+        heading = raw_head - _off_head;
+        while (heading < 0)
+            heading += 360.0;
+        while (heading >= 360)
+            heading -= 360.0;
+
+        lat_g_raw = raw_lat - _off_lat;
+        lon_g_raw = raw_lon - _off_lon;
+        vert_g = raw_vert;
+        lat_g = lat_g_raw;
+        lon_g = lon_g_raw;
+    }
+
     // 公共的后续步骤
     inline void finishProcessing(float h)
     {
@@ -179,75 +274,177 @@ public:
 
         float c_lat = raw_lat - _off_lat;
         float c_lon = raw_lon - _off_lon;
+        lat_g_raw = c_lat;
+        lon_g_raw = c_lon;
+        vert_g = raw_vert;
 
         // 滤波
         lat_g = (lat_g * (1.0 - ALPHA)) + (c_lat * ALPHA);
         lon_g = (lon_g * (1.0 - ALPHA)) + (c_lon * ALPHA);
     }
 
-    void update()
+    // [修改] 返回值：本次调用是否解析到一帧新数据
+    // 只处理串口里已经到达的字节 (不等待)，半帧留在解析器里，下次唤醒接着解析
+    bool update()
     {
-        // [修改] 检查缓冲区长度是否满足新的 DATA_LEN (22)
-        if (serial->available() >= (2 + DATA_LEN))
+        bool gotFrame = false;
+        uint32_t now = millis();
+        adoptConfig(); // [新增] 配置只在两帧之间切换
+
+        int n = serial->available();
+        while (n-- > 0)
         {
-            if (serial->peek() != 0xBB)
+            BNOFeedResult r = parser.feed((uint8_t)serial->read());
+            if (r == BNO_FRAME_OK)
             {
-                serial->read();
-                return;
+                if (now - _lastReqMs > REQ_INTERVAL_MS)
+                    _late++;
+                _reqInFlight = false;
+                if (decodeFrame(parser.payload()))
+                    gotFrame = true;
+                else
+                    _badFrames++;
             }
-
-            uint8_t header[2];
-            serial->readBytes(header, 2);
-
-            if (header[0] == 0xBB && header[1] == DATA_LEN)
+            else if (r == BNO_STATUS)
             {
-                uint8_t buf[DATA_LEN];
-                serial->readBytes(buf, DATA_LEN);
-
-                // 解析角度
-                int16_t h_int = (int16_t)((buf[1] << 8) | buf[0]);
-                int16_t r_int = (int16_t)((buf[3] << 8) | buf[2]);
-                int16_t p_int = (int16_t)((buf[5] << 8) | buf[4]);
-                float t_h = h_int / 16.0;
-                float t_r = r_int / 16.0;
-                float t_p = p_int / 16.0;
-
-                // 解析加速度 X, Y
-                int16_t x_int = (int16_t)((buf[15] << 8) | buf[14]);
-                int16_t y_int = (int16_t)((buf[17] << 8) | buf[16]);
-
-                // [新增] 解析加速度 Z (假设在 bytes 18-19)
-                int16_t z_int = (int16_t)((buf[19] << 8) | buf[18]);
-
-                float t_ax = (x_int / 100.0) / 9.81;
-                float t_ay = (y_int / 100.0) / 9.81;
-                float t_az = (z_int / 100.0) / 9.81; // 转换 Z 轴
-
-                // --- [核心优化] 直接通过指针调用，传入 6 个参数 ---
-                if (currentProcessor)
-                {
-                    (this->*currentProcessor)(t_h, t_r, t_p, t_ax, t_ay, t_az);
-                }
-
-                isConnected = true;
+                // 读请求只会收到错误码；写成功的应答 (0x01) 只在 begin() 里出现
+                if (parser.status() != BNO_STATUS_WRITE_OK)
+                    _errors++;
+                _reqInFlight = false;
             }
         }
 
-        static uint32_t last_req = 0;
-        if (millis() - last_req > 20)
+        // 在途请求超时：丢掉半帧，重新请求
+        if (_reqInFlight && now - _lastReqMs >= REQ_TIMEOUT_MS)
+        {
+            _dropped++;
+            _reqInFlight = false;
+            parser.reset();
+        }
+
+        // 上一个请求已经有了结果，按节拍发下一个
+        if (!_reqInFlight && now - _lastReqMs >= REQ_INTERVAL_MS)
         {
-            if (serial->available() > 64)
-            {
-                while (serial->available())
-                    serial->read();
-            }
-            // 请求数据
             sendCommand(READ_CMD, REG_DATA_START, DATA_LEN, NULL);
-            last_req = millis();
+            _lastReqMs = now;
+            _reqInFlight = true;
         }
+
+        mFrames.set(parser.getFrames());
+        mResyncs.set(parser.getResyncs());
+        return gotFrame;
+    }
+
+    // [新增] 打印解析统计 (串口 'h' 指令)
+    void printStats()
+    {
+        Serial.printf("[IMU] frames=%lu dropped=%lu late=%lu resync=%lu errors=%lu bad=%lu\n",
+                      parser.getFrames(), _dropped, _late, parser.getResyncs(), _errors, _badFrames);
+        Serial.printf("[IMU] %s decode: avg=%lu max=%lu cycles\n", _quatMode ? "quat" : "euler",
+                      _cycFrames ? (uint32_t)(_cycSum / _cycFrames) : 0, _cycMax);
+    }
+
+    uint32_t getDropped() { return _dropped; }
+    uint32_t getLate() { return _late; }
+    uint32_t getResyncs() { return parser.getResyncs(); }
+    uint32_t getErrors() { return _errors; }
+
+    // [新增] 注册串口接收回调 (一帧应答收完后的 UART 空闲超时触发)
+    void onReceive(OnReceiveCb cb)
+    {
+        serial->onReceive(cb, true);
     }
 
 private:
+    // [新增] SensorTask 里、解码下一帧之前调用：换上最新发布的配置。拷贝期间又有新的发布就等下一次
+    void adoptConfig()
+    {
+        uint32_t s = _cfgSeq.load(std::memory_order_acquire);
+        if (s == _cfgApplied || (s & 1))
+            return;
+        ImuConfig c;
+        memcpy(&c, (const void *)&_cfgPending, sizeof(c));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_cfgSeq.load(std::memory_order_relaxed) != s)
+            return;
+        _cfgApplied = s;
+
+        currentProcessor = c.vertical ? &IMU_Driver::process_Vertical : &IMU_Driver::process_Flat;
+        _quatMode = c.quatMode;
+        _mount = c.mount;
+        _mountInv = c.mount.conj();
+        _off_head = c.offHead;
+        _off_roll = c.offRoll;
+        _off_pit = c.offPit;
+        _off_lon = c.offLon;
+        _off_lat = c.offLat;
+        _cycFrames = 0;
+        _cycSum = 0;
+        _cycMax = 0;
+    }
+
+    // 解析一帧读应答 (EUL + QUA + LIA，从 0x1A 开始连续 22 字节)
+    // 协议没有校验和，欧拉角超出量程的帧说明字节错位了，直接丢弃
+    bool decodeFrame(const uint8_t *buf)
+    {
+        // 解析角度
+        int16_t h_int = (int16_t)((buf[1] << 8) | buf[0]);
+        int16_t r_int = (int16_t)((buf[3] << 8) | buf[2]);
+        int16_t p_int = (int16_t)((buf[5] << 8) | buf[4]);
+        if (h_int < 0 || h_int > 360 * 16 || abs(r_int) > 180 * 16 || abs(p_int) > 180 * 16)
+            return false;
+        uint32_t c0 = ESP.getCycleCount();
+
+        // QUA: w, x, y, z，1/2^14；LIA: 1/100 m/s^2
+        const float QS = 1.0f / 16384.0f;
+        Quat qs = {(int16_t)((buf[7] << 8) | buf[6]) * QS, (int16_t)((buf[9] << 8) | buf[8]) * QS,
+                   (int16_t)((buf[11] << 8) | buf[10]) * QS, (int16_t)((buf[13] << 8) | buf[12]) * QS};
+        raw_q = qs.normalized();
+        raw_lia = {(int16_t)((buf[15] << 8) | buf[14]) / 100.0f, (int16_t)((buf[17] << 8) | buf[16]) / 100.0f,
+                   (int16_t)((buf[19] << 8) | buf[18]) / 100.0f};
+
+        if (_quatMode)
+        {
+            process_Quat(raw_q, raw_lia);
+            recordCycles(ESP.getCycleCount() - c0);
+            isConnected = true;
+            return true;
+        }
+
+        float t_h = h_int / 16.0;
+        float t_r = r_int / 16.0;
+        float t_p = p_int / 16.0;
+
+        // 解析加速度 X, Y
+        int16_t x_int = (int16_t)((buf[15] << 8) | buf[14]);
+        int16_t y_int = (int16_t)((buf[17] << 8) | buf[16]);
+
+        // [新增] 解析加速度 Z (假设在 bytes 18-19)
+        int16_t z_int = (int16_t)((buf[19] << 8) | buf[18]);
+
+        float t_ax = (x_int / 100.0) / 9.81;
+        float t_ay = (y_int / 100.0) / 9.81;
+        float t_az = (z_int / 100.0) / 9.81; // 转换 Z 轴
+
+        // --- [核心优化] 直接通过指针调用，传入 6 个参数 ---
+        if (currentProcessor)
+        {
+            (this->*currentProcessor)(t_h, t_r, t_p, t_ax, t_ay, t_az);
+        }
+        recordCycles(ESP.getCycleCount() - c0);
+
+        isConnected = true;
+        return true;
+    }
+
+    void recordCycles(uint32_t c)
+    {
+        _cycFrames++;
+        _cycSum += c;
+        if (c > _cycMax)
+            _cycMax = c;
+    }
+
     void sendCommand(uint8_t rw, uint8_t reg, uint8_t len, uint8_t *data)
     {
         serial->write(START_BYTE);
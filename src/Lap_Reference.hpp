@@ -0,0 +1,328 @@
+#pragma once
+#include "Hal.hpp"
+#include <atomic>
+
+// ==========================================
+// 最佳圈参考轨迹 (按里程索引) + 实时圈速差
+// ==========================================
+// 每一圈按 (累计里程, 本圈已用时间) 记录成一条单调递增的轨迹。
+// 跑出比参考圈更快的一圈时，直接交换两块缓冲区的指针作为新的参考 (不拷贝)。
+// [修改] 存 SD 卡 (最多 64KB) 不在过线的 FusionTask 里做，由 loop() 调用 poll() 写入。
+// [修改] 切换赛道时的读卡也在 poll() 里做：读进第三块缓冲，FusionTask 在 adopt() 里交换指针换上，
+// _ref 始终只由 FusionTask 修改。
+// 实时差值 = 本圈已用时间 - 参考圈跑到相同里程时的用时 (线性插值)。
+// 查找用一个只会向前移动的游标，每帧只前进几个点，均摊 O(1)。
+
+// [修改] 点间距按里程而不是按帧：融合后 100Hz 更新，0.5m 的间距会让一圈只能记 4~7km。
+// 3m 间距下一圈至少能记 8192 x 3m ≈ 24.5km (覆盖纽北北环 20.8km)，与更新频率无关；
+// 相邻点之间线性插值，3m 对应的时间 (100km/h 时约 108ms) 内速度变化很小，差值精度不受影响
+#define LAP_REF_MAX_POINTS 8192   // 每块 64KB，放在 PSRAM
+#define LAP_REF_MIN_STEP_M 3.0f   // 两个记录点之间的最小里程
+#define LAP_REF_MAGIC 0x46525452  // "RTRF"
+#define LAP_REF_VERSION 1
+#define LAP_REF_DIR "/track_ref"
+
+struct LapRefPoint
+{
+    float dist;  // 累计里程 (m)
+    uint32_t ms; // 本圈已用时间 (ms)
+};
+
+struct LapRefFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t trackId;
+    uint32_t lapMs;
+    uint32_t count;
+};
+
+class LapReference
+{
+private:
+    LapRefPoint *_ref = NULL; // 参考圈 (最佳)
+    LapRefPoint *_rec = NULL; // 正在记录的这一圈
+    uint32_t _refCount = 0;
+    uint32_t _recCount = 0;
+    uint32_t _refLapMs = 0;  // 参考圈圈速 (0 表示没有参考)
+    bool _recOverflow = false;
+
+    float _dist = 0;         // 本圈累计里程
+    uint32_t _cursor = 0;    // 参考圈中 "里程 <= 当前里程" 的最后一个点
+    bool _hasDelta = false;
+    int32_t _delta = 0;      // 实时差值 (ms，负数为比参考快)
+
+    uint32_t _trackId = 0;
+
+    // [新增] 延迟加载: selectTrack() 把要加载的赛道和版本放进 _loadTrackId / _loadVersion，
+    // poll() 读进 _stage 后把版本放进 _stageVersion，adopt() 看到版本还是当前的就换上。
+    // _stageVersion 为 0 时 _stage 归 loop()，非 0 时归 FusionTask
+    LapRefPoint *_stage = NULL;
+    uint32_t _stageCount = 0;
+    uint32_t _stageLapMs = 0;
+    std::atomic<uint32_t> _loadTrackId{0};
+    std::atomic<uint32_t> _loadVersion{0};
+    std::atomic<uint32_t> _stageVersion{0};
+
+    // [新增] 延迟存盘: 参考圈每换一次 (新的最佳圈 / 加载 / 切换赛道) 版本号加 1；
+    // 新的最佳圈另外把版本号放进 _saveVersion，loop() 里 poll() 看到后写卡
+    std::atomic<uint32_t> _refVersion{0};
+    std::atomic<uint32_t> _saveVersion{0};
+    uint32_t _savedVersion = 0; // poll() 已处理到的版本 (只在 loop() 里读写)
+
+    // force: 终点必须记录，离上一个点太近时覆盖上一个点
+    void record(uint32_t ms, bool force = false)
+    {
+        if (_recCount > 0 && _dist - _rec[_recCount - 1].dist < LAP_REF_MIN_STEP_M)
+        {
+            if (!force)
+                return;
+            _recCount--;
+        }
+        if (_recCount >= LAP_REF_MAX_POINTS)
+        {
+            _recOverflow = true;
+            return;
+        }
+        _rec[_recCount].dist = _dist;
+        _rec[_recCount].ms = ms;
+        _recCount++;
+    }
+
+    // 游标向前推进，并在相邻两点之间插值出参考用时
+    void updateDelta(uint32_t ms)
+    {
+        if (_refCount < 2 || _dist > _ref[_refCount - 1].dist)
+        {
+            _hasDelta = false;
+            return;
+        }
+        while (_cursor + 1 < _refCount && _ref[_cursor + 1].dist <= _dist)
+            _cursor++;
+
+        const LapRefPoint &a = _ref[_cursor];
+        const LapRefPoint &b = _ref[(_cursor + 1 < _refCount) ? _cursor + 1 : _cursor];
+        float span = b.dist - a.dist;
+        float refMs = a.ms;
+        if (span > 0)
+            refMs += (b.ms - a.ms) * ((_dist - a.dist) / span);
+
+        _delta = (int32_t)ms - (int32_t)(refMs + 0.5f);
+        _hasDelta = true;
+    }
+
+    static const char *filePath(uint32_t trackId, char *path, size_t len)
+    {
+        snprintf(path, len, LAP_REF_DIR "/%08lX.bin", (unsigned long)trackId);
+        return path;
+    }
+
+    // 把版本 v 的参考圈写到 SD 卡。写的过程中参考圈被换掉 (版本号变了) 时，文件可能是新旧混合的，删掉
+    bool save(uint32_t v)
+    {
+        if (!halFs.isMounted())
+            return false;
+        LapRefFileHeader h = {LAP_REF_MAGIC, LAP_REF_VERSION, 0, _trackId, _refLapMs, _refCount};
+        const LapRefPoint *pts = _ref;
+        if (h.count < 2)
+            return false;
+        if (!halFs.exists(LAP_REF_DIR))
+            halFs.mkdir(LAP_REF_DIR);
+
+        char path[32];
+        HalFile f = halFs.open(filePath(_trackId, path, sizeof(path)), FILE_WRITE);
+        if (!f)
+            return false;
+        f.write((const uint8_t *)&h, sizeof(h));
+        f.write((const uint8_t *)pts, h.count * sizeof(LapRefPoint));
+        f.close();
+
+        if (_refVersion.load(std::memory_order_acquire) != v)
+        {
+            halFs.remove(path);
+            Serial.println("[REF] Reference changed while saving, discarded");
+            return false;
+        }
+        Serial.printf("[REF] Saved %s (%lu pts, %.3fs)\n", path, (unsigned long)h.count, h.lapMs / 1000.0);
+        return true;
+    }
+
+    // 把赛道 trackId 的参考圈读进 _stage (只在 loop() 里调用)
+    bool load(uint32_t trackId)
+    {
+        if (!halFs.isMounted())
+            return false;
+        char path[32];
+        filePath(trackId, path, sizeof(path));
+        if (!halFs.exists(path))
+            return false;
+
+        HalFile f = halFs.open(path, FILE_READ);
+        if (!f)
+            return false;
+        LapRefFileHeader h;
+        bool ok = f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                  h.magic == LAP_REF_MAGIC && h.version == LAP_REF_VERSION &&
+                  h.trackId == trackId && h.count >= 2 && h.count <= LAP_REF_MAX_POINTS;
+        if (ok)
+        {
+            size_t bytes = h.count * sizeof(LapRefPoint);
+            ok = f.read((uint8_t *)_stage, bytes) == bytes;
+        }
+        f.close();
+
+        if (!ok)
+        {
+            Serial.printf("[REF] Ignoring invalid %s\n", path);
+            return false;
+        }
+        _stageCount = h.count;
+        _stageLapMs = h.lapMs;
+        Serial.printf("[REF] Loaded %s (%lu pts, %.3fs)\n", path, (unsigned long)_stageCount, _stageLapMs / 1000.0);
+        return true;
+    }
+
+public:
+    ~LapReference()
+    {
+        free(_ref);
+        free(_rec);
+        free(_stage);
+    }
+
+    bool begin()
+    {
+        if (_ref)
+            return true;
+        _ref = (LapRefPoint *)hal_alloc_large(LAP_REF_MAX_POINTS * sizeof(LapRefPoint));
+        _rec = (LapRefPoint *)hal_alloc_large(LAP_REF_MAX_POINTS * sizeof(LapRefPoint));
+        _stage = (LapRefPoint *)hal_alloc_large(LAP_REF_MAX_POINTS * sizeof(LapRefPoint));
+        if (!_ref || !_rec || !_stage)
+        {
+            free(_ref);
+            free(_rec);
+            free(_stage);
+            _ref = _rec = _stage = NULL;
+            Serial.println("[REF] PSRAM alloc failed, live delta disabled");
+            return false;
+        }
+        return true;
+    }
+
+    // 切换赛道：清掉旧参考，请 loop() 从 SD 卡加载这条赛道的参考圈 (见 poll() / adopt())
+    void selectTrack(uint32_t trackId)
+    {
+        _trackId = trackId;
+        _refCount = 0;
+        _refLapMs = 0;
+        uint32_t v = _refVersion.fetch_add(1, std::memory_order_release) + 1; // 还没写卡的旧赛道参考圈作废
+        resetLap();
+        if (begin())
+        {
+            _loadTrackId.store(trackId, std::memory_order_relaxed);
+            _loadVersion.store(v, std::memory_order_release);
+        }
+    }
+
+    // [新增] FusionTask 里调用 (TrackManager::update 开头)：poll() 读好的参考圈换上。
+    // 读卡期间又切换了赛道或已经跑出了新的参考圈 (版本号变了) 的，丢弃
+    void adopt()
+    {
+        uint32_t v = _stageVersion.load(std::memory_order_acquire);
+        if (v == 0)
+            return;
+        if (v == _refVersion.load(std::memory_order_relaxed))
+        {
+            LapRefPoint *tmp = _ref;
+            _ref = _stage;
+            _stage = tmp;
+            _refCount = _stageCount;
+            _refLapMs = _stageLapMs;
+            _cursor = 0;
+            _refVersion.fetch_add(1, std::memory_order_release);
+        }
+        _stageVersion.store(0, std::memory_order_release); // _stage 还给 loop()
+    }
+
+    void resetLap()
+    {
+        _recCount = 0;
+        _recOverflow = false;
+        _dist = 0;
+        _cursor = 0;
+        _hasDelta = false;
+        _delta = 0;
+    }
+
+    // 过起点线时调用 (在过线点记录里程 0、用时 0)
+    void beginLap()
+    {
+        if (!_rec)
+            return;
+        resetLap();
+        record(0);
+    }
+
+    // 每个 GPS 点调用：step 为与上一点的距离 (m)，ms 为本圈已用时间
+    void addFix(float step, uint32_t ms)
+    {
+        if (!_rec)
+            return;
+        _dist += step;
+        record(ms);
+        updateDelta(ms);
+    }
+
+    // 过终点线时调用：step 为上一点到过线点的距离。返回 true 表示这一圈成为新的参考圈
+    bool finishLap(float step, uint32_t lapMs)
+    {
+        if (!_rec)
+            return false;
+        _dist += step;
+        record(lapMs, true);
+
+        bool better = !_recOverflow && _recCount >= 2 && (_refLapMs == 0 || lapMs < _refLapMs);
+        if (better)
+        {
+            LapRefPoint *tmp = _ref;
+            _ref = _rec;
+            _rec = tmp;
+            _refCount = _recCount;
+            _refLapMs = lapMs;
+            // 交给 loop() 写卡 (见 poll())
+            uint32_t v = _refVersion.fetch_add(1, std::memory_order_release) + 1;
+            _saveVersion.store(v, std::memory_order_release);
+        }
+        resetLap();
+        return better;
+    }
+
+    // [新增] 在 loop() 里调用：finishLap() 换上了新的参考圈时写到 SD 卡。
+    // 排队之后参考圈又被换掉的 (切换赛道 / 加载) 不再保存；又跑出更快一圈的，下次 poll() 存新的
+    // [修改] 切换了赛道时在这里读卡 (_stage 被 FusionTask 取走之前不再读)
+    void poll()
+    {
+        uint32_t v = _saveVersion.load(std::memory_order_acquire);
+        if (v != _savedVersion)
+        {
+            _savedVersion = v;
+            if (_refVersion.load(std::memory_order_acquire) == v)
+                save(v);
+        }
+
+        uint32_t lv = _loadVersion.load(std::memory_order_acquire);
+        if (lv != 0 && _stageVersion.load(std::memory_order_acquire) == 0 &&
+            _loadVersion.compare_exchange_strong(lv, 0, std::memory_order_acq_rel) &&
+            load(_loadTrackId.load(std::memory_order_relaxed)))
+            _stageVersion.store(lv, std::memory_order_release);
+    }
+
+    bool hasReference() { return _refCount >= 2; }
+    uint32_t getReferenceLapMs() { return _refLapMs; }
+    bool hasDelta() { return _hasDelta; }
+    int32_t getDelta() { return _delta; }
+    // 预测圈速 = 参考圈速 + 当前差值
+    uint32_t getPredictedLapMs() { return _hasDelta ? (uint32_t)((int32_t)_refLapMs + _delta) : 0; }
+    float getLapDistance() { return _dist; }
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+
+// --- 耗时/等待时间直方图 (固定桶，单位 us) ---
+// 传感器等待、刷屏、报圈延迟等都用它；Metrics 注册表直接引用这些实例
+class LatencyHistogram
+{
+public:
+    static const uint8_t NUM_BUCKETS = 9;
+
+private:
+    // 桶上限: <0.5ms <1ms <2ms <5ms <10ms <20ms <50ms <100ms >=100ms
+    const uint32_t EDGES_US[NUM_BUCKETS - 1] = {500, 1000, 2000, 5000, 10000, 20000, 50000, 100000};
+    uint32_t _counts[NUM_BUCKETS] = {0};
+    uint32_t _max_us = 0;
+    uint64_t _sum_us = 0;
+    uint32_t _total = 0;
+
+public:
+    void record(uint32_t us)
+    {
+        uint8_t i = 0;
+        while (i < NUM_BUCKETS - 1 && us >= EDGES_US[i])
+            i++;
+        _counts[i]++;
+        _sum_us += us;
+        _total++;
+        if (us > _max_us)
+            _max_us = us;
+    }
+
+    void reset()
+    {
+        memset(_counts, 0, sizeof(_counts));
+        _max_us = 0;
+        _sum_us = 0;
+        _total = 0;
+    }
+
+    void print(const char *name)
+    {
+        Serial.printf("[LAT] %s: n=%lu avg=%luus max=%luus\n", name, _total, getAvg(), _max_us);
+        for (uint8_t i = 0; i < NUM_BUCKETS; i++)
+        {
+            if (i < NUM_BUCKETS - 1)
+                Serial.printf("  <%6luus : %lu\n", EDGES_US[i], _counts[i]);
+            else
+                Serial.printf("  >=%5luus : %lu\n", EDGES_US[i - 1], _counts[i]);
+        }
+    }
+
+    uint32_t getTotal() { return _total; }
+    uint32_t getAvg() { return _total ? (uint32_t)(_sum_us / _total) : 0; }
+    uint32_t getMax() { return _max_us; }
+    uint32_t getBucket(uint8_t i) { return (i < NUM_BUCKETS) ? _counts[i] : 0; }
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// 二进制 session 日志格式 (.rtl)
+// ==========================================
+// 文件 = 文件头块 + 若干数据块，每块固定 RTL_BLOCK_SIZE 字节 (小端)。
+//   块 0     : RtlFileHeader，其余填 0
+//   块 1..n  : RtlBlockHeader + 同一类型的定长记录 (块尾未用部分填 0)
+// 每个数据块都带 session id、顺序号和 CRC32，损坏或残留的旧块可以被识别并跳过。
+// 第 seq 号数据块固定写在文件偏移 (seq + 1) * RTL_BLOCK_SIZE 处，每块只写一次 (同步时未写满的块直接封口，
+// 之后的记录开新块)，journal 提交过的块不会再被改写。
+// 主机端转换工具: tools/rtl2csv.py (改动这里的结构体时必须同步修改)
+
+#define RTL_MAGIC 0x314C5452       // "RTL1"
+#define RTL_BLOCK_MAGIC 0x4B4C4252 // "RBLK"
+#define RTL_VERSION 1
+#define RTL_BLOCK_SIZE 4096 // 扇区对齐，且能整除 FAT 簇大小 (4K~64K)
+
+enum RtlBlockType : uint8_t
+{
+    RTL_BLOCK_GPS = 1, // 10Hz 主记录 (与 CSV 的列一一对应)
+    RTL_BLOCK_IMU = 2  // [新增] IMU 原生速率 (100Hz) 记录，与 GPS 块交错存放
+};
+
+#define RTL_STREAM_COUNT 2 // 数据流数量 (= 块类型数)，每个流各有一个正在填充的块
+
+// 记录标志位
+#define RTL_FLAG_FIX 0x01        // 定位有效
+#define RTL_FLAG_DATE_VALID 0x02 // GPS 日期有效 (无效时 CSV 时间列输出 2000-01-01)
+
+struct RtlFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;  // sizeof(RtlFileHeader)
+    uint32_t blockSize;   // RTL_BLOCK_SIZE
+    uint32_t sessionId;   // 每个 session 随机生成，写进每个数据块
+    uint64_t startTimeMs; // session 开始时的系统时间 (ms，与 CSV 时间列同一时区)
+    uint16_t gpsRecordSize;
+    uint16_t reserved;
+    uint32_t crc;         // 本结构体 (crc 字段之前部分) 的 CRC32
+};
+
+struct RtlBlockHeader
+{
+    uint32_t magic;
+    uint32_t sessionId;
+    uint32_t seq;       // 数据块顺序号 (从 0 开始)
+    uint8_t type;       // RtlBlockType
+    uint8_t recordSize; // 单条记录字节数
+    uint16_t count;     // 本块记录条数
+    uint32_t crc;       // CRC32 (块头前 16 字节 + count * recordSize 字节记录)
+};
+
+#define RTL_BLOCK_PAYLOAD (RTL_BLOCK_SIZE - sizeof(RtlBlockHeader))
+
+struct RtlBlock
+{
+    RtlBlockHeader h;
+    uint8_t payload[RTL_BLOCK_PAYLOAD];
+};
+
+// 10Hz 主记录：全部是缩放后的整数，32 字节 (CSV 约 110 字节)
+struct RtlGpsRecord
+{
+    uint32_t t_ms;      // 距 session 开始的毫秒数
+    int32_t lat;        // 1e-7 度
+    int32_t lon;        // 1e-7 度
+    int32_t alt_cm;     // 海拔 (cm)
+    uint16_t speed_c;   // 速度 (0.01 km/h)
+    uint8_t sats;
+    uint8_t flags;      // RTL_FLAG_*
+    uint16_t heading_d; // 0.1 度
+    int16_t roll_d;     // 0.1 度
+    int16_t pitch_d;    // 0.1 度
+    int16_t lon_mg;     // 纵向 G (0.001 g)
+    int16_t lat_mg;     // 横向 G (0.001 g)
+    uint16_t reserved;
+};
+
+// [新增] 100Hz IMU 记录：校准后、未经 EMA 滤波的原始值，16 字节
+struct RtlImuRecord
+{
+    uint32_t t_ms;   // 距 session 开始的毫秒数 (帧到达时刻)
+    int16_t lat_mg;  // 横向 G (0.001 g)
+    int16_t lon_mg;  // 纵向 G (0.001 g)
+    int16_t vert_mg; // 垂直 G (0.001 g)
+    int16_t roll_d;  // 0.1 度
+    int16_t pitch_d; // 0.1 度
+    uint16_t reserved;
+};
+
+static_assert(sizeof(RtlFileHeader) == 32, "RtlFileHeader layout must match tools/rtl2csv.py");
+static_assert(sizeof(RtlBlockHeader) == 20, "RtlBlockHeader layout must match tools/rtl2csv.py");
+static_assert(sizeof(RtlBlock) == RTL_BLOCK_SIZE, "RtlBlock must be exactly one block");
+static_assert(sizeof(RtlGpsRecord) == 32, "RtlGpsRecord layout must match tools/rtl2csv.py");
+static_assert(sizeof(RtlImuRecord) == 16, "RtlImuRecord layout must match tools/rtl2csv.py");
+
+// [新增] 日志提交记录 (journal)：每次同步后原地更新，开机时据此恢复未正常关闭的 session
+#define RTL_JOURNAL_MAGIC 0x4A4C5452 // "RTLJ"
+#define RTL_JOURNAL_PATH "/session/journal.bin"
+
+enum RtlJournalState : uint8_t
+{
+    RTL_JOURNAL_CLOSED = 0, // 上一个 session 已正常关闭
+    RTL_JOURNAL_OPEN = 1    // 正在记录 (开机时看到这个状态说明中途断电)
+};
+
+struct RtlJournal
+{
+    uint32_t magic;
+    uint32_t sessionId;
+    uint32_t committedBlocks; // 已同步到卡上的数据块数 (0..n-1 号块全部有效)
+    uint8_t state;            // RtlJournalState
+    uint8_t reserved[3];
+    char path[48];            // session 文件路径
+    uint32_t crc;             // 前面所有字段的 CRC32
+};
+
+static_assert(sizeof(RtlJournal) == 68, "RtlJournal layout");
+
+// 标准 CRC-32 (与 zlib.crc32 相同)，半字节查表，表只有 64 字节
+inline uint32_t rtlCrc32(const uint8_t *data, size_t len, uint32_t crc = 0)
+{
+    static const uint32_t T[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ T[crc & 0x0F];
+        crc = (crc >> 4) ^ T[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// 计算并填写数据块的 CRC
+inline void rtlSealBlock(RtlBlock &b)
+{
+    uint32_t crc = rtlCrc32((const uint8_t *)&b.h, offsetof(RtlBlockHeader, crc));
+    b.h.crc = rtlCrc32(b.payload, (size_t)b.h.count * b.h.recordSize, crc);
+}
+
+inline bool rtlCheckBlock(const RtlBlock &b, uint32_t sessionId)
+{
+    if (b.h.magic != RTL_BLOCK_MAGIC || b.h.sessionId != sessionId || b.h.recordSize == 0 ||
+        (size_t)b.h.count * b.h.recordSize > RTL_BLOCK_PAYLOAD)
+        return false;
+    uint32_t crc = rtlCrc32((const uint8_t *)&b.h, offsetof(RtlBlockHeader, crc));
+    return rtlCrc32(b.payload, (size_t)b.h.count * b.h.recordSize, crc) == b.h.crc;
+}
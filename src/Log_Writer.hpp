@@ -0,0 +1,268 @@
+#pragma once
+#include "Hal.hpp"
+#include "Log_Format.hpp"
+
+// ==========================================
+// 日志编码 / 块缓冲 / 写卡 / 恢复 (只依赖 HAL，主机端可测)
+// ==========================================
+// DataLogger 负责从 GPS/IMU 取值、任务和队列；这里是与平台无关的部分:
+//   LogSample + logFormatCsv() / rtlEncodeGps() / rtlEncodeImu()   记录编码
+//   RtlBlockBuilder<Port>                                          采集侧块缓冲池
+//   rtlWriteFileHeader() / rtlWriteBlock() / rtlWriteJournal()     写卡侧
+//   rtlReadJournal() / rtlScanBlocks() / rtlRecoverSession()       开机恢复
+
+// 一条主记录的原始值 (CSV 一行 / RtlGpsRecord 一条)
+struct LogSample
+{
+    double lat, lon;
+    float alt_m;
+    float speed_kmh;
+    uint8_t sats;
+    bool fix;
+    bool dateValid;
+    float heading, roll, pitch;
+    float lon_g, lat_g;
+};
+
+inline int16_t rtlClampI16(long v) { return (int16_t)constrain(v, -32768L, 32767L); }
+
+// CSV 一行 (列顺序与表头 "Time,Lat,Lon,Alt,Speed_kmh,Sats,Fix,Heading,Roll,Pitch,Lon_G,Lat_G" 一致)
+inline int logFormatCsv(char *line, size_t size, const char *timestamp, const LogSample &s)
+{
+    return snprintf(line, size,
+                    "%s,%.8f,%.8f,%.2f,%.2f,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f\n",
+                    timestamp, s.lat, s.lon, s.alt_m, s.speed_kmh, s.sats, s.fix ? 1 : 0,
+                    s.heading, s.roll, s.pitch, s.lon_g, s.lat_g);
+}
+
+// 二进制主记录：只做整数缩放，不做任何字符串格式化
+inline void rtlEncodeGps(const LogSample &s, uint32_t t_ms, RtlGpsRecord &r)
+{
+    r.t_ms = t_ms;
+    r.lat = (int32_t)lround(s.lat * 1e7);
+    r.lon = (int32_t)lround(s.lon * 1e7);
+    r.alt_cm = (int32_t)lround(s.alt_m * 100);
+    r.speed_c = (uint16_t)constrain(lroundf(s.speed_kmh * 100), 0L, 65535L);
+    r.sats = s.sats;
+    r.flags = (s.fix ? RTL_FLAG_FIX : 0) | (s.dateValid ? RTL_FLAG_DATE_VALID : 0);
+    r.heading_d = (uint16_t)lroundf(s.heading * 10);
+    r.roll_d = (int16_t)lroundf(s.roll * 10);
+    r.pitch_d = (int16_t)lroundf(s.pitch * 10);
+    r.lon_mg = rtlClampI16(lroundf(s.lon_g * 1000));
+    r.lat_mg = rtlClampI16(lroundf(s.lat_g * 1000));
+    r.reserved = 0;
+}
+
+// 100Hz IMU 记录 (G 值为校准后、未滤波的原始值)
+inline void rtlEncodeImu(uint32_t t_ms, float lat_g, float lon_g, float vert_g, float roll, float pitch, RtlImuRecord &r)
+{
+    r.t_ms = t_ms;
+    r.lat_mg = rtlClampI16(lroundf(lat_g * 1000));
+    r.lon_mg = rtlClampI16(lroundf(lon_g * 1000));
+    r.vert_mg = rtlClampI16(lroundf(vert_g * 1000));
+    r.roll_d = (int16_t)lroundf(roll * 10);
+    r.pitch_d = (int16_t)lroundf(pitch * 10);
+    r.reserved = 0;
+}
+
+// --- 采集侧: 块缓冲池 ---
+// 每个数据流 (GPS / IMU) 各有一个正在填充的块，块满了计算 CRC 交给写卡方。
+// Port 是块下标的队列接口 (设备上是两个 FreeRTOS 队列，测试里是普通数组):
+//   bool takeFree(uint8_t &idx)   取一个空闲块，没有时立即返回 false (不阻塞采集)
+//   uint32_t freeCount()          空闲块数
+//   void submit(uint8_t idx)      交给写卡方 (写完后由写卡方放回空闲队列)
+template <typename Port>
+class RtlBlockBuilder
+{
+private:
+    RtlBlock *_pool = NULL;
+    Port *_port = NULL;
+    int8_t _cur[RTL_STREAM_COUNT] = {-1, -1}; // 每个数据流正在填充的块 (-1 表示没有)，下标为块类型 - 1
+    uint32_t _sessionId = 0;
+    uint32_t _seq = 0;      // 已分配的块数 (= 下一个块的顺序号)
+    uint32_t _dropped = 0;  // 缓冲池耗尽 (写卡跟不上) 时丢弃的记录数
+
+    // 取一个空闲块并写好块头
+    bool openBlock(RtlBlockType type, uint8_t recordSize)
+    {
+        uint8_t idx;
+        if (!_port->takeFree(idx))
+            return false;
+        RtlBlock &b = _pool[idx];
+        memset(&b, 0, sizeof(b));
+        b.h.magic = RTL_BLOCK_MAGIC;
+        b.h.sessionId = _sessionId;
+        b.h.seq = _seq++;
+        b.h.type = type;
+        b.h.recordSize = recordSize;
+        _cur[type - 1] = idx;
+        return true;
+    }
+
+public:
+    void begin(RtlBlock *pool, Port *port)
+    {
+        _pool = pool;
+        _port = port;
+    }
+
+    // 新 session: 之前未提交的块直接丢弃 (调用前应已 submitAll)
+    void reset(uint32_t sessionId)
+    {
+        _sessionId = sessionId;
+        _seq = 0;
+        _dropped = 0;
+        for (uint8_t s = 0; s < RTL_STREAM_COUNT; s++)
+            _cur[s] = -1;
+    }
+
+    // 每种类型的记录追加到自己的块里，块满了单独提交，所以文件里 GPS/IMU 块是交错的
+    void append(RtlBlockType type, const void *rec, uint8_t size)
+    {
+        uint8_t s = type - 1;
+        if (_cur[s] >= 0 && (size_t)(_pool[_cur[s]].h.count + 1) * size > RTL_BLOCK_PAYLOAD)
+            submit(s);
+        if (_cur[s] < 0 && !openBlock(type, size))
+        {
+            _dropped++;
+            return;
+        }
+        RtlBlock &b = _pool[_cur[s]];
+        memcpy(b.payload + b.h.count * size, rec, size);
+        b.h.count++;
+    }
+
+    // 计算 CRC 后交给写卡方。这个块从此不再改动 (同步时也用它把未写满的块封口)
+    void submit(uint8_t stream)
+    {
+        if (_cur[stream] < 0)
+            return;
+        uint8_t idx = _cur[stream];
+        rtlSealBlock(_pool[idx]);
+        _port->submit(idx);
+        _cur[stream] = -1;
+    }
+
+    void submitAll()
+    {
+        for (uint8_t s = 0; s < RTL_STREAM_COUNT; s++)
+            submit(s);
+    }
+
+    uint32_t blockCount() { return _seq; }
+    uint32_t getDropped() { return _dropped; }
+    uint32_t getSessionId() { return _sessionId; }
+};
+
+// --- 写卡侧 ---
+
+// 文件头占第 0 块 (其余填 0)
+inline bool rtlWriteFileHeader(HalFile &f, uint32_t sessionId, uint64_t startTimeMs)
+{
+    static RtlBlock hdrBlock; // 只在 session 开始时用一次
+    memset(&hdrBlock, 0, sizeof(hdrBlock));
+    RtlFileHeader *h = (RtlFileHeader *)&hdrBlock;
+    h->magic = RTL_MAGIC;
+    h->version = RTL_VERSION;
+    h->headerSize = sizeof(RtlFileHeader);
+    h->blockSize = RTL_BLOCK_SIZE;
+    h->sessionId = sessionId;
+    h->startTimeMs = startTimeMs;
+    h->gpsRecordSize = sizeof(RtlGpsRecord);
+    h->crc = rtlCrc32((const uint8_t *)h, offsetof(RtlFileHeader, crc));
+    return f.write((const uint8_t *)&hdrBlock, sizeof(hdrBlock)) == sizeof(hdrBlock);
+}
+
+// 数据块写到它的固定位置。
+// allocated 是文件已预分配的长度：不够时一次延长 prealloc 字节，FAT 表只在这时更新。返回写入字节数
+inline size_t rtlWriteBlock(HalFile &f, const RtlBlock &b, uint32_t &allocated, uint32_t prealloc)
+{
+    uint32_t pos = (b.h.seq + 1) * RTL_BLOCK_SIZE;
+    if (pos + RTL_BLOCK_SIZE > allocated)
+    {
+        uint32_t newSize = allocated + prealloc;
+        while (pos + RTL_BLOCK_SIZE > newSize)
+            newSize += prealloc;
+        uint8_t zero = 0;
+        if (f.seek(newSize - 1) && f.write(&zero, 1) == 1)
+            allocated = newSize;
+    }
+    if (!f.seek(pos))
+        return 0;
+    return f.write((const uint8_t *)&b, sizeof(RtlBlock));
+}
+
+inline void rtlWriteJournal(HalFile &jf, RtlJournalState state, uint32_t sessionId, uint32_t committed, const char *path)
+{
+    if (!jf)
+        return;
+    RtlJournal j;
+    memset(&j, 0, sizeof(j));
+    j.magic = RTL_JOURNAL_MAGIC;
+    j.sessionId = sessionId;
+    j.committedBlocks = committed;
+    j.state = state;
+    size_t n = min(strlen(path), sizeof(j.path) - 1); // j 已清零，保证以 0 结尾
+    memcpy(j.path, path, n);
+    j.crc = rtlCrc32((const uint8_t *)&j, offsetof(RtlJournal, crc));
+    jf.seek(0);
+    jf.write((const uint8_t *)&j, sizeof(j));
+    jf.flush();
+}
+
+// --- 开机恢复 ---
+
+// 读取并校验 journal (magic + CRC)，path 保证以 0 结尾
+inline bool rtlReadJournal(HalFile &jf, RtlJournal &j)
+{
+    if (!jf || jf.read((uint8_t *)&j, sizeof(j)) != sizeof(j))
+        return false;
+    if (j.magic != RTL_JOURNAL_MAGIC || j.crc != rtlCrc32((const uint8_t *)&j, offsetof(RtlJournal, crc)))
+        return false;
+    j.path[sizeof(j.path) - 1] = 0;
+    return true;
+}
+
+// 提交点之前的块在同步时已经落盘；之后的块能读到几块算几块，遇到第一个无效块 (CRC 错、
+// 其他 session 的残留、顺序号不对、文件结束) 停止。返回有效块数
+inline uint32_t rtlScanBlocks(HalFile &f, uint32_t sessionId, uint32_t committed)
+{
+    static RtlBlock blk;
+    uint32_t valid = committed;
+    while (f.seek((valid + 1) * RTL_BLOCK_SIZE) &&
+           f.read((uint8_t *)&blk, sizeof(blk)) == sizeof(blk) &&
+           rtlCheckBlock(blk, sessionId) && blk.h.seq == valid)
+        valid++;
+    return valid;
+}
+
+// 开机时调用：journal 显示上次记录中途断电时，找出有效块、截掉后面的部分，并把 journal 改为已关闭。
+// 进行了恢复返回 true (j 为原来的 journal 内容，valid 为恢复出的数据块数)；没有需要恢复的返回 false
+inline bool rtlRecoverSession(const char *journalPath, RtlJournal &j, uint32_t &valid)
+{
+    if (!halFs.exists(journalPath))
+        return false;
+
+    HalFile jf = halFs.open(journalPath, FILE_READ);
+    bool ok = rtlReadJournal(jf, j);
+    if (jf)
+        jf.close();
+    if (!ok || j.state != RTL_JOURNAL_OPEN)
+        return false;
+
+    valid = 0;
+    HalFile f = halFs.open(j.path, FILE_READ);
+    if (f)
+    {
+        valid = rtlScanBlocks(f, j.sessionId, j.committedBlocks);
+        f.close();
+        if (!halFs.truncate(j.path, (valid + 1) * RTL_BLOCK_SIZE))
+            Serial.printf("❌ [LOG] truncate %s failed\n", j.path);
+    }
+
+    HalFile out = halFs.open(journalPath, FILE_WRITE);
+    rtlWriteJournal(out, RTL_JOURNAL_CLOSED, j.sessionId, valid, j.path);
+    if (out)
+        out.close();
+    return true;
+}
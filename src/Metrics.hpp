@@ -0,0 +1,188 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "Latency_Histogram.hpp"
+
+// ==========================================
+// 运行指标注册表 (计数器 / 仪表 / 直方图)
+// ==========================================
+// 各驱动自己持有 MetricCounter / MetricGauge / LatencyHistogram，在 begin() 里登记到 metrics。
+// 热路径上只有一次原子加 (或一次赋值)，不加锁、不格式化字符串。
+// loop() 每圈调用 metrics.poll()，每秒采样一次: 算出计数器的每秒增量，更新堆 / PSRAM 余量。
+// 显示和导出 (诊断页、BLE CMD:STATS) 都通过 format() 逐条取文本。
+
+#define METRICS_MAX 24
+#define METRICS_PERIOD_MS 1000
+
+// 累计计数 (只增不减)。可以多个任务一起 add()；已经有累计值的来源可以直接 set()
+class MetricCounter
+{
+private:
+    std::atomic<uint32_t> _v{0};
+
+public:
+    void add(uint32_t n = 1) { _v.fetch_add(n, std::memory_order_relaxed); }
+    void set(uint32_t total) { _v.store(total, std::memory_order_relaxed); }
+    uint32_t get() { return _v.load(std::memory_order_relaxed); }
+};
+
+// 瞬时值
+class MetricGauge
+{
+private:
+    std::atomic<int32_t> _v{0};
+
+public:
+    void set(int32_t v) { _v.store(v, std::memory_order_relaxed); }
+    int32_t get() { return _v.load(std::memory_order_relaxed); }
+};
+
+enum MetricType : uint8_t
+{
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM
+};
+
+class Metrics
+{
+private:
+    struct Entry
+    {
+        const char *name;
+        const char *unit;
+        MetricType type;
+        void *ptr;
+        uint32_t last; // 计数器: 上次采样时的累计值
+        uint32_t rate; // 计数器: 最近一秒的增量
+    };
+
+    Entry _e[METRICS_MAX];
+    uint8_t _n = 0;
+    uint32_t _lastSampleMs = 0;
+
+    // 系统自带的仪表
+    MetricGauge _heapFree, _heapMin, _psramFree;
+
+    void addEntry(const char *name, const char *unit, MetricType type, void *ptr)
+    {
+        if (_n >= METRICS_MAX)
+        {
+            Serial.printf("[METRICS] registry full, %s dropped\n", name);
+            return;
+        }
+        _e[_n++] = {name, unit, type, ptr, 0, 0};
+    }
+
+public:
+    void begin()
+    {
+        addGauge("heap.free", &_heapFree, "KB");
+        addGauge("heap.min", &_heapMin, "KB");
+        addGauge("psram.free", &_psramFree, "KB");
+        sample();
+    }
+
+    void addCounter(const char *name, MetricCounter *c, const char *unit = "") { addEntry(name, unit, METRIC_COUNTER, c); }
+    void addGauge(const char *name, MetricGauge *g, const char *unit = "") { addEntry(name, unit, METRIC_GAUGE, g); }
+    void addHistogram(const char *name, LatencyHistogram *h) { addEntry(name, "us", METRIC_HISTOGRAM, h); }
+
+    // loop() 里每圈调用，够一秒才真正采样
+    void poll()
+    {
+        if (millis() - _lastSampleMs >= METRICS_PERIOD_MS)
+            sample();
+    }
+
+    void sample()
+    {
+        uint32_t now = millis();
+        uint32_t dt = now - _lastSampleMs;
+        _lastSampleMs = now;
+
+        _heapFree.set(ESP.getFreeHeap() / 1024);
+        _heapMin.set(ESP.getMinFreeHeap() / 1024);
+        _psramFree.set(ESP.getFreePsram() / 1024);
+
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            if (_e[i].type != METRIC_COUNTER)
+                continue;
+            uint32_t v = ((MetricCounter *)_e[i].ptr)->get();
+            // 按实际间隔折算成每秒 (loop 偶尔被阻塞时间隔会大于 1s)
+            _e[i].rate = dt ? (uint32_t)((uint64_t)(v - _e[i].last) * 1000 / dt) : 0;
+            _e[i].last = v;
+        }
+    }
+
+    uint8_t count() { return _n; }
+    const char *name(uint8_t i) { return (i < _n) ? _e[i].name : ""; }
+
+    // 第 i 条的数值部分 (诊断页右栏)
+    //   计数器: "1234 (56B/s)"    仪表: "78KB"    直方图: "avg 1200us max 8000us"
+    void formatValue(uint8_t i, char *buf, size_t len)
+    {
+        if (i >= _n)
+        {
+            buf[0] = 0;
+            return;
+        }
+        Entry &e = _e[i];
+        switch (e.type)
+        {
+        case METRIC_COUNTER:
+            snprintf(buf, len, "%lu (%lu%s/s)", ((MetricCounter *)e.ptr)->get(), e.rate, e.unit);
+            break;
+        case METRIC_GAUGE:
+            snprintf(buf, len, "%ld%s", ((MetricGauge *)e.ptr)->get(), e.unit);
+            break;
+        case METRIC_HISTOGRAM:
+        {
+            LatencyHistogram *h = (LatencyHistogram *)e.ptr;
+            snprintf(buf, len, "avg %luus max %luus", h->getAvg(), h->getMax());
+            break;
+        }
+        }
+    }
+
+    // 第 i 条的完整文本 (BLE / 串口): "name=..."，直方图附带全部桶计数
+    //   "gps.bytes=123456,rate=960"   "heap.free=78"   "lvgl.frame=n:500,avg:1200,max:8000,h:1/2/3/4/5/6/7/8/9"
+    void format(uint8_t i, char *buf, size_t len)
+    {
+        if (i >= _n)
+        {
+            buf[0] = 0;
+            return;
+        }
+        Entry &e = _e[i];
+        switch (e.type)
+        {
+        case METRIC_COUNTER:
+            snprintf(buf, len, "%s=%lu,rate=%lu", e.name, ((MetricCounter *)e.ptr)->get(), e.rate);
+            break;
+        case METRIC_GAUGE:
+            snprintf(buf, len, "%s=%ld", e.name, ((MetricGauge *)e.ptr)->get());
+            break;
+        case METRIC_HISTOGRAM:
+        {
+            LatencyHistogram *h = (LatencyHistogram *)e.ptr;
+            int n = snprintf(buf, len, "%s=n:%lu,avg:%lu,max:%lu,h:", e.name, h->getTotal(), h->getAvg(), h->getMax());
+            for (uint8_t b = 0; b < LatencyHistogram::NUM_BUCKETS && n > 0 && (size_t)n < len; b++)
+                n += snprintf(buf + n, len - n, b ? "/%lu" : "%lu", h->getBucket(b));
+            break;
+        }
+        }
+    }
+
+    void print()
+    {
+        char line[128];
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            format(i, line, sizeof(line));
+            Serial.printf("[METRICS] %s\n", line);
+        }
+    }
+};
+
+Metrics metrics;
@@ -61,19 +61,6 @@ static void ensure_styles_init()
 
     styles_initialized = true;
 }
-// 辅助函数: 计算两点距离
-float calc_dist_ui(double lat1, double lon1, double lat2, double lon2)
-{
-    const double R = 6371000.0;
-    double dLat = (lat2 - lat1) * DEG_TO_RAD;
-    double dLon = (lon2 - lon1) * DEG_TO_RAD;
-    double a = sin(dLat / 2) * sin(dLat / 2) +
-               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) *
-                   sin(dLon / 2) * sin(dLon / 2);
-    double c = 2 * atan2(sqrt(a), sqrt(1 - a));
-    return (float)(R * c);
-}
-
 // ==========================================
 // 事件回调
 // ==========================================
@@ -116,8 +103,8 @@ void btn_track_event_cb(lv_event_t *e)
     {
         Serial.println("[UI] Track Button -> STOP RACE");
 
-        // 1. 退出赛道逻辑
-        trackMgr.exitTrackMode();
+        // 1. 退出赛道逻辑 ([修改] 由 FusionTask 执行)
+        trackMgr.requestArm(false);
 
         // 2. 停止系统运行状态 (停止录制日志等)
         sys_cfg.is_running = false;
@@ -131,7 +118,7 @@ void btn_track_event_cb(lv_event_t *e)
     if (sys_cfg.is_running && sys_cfg.current_mode == MODE_ROAM)
         return;
 
-    trackMgr.enterStandbyMode();
+    trackMgr.requestArm(true); // [修改] UiTask 不直接改赛道状态，由 FusionTask 在下一轮套用
     sys_cfg.current_mode = MODE_TRACK;
 
     build_track_wait_page();
@@ -186,7 +173,7 @@ void btn_wait_exit_event_cb(lv_event_t *e)
 
     // [核心修改] 用户退出了，必须关闭赛道检测！
     // 否则回到主页后，如果车经过起点，依然会在后台触发计时
-    trackMgr.exitTrackMode();
+    trackMgr.requestArm(false);
 
     // A. 杀死定时器
     if (timer_track_wait)
@@ -329,13 +316,11 @@ void track_wait_timer_cb(lv_timer_t *timer)
     // 更新距离 (带 Age 检查，防止旧数据)
     if (gps.tgps.location.isValid() && gps.tgps.location.age() < 3000)
     {
-        double sLat, sLon;
-        trackMgr.getStartPoint(sLat, sLon);
-
-        if (abs(sLat) < 0.1)
+        if (!trackMgr.isTrackSetup())
             return;
 
-        float dist = calc_dist_ui(gps.tgps.location.lat(), gps.tgps.location.lng(), sLat, sLon);
+        // [修改] 复用赛道管理器预计算的局部坐标系，不再单独做 haversine
+        float dist = trackMgr.getDistanceToStart(gps.tgps.location.lat(), gps.tgps.location.lng());
 
         if (dist < trackMgr.getTriggerRadius() * 2)
         {
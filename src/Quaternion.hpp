@@ -0,0 +1,123 @@
+#pragma once
+#include <math.h>
+
+// ==========================================
+// 最小四元数 / 三维向量工具 (IMU 坐标变换用)
+// ==========================================
+// 约定: 单位四元数 q 表示把 A 坐标系中的向量转到 B 坐标系: v_B = q * v_A * q^-1
+// 两个旋转的复合: q_CA = q_CB * q_BA
+
+struct Vec3
+{
+    float x, y, z;
+
+    Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+    Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+    Vec3 operator*(float s) const { return {x * s, y * s, z * s}; }
+    float dot(const Vec3 &o) const { return x * o.x + y * o.y + z * o.z; }
+    Vec3 cross(const Vec3 &o) const { return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x}; }
+    float norm() const { return sqrtf(x * x + y * y + z * z); }
+    Vec3 normalized() const
+    {
+        float n = norm();
+        return (n > 1e-9f) ? (*this) * (1.0f / n) : Vec3{0, 0, 0};
+    }
+};
+
+struct Quat
+{
+    float w, x, y, z;
+
+    static Quat identity() { return {1, 0, 0, 0}; }
+
+    Quat operator*(const Quat &o) const
+    {
+        return {w * o.w - x * o.x - y * o.y - z * o.z,
+                w * o.x + x * o.w + y * o.z - z * o.y,
+                w * o.y - x * o.z + y * o.w + z * o.x,
+                w * o.z + x * o.y - y * o.x + z * o.w};
+    }
+
+    Quat conj() const { return {w, -x, -y, -z}; }
+
+    Quat normalized() const
+    {
+        float n = sqrtf(w * w + x * x + y * y + z * z);
+        if (n < 1e-9f)
+            return identity();
+        float k = 1.0f / n;
+        return {w * k, x * k, y * k, z * k};
+    }
+
+    // v' = q v q^-1，展开成 v + w*t + u x t (t = 2u x v)，18 次乘法，不用先转矩阵
+    Vec3 rotate(const Vec3 &v) const
+    {
+        Vec3 u = {x, y, z};
+        Vec3 t = u.cross(v) * 2.0f;
+        return v + t * w + u.cross(t);
+    }
+
+    // 把单位向量 from 转到 to 的最短旋转 (两者反向时绕任意垂直轴转 180 度)
+    static Quat fromTwoVectors(const Vec3 &from, const Vec3 &to)
+    {
+        Vec3 a = from.normalized();
+        Vec3 b = to.normalized();
+        float d = a.dot(b);
+        if (d < -0.999999f)
+        {
+            Vec3 axis = (fabsf(a.x) < 0.9f) ? Vec3{1, 0, 0}.cross(a) : Vec3{0, 1, 0}.cross(a);
+            axis = axis.normalized();
+            return {0, axis.x, axis.y, axis.z};
+        }
+        Vec3 c = a.cross(b);
+        return Quat{1.0f + d, c.x, c.y, c.z}.normalized();
+    }
+
+    // 由旋转矩阵的三行构造 (r0/r1/r2 = 目标坐标系的 X/Y/Z 轴在源坐标系中的表示，须为右手正交基)
+    static Quat fromRows(const Vec3 &r0, const Vec3 &r1, const Vec3 &r2)
+    {
+        float tr = r0.x + r1.y + r2.z;
+        Quat q;
+        if (tr > 0)
+        {
+            float s = sqrtf(tr + 1.0f) * 2.0f;
+            q = {0.25f * s, (r2.y - r1.z) / s, (r0.z - r2.x) / s, (r1.x - r0.y) / s};
+        }
+        else if (r0.x > r1.y && r0.x > r2.z)
+        {
+            float s = sqrtf(1.0f + r0.x - r1.y - r2.z) * 2.0f;
+            q = {(r2.y - r1.z) / s, 0.25f * s, (r0.y + r1.x) / s, (r0.z + r2.x) / s};
+        }
+        else if (r1.y > r2.z)
+        {
+            float s = sqrtf(1.0f + r1.y - r0.x - r2.z) * 2.0f;
+            q = {(r0.z - r2.x) / s, (r0.y + r1.x) / s, 0.25f * s, (r1.z + r2.y) / s};
+        }
+        else
+        {
+            float s = sqrtf(1.0f + r2.z - r0.x - r1.y) * 2.0f;
+            q = {(r1.x - r0.y) / s, (r0.z + r2.x) / s, (r1.z + r2.y) / s, 0.25f * s};
+        }
+        return q.normalized();
+    }
+
+    // 绕单位轴 axis 旋转 angle 弧度
+    static Quat fromAxisAngle(const Vec3 &axis, float angle)
+    {
+        float s = sinf(angle * 0.5f);
+        return {cosf(angle * 0.5f), axis.x * s, axis.y * s, axis.z * s};
+    }
+};
+
+// [新增] 车身姿态 q (车身 -> 世界；车身 X 右 Y 前 Z 上，世界 X 东 Y 北 Z 上) 换算成角度 (度)
+// heading: 顺时针为正 (-180..180，与罗盘一致)；pitch: 抬头为正；roll: 右倾为正
+inline void quatToHeadingPitchRoll(const Quat &q, float &heading, float &pitch, float &roll)
+{
+    const float R2D = 57.29577951f;
+    Vec3 fwd = q.rotate({0, 1, 0});
+    Vec3 right = q.rotate({1, 0, 0});
+    Vec3 up = q.rotate({0, 0, 1});
+    heading = atan2f(fwd.x, fwd.y) * R2D;
+    pitch = atan2f(fwd.z, sqrtf(fwd.x * fwd.x + fwd.y * fwd.y)) * R2D;
+    roll = atan2f(-right.z, up.z) * R2D;
+}
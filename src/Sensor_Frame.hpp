@@ -0,0 +1,39 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// 传感器帧 (SensorTask -> FusionTask 的队列元素)
+// ==========================================
+// 单独成文件只依赖 HAL，融合 (Fusion_Estimator.hpp) 和回放在主机端也能用
+
+enum SensorFrameType : uint8_t
+{
+    FRAME_GPS = 0,
+    FRAME_IMU = 1
+};
+
+struct SensorFrame
+{
+    SensorFrameType type;
+    uint32_t arrival_us; // 到达时刻 (micros)，用于统计等待时间
+    uint32_t arrival_ms; // 到达时刻 (millis)，给计时算法用
+
+    // GPS 帧
+    uint32_t epoch_ms; // GPS 周期时间 (已映射到 millis 时间轴，去除了到达抖动)
+    bool fix;
+    uint8_t sats; // [新增] 与位置同一时刻取的卫星数
+    double lat;
+    double lon;
+    float course;
+    float speed_kmh;
+
+    // IMU 帧
+    float heading;
+    float roll;
+    float pitch;
+    float lon_g;
+    float lat_g;
+    float lon_g_raw; // [新增] 未滤波的 G 值 (100Hz 日志用)
+    float lat_g_raw;
+    float vert_g;
+};
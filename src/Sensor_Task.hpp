@@ -0,0 +1,310 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "GPS_Driver.hpp"
+#include "IMU_Driver.hpp"
+#include "IMU_Calibration.hpp"
+#include "Task_Monitor.hpp"
+#include "Trace.hpp"
+#include "Latency_Histogram.hpp"
+#include "Session_Replay.hpp"
+#include "Sensor_Frame.hpp"
+
+extern GPS_Driver gps;
+extern IMU_Driver imu;
+
+// ==========================================
+// 传感器接收任务 (事件驱动)
+// ==========================================
+// GPS / IMU 串口收到一段突发数据后 (UART 空闲超时) 唤醒本任务，
+// 立即解析并给每一帧打上到达时间戳，然后放进队列。
+// loop() 里的消费者从队列取帧，不再受 lv_timer_handler() 渲染耗时的影响。
+// [新增] 演示模式: 帧改为从 SD 卡上的 session 日志按原来的时间间隔读出 (Session_Replay.hpp)，
+// 下游的融合、赛道计时、UI、直线加速都和真实驾驶一样跑；串口照常读，只是不再发布。
+
+enum DemoState : uint8_t
+{
+    DEMO_OFF = 0,
+    DEMO_STARTING = 1, // 文件已打开，等 SensorTask 接手
+    DEMO_ON = 2,
+    DEMO_STOPPING = 3  // 等 SensorTask 关闭文件
+};
+
+class SensorTask
+{
+private:
+    static const uint8_t QUEUE_LEN = 32;
+    static const uint32_t IMU_POLL_MS = 10; // 没有串口事件时，最长 10ms 也要醒来发 IMU 读请求 (100Hz)
+
+    TaskHandle_t _task = NULL;
+    QueueHandle_t _queue = NULL;
+    // [修改] GPS / IMU 各自的串口事件时刻 (共用一个时，一路的事件会被当成另一路帧的到达时间)
+    volatile uint32_t _gpsRxUs = 0;
+    volatile uint32_t _imuRxUs = 0;
+    uint32_t _dropped = 0;           // 队列满被丢弃的帧数
+    int8_t _monId = -1;
+
+    // [新增] 演示输入源 (文件只在 SensorTask 里读；开始时由调用方打开，状态切到 DEMO_STARTING 后交出)
+    // [修改] 交接靠 _demoState 的 release/acquire: 调用方打开文件后 release 写 STARTING，
+    // SensorTask acquire 读到 STARTING 时一定能看到打开后的 _demo；反过来 SensorTask 关闭文件后才 release 写 OFF
+    SessionReader _demo;
+    std::atomic<uint8_t> _demoState{DEMO_OFF};
+    std::atomic<bool> _demoEnded{false}; // 播放结束，等 loop() 发 MSG:DEMO=END (SensorTask 里不做 BLE 发送)
+    ReplayFrame _demoFrame;
+    bool _demoHasFrame = false;
+    uint32_t _demoBaseMs = 0; // 日志时间 0 对应的 millis()
+    uint32_t _demoBaseUs = 0;
+
+    void publish(SensorFrame &f)
+    {
+        if (xQueueSend(_queue, &f, 0) != pdTRUE)
+            _dropped++;
+    }
+
+    void endDemo(const char *why)
+    {
+        Serial.printf("[DEMO] %s (%lu frames)\n", why, (unsigned long)_demo.getFrames());
+        _demo.close();
+        _demoHasFrame = false;
+        _demoEnded.store(true, std::memory_order_relaxed);
+        _demoState.store(DEMO_OFF, std::memory_order_release);
+    }
+
+    // 发布所有已经到时间的日志帧 (每次唤醒最多晚 IMU_POLL_MS)
+    void pollDemo()
+    {
+        uint8_t state = _demoState.load(std::memory_order_acquire);
+        if (state == DEMO_STOPPING)
+        {
+            endDemo("stopped");
+            return;
+        }
+        if (state == DEMO_STARTING)
+        {
+            if (!_demo.next(_demoFrame))
+            {
+                endDemo("empty log");
+                return;
+            }
+            _demoHasFrame = true;
+            _demoBaseMs = millis() - _demoFrame.t_ms;
+            _demoBaseUs = micros() - _demoFrame.t_ms * 1000;
+            // 同时 stopDemo() 改成了 STOPPING 时保留它，下一次唤醒再关闭
+            if (!_demoState.compare_exchange_strong(state, DEMO_ON, std::memory_order_acq_rel))
+                return;
+        }
+        else if (state != DEMO_ON)
+            return;
+
+        uint32_t now = millis();
+        while (true)
+        {
+            if (!_demoHasFrame)
+            {
+                if (!_demo.next(_demoFrame))
+                {
+                    endDemo("finished");
+                    return;
+                }
+                _demoHasFrame = true;
+            }
+            const ReplayFrame &r = _demoFrame;
+            uint32_t due = _demoBaseMs + r.t_ms;
+            if ((int32_t)(now - due) < 0)
+                break;
+
+            // 时间戳按日志时间换算，融合的积分步长与原来一致 (不受唤醒抖动影响)
+            SensorFrame f;
+            f.arrival_ms = due;
+            f.arrival_us = _demoBaseUs + r.t_ms * 1000;
+            if (r.type == REPLAY_GPS)
+            {
+                f.type = FRAME_GPS;
+                f.epoch_ms = due;
+                f.fix = r.fix;
+                f.sats = r.sats;
+                f.lat = r.lat;
+                f.lon = r.lon;
+                f.course = r.course;
+                f.speed_kmh = r.speed_kmh;
+            }
+            else
+            {
+                f.type = FRAME_IMU;
+                f.heading = r.heading;
+                f.roll = r.roll;
+                f.pitch = r.pitch;
+                f.lon_g = f.lon_g_raw = r.lon_g;
+                f.lat_g = f.lat_g_raw = r.lat_g;
+                f.vert_g = r.vert_g;
+            }
+            publish(f);
+            _demoHasFrame = false;
+        }
+    }
+
+    // 取出一路串口的事件时刻并清零；超过 50ms 的旧时刻不用
+    static void arrivalTime(volatile uint32_t &rx, uint32_t now_us, uint32_t now_ms, uint32_t &us, uint32_t &ms)
+    {
+        uint32_t rx_us = rx;
+        rx = 0;
+        us = (rx_us != 0 && now_us - rx_us < 50000) ? rx_us : now_us;
+        ms = now_ms - (now_us - us) / 1000;
+    }
+
+    static void taskLoop(void *param)
+    {
+        SensorTask *self = (SensorTask *)param;
+        SensorFrame f;
+
+        while (true)
+        {
+            // 等待串口事件唤醒 (或超时，用于 IMU 的周期性读请求)
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IMU_POLL_MS));
+            uint32_t t_busy = micros();
+
+            // 到达时间：优先使用本路串口的事件时刻，没有事件时 (超时唤醒) 用当前时刻
+            uint32_t now_us = micros();
+            uint32_t now_ms = millis();
+            uint32_t gps_us, gps_ms, imu_us, imu_ms;
+            arrivalTime(self->_gpsRxUs, now_us, now_ms, gps_us, gps_ms);
+            arrivalTime(self->_imuRxUs, now_us, now_ms, imu_us, imu_ms);
+
+            // [新增] 演示模式下发布日志帧，串口数据照常解析但丢弃
+            self->pollDemo();
+            bool live = (self->_demoState.load(std::memory_order_relaxed) == DEMO_OFF);
+
+            if (gps.update() && live)
+            {
+                f.type = FRAME_GPS;
+                f.arrival_us = gps_us;
+                f.arrival_ms = gps_ms;
+                f.epoch_ms = gps.mapEpochMs(gps_ms);
+                f.fix = gps.hasFix();
+                f.sats = gps.getSatellites();
+                f.lat = gps.getLat();
+                f.lon = gps.getLng();
+                f.course = gps.getCourse();
+                f.speed_kmh = gps.getSpeed();
+                TRACE_MARK(TRACE_GPS_EPOCH, f.fix);
+                self->publish(f);
+            }
+
+            if (imu.update() && live)
+            {
+                imuCal.addSample(imu); // [新增] 安装校准采样 (未在校准时直接返回)
+                f.type = FRAME_IMU;
+                f.arrival_us = imu_us;
+                f.arrival_ms = imu_ms;
+                f.heading = imu.heading;
+                f.roll = imu.roll;
+                f.pitch = imu.pitch;
+                f.lon_g = imu.lon_g;
+                f.lat_g = imu.lat_g;
+                f.lon_g_raw = imu.lon_g_raw;
+                f.lat_g_raw = imu.lat_g_raw;
+                f.vert_g = imu.vert_g;
+                TRACE_MARK(TRACE_IMU_FRAME, 0);
+                self->publish(f);
+            }
+            taskMon.addBusy(self->_monId, micros() - t_busy);
+        }
+    }
+
+public:
+    LatencyHistogram gpsLatency;
+    LatencyHistogram imuLatency;
+
+    void begin()
+    {
+        _queue = xQueueCreate(QUEUE_LEN, sizeof(SensorFrame));
+
+        // 与 loop() 同核 (Core 1)，优先级更高：有数据到达时立即抢占 UI 渲染
+        // [修改] 栈 4K -> 6K: 演示模式在本任务里读 SD 卡
+        xTaskCreatePinnedToCore(taskLoop, "SensorTask", 6144, this, 5, &_task, 1);
+        _monId = taskMon.add("SensorTask", &_task);
+
+        // 串口事件 -> 记下本路的时刻，唤醒任务
+        auto wakeGps = [this]()
+        {
+            _gpsRxUs = micros();
+            if (_task)
+                xTaskNotifyGive(_task);
+        };
+        auto wakeImu = [this]()
+        {
+            _imuRxUs = micros();
+            if (_task)
+                xTaskNotifyGive(_task);
+        };
+        gps.onReceive(wakeGps);
+        imu.onReceive(wakeImu);
+
+        Serial.println("[SENSOR] Ingest task running on Core 1");
+    }
+
+    // 非阻塞取一帧 (队列空返回 false)
+    bool receive(SensorFrame &f)
+    {
+        return _queue && xQueueReceive(_queue, &f, 0) == pdTRUE;
+    }
+
+    // [新增] 阻塞等到队列里有帧 (不取出)，超时返回 false
+    bool waitForFrame(TickType_t timeout)
+    {
+        SensorFrame f;
+        return _queue && xQueuePeek(_queue, &f, timeout) == pdTRUE;
+    }
+
+    // 消费者用完一帧后调用，记录 "到达 -> 使用" 的等待时间
+    void markConsumed(const SensorFrame &f)
+    {
+        uint32_t wait_us = micros() - f.arrival_us;
+        if (f.type == FRAME_GPS)
+            gpsLatency.record(wait_us);
+        else
+            imuLatency.record(wait_us);
+    }
+
+    void printLatency()
+    {
+        gpsLatency.print("GPS");
+        imuLatency.print("IMU");
+        Serial.printf("[LAT] queue dropped=%lu\n", _dropped);
+    }
+
+    uint32_t getDropped() { return _dropped; }
+
+    // [新增] 演示模式: 回放 SD 卡上的 session 日志 (.csv / .rtl)，播完自动回到真实输入
+    // 已经在演示中或文件打不开时返回 false
+    // 只应从一个任务 (BLE 指令) 调用：状态为 OFF 时 SensorTask 不会碰 _demo
+    bool startDemo(const char *path)
+    {
+        if (_demoState.load(std::memory_order_acquire) != DEMO_OFF || !halFs.isMounted() || !_demo.open(path))
+            return false;
+        Serial.printf("[DEMO] Playing %s (%s)\n", path, _demo.isBinary() ? "rtl" : "csv");
+        _demoState.store(DEMO_STARTING, std::memory_order_release); // 文件打开后才交给 SensorTask
+        xTaskNotifyGive(_task);
+        return true;
+    }
+
+    void stopDemo()
+    {
+        uint8_t state = _demoState.load(std::memory_order_relaxed);
+        while ((state == DEMO_ON || state == DEMO_STARTING) &&
+               !_demoState.compare_exchange_weak(state, DEMO_STOPPING, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    bool isDemo() { return _demoState.load(std::memory_order_relaxed) != DEMO_OFF; }
+
+    // [新增] loop() 里调用：播放结束的通知在这里发 (BLE 发送可能阻塞，不放在优先级 5 的 SensorTask)
+    void pollDemoEvents()
+    {
+        if (_demoEnded.exchange(false, std::memory_order_relaxed))
+            ble.send("MSG:DEMO=END");
+    }
+};
+
+SensorTask sensorTask;
@@ -0,0 +1,587 @@
+#pragma once
+#include <utility>
+#include "Hal.hpp"
+#include "Log_Format.hpp"
+#include "Track_Manager.hpp"
+#include "DragRace_Manager.hpp"
+
+// ==========================================
+// Session 日志回放
+// ==========================================
+// 读 /session 下的 CSV 或二进制 .rtl 日志 (按文件头自动识别)，按时间顺序还原出 GPS / IMU 帧。
+//   主机端: SessionReplay 用虚拟时钟 (halClock) 全速驱动 TrackManager / DragRaceManager，
+//           记下检测到的圈速和直线加速成绩；结果可以存成基准文件，改了阈值之后再比较 (program replay)
+//   设备上: SensorTask 的演示输入源 (CMD:DEMO=<path>)，按日志时间实时播放，代替真实的串口数据
+// CSV 只有 10Hz 主记录，每行还原成一个 GPS 帧 + 一个 IMU 帧 (同一时刻)；
+// .rtl 的 GPS 块和 100Hz IMU 块按时间戳归并 (旧文件没有 IMU 块时，同 CSV 一样用主记录里的姿态)。
+//
+// 与设备上的差别:
+//   - 日志里的 Heading 是 IMU 航向，GPS 航迹向由相邻两次定位的位移算出
+//   - IMU 流是未滤波的 G 值 (与四元数模式相同，不做 EMA)
+//   - 主机端没有融合，TrackManager 由 10Hz 定位驱动 (设备演示模式走完整的融合流程)
+
+#define REPLAY_CSV_PERIOD_MS 100 // CSV 没有有效 GPS 日期时，按 10Hz 记录周期推算时间
+#define REPLAY_COURSE_MIN_M 1.0f // 位移超过 1m 才更新航迹向 (静止时保持上一个值)
+#define REPLAY_DRAG_PERIOD_MS 20 // DragRaceManager 的调用周期，与 DragRace_UI 的刷新定时器相同
+#define REPLAY_BOOT_MS 60000     // 虚拟时钟从 "开机 60s" 开始 (TrackManager 的过线冷却从 0 起算)
+#define REPLAY_MAX_EVENTS 256
+
+enum ReplayFrameType : uint8_t
+{
+    REPLAY_GPS = 0,
+    REPLAY_IMU = 1
+};
+
+struct ReplayFrame
+{
+    ReplayFrameType type;
+    uint32_t t_ms; // 距 session 开始的毫秒数
+
+    // GPS 帧
+    bool fix;
+    uint8_t sats;
+    double lat;
+    double lon;
+    float speed_kmh;
+    float course; // 由位移推算的航迹向 (度)
+
+    // IMU 帧
+    float heading;
+    float roll;
+    float pitch;
+    float lon_g;
+    float lat_g;
+    float vert_g;
+};
+
+class SessionReader
+{
+private:
+    HalFile _f;
+    bool _binary = false;
+    uint32_t _frames = 0;
+
+    // 航迹向推算
+    bool _hasCoursePos = false;
+    double _courseLat = 0, _courseLon = 0;
+    float _course = 0;
+    float _heading = 0; // 最近一条主记录里的 IMU 航向 (.rtl 的 IMU 记录不带航向)
+
+    // --- CSV ---
+    char _buf[512];
+    uint16_t _len = 0;
+    uint16_t _pos = 0;
+    bool _pendingImu = false; // 一行还原出的 IMU 帧，下一次 next() 返回
+    ReplayFrame _pending;
+    bool _hasT0 = false;
+    int64_t _t0 = 0;   // 第一条有效日期对应的绝对时间 (ms)
+    uint32_t _lastT = 0;
+    uint32_t _rows = 0;
+
+    // --- .rtl ---
+    // 每个流一个游标，各自按文件顺序 (= 块顺序号) 找下一个本类型的有效块
+    struct Cursor
+    {
+        RtlBlock *blk;
+        uint32_t nextBlock; // 下一个要读的数据块下标
+        uint16_t idx;       // 当前块里下一条记录
+        bool valid;         // 当前记录有效
+    };
+    RtlFileHeader _hdr;
+    RtlBlock *_blocks = NULL; // RTL_STREAM_COUNT 个 4KB 块 (大块内存)
+    Cursor _cur[RTL_STREAM_COUNT];
+    bool _imuStream = false;
+    uint32_t _badBlocks = 0;
+
+    // 0000-03-01 起算的天数 (公历)，用于把 CSV 的时间列换算成毫秒
+    static int64_t daysFromCivil(int y, int m, int d)
+    {
+        y -= m <= 2;
+        int era = (y >= 0 ? y : y - 399) / 400;
+        int yoe = y - era * 400;
+        int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return (int64_t)era * 146097 + doe;
+    }
+
+    // "2025-01-01 12:00:00.123" -> ms；没有有效日期 (DataLogger 写 2000-01-01) 时返回 false
+    static bool parseCsvTime(const char *s, int64_t &ms)
+    {
+        int Y, M, D, h, m, sec, milli;
+        if (sscanf(s, "%d-%d-%d %d:%d:%d.%d", &Y, &M, &D, &h, &m, &sec, &milli) != 7 || Y <= 2000)
+            return false;
+        ms = ((daysFromCivil(Y, M, D) * 24 + h) * 60 + m) * 60000LL + sec * 1000LL + milli;
+        return true;
+    }
+
+    void updateCourse(ReplayFrame &f)
+    {
+        if (f.fix)
+        {
+            if (!_hasCoursePos)
+            {
+                _hasCoursePos = true;
+                _courseLat = f.lat;
+                _courseLon = f.lon;
+            }
+            else
+            {
+                float mPerDegLat = 6371000.0 * DEG_TO_RAD;
+                float dx = (float)(f.lon - _courseLon) * mPerDegLat * cos(f.lat * DEG_TO_RAD);
+                float dy = (float)(f.lat - _courseLat) * mPerDegLat;
+                if (dx * dx + dy * dy >= REPLAY_COURSE_MIN_M * REPLAY_COURSE_MIN_M)
+                {
+                    _course = atan2f(dx, dy) * RAD_TO_DEG;
+                    if (_course < 0)
+                        _course += 360.0f;
+                    _courseLat = f.lat;
+                    _courseLon = f.lon;
+                }
+            }
+        }
+        f.course = _course;
+    }
+
+    // --- CSV ---
+
+    // 读一行 (不含换行)，文件结束返回 false；超长行截断
+    bool readLine(char *line, size_t size)
+    {
+        size_t n = 0;
+        bool any = false;
+        while (true)
+        {
+            if (_pos >= _len)
+            {
+                _len = _f.read((uint8_t *)_buf, sizeof(_buf));
+                _pos = 0;
+                if (_len == 0)
+                    break;
+            }
+            char c = _buf[_pos++];
+            any = true;
+            if (c == '\n')
+                break;
+            if (c != '\r' && n + 1 < size)
+                line[n++] = c;
+        }
+        line[n] = 0;
+        return any;
+    }
+
+    bool nextCsv(ReplayFrame &f)
+    {
+        if (_pendingImu)
+        {
+            _pendingImu = false;
+            f = _pending;
+            return true;
+        }
+
+        char line[256];
+        while (readLine(line, sizeof(line)))
+        {
+            // Time,Lat,Lon,Alt,Speed_kmh,Sats,Fix,Heading,Roll,Pitch,Lon_G,Lat_G (见 DataLogger::formatCsvRow)
+            char *p = strchr(line, ',');
+            if (!p || line[0] < '0' || line[0] > '9') // 表头 / 空行
+                continue;
+            *p++ = 0;
+            double v[11];
+            int n = 0;
+            while (n < 11)
+            {
+                char *end;
+                v[n] = strtod(p, &end);
+                if (end == p)
+                    break;
+                n++;
+                p = (*end == ',') ? end + 1 : end;
+            }
+            if (n < 11)
+                continue;
+
+            int64_t ms;
+            uint32_t t;
+            if (parseCsvTime(line, ms))
+            {
+                if (!_hasT0)
+                {
+                    _hasT0 = true;
+                    _t0 = ms - (_rows ? _lastT + REPLAY_CSV_PERIOD_MS : 0);
+                }
+                t = (uint32_t)(ms - _t0);
+            }
+            else
+            {
+                t = _rows ? _lastT + REPLAY_CSV_PERIOD_MS : 0;
+            }
+            _lastT = t;
+            _rows++;
+
+            f.type = REPLAY_GPS;
+            f.t_ms = t;
+            f.lat = v[0];
+            f.lon = v[1];
+            f.speed_kmh = (float)v[3];
+            f.sats = (uint8_t)v[4];
+            f.fix = v[5] != 0;
+            f.heading = (float)v[6];
+            f.roll = (float)v[7];
+            f.pitch = (float)v[8];
+            f.lon_g = (float)v[9];
+            f.lat_g = (float)v[10];
+            f.vert_g = 0;
+            updateCourse(f);
+
+            _pending = f;
+            _pending.type = REPLAY_IMU;
+            _pendingImu = true;
+            return true;
+        }
+        return false;
+    }
+
+    // --- .rtl ---
+
+    // 游标移到下一个本类型的有效块 (只读块头就能跳过另一个流的块)
+    bool loadBlock(uint8_t type)
+    {
+        Cursor &c = _cur[type - 1];
+        while (true)
+        {
+            uint32_t off = (c.nextBlock + 1) * RTL_BLOCK_SIZE;
+            c.nextBlock++;
+            if (!_f.seek(off) || _f.read((uint8_t *)&c.blk->h, sizeof(RtlBlockHeader)) != sizeof(RtlBlockHeader))
+                return false;
+            if (c.blk->h.magic != RTL_BLOCK_MAGIC || c.blk->h.sessionId != _hdr.sessionId || c.blk->h.type != type)
+                continue;
+            size_t len = (size_t)c.blk->h.count * c.blk->h.recordSize;
+            if (len > RTL_BLOCK_PAYLOAD || _f.read(c.blk->payload, len) != len || !rtlCheckBlock(*c.blk, _hdr.sessionId))
+            {
+                _badBlocks++;
+                continue;
+            }
+            if (c.blk->h.count == 0)
+                continue;
+            c.idx = 0;
+            return true;
+        }
+    }
+
+    // 当前记录用完后前进到下一条
+    void advance(uint8_t type)
+    {
+        Cursor &c = _cur[type - 1];
+        if (c.valid && ++c.idx < c.blk->h.count)
+            return;
+        c.valid = loadBlock(type);
+    }
+
+    template <typename T>
+    const T &record(uint8_t type)
+    {
+        Cursor &c = _cur[type - 1];
+        return *(const T *)(c.blk->payload + (size_t)c.idx * c.blk->h.recordSize);
+    }
+
+    bool nextRtl(ReplayFrame &f)
+    {
+        if (_pendingImu)
+        {
+            _pendingImu = false;
+            f = _pending;
+            return true;
+        }
+
+        Cursor &g = _cur[RTL_BLOCK_GPS - 1];
+        Cursor &m = _cur[RTL_BLOCK_IMU - 1];
+        if (!g.valid && !m.valid)
+            return false;
+
+        // 两个流按时间归并，同一时刻先出 GPS
+        if (g.valid && (!m.valid || record<RtlGpsRecord>(RTL_BLOCK_GPS).t_ms <= record<RtlImuRecord>(RTL_BLOCK_IMU).t_ms))
+        {
+            const RtlGpsRecord &r = record<RtlGpsRecord>(RTL_BLOCK_GPS);
+            f.type = REPLAY_GPS;
+            f.t_ms = r.t_ms;
+            f.fix = r.flags & RTL_FLAG_FIX;
+            f.sats = r.sats;
+            f.lat = r.lat / 1e7;
+            f.lon = r.lon / 1e7;
+            f.speed_kmh = r.speed_c / 100.0f;
+            f.heading = r.heading_d / 10.0f;
+            f.roll = r.roll_d / 10.0f;
+            f.pitch = r.pitch_d / 10.0f;
+            f.lon_g = r.lon_mg / 1000.0f;
+            f.lat_g = r.lat_mg / 1000.0f;
+            f.vert_g = 0;
+            _heading = f.heading;
+            updateCourse(f);
+            advance(RTL_BLOCK_GPS);
+
+            if (!_imuStream)
+            {
+                _pending = f;
+                _pending.type = REPLAY_IMU;
+                _pendingImu = true;
+            }
+            return true;
+        }
+
+        const RtlImuRecord &r = record<RtlImuRecord>(RTL_BLOCK_IMU);
+        f.type = REPLAY_IMU;
+        f.t_ms = r.t_ms;
+        f.heading = _heading;
+        f.roll = r.roll_d / 10.0f;
+        f.pitch = r.pitch_d / 10.0f;
+        f.lon_g = r.lon_mg / 1000.0f;
+        f.lat_g = r.lat_mg / 1000.0f;
+        f.vert_g = r.vert_mg / 1000.0f;
+        advance(RTL_BLOCK_IMU);
+        return true;
+    }
+
+public:
+    // 按文件头识别格式 (RTL_MAGIC 为二进制，否则按 CSV 读)
+    bool open(HalFile &&file)
+    {
+        close();
+        _f = std::move(file);
+        if (!_f)
+            return false;
+
+        uint32_t magic = 0;
+        _binary = _f.read((uint8_t *)&magic, 4) == 4 && magic == RTL_MAGIC;
+        _f.seek(0);
+        if (!_binary)
+            return true;
+
+        if (_f.read((uint8_t *)&_hdr, sizeof(_hdr)) != sizeof(_hdr) || _hdr.version != RTL_VERSION ||
+            _hdr.blockSize != RTL_BLOCK_SIZE ||
+            rtlCrc32((const uint8_t *)&_hdr, offsetof(RtlFileHeader, crc)) != _hdr.crc)
+        {
+            Serial.println("[REPLAY] Bad .rtl header");
+            close();
+            return false;
+        }
+        if (!_blocks)
+            _blocks = (RtlBlock *)hal_alloc_large(RTL_STREAM_COUNT * sizeof(RtlBlock));
+        if (!_blocks)
+        {
+            close();
+            return false;
+        }
+        for (uint8_t s = 0; s < RTL_STREAM_COUNT; s++)
+        {
+            _cur[s].blk = &_blocks[s];
+            _cur[s].nextBlock = 0;
+            _cur[s].valid = false;
+            advance(s + 1);
+        }
+        _imuStream = _cur[RTL_BLOCK_IMU - 1].valid;
+        return true;
+    }
+
+    bool open(const char *path) { return open(halFs.open(path)); }
+
+    void close()
+    {
+        _f.close();
+        _frames = 0;
+        _hasCoursePos = false;
+        _course = 0;
+        _heading = 0;
+        _len = _pos = 0;
+        _pendingImu = false;
+        _hasT0 = false;
+        _lastT = 0;
+        _rows = 0;
+        _imuStream = false;
+        _badBlocks = 0;
+    }
+
+    bool isOpen() { return (bool)_f; }
+
+    // 按时间顺序取下一帧，日志结束返回 false
+    bool next(ReplayFrame &f)
+    {
+        if (!_f)
+            return false;
+        bool ok = _binary ? nextRtl(f) : nextCsv(f);
+        if (ok)
+            _frames++;
+        return ok;
+    }
+
+    bool isBinary() { return _binary; }
+    bool hasImuStream() { return _imuStream; }
+    uint32_t getFrames() { return _frames; }
+    uint32_t getBadBlocks() { return _badBlocks; }
+};
+
+// ------------------------------------------
+// 回放结果: 检测到的圈 / 直线加速成绩，一行一个事件 (文本，方便 diff)
+//   LAP,<n>,<t_ms>,<lap_ms>[,<sector_ms>...]    t_ms 为过线时的日志时间，没有成绩的分段为 -1
+//   DRAG,<n>,<t_ms>,<result_ms>
+// ------------------------------------------
+enum ReplayEventKind : uint8_t
+{
+    REPLAY_EVT_LAP = 0,
+    REPLAY_EVT_DRAG = 1
+};
+
+struct ReplayEvent
+{
+    ReplayEventKind kind;
+    uint8_t sectorCount;
+    uint16_t n;
+    uint32_t t_ms;
+    uint32_t value_ms;
+    uint32_t sectors[TRACK_MAX_SECTORS];
+};
+
+struct ReplayReport
+{
+    ReplayEvent events[REPLAY_MAX_EVENTS];
+    uint16_t count = 0;
+    uint16_t laps = 0;
+    uint16_t drags = 0;
+
+    void clear() { count = laps = drags = 0; }
+
+    ReplayEvent *add(ReplayEventKind kind, uint32_t t_ms, uint32_t value_ms)
+    {
+        if (count >= REPLAY_MAX_EVENTS)
+            return NULL;
+        ReplayEvent &e = events[count++];
+        e.kind = kind;
+        e.n = (kind == REPLAY_EVT_LAP) ? ++laps : ++drags;
+        e.t_ms = t_ms;
+        e.value_ms = value_ms;
+        e.sectorCount = 0;
+        return &e;
+    }
+
+    int format(uint16_t i, char *buf, size_t len)
+    {
+        const ReplayEvent &e = events[i];
+        int n = snprintf(buf, len, "%s,%u,%lu,%lu", e.kind == REPLAY_EVT_LAP ? "LAP" : "DRAG", e.n,
+                         (unsigned long)e.t_ms, (unsigned long)e.value_ms);
+        for (uint8_t s = 0; s < e.sectorCount && n > 0 && (size_t)n < len; s++)
+            n += snprintf(buf + n, len - n, ",%ld", e.sectors[s] == TRACK_NO_TIME ? -1L : (long)e.sectors[s]);
+        return n;
+    }
+
+    // format() 的逆操作；不认识的行 (注释、空行) 返回 false
+    bool parseLine(const char *line)
+    {
+        ReplayEventKind kind;
+        if (strncmp(line, "LAP,", 4) == 0)
+            kind = REPLAY_EVT_LAP;
+        else if (strncmp(line, "DRAG,", 5) == 0)
+            kind = REPLAY_EVT_DRAG;
+        else
+            return false;
+
+        const char *p = strchr(line, ',') + 1;
+        char *end;
+        strtoul(p, &end, 10); // 序号按出现顺序重新编
+        if (*end != ',')
+            return false;
+        uint32_t t = strtoul(end + 1, &end, 10);
+        if (*end != ',')
+            return false;
+        uint32_t v = strtoul(end + 1, &end, 10);
+        ReplayEvent *e = add(kind, t, v);
+        if (!e)
+            return false;
+        while (*end == ',' && e->sectorCount < TRACK_MAX_SECTORS)
+        {
+            long s = strtol(end + 1, &end, 10);
+            e->sectors[e->sectorCount++] = (s < 0) ? TRACK_NO_TIME : (uint32_t)s;
+        }
+        return true;
+    }
+};
+
+// ------------------------------------------
+// 回放引擎: 用虚拟时钟驱动 TrackManager / DragRaceManager
+// ------------------------------------------
+// 调用方先配置好赛道 (setupTrack / addSector / enterStandbyMode) 和阈值，run() 把整个日志跑完。
+// 时钟按日志时间戳推进，不等待，所以比实时快得多。
+class SessionReplay
+{
+public:
+    uint32_t frames = 0;
+    uint32_t durationMs = 0; // 日志时长
+    uint32_t wallUs = 0;     // 实际耗时
+
+    void run(SessionReader &reader, TrackManager &track, DragRaceManager &drag, ReplayReport &report)
+    {
+        ReplayFrame f;
+        float speed = 0, lonG = 0;
+        bool dragStarted = false;
+        uint32_t nextDragMs = 0;
+        uint32_t t0 = hal_real_micros();
+        frames = 0;
+        durationMs = 0;
+
+        while (reader.next(f))
+        {
+            uint32_t now = REPLAY_BOOT_MS + f.t_ms;
+
+            // 设备上直线加速由 UI 定时器每 20ms 用最新的速度 / G 值调用一次：
+            // 先把这一帧之前到期的调用跑完 (同一时刻的 GPS 和 IMU 帧都处理完才会轮到)
+            if (!dragStarted)
+            {
+                dragStarted = true;
+                nextDragMs = now;
+            }
+            while ((int32_t)(now - nextDragMs) > 0)
+            {
+                halClock.setVirtual(nextDragMs);
+                DragState before = drag.getState();
+                drag.update(speed, lonG);
+                if (before != DRAG_FINISHED && drag.getState() == DRAG_FINISHED)
+                    report.add(REPLAY_EVT_DRAG, nextDragMs - REPLAY_BOOT_MS, (uint32_t)lroundf(drag.getResult() * 1000));
+                nextDragMs += REPLAY_DRAG_PERIOD_MS;
+            }
+
+            halClock.setVirtual(now);
+            frames++;
+            durationMs = f.t_ms;
+
+            if (f.type == REPLAY_GPS)
+            {
+                speed = f.fix ? f.speed_kmh : 0;
+                if (f.fix)
+                {
+                    int lapsBefore = track.getLapCount();
+                    bool wasRunning = track.isRunning();
+                    track.update(f.lat, f.lon, f.course, f.speed_kmh, now);
+
+                    // 圈赛每过一次线圈数 +1；冲刺赛过终点线后停止计时 (圈数不变)
+                    bool lapDone = (lapsBefore > 0 && track.getLapCount() > lapsBefore) ||
+                                   (wasRunning && !track.isRunning() && track.getLapCount() == lapsBefore);
+                    if (lapDone)
+                    {
+                        ReplayEvent *e = report.add(REPLAY_EVT_LAP, f.t_ms, track.getLastLapTime());
+                        if (e)
+                        {
+                            e->sectorCount = track.getSectorCount() > 1 ? track.getSectorCount() : 0;
+                            for (uint8_t s = 0; s < e->sectorCount; s++)
+                                e->sectors[s] = track.getPrevLapSectorTime(s);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                lonG = f.lon_g;
+            }
+        }
+
+        wallUs = hal_real_micros() - t0;
+        halClock.useRealTime();
+    }
+};
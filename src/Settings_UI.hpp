@@ -4,6 +4,7 @@
 #include "System_Config.hpp"
 #include "Audio_Driver.hpp"
 #include "IMU_Driver.hpp"
+#include "IMU_Calibration.hpp"
 
 extern void screen_gesture_event_cb(lv_event_t *e);
 extern lv_obj_t *ui_ScreenMain;
@@ -14,61 +15,39 @@ LV_FONT_DECLARE(font_race);
 static lv_style_t style_zh;
 static bool style_zh_inited = false;
 // --- 事件回调 ---
-// [新增] 校准按钮的回调函数
-void btn_calibrate_event_cb(lv_event_t *e)
+// [修改] 校准进度刷新 (100ms)，校准结束后自动删除
+void cal_progress_timer_cb(lv_timer_t *timer)
 {
-    lv_obj_t *btn = lv_event_get_target(e);
-    lv_obj_t *label = lv_obj_get_child(btn, 0);
-    lv_label_set_text(label, "Sampling...");
-    lv_timer_handler(); // 刷新 UI
-
-    // 准备累加器
-    float sum_h = 0, sum_r = 0, sum_p = 0;
-    float sum_lon = 0, sum_lat = 0;
-    int samples = 50;
-
-    Serial.println("Start Calibration (5-Axis)...");
-
-    for (int i = 0; i < samples; i++)
+    lv_obj_t *label = (lv_obj_t *)timer->user_data;
+    switch (imuCal.getState())
     {
-        float h, r, p, lon, lat;
-        // 获取当前的“原始绝对值”
-        imu.getRawValues(h, r, p, lon, lat);
-
-        sum_h += h;
-        sum_r += r;
-        sum_p += p;
-        sum_lon += lon;
-        sum_lat += lat;
-
-        // 注意：Heading如果正好在 0/360 边界跳变（比如 359, 1, 358...），
-        // 简单的算术平均会出错。
-        // 但我们在做“调平”时通常假设车是静止不动的，所以数据很稳，直接平均没问题。
-
-        delay(10);
+    case IMU_CAL_SETTLING:
+        lv_label_set_text(label, "Hold...");
+        return;
+    case IMU_CAL_SAMPLING:
+    case IMU_CAL_READY:
+        lv_label_set_text_fmt(label, "%d%%", imuCal.getProgress());
+        return;
+    case IMU_CAL_DONE:
+        lv_label_set_text(label, "Done!");
+        break;
+    default:
+        lv_label_set_text(label, "Retry");
+        break;
     }
+    lv_timer_del(timer);
+}
 
-    // 计算平均值 -> 这就是我们的“零点偏移量”
-    sys_cfg.offset_heading = sum_h / samples;
-    sys_cfg.offset_roll = sum_r / samples;
-    sys_cfg.offset_pitch = sum_p / samples;
-    sys_cfg.offset_lon = sum_lon / samples;
-    sys_cfg.offset_lat = sum_lat / samples;
-
-    // 保存到 NVS
-    sys_cfg.save();
-
-    // 立即生效
-    imu.setAllOffsets(
-        sys_cfg.offset_heading,
-        sys_cfg.offset_roll,
-        sys_cfg.offset_pitch,
-        sys_cfg.offset_lon,
-        sys_cfg.offset_lat);
-
-    Serial.println("Calibration Done!");
-    lv_label_set_text(label, "Done!");
-    
+// [修改] 校准按钮的回调函数：只启动校准状态机，不再阻塞 UI
+void btn_calibrate_event_cb(lv_event_t *e)
+{
+    if (imuCal.isBusy())
+        return;
+    lv_obj_t *btn = lv_event_get_target(e);
+    lv_obj_t *label = lv_obj_get_child(btn, 0);
+    lv_label_set_text(label, "Hold...");
+    imuCal.start();
+    lv_timer_create(cal_progress_timer_cb, 100, label);
 }
 // 音量滑块回调
 void slider_volume_event_cb(lv_event_t *e)
@@ -110,6 +89,38 @@ void sw_gps_event_cb(lv_event_t *e)
     sys_cfg.save();
 }
 
+// [新增] GPS UBX 二进制模式回调 (重启后生效)
+void sw_gps_ubx_event_cb(lv_event_t *e)
+{
+    lv_obj_t *sw = lv_event_get_target(e);
+    sys_cfg.gps_ubx_mode = lv_obj_has_state(sw, LV_STATE_CHECKED);
+    sys_cfg.save();
+}
+
+// [新增] 二进制日志格式回调 (下一次开始记录时生效)
+void sw_log_bin_event_cb(lv_event_t *e)
+{
+    lv_obj_t *sw = lv_event_get_target(e);
+    sys_cfg.log_binary = lv_obj_has_state(sw, LV_STATE_CHECKED);
+    sys_cfg.save();
+}
+
+// [新增] GPS/IMU 融合开关 (下一次定位时生效)
+void sw_fusion_event_cb(lv_event_t *e)
+{
+    lv_obj_t *sw = lv_event_get_target(e);
+    sys_cfg.fusion_enabled = lv_obj_has_state(sw, LV_STATE_CHECKED);
+    sys_cfg.save();
+}
+
+// [新增] IMU 四元数模式回调 (立即生效)
+void sw_imu_quat_event_cb(lv_event_t *e)
+{
+    sys_cfg.imu_quat_mode = lv_obj_has_state(lv_event_get_target(e), LV_STATE_CHECKED);
+    sys_cfg.save();
+    imu.applyConfig();
+}
+
 // IMU 回调
 void sw_imu_swap_event_cb(lv_event_t *e)
 {
@@ -317,9 +328,13 @@ void build_settings_page()
     // 请修改 create_setting_item，在创建 Label 后调用 lv_obj_add_style(label, &style_zh, 0);
     create_setting_item(list_cont, "蓝牙输出 (RaceChrono)", sys_cfg.bluetooth_on, sw_bt_event_cb);
     create_setting_item(list_cont, "GPS 10Hz 高刷模式", sys_cfg.gps_10hz_mode, sw_gps_event_cb);
+    create_setting_item(list_cont, "GPS UBX 模式", sys_cfg.gps_ubx_mode, sw_gps_ubx_event_cb);
+    create_setting_item(list_cont, "BIN 记录模式", sys_cfg.log_binary, sw_log_bin_event_cb);
+    create_setting_item(list_cont, "IMU 高刷定位", sys_cfg.fusion_enabled, sw_fusion_event_cb);
     create_setting_item(list_cont, "交换 G值轴 (X/Y)", sys_cfg.imu_swap_axis, sw_imu_swap_event_cb);
     create_setting_item(list_cont, "反转 X 轴方向", sys_cfg.imu_invert_x, sw_imu_inv_x_event_cb);
     create_setting_item(list_cont, "反转 Y 轴方向", sys_cfg.imu_invert_y, sw_imu_inv_y_event_cb);
+    create_setting_item(list_cont, "IMU Quat 模式", sys_cfg.imu_quat_mode, sw_imu_quat_event_cb);
 
     // [校准按钮]
     lv_obj_t *cont_cali = lv_obj_create(list_cont);
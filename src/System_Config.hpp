@@ -18,6 +18,9 @@ public:
     // --- 基础设置 ---
     bool bluetooth_on = false;
     bool gps_10hz_mode = true;
+    bool gps_ubx_mode = false; // [新增] UBX NAV-PVT 二进制解析模式
+    bool log_binary = false;   // [新增] session 日志使用二进制格式 (.rtl)，默认仍为 CSV
+    bool fusion_enabled = true; // [新增] GPS/IMU 融合 (两次定位之间用 IMU 推算位置和速度)
     uint8_t volume = 10;
     bool boot_into_usb = false;
 
@@ -27,6 +30,10 @@ public:
     bool imu_invert_y = false;  // 反转 Y 轴方向
     int mount_orientation = 0;
 
+    // --- [新增] 四元数模式：用安装四元数 (传感器坐标 -> 车身坐标) 代替上面的交换/反转开关 ---
+    bool imu_quat_mode = false;
+    float mount_qw = 1.0f, mount_qx = 0.0f, mount_qy = 0.0f, mount_qz = 0.0f; // 默认单位四元数 (平放，Y 朝前)
+
 
     // --- 校准偏移量 ---
     float offset_lon = 0.0f; // 纵向 G
@@ -45,6 +52,9 @@ public:
         prefs.begin(NS, true);
         bluetooth_on = prefs.getBool("bt", false);
         gps_10hz_mode = prefs.getBool("gps10", false);
+        gps_ubx_mode = prefs.getBool("gps_ubx", false);
+        log_binary = prefs.getBool("log_bin", false);
+        fusion_enabled = prefs.getBool("fusion", true);
         volume = prefs.getUChar("vol", 10);
         boot_into_usb = prefs.getBool("usb_mode", false);
 
@@ -53,6 +63,11 @@ public:
         imu_invert_x = prefs.getBool("invX", false);
         imu_invert_y = prefs.getBool("invY", false);
         mount_orientation = prefs.getUChar("imu_mount", 0);
+        imu_quat_mode = prefs.getBool("imu_quat", false);
+        mount_qw = prefs.getFloat("mq_w", 1.0f);
+        mount_qx = prefs.getFloat("mq_x", 0.0f);
+        mount_qy = prefs.getFloat("mq_y", 0.0f);
+        mount_qz = prefs.getFloat("mq_z", 0.0f);
 
         // 读取偏移量
         offset_lon = prefs.getFloat("off_lon", 0.0f);
@@ -70,6 +85,9 @@ public:
         prefs.begin(NS, false);
         prefs.putBool("bt", bluetooth_on);
         prefs.putBool("gps10", gps_10hz_mode);
+        prefs.putBool("gps_ubx", gps_ubx_mode);
+        prefs.putBool("log_bin", log_binary);
+        prefs.putBool("fusion", fusion_enabled);
         prefs.putBool("usb_mode", boot_into_usb);
         prefs.putUChar("vol", volume);
 
@@ -78,6 +96,11 @@ public:
         prefs.putBool("invX", imu_invert_x);
         prefs.putBool("invY", imu_invert_y);
         prefs.putUChar("imu_mount", mount_orientation);
+        prefs.putBool("imu_quat", imu_quat_mode);
+        prefs.putFloat("mq_w", mount_qw);
+        prefs.putFloat("mq_x", mount_qx);
+        prefs.putFloat("mq_y", mount_qy);
+        prefs.putFloat("mq_z", mount_qz);
 
         // 保存偏移量
         prefs.putFloat("off_lon", offset_lon);
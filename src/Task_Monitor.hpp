@@ -0,0 +1,79 @@
+#pragma once
+#include <Arduino.h>
+
+// ==========================================
+// 任务 CPU 占用 / 栈余量统计
+// ==========================================
+// 各模块在 begin() 里登记自己的任务 (传句柄的地址，任务晚一点创建也没关系)。
+// CPU 占用由任务自己上报: 每圈工作结束时 addBusy(本圈耗时)，阻塞等待的时间不算。
+// 不上报的任务 (AudioTask 的 i2s_write 阻塞、LogWriter 的写卡等待分不开) 只显示栈余量。
+
+#define TASK_MON_MAX 8
+
+class TaskMonitor
+{
+private:
+    struct Entry
+    {
+        const char *name;
+        TaskHandle_t *handle;
+        uint64_t busyUs; // 只由该任务自己累加
+        bool timed;
+    };
+
+    Entry _e[TASK_MON_MAX];
+    uint8_t _n = 0;
+    uint32_t _windowStartUs = 0;
+
+public:
+    // 返回编号，给 addBusy() 用
+    int8_t add(const char *name, TaskHandle_t *handle, bool timed = true)
+    {
+        if (_n >= TASK_MON_MAX)
+            return -1;
+        _e[_n] = {name, handle, 0, timed};
+        if (_windowStartUs == 0)
+            _windowStartUs = micros();
+        return _n++;
+    }
+
+    void addBusy(int8_t id, uint32_t us)
+    {
+        if (id >= 0)
+            _e[id].busyUs += us;
+    }
+
+    void print()
+    {
+        uint32_t window = micros() - _windowStartUs;
+        Serial.printf("[TASK] window=%lums\n", window / 1000);
+        for (uint8_t i = 0; i < _n; i++)
+        {
+            TaskHandle_t h = *_e[i].handle;
+            if (!h)
+            {
+                Serial.printf("  %-12s (not started)\n", _e[i].name);
+                continue;
+            }
+            // ESP-IDF 的 uxTaskGetStackHighWaterMark 单位是字节
+            uint32_t freeStack = uxTaskGetStackHighWaterMark(h);
+            int core = xTaskGetAffinity(h);
+            if (_e[i].timed)
+                Serial.printf("  %-12s core=%d prio=%2u cpu=%5.1f%% stack free min=%luB\n", _e[i].name,
+                              core == tskNO_AFFINITY ? -1 : core, uxTaskPriorityGet(h),
+                              window ? 100.0 * _e[i].busyUs / window : 0.0, freeStack);
+            else
+                Serial.printf("  %-12s core=%d prio=%2u cpu=    -  stack free min=%luB\n", _e[i].name,
+                              core == tskNO_AFFINITY ? -1 : core, uxTaskPriorityGet(h), freeStack);
+        }
+    }
+
+    void reset()
+    {
+        for (uint8_t i = 0; i < _n; i++)
+            _e[i].busyUs = 0;
+        _windowStartUs = micros();
+    }
+};
+
+TaskMonitor taskMon;
@@ -0,0 +1,87 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ==========================================
+// 遥测快照 (seqlock 发布)
+// ==========================================
+// FusionTask 每处理完一批传感器帧发布一次；UI、BLE、日志等其他任务只读快照，
+// 不再直接读 gps.tgps / imu.lat_g / fusion.getState() 这些被别的任务同时改写的全局变量。
+//
+// seqlock: 写者先把序号加成奇数，写完数据再加成偶数；读者拷贝前后序号相同且为偶数才算读到完整的一份，
+// 否则重读。写者从不等待读者，读者也拿不到写了一半的数据 (比如新纬度 + 旧经度)。
+// 只允许一个写者任务。
+
+// 读者连续失败这么多次就睡 1 tick (写者可能和读者在同一个核上、优先级更低，被读者挡住了)
+#define SEQLOCK_SPIN_LIMIT 64
+
+template <typename T>
+class Seqlock
+{
+private:
+    std::atomic<uint32_t> _seq{0};
+    T _data{};
+    uint32_t _retries = 0; // 读者重读次数 (统计)
+
+public:
+    // --- 写者 (唯一) ---
+    void write(const T &v)
+    {
+        uint32_t s = _seq.load(std::memory_order_relaxed);
+        _seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void *)&_data, &v, sizeof(T));
+        _seq.store(s + 2, std::memory_order_release);
+    }
+
+    // --- 读者 (任意多个) ---
+    // 返回读到的版本号 (每发布一次加 1)
+    uint32_t read(T &out)
+    {
+        uint16_t spins = 0;
+        while (true)
+        {
+            uint32_t s1 = _seq.load(std::memory_order_acquire);
+            if ((s1 & 1) == 0)
+            {
+                memcpy(&out, (const void *)&_data, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == s1)
+                    return s1 / 2;
+            }
+            _retries++;
+            if (++spins >= SEQLOCK_SPIN_LIMIT)
+            {
+                spins = 0;
+                vTaskDelay(1);
+            }
+        }
+    }
+
+    uint32_t version() { return _seq.load(std::memory_order_acquire) / 2; }
+    uint32_t getRetries() { return _retries; }
+};
+
+struct TelemetrySnapshot
+{
+    uint32_t t_ms; // 快照对应的时刻 (millis 时间轴)
+
+    // 位置 / 速度 (融合生效时是融合结果，否则是原始 GPS)
+    bool fix;
+    bool fused;
+    uint8_t sats;
+    double lat;
+    double lon;
+    float speed_kmh;
+    float course;
+
+    // IMU
+    float heading;
+    float roll;
+    float pitch;
+    float lon_g; // 已滤波 (显示用)
+    float lat_g;
+    float vert_g;
+};
+
+Seqlock<TelemetrySnapshot> telemetry;
@@ -0,0 +1,156 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// ==========================================
+// 热路径事件追踪 (每核一个无锁环形缓冲)
+// ==========================================
+// TRACE_BEGIN / TRACE_END / TRACE_MARK 记录一条 16 字节事件: 周期计数 (核内高精度)、micros (两个核对齐用)、
+// 事件 ID、阶段、核号、一个参数。写入只有一次原子 fetch_add + 4 次写，关中断/加锁都不需要；
+// 缓冲写满后覆盖最旧的事件。
+// 导出: 串口 'x' 或 BLE CMD:TRACE，输出若干行 "TRC:<hex>" (二进制转十六进制，BLE 和串口同一格式)，
+// 主机上用 tools/trace2chrome.py 转成 Chrome trace JSON (chrome://tracing 或 Perfetto 打开)。
+// 编译时定义 TRACE_ENABLED=0 可以把所有探针去掉。
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+#define TRACE_RING_LEN 256 // 每核事件数 (2 的幂)，2 核共 8KB
+#define TRACE_MAGIC 0x31435254 // "TRC1"
+#define TRACE_HEX_BYTES 64     // 每行 "TRC:" 带的字节数 (BLE 一次 notify 放得下)
+
+// 事件 ID (tools/trace2chrome.py 里有同样的表)
+enum TraceId : uint16_t
+{
+    TRACE_GPS_EPOCH = 1, // GPS 一个周期解析完成 (arg: 1=有定位)
+    TRACE_IMU_FRAME,     // IMU 一帧解析完成
+    TRACE_FUSION_PASS,   // FusionTask 一轮 (arg: 本轮处理的帧数)
+    TRACE_LOG_FLUSH,     // LogWriter 写一个块 / 同步 (arg: 块序号，0xFFFFFFFF=同步)
+    TRACE_LVGL_FLUSH,    // 一块区域的 DMA 刷屏 (arg: 像素数)
+    TRACE_BLE_NOTIFY,    // BLE notify (arg: 字节数)
+    TRACE_AUDIO_CLIP     // 开始播放一个语音片段/文件 (arg: 片段编号，0xFF=文件)
+};
+
+enum TracePhase : uint8_t
+{
+    TRACE_PH_INSTANT = 0,
+    TRACE_PH_BEGIN,
+    TRACE_PH_END
+};
+
+struct TraceEvent
+{
+    uint32_t cycles; // ESP.getCycleCount()，每核独立
+    uint32_t us;     // micros()
+    uint16_t id;
+    uint8_t phase;
+    uint8_t core;
+    uint32_t arg;
+};
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent must be 16 bytes");
+
+class Tracer
+{
+    static_assert((TRACE_RING_LEN & (TRACE_RING_LEN - 1)) == 0, "TRACE_RING_LEN must be a power of 2");
+
+private:
+    TraceEvent _ev[2][TRACE_RING_LEN];
+    std::atomic<uint32_t> _head[2];
+    std::atomic<bool> _paused{false};
+
+    // 导出用: 攒够一行就发出去
+    typedef void (*LineSink)(const char *line);
+    char _line[4 + TRACE_HEX_BYTES * 2 + 1];
+    uint8_t _lineBytes = 0;
+
+    void emitBytes(LineSink sink, const void *data, size_t len)
+    {
+        static const char HEX_CHARS[] = "0123456789abcdef";
+        const uint8_t *p = (const uint8_t *)data;
+        for (size_t i = 0; i < len; i++)
+        {
+            if (_lineBytes == 0)
+                memcpy(_line, "TRC:", 4);
+            _line[4 + _lineBytes * 2] = HEX_CHARS[p[i] >> 4];
+            _line[4 + _lineBytes * 2 + 1] = HEX_CHARS[p[i] & 0x0F];
+            if (++_lineBytes == TRACE_HEX_BYTES)
+                flushLine(sink);
+        }
+    }
+
+    void flushLine(LineSink sink)
+    {
+        if (_lineBytes == 0)
+            return;
+        _line[4 + _lineBytes * 2] = 0;
+        sink(_line);
+        _lineBytes = 0;
+    }
+
+public:
+    Tracer()
+    {
+        _head[0] = 0;
+        _head[1] = 0;
+    }
+
+    inline void record(uint16_t id, uint8_t phase, uint32_t arg)
+    {
+        if (_paused.load(std::memory_order_relaxed))
+            return;
+        uint8_t core = xPortGetCoreID();
+        // 同一个核上的任务可能互相抢占，用 fetch_add 领位置，各写各的槽
+        uint32_t i = _head[core].fetch_add(1, std::memory_order_relaxed);
+        TraceEvent &e = _ev[core][i & (TRACE_RING_LEN - 1)];
+        e.cycles = ESP.getCycleCount();
+        e.us = micros();
+        e.id = id;
+        e.phase = phase;
+        e.core = core;
+        e.arg = arg;
+    }
+
+    // 导出全部事件 (导出期间暂停记录，避免边写边读)
+    // 格式 (小端): magic u32 | cpu_mhz u16 | cores u16 | ring_len u32
+    //              每核: head u32 (累计写入次数) | n u32 | n 个 TraceEvent (从旧到新)
+    void dump(LineSink sink)
+    {
+        _paused = true;
+        delay(2); // 让正在写的探针写完
+
+        uint32_t hdr[3] = {TRACE_MAGIC, (uint32_t)getCpuFrequencyMhz() | (2u << 16), TRACE_RING_LEN};
+        _lineBytes = 0;
+        emitBytes(sink, hdr, sizeof(hdr));
+        for (uint8_t c = 0; c < 2; c++)
+        {
+            uint32_t head = _head[c].load();
+            uint32_t n = min(head, (uint32_t)TRACE_RING_LEN);
+            uint32_t meta[2] = {head, n};
+            emitBytes(sink, meta, sizeof(meta));
+            for (uint32_t k = head - n; k != head; k++)
+                emitBytes(sink, &_ev[c][k & (TRACE_RING_LEN - 1)], sizeof(TraceEvent));
+        }
+        flushLine(sink);
+
+        _paused = false;
+    }
+
+    void clear()
+    {
+        _head[0] = 0;
+        _head[1] = 0;
+    }
+};
+
+Tracer tracer;
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(id, arg) tracer.record((id), TRACE_PH_BEGIN, (arg))
+#define TRACE_END(id, arg) tracer.record((id), TRACE_PH_END, (arg))
+#define TRACE_MARK(id, arg) tracer.record((id), TRACE_PH_INSTANT, (arg))
+#else
+#define TRACE_BEGIN(id, arg)
+#define TRACE_END(id, arg)
+#define TRACE_MARK(id, arg)
+#endif
@@ -0,0 +1,283 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "Track_Manager.hpp"
+
+extern bool sd_connected;
+extern TrackManager trackMgr;
+
+// ==========================================
+// SD 卡赛道库 (二进制目录 + 网格索引)
+// ==========================================
+// 文件由 tools/build_track_db.py 生成，布局:
+//   [TrackDbHeader 32B] [网格键 uint32 x count (升序)] [TrackDbRecord x count (与键同序)]
+// 网格键 = 纬度格号 * 经度格数 + 经度格号，同一纬度行里相邻的格子键也相邻。
+// begin() 时只把键数组读进 PSRAM (1 万条赛道 = 40KB)，
+// 查找时对键做二分，只读 3x3 邻格内的记录，复杂度 O(log n)。
+
+#define TRACK_DB_PATH "/tracks.rtdb"
+#define TRACK_DB_MAGIC 0x42445452 // "RTDB"
+#define TRACK_DB_VERSION 1
+#define TRACK_DB_AUTO_RADIUS_M 3000.0f // 首次定位时，起点在此距离内的赛道才会自动加载
+
+struct TrackDbHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize; // sizeof(TrackDbRecord)，用于校验
+    uint32_t count;
+    int32_t cellE7;      // 网格边长 (1e-7 度)
+    uint32_t reserved[4];
+};
+
+struct TrackDbGate
+{
+    int32_t lat;        // 1e-7 度
+    int32_t lon;        // 1e-7 度
+    int16_t heading10;  // 通过方向 (0.1 度)，< 0 表示自动
+    int16_t reserved;
+};
+
+struct TrackDbRecord
+{
+    char name[32];
+    uint8_t type;         // TrackType
+    uint8_t gateCount;    // 分段线数量 (不含起终点)
+    uint16_t halfWidthCm; // 计时线半宽 (cm)
+    TrackDbGate start;
+    TrackDbGate finish;   // 圈赛忽略
+    TrackDbGate gates[TRACK_MAX_SECTORS - 1];
+};
+
+static_assert(sizeof(TrackDbHeader) == 32, "TrackDbHeader layout");
+static_assert(sizeof(TrackDbRecord) == 240, "TrackDbRecord layout must match tools/build_track_db.py");
+
+class TrackDatabase
+{
+private:
+    uint32_t *_keys = NULL;
+    uint32_t _count = 0;
+    int32_t _cellE7 = 0;
+    uint32_t _lonCells = 0;
+    bool _autoDone = false;
+    // [新增] 首次定位的位置由 FusionTask 记下，loop() 里再去查卡 (查找要读 SD，不能卡住帧处理)
+    std::atomic<bool> _autoPending{false};
+    double _autoLat = 0, _autoLon = 0;
+    char _loadedName[32] = {0};
+
+    uint32_t dataOffset() { return sizeof(TrackDbHeader) + _count * sizeof(uint32_t); }
+
+    inline int32_t latIndex(double lat) { return (int32_t)floor((lat + 90.0) * 1e7 / _cellE7); }
+    inline int32_t lonIndex(double lon) { return (int32_t)floor((lon + 180.0) * 1e7 / _cellE7); }
+
+    // 第一个 >= key 的位置
+    uint32_t lowerBound(uint32_t key)
+    {
+        uint32_t lo = 0, hi = _count;
+        while (lo < hi)
+        {
+            uint32_t mid = (lo + hi) >> 1;
+            if (_keys[mid] < key)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    bool readRecord(File &f, uint32_t idx, TrackDbRecord &rec)
+    {
+        if (!f.seek(dataOffset() + idx * sizeof(TrackDbRecord)))
+            return false;
+        return f.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    }
+
+    // 赛道尺度下的平面近似距离 (m)
+    static float distanceM(double lat, double lon, const TrackDbGate &g)
+    {
+        float dy = (float)(g.lat * 1e-7 - lat) * 111195.0f;
+        float dx = (float)(g.lon * 1e-7 - lon) * 111195.0f * cos(lat * DEG_TO_RAD);
+        return sqrtf(dx * dx + dy * dy);
+    }
+
+public:
+    bool begin()
+    {
+        if (!sd_connected || !SD_MMC.exists(TRACK_DB_PATH))
+            return false;
+
+        File f = SD_MMC.open(TRACK_DB_PATH, FILE_READ);
+        if (!f)
+            return false;
+
+        TrackDbHeader h;
+        bool ok = f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                  h.magic == TRACK_DB_MAGIC && h.version == TRACK_DB_VERSION &&
+                  h.recordSize == sizeof(TrackDbRecord) && h.count > 0 && h.cellE7 > 0;
+        if (ok)
+        {
+            free(_keys);
+            _keys = (uint32_t *)ps_malloc(h.count * sizeof(uint32_t));
+            ok = _keys && f.read((uint8_t *)_keys, h.count * sizeof(uint32_t)) == h.count * sizeof(uint32_t);
+        }
+        f.close();
+
+        if (!ok)
+        {
+            free(_keys);
+            _keys = NULL;
+            _count = 0;
+            Serial.println("❌ [TRACKDB] Invalid track database");
+            return false;
+        }
+
+        _count = h.count;
+        _cellE7 = h.cellE7;
+        _lonCells = (uint32_t)((3600000000LL + _cellE7 - 1) / _cellE7);
+        Serial.printf("✅ [TRACKDB] %lu tracks, cell=%.3f deg\n", _count, _cellE7 * 1e-7);
+        return true;
+    }
+
+    // 在 3x3 邻格内查找起点离 (lat, lon) 最近的赛道
+    bool findNearest(double lat, double lon, TrackDbRecord &out, float &distM)
+    {
+        if (!_keys)
+            return false;
+        File f = SD_MMC.open(TRACK_DB_PATH, FILE_READ);
+        if (!f)
+            return false;
+
+        int32_t row = latIndex(lat);
+        int32_t col = lonIndex(lon);
+        bool found = false;
+        distM = 1e9f;
+        TrackDbRecord rec;
+
+        for (int32_t r = row - 1; r <= row + 1; r++)
+        {
+            if (r < 0)
+                continue;
+            // 同一行里 col-1 .. col+1 三个格子的键是连续的，一次二分就能定位
+            uint32_t k0 = r * _lonCells + (col > 0 ? col - 1 : 0);
+            uint32_t k1 = r * _lonCells + min((uint32_t)(col + 1), _lonCells - 1);
+            for (uint32_t i = lowerBound(k0); i < _count && _keys[i] <= k1; i++)
+            {
+                if (!readRecord(f, i, rec))
+                    break;
+                float d = distanceM(lat, lon, rec.start);
+                if (d < distM)
+                {
+                    distM = d;
+                    out = rec;
+                    found = true;
+                }
+            }
+        }
+        f.close();
+        return found;
+    }
+
+    // 把一条记录加载到赛道管理器 (包括分段线)
+    // [修改] 在 loop() 里执行：整条赛道一次提交，由 FusionTask 套用，不直接改正在计时的赛道管理器
+    void apply(const TrackDbRecord &rec)
+    {
+        TrackConfig c = {};
+        c.type = (TrackType)rec.type;
+        c.radius = rec.halfWidthCm / 100.0f;
+        c.sLat = rec.start.lat * 1e-7;
+        c.sLon = rec.start.lon * 1e-7;
+        c.eLat = rec.finish.lat * 1e-7;
+        c.eLon = rec.finish.lon * 1e-7;
+        c.startHeading = (rec.start.heading10 < 0) ? -1 : rec.start.heading10 / 10.0f;
+        for (uint8_t i = 0; i < rec.gateCount && i < TRACK_MAX_SECTORS - 1; i++)
+        {
+            const TrackDbGate &g = rec.gates[i];
+            c.gateLat[i] = g.lat * 1e-7;
+            c.gateLon[i] = g.lon * 1e-7;
+            c.gateHeading[i] = (g.heading10 < 0) ? -1 : g.heading10 / 10.0f;
+            c.gateCount++;
+        }
+        trackMgr.requestConfig(c);
+        strlcpy(_loadedName, rec.name, sizeof(_loadedName));
+    }
+
+    // [修改] FusionTask 里每个有效定位都可以调用：只记下第一个位置，不读卡
+    void noteFix(double lat, double lon)
+    {
+        if (_autoDone || _autoPending.load(std::memory_order_relaxed))
+            return;
+        _autoLat = lat;
+        _autoLon = lon;
+        _autoPending.store(true, std::memory_order_release); // 坐标写完再置位
+    }
+
+    // loop() 里调用：有待处理的首次定位时查一次卡 (只执行一次)
+    void poll()
+    {
+        if (_autoPending.load(std::memory_order_acquire))
+        {
+            autoDetect(_autoLat, _autoLon);
+            _autoPending.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // 首次定位时调用一次：没有通过 APP 配置赛道时，自动加载附近的赛道
+    // 加载后赛道不会自动进入预备 (与 APP 的 TRACK:SETUP 一样，setupTrack() 之后是未预备状态)：
+    // 预备后第一次过线就会开始计时并自动开始记录日志，所以仍由用户在模式页点赛道按钮进入
+    // (ModeSelect_UI 的 btn_track_event_cb 会同时切换模式和等待页)。这里只负责填好赛道
+    void autoDetect(double lat, double lon)
+    {
+        if (_autoDone)
+            return;
+        _autoDone = true;
+        if (!_keys || trackMgr.hasTrackConfig()) // APP 已经发过 SETUP (可能还没套用) 时不覆盖
+            return;
+
+        TrackDbRecord rec;
+        float dist;
+        if (findNearest(lat, lon, rec, dist) && dist < TRACK_DB_AUTO_RADIUS_M)
+        {
+            apply(rec);
+            Serial.printf("[TRACKDB] Auto-loaded '%s' (%.0fm away), press TRACK to arm\n", _loadedName, dist);
+        }
+        else
+        {
+            Serial.println("[TRACKDB] No track nearby");
+        }
+    }
+
+    // 查找耗时测试：在随机一条赛道所在格子的中心查询 n 次
+    void benchmark(uint32_t n)
+    {
+        if (!_keys)
+        {
+            Serial.println("[TRACKDB] Not loaded");
+            return;
+        }
+        uint32_t total_us = 0, max_us = 0, hits = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uint32_t key = _keys[esp_random() % _count];
+            double lat = ((key / _lonCells) + 0.5) * _cellE7 * 1e-7 - 90.0;
+            double lon = ((key % _lonCells) + 0.5) * _cellE7 * 1e-7 - 180.0;
+
+            TrackDbRecord rec;
+            float dist;
+            uint32_t t0 = micros();
+            hits += findNearest(lat, lon, rec, dist) ? 1 : 0;
+            uint32_t dt = micros() - t0;
+            total_us += dt;
+            if (dt > max_us)
+                max_us = dt;
+        }
+        Serial.printf("[TRACKDB] %lu lookups over %lu tracks: avg=%luus max=%luus hits=%lu\n",
+                      n, _count, total_us / n, max_us, hits);
+    }
+
+    uint32_t getCount() { return _count; }
+    const char *getLoadedName() { return _loadedName; }
+};
+
+TrackDatabase trackDb;
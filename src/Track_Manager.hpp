@@ -1,11 +1,15 @@
 #pragma once
-#include <Arduino.h>
-#include <vector>
-#include "Audio_Driver.hpp"
+#include "Hal.hpp"
+#include "Lap_Reference.hpp"
+#include <atomic>
 
 // 定义回调函数类型
 typedef void (*TrackEventCallback)();
 
+// [新增] 分段计时：起点线与终点线之间最多 15 条分段线，即最多 16 个分段
+#define TRACK_MAX_SECTORS 16
+#define TRACK_NO_TIME 0xFFFFFFFF
+
 enum TrackType
 {
     TRACK_TYPE_CIRCUIT = 0,
@@ -18,6 +22,128 @@ struct GeoPoint
     double lon;
 };
 
+// [新增] 赛道局部平面坐标系 (等距圆柱投影，原点为起点)
+// setupTrack() 时算一次每度对应的米数，之后每帧的距离/方向判断都只是浮点乘加，
+// 不再需要 sin/cos/atan2/sqrt。赛道尺度 (10km 以内) 下误差远小于 GPS 本身的精度。
+struct LocalFrame
+{
+    double lat0, lon0; // 原点
+    float mPerDegLat;  // 原点处 1 度纬度对应的米数
+    float mPerDegLon;  // 原点处 1 度经度对应的米数
+
+    void setup(double lat, double lon)
+    {
+        lat0 = lat;
+        lon0 = lon;
+        mPerDegLat = 6371000.0 * DEG_TO_RAD;
+        mPerDegLon = mPerDegLat * cos(lat * DEG_TO_RAD);
+    }
+
+    // 经纬度 -> 平面坐标 (东 x, 北 y, 单位 m)
+    // 先用 double 求差再转 float，避免大数相减丢精度
+    inline void toLocal(double lat, double lon, float &x, float &y)
+    {
+        x = (float)(lon - lon0) * mPerDegLon;
+        y = (float)(lat - lat0) * mPerDegLat;
+    }
+
+    // 平面坐标 -> 经纬度
+    inline void toGeo(float x, float y, double &lat, double &lon)
+    {
+        lat = lat0 + y / mPerDegLat;
+        lon = lon0 + x / mPerDegLon;
+    }
+};
+
+// [新增] 计时线 (门)：以中心点为基准、垂直于通过方向、宽度有限的一条线段
+// 坐标都在赛道局部平面坐标系中
+struct TimingLine
+{
+    float cx, cy;    // 中心点 (m)
+    float halfWidth; // 半宽 (m)，横向偏离中心超过这个值的穿越不算
+    bool hasDir;     // 是否已确定通过方向 (未确定时用每段运动方向自动判定)
+    float nx, ny;    // 通过方向的单位向量 (东/北分量)，即计时线的法线
+
+    void setup(LocalFrame &frame, double lat, double lon, float half_width, float heading_deg)
+    {
+        frame.toLocal(lat, lon, cx, cy);
+        halfWidth = half_width;
+        setDirection(heading_deg);
+    }
+
+    // heading < 0 表示方向未知 (自动)
+    void setDirection(float heading_deg)
+    {
+        hasDir = (heading_deg >= 0);
+        if (hasDir)
+        {
+            nx = sin(heading_deg * DEG_TO_RAD);
+            ny = cos(heading_deg * DEG_TO_RAD);
+        }
+    }
+
+    // 检测线段 P0->P1 是否沿通过方向穿过计时线
+    // 命中时 t 为穿越点在线段上的比例 [0,1]，lateral 为穿越点到中心的横向距离
+    bool intersect(float x0, float y0, float x1, float y1, float &t, float &lateral)
+    {
+        x0 -= cx;
+        y0 -= cy;
+        x1 -= cx;
+        y1 -= cy;
+        float dx = x1 - x0;
+        float dy = y1 - y0;
+        float len2 = dx * dx + dy * dy;
+        if (len2 < 0.01f) // 两帧间移动不足 0.1m (静止)，不判定
+            return false;
+
+        // 法线：已知方向用固定值，否则用本段的运动方向
+        float ux = nx, uy = ny;
+        if (!hasDir)
+        {
+            float inv = 1.0f / sqrtf(len2);
+            ux = dx * inv;
+            uy = dy * inv;
+        }
+
+        // 两端点到计时线的有符号距离：必须从线后方 (<0) 穿到线前方 (>=0)
+        float s0 = x0 * ux + y0 * uy;
+        float s1 = x1 * ux + y1 * uy;
+        if (!(s0 < 0 && s1 >= 0))
+            return false;
+
+        t = s0 / (s0 - s1);
+        float xc = x0 + t * dx;
+        float yc = y0 + t * dy;
+        lateral = fabsf(yc * ux - xc * uy);
+        return lateral <= halfWidth;
+    }
+
+    // 点到中心的距离平方 (m^2)
+    inline float dist2(float x, float y)
+    {
+        float dx = x - cx;
+        float dy = y - cy;
+        return dx * dx + dy * dy;
+    }
+};
+
+// [新增] 一条赛道的完整配置 (APP 的 TRACK: 指令 / SD 卡赛道库 填写，FusionTask 套用)
+struct TrackConfig
+{
+    bool valid; // 已经 SETUP 过 (没有 SETUP 时不能追加分段线)
+    TrackType type;
+    float radius;
+    double sLat, sLon, eLat, eLon;
+    float startHeading;
+    uint8_t gateCount;
+    double gateLat[TRACK_MAX_SECTORS - 1];
+    double gateLon[TRACK_MAX_SECTORS - 1];
+    float gateHeading[TRACK_MAX_SECTORS - 1];
+};
+
+#define TRACK_REQ_ARM 1
+#define TRACK_REQ_DISARM 2
+
 enum RaceState
 {
     RACE_IDLE = 0,    // 闲置
@@ -32,15 +158,32 @@ private:
     TrackType type;
     GeoPoint startPoint;
     GeoPoint endPoint;
+    LocalFrame frame;     // [新增] 赛道局部平面坐标系 (setupTrack 时预计算)
+    TimingLine startLine; // [新增] 起点计时线
+    TimingLine endLine;   // [新增] 终点计时线 (圈赛时与起点线相同)
+
+    // [新增] 分段计时线 (按顺序穿过)，和起终点线共用同一套求交判定
+    TimingLine sectorLines[TRACK_MAX_SECTORS - 1];
+    uint8_t sectorGateCount = 0;
+    uint8_t nextGate = 0;          // 本圈下一条要穿过的分段线
+    uint32_t sectorStartMs = 0;    // 当前分段的开始时刻
+    uint32_t lapSectors[TRACK_MAX_SECTORS];  // 本圈已完成的分段时间
+    uint32_t lastSectors[TRACK_MAX_SECTORS]; // 上一圈的分段时间 (未完整穿过的为 TRACK_NO_TIME)
+    uint32_t bestSectors[TRACK_MAX_SECTORS]; // 各分段的最好成绩
+    uint32_t theoreticalBest = TRACK_NO_TIME; // 最佳分段之和 (每次最佳分段变化时更新)
+    int8_t lastSectorIdx = -1;     // 最近完成的分段 (-1 表示本次还没有)
+    uint32_t lastSectorTime = TRACK_NO_TIME; // 最近完成的分段时间
+    int32_t lastSectorDelta = 0;   // 最近完成的分段与该分段之前最好成绩的差 (ms，负数为更快)
+
+    LapReference lapRef; // [新增] 最佳圈参考轨迹 (实时圈速差)
 
     bool _isArmed = false;
 
-    // [修改] 触发半径收缩到 3.0米
-    // 在 10Hz 下，200km/h 的车一帧跑 5.5米。
-    // 3.0米半径意味着检测窗口直径 6.0米，勉强能兜住高速冲线。
-    // 再小容易漏，再大容易误触。
+    // [修改] 计时线半宽 (默认 3.0米，即 6米宽的门)
+    // 过线判定改为 "相邻两帧的连线与计时线求交"，不再依赖某一帧恰好落在线附近，
+    // 所以 10Hz 下 200km/h 一帧跑 5.5米 也不会漏判；门宽只决定横向容差。
     float triggerRadius = 3.0;
-    const uint32_t LAP_COOLDOWN_MS = 5000;
+    uint32_t lapCooldownMs = 5000; // [修改] 两次过线的最短间隔，可调 (回放调参用)
 
     RaceState currentState = RACE_IDLE;
     uint32_t startTimeMs = 0;
@@ -53,36 +196,111 @@ private:
 
     double trackHeading = -1.0;
 
-    // 极值检测变量
-    float prevDistanceToStart = 99999.0;
-    float prevDistanceToEnd = 99999.0;
-
-    // [新增] 记录上一帧的时间戳，用于时间插值
+    // [修改] 记录上一帧的位置和时间戳，用于线段求交和时间插值
+    bool hasPrev = false;
+    float prevX = 0, prevY = 0; // 上一帧的局部平面坐标
     uint32_t prevTimeMs = 0;
 
+    // [新增] 跨任务的修改请求：BLE 回调 / loop() / UiTask 只改 _cfg 或置请求标志，
+    // 由 FusionTask 在处理帧之前 (applyRequests) 套用，所以计时线和分段线只在 update() 所在的任务里改
+    TrackConfig _cfg = {};
+    std::atomic<uint32_t> _cfgSeq{0}; // 偶数: 空闲；奇数: 有写者正在改 _cfg (兼作写者之间的锁)
+    uint32_t _cfgApplied = 0;         // FusionTask 已套用的 _cfgSeq
+    std::atomic<uint8_t> _armReq{0};  // TRACK_REQ_ARM / TRACK_REQ_DISARM
+    std::atomic<bool> _resetReq{false};
+
     TrackEventCallback onRaceStartCB = NULL;
     TrackEventCallback onRaceFinishCB = NULL;
     TrackEventCallback onLapStartCB = NULL;
     TrackEventCallback onLapFinishCB = NULL;
 
-    float getDistance(double lat1, double lon1, double lat2, double lon2)
+    // [新增] 按插值比例计算两帧之间的穿越时刻 (四舍五入到 ms)
+    uint32_t interpolateTime(uint32_t t0, uint32_t t1, float t)
+    {
+        return t0 + (uint32_t)((t1 - t0) * t + 0.5f);
+    }
+
+    // [新增] 赛道标识：起终点坐标 (约 1m 精度) + 类型 的 FNV-1a 哈希，用于区分 SD 卡上的参考圈文件
+    uint32_t trackId()
+    {
+        int32_t v[5] = {(int32_t)type,
+                        (int32_t)lround(startPoint.lat * 1e5), (int32_t)lround(startPoint.lon * 1e5),
+                        (int32_t)lround(endPoint.lat * 1e5), (int32_t)lround(endPoint.lon * 1e5)};
+        uint32_t h = 2166136261u;
+        const uint8_t *p = (const uint8_t *)v;
+        for (size_t i = 0; i < sizeof(v); i++)
+        {
+            h ^= p[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // [新增] 开始新的一圈的分段计时
+    void beginSectors(uint32_t lapStartMs)
+    {
+        nextGate = 0;
+        sectorStartMs = lapStartMs;
+        for (uint8_t i = 0; i < TRACK_MAX_SECTORS; i++)
+            lapSectors[i] = TRACK_NO_TIME;
+    }
+
+    // [新增] 完成一个分段：记录时间、计算与最好成绩的差、更新最佳和理论最佳
+    void completeSector(uint8_t idx, uint32_t crossMs)
+    {
+        uint32_t st = crossMs - sectorStartMs;
+        sectorStartMs = crossMs;
+        lapSectors[idx] = st;
+
+        lastSectorIdx = idx;
+        lastSectorTime = st;
+        lastSectorDelta = (bestSectors[idx] == TRACK_NO_TIME) ? 0 : (int32_t)(st - bestSectors[idx]);
+
+        if (st < bestSectors[idx])
+        {
+            bestSectors[idx] = st;
+
+            // 所有分段都有成绩后才有理论最佳
+            uint32_t sum = 0;
+            for (uint8_t i = 0; i <= sectorGateCount; i++)
+            {
+                if (bestSectors[i] == TRACK_NO_TIME)
+                {
+                    sum = TRACK_NO_TIME;
+                    break;
+                }
+                sum += bestSectors[i];
+            }
+            theoreticalBest = sum;
+        }
+    }
+
+    // [新增] 过终点线时收尾本圈的分段
+    // 中途漏过分段线 (GPS 跳点/横向偏出门宽) 时，最后一段的时间包含了漏掉的分段，不计入
+    void finishSectors(uint32_t finishMs)
+    {
+        if (nextGate == sectorGateCount)
+            completeSector(sectorGateCount, finishMs);
+        memcpy(lastSectors, lapSectors, sizeof(lastSectors));
+    }
+
+    // [新增] 写者加锁：_cfgSeq 从偶数改成奇数。写者之间互斥，改的时间极短，抢不到就让出 CPU
+    uint32_t lockConfig()
     {
-        const double R = 6371000.0;
-        double dLat = (lat2 - lat1) * DEG_TO_RAD;
-        double dLon = (lon2 - lon1) * DEG_TO_RAD;
-        double a = sin(dLat / 2) * sin(dLat / 2) +
-                   cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) *
-                       sin(dLon / 2) * sin(dLon / 2);
-        double c = 2 * atan2(sqrt(a), sqrt(1 - a));
-        return (float)(R * c);
+        uint32_t s = _cfgSeq.load(std::memory_order_relaxed);
+        while ((s & 1) || !_cfgSeq.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+        {
+            hal_yield();
+            s = _cfgSeq.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        return s;
     }
 
-    double getHeadingDiff(double h1, double h2)
+    // 没有改动时恢复原来的版本号，FusionTask 不会重新套用 (重新套用会清空成绩)
+    void unlockConfig(uint32_t s, bool changed)
     {
-        double diff = abs(h1 - h2);
-        if (diff > 180.0)
-            diff = 360.0 - diff;
-        return diff;
+        _cfgSeq.store(changed ? s + 2 : s, std::memory_order_release);
     }
 
 public:
@@ -96,11 +314,10 @@ public:
     void attachOnLapStart(TrackEventCallback cb) { onLapStartCB = cb; }
     void attachOnLapFinish(TrackEventCallback cb) { onLapFinishCB = cb; }
 
-    void setupTrack(TrackType t, float radius, double sLat, double sLon, double eLat, double eLon)
+    // [修改] radius 现在是计时线的半宽；startHeading 为起点线的通过方向 (度)，< 0 表示首次过线时自动确定
+    void setupTrack(TrackType t, float radius, double sLat, double sLon, double eLat, double eLon, float startHeading = -1)
     {
         type = t;
-        // 忽略传入的 radius，强制使用 3.0米 的高精度逻辑
-        // 如果你需要兼容旧的大半径，可以把下面这行删掉
         triggerRadius = radius;
 
         startPoint = {sLat, sLon};
@@ -108,9 +325,16 @@ public:
             endPoint = startPoint;
         else
             endPoint = {eLat, eLon};
+
+        frame.setup(startPoint.lat, startPoint.lon);
+        startLine.setup(frame, startPoint.lat, startPoint.lon, triggerRadius, startHeading);
+        endLine.setup(frame, endPoint.lat, endPoint.lon, triggerRadius, (type == TRACK_TYPE_CIRCUIT) ? startHeading : -1);
+        sectorGateCount = 0;
+        lapRef.selectTrack(trackId());
+
         resetSession();
         _isArmed = false;
-        Serial.printf("Track Setup: Mode=%d, Pro-Radius=%.1fm\n", type, triggerRadius);
+        Serial.printf("Track Setup: Mode=%d, Gate=%.1fm, Heading=%.1f\n", type, triggerRadius * 2, startHeading);
     }
 
     void resetSession()
@@ -123,9 +347,129 @@ public:
         bestLapTime = 0xFFFFFFFF;
         lapCount = 0;
         trackHeading = -1.0;
-        prevDistanceToStart = 99999.0;
-        prevDistanceToEnd = 99999.0;
+        hasPrev = false;
         prevTimeMs = 0;
+
+        // [新增] 分段成绩随比赛一起清空
+        beginSectors(0);
+        for (uint8_t i = 0; i < TRACK_MAX_SECTORS; i++)
+        {
+            lastSectors[i] = TRACK_NO_TIME;
+            bestSectors[i] = TRACK_NO_TIME;
+        }
+        theoreticalBest = TRACK_NO_TIME;
+        lastSectorIdx = -1;
+        lastSectorTime = TRACK_NO_TIME;
+        lastSectorDelta = 0;
+
+        // 参考圈是跨 session 的，只丢弃正在记录的这一圈
+        lapRef.resetLap();
+    }
+
+    // [新增] 按行驶顺序追加一条分段线 (须在 setupTrack 之后调用)
+    // heading 为通过方向 (度)，< 0 表示按每段运动方向自动判定
+    bool addSector(double lat, double lon, float heading = -1)
+    {
+        if (!isTrackSetup() || sectorGateCount >= TRACK_MAX_SECTORS - 1)
+            return false;
+        sectorLines[sectorGateCount].setup(frame, lat, lon, triggerRadius, heading);
+        sectorGateCount++;
+        resetSession();
+        Serial.printf("[TRACK] Sector gate %d added (%d sectors)\n", sectorGateCount, sectorGateCount + 1);
+        return true;
+    }
+
+    void clearSectors()
+    {
+        sectorGateCount = 0;
+        resetSession();
+    }
+
+    void setLapCooldown(uint32_t ms) { lapCooldownMs = ms; }
+
+    // --- [新增] 其他任务用的请求接口 (上面的 setupTrack / addSector / enterStandbyMode 等只在 FusionTask 里调用，
+    // 主机端回放和测试是单线程的，也可以直接调用) ---
+
+    // 整条赛道 (含分段线) 一次提交，FusionTask 不会套用到只有起点没有分段线的中间状态
+    void requestConfig(const TrackConfig &c)
+    {
+        uint32_t s = lockConfig();
+        _cfg = c;
+        _cfg.valid = true;
+        _cfg.gateCount = min(c.gateCount, (uint8_t)(TRACK_MAX_SECTORS - 1));
+        unlockConfig(s, true);
+    }
+
+    void requestSetup(TrackType t, float radius, double sLat, double sLon, double eLat, double eLon, float startHeading = -1)
+    {
+        TrackConfig c = {};
+        c.type = t;
+        c.radius = radius;
+        c.sLat = sLat;
+        c.sLon = sLon;
+        c.eLat = eLat;
+        c.eLon = eLon;
+        c.startHeading = startHeading;
+        requestConfig(c);
+    }
+
+    // 返回追加后的分段数；还没有 SETUP 或分段线已满时返回 -1
+    int requestAddSector(double lat, double lon, float heading = -1)
+    {
+        uint32_t s = lockConfig();
+        bool ok = _cfg.valid && _cfg.gateCount < TRACK_MAX_SECTORS - 1;
+        if (ok)
+        {
+            _cfg.gateLat[_cfg.gateCount] = lat;
+            _cfg.gateLon[_cfg.gateCount] = lon;
+            _cfg.gateHeading[_cfg.gateCount] = heading;
+            _cfg.gateCount++;
+        }
+        int sectors = _cfg.gateCount + 1;
+        unlockConfig(s, ok);
+        return ok ? sectors : -1;
+    }
+
+    void requestClearSectors()
+    {
+        uint32_t s = lockConfig();
+        bool had = _cfg.gateCount > 0;
+        _cfg.gateCount = 0;
+        unlockConfig(s, had);
+        if (!had)
+            requestReset(); // 与 clearSectors() 一样，至少清空本次成绩
+    }
+
+    void requestReset() { _resetReq.store(true, std::memory_order_release); }
+    void requestArm(bool arm) { _armReq.store(arm ? TRACK_REQ_ARM : TRACK_REQ_DISARM, std::memory_order_release); }
+
+    // 已经请求过 SETUP (可能还没被 FusionTask 套用)
+    bool hasTrackConfig() { return _cfgSeq.load(std::memory_order_acquire) != 0; }
+
+    // [新增] FusionTask 每一轮处理帧之前调用：套用其他任务提交的配置 / 重置 / 预备请求
+    void applyRequests()
+    {
+        uint32_t s = _cfgSeq.load(std::memory_order_acquire);
+        if (s != _cfgApplied && (s & 1) == 0)
+        {
+            TrackConfig c;
+            memcpy(&c, (const void *)&_cfg, sizeof(c));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_cfgSeq.load(std::memory_order_relaxed) == s) // 拷贝期间被改了就等下一轮
+            {
+                _cfgApplied = s;
+                setupTrack(c.type, c.radius, c.sLat, c.sLon, c.eLat, c.eLon, c.startHeading);
+                for (uint8_t i = 0; i < c.gateCount; i++)
+                    addSector(c.gateLat[i], c.gateLon[i], c.gateHeading[i]);
+            }
+        }
+        if (_resetReq.exchange(false, std::memory_order_acq_rel))
+            resetSession();
+        uint8_t arm = _armReq.exchange(0, std::memory_order_acq_rel);
+        if (arm == TRACK_REQ_ARM)
+            enterStandbyMode();
+        else if (arm == TRACK_REQ_DISARM)
+            exitTrackMode();
     }
 
     void enterStandbyMode()
@@ -143,61 +487,57 @@ public:
     }
 
     // [核心函数]
+    // now 为这一帧的 GPS 周期时间 (映射到 millis 时间轴)
     void update(double currLat, double currLon, double currHeading, float currSpeedKmh, uint32_t now)
     {
+        lapRef.adopt(); // [新增] loop() 读好的参考圈在帧处理的任务里换上
         if (!_isArmed || (abs(currLat) < 0.1 && abs(currLon) < 0.1))
             return;
 
-        float distToStart = getDistance(currLat, currLon, startPoint.lat, startPoint.lon);
-        float distToEnd = getDistance(currLat, currLon, endPoint.lat, endPoint.lon);
+        // 每帧只做一次投影，后面的判断全部在平面坐标里完成
+        float x, y;
+        frame.toLocal(currLat, currLon, x, y);
+        float step = hasPrev ? sqrtf((x - prevX) * (x - prevX) + (y - prevY) * (y - prevY)) : 0; // 与上一帧的距离 (m)
 
         // --- 1. 检测比赛开始 ---
         if (currentState == RACE_IDLE || currentState == RACE_ARMED)
         {
-            if (distToStart < triggerRadius) // < 3.0米 才会进入判定
+            // 接近起点线时进入预备状态 (仅用于状态显示，判定靠线段求交)
+            float armRadius = max(triggerRadius * 4, 30.0f);
+            currentState = (startLine.dist2(x, y) < armRadius * armRadius) ? RACE_ARMED : RACE_IDLE;
+
+            float t, lateral;
+            if (hasPrev && (now - lastTriggerTimeMs > lapCooldownMs) &&
+                startLine.intersect(prevX, prevY, x, y, t, lateral))
             {
-                // 提高速度门限到 8km/h，防止静止漂移误触
-                if (true)// (currSpeedKmh > 8.0)
+                currentState = RACE_RUNNING;
+
+                // [亚帧插值] 真实的过线时刻在上一帧和这一帧之间，按穿越点的位置比例插值
+                uint32_t exactStartTime = interpolateTime(prevTimeMs, now, t);
+
+                startTimeMs = exactStartTime;
+                lastTriggerTimeMs = now; // 冷却计时还是用 now
+                currentLapTime = 0;
+                lapCount = 1;
+                trackHeading = currHeading;
+                beginSectors(exactStartTime);
+                lapRef.beginLap();
+                lapRef.addFix(step * (1 - t), now - exactStartTime);
+
+                // 起点线方向未配置时，锁定为第一次过线的方向，之后每圈都按这个方向判定
+                if (!startLine.hasDir)
                 {
-                    // 距离开始变大 (说明上一帧就是最近点)
-                    if (currentState == RACE_ARMED && distToStart > prevDistanceToStart)
-                    {
-                        // [严格检查] 只有当最近点真的小于 1.5米 时才触发
-                        // 这杜绝了只是擦过 3米 圈边缘导致的误触
-                        if (prevDistanceToStart < 1.5 && (now - lastTriggerTimeMs > LAP_COOLDOWN_MS))
-                        {
-                            currentState = RACE_RUNNING;
-
-                            // [回溯时间补偿]
-                            // 真实的过线时间其实发生在“上一帧”和“这一帧”之间
-                            // 简单起见，我们认为上一帧时刻 (prevTimeMs) 就是最近点时刻
-                            // 这样精度比直接用 now 要准 100ms
-                            uint32_t exactStartTime = (prevTimeMs > 0) ? prevTimeMs : now;
-
-                            startTimeMs = exactStartTime;
-                            lastTriggerTimeMs = now; // 冷却计时还是用 now
-                            currentLapTime = 0;
-                            lapCount = 1;
-                            trackHeading = currHeading;
-
-                            Serial.printf("🏁 START! (MinDist: %.2fm, TimeFix: -%dms)\n", prevDistanceToStart, now - exactStartTime);
-                            audioDriver.play("/mp3/race_start.mp3");
-
-                            if (onRaceStartCB != NULL)
-                                onRaceStartCB();
-                            if (onLapStartCB != NULL)
-                                onLapStartCB();
-                        }
-                    }
-                    else
-                    {
-                        currentState = RACE_ARMED;
-                    }
+                    startLine.setDirection(currHeading);
+                    if (type == TRACK_TYPE_CIRCUIT)
+                        endLine = startLine;
                 }
-            }
-            else
-            {
-                currentState = RACE_IDLE;
+
+                Serial.printf("🏁 START! (Lateral: %.2fm, TimeFix: -%lums)\n", lateral, (unsigned long)(now - exactStartTime));
+
+                if (onRaceStartCB != NULL)
+                    onRaceStartCB();
+                if (onLapStartCB != NULL)
+                    onLapStartCB();
             }
         }
 
@@ -206,94 +546,128 @@ public:
         {
             currentLapTime = now - startTimeMs;
 
-            if (distToEnd < triggerRadius && (now - lastTriggerTimeMs > LAP_COOLDOWN_MS))
+            float t, lateral;
+
+            // [新增] 分段线：每帧只检查下一条，必须按顺序穿过
+            if (hasPrev && nextGate < sectorGateCount &&
+                sectorLines[nextGate].intersect(prevX, prevY, x, y, t, lateral))
             {
-                if (currSpeedKmh > 8.0)
+                completeSector(nextGate, interpolateTime(prevTimeMs, now, t));
+                Serial.printf("[TRACK] S%d: %.3fs (%+.3fs)\n", nextGate + 1, lapSectors[nextGate] / 1000.0, lastSectorDelta / 1000.0);
+                nextGate++;
+            }
+
+            if (hasPrev && currSpeedKmh > 8.0 && (now - lastTriggerTimeMs > lapCooldownMs) &&
+                endLine.intersect(prevX, prevY, x, y, t, lateral))
+            {
+                // [亚帧插值]
+                uint32_t exactFinishTime = interpolateTime(prevTimeMs, now, t);
+
+                // 计算修正后的圈速
+                // 圈速 = (结束时刻 - 开始时刻)
+                // 注意：startTimeMs 已经是修正过的了，所以这里直接减
+                uint32_t correctedLapTime = exactFinishTime - startTimeMs;
+
+                // 更新基准时间
+                lastTriggerTimeMs = now;
+                lastLapTime = correctedLapTime;
+
+                if (lastLapTime < bestLapTime)
+                    bestLapTime = lastLapTime;
+                finishSectors(exactFinishTime);
+                if (lapRef.finishLap(step * t, correctedLapTime))
+                    Serial.println("[TRACK] New reference lap");
+                Serial.printf("🏁 LAP! Time: %.3fs (Lateral: %.2fm)\n", lastLapTime / 1000.0, lateral);
+
+                if (type == TRACK_TYPE_SPRINT)
                 {
-                    bool headingOK = true;
-                    if (trackHeading >= 0)
-                    {
-                        if (getHeadingDiff(currHeading, trackHeading) > 90.0)
-                            headingOK = false;
-                    }
-
-                    // 同样加上严格距离检查 (< 1.5m)
-                    if (headingOK && distToEnd > prevDistanceToEnd && prevDistanceToEnd < 1.5)
-                    {
-                        // [回溯时间补偿]
-                        uint32_t exactFinishTime = (prevTimeMs > 0) ? prevTimeMs : now;
-
-                        // 计算修正后的圈速
-                        // 圈速 = (结束时刻 - 开始时刻)
-                        // 注意：startTimeMs 已经是修正过的了，所以这里直接减
-                        uint32_t correctedLapTime = exactFinishTime - startTimeMs;
-
-                        // 更新基准时间
-                        lastTriggerTimeMs = now;
-                        lastLapTime = correctedLapTime;
-
-                        if (lastLapTime < bestLapTime)
-                            bestLapTime = lastLapTime;
-                        Serial.printf("🏁 LAP! Time: %.3fs (MinDist: %.2fm)\n", lastLapTime / 1000.0, prevDistanceToEnd);
-
-                        if (type == TRACK_TYPE_SPRINT)
-                        {
-                            currentState = RACE_FINISHED;
-                            if (onLapFinishCB != NULL)
-                                onLapFinishCB();
-                            if (onRaceFinishCB != NULL)
-                                onRaceFinishCB();
-                        }
-                        else
-                        {
-                            if (onLapFinishCB != NULL)
-                                onLapFinishCB();
-
-                            // 这一圈的结束时间，就是下一圈的开始时间！
-                            startTimeMs = exactFinishTime;
-                            currentLapTime = 0;
-                            lapCount++;
-
-                            if (onLapStartCB != NULL)
-                                onLapStartCB();
-                        }
-                    }
+                    currentState = RACE_FINISHED;
+                    if (onLapFinishCB != NULL)
+                        onLapFinishCB();
+                    if (onRaceFinishCB != NULL)
+                        onRaceFinishCB();
                 }
+                else
+                {
+                    if (onLapFinishCB != NULL)
+                        onLapFinishCB();
+
+                    // 这一圈的结束时间，就是下一圈的开始时间！
+                    startTimeMs = exactFinishTime;
+                    currentLapTime = now - startTimeMs;
+                    lapCount++;
+                    beginSectors(exactFinishTime);
+                    lapRef.beginLap();
+                    lapRef.addFix(step * (1 - t), currentLapTime);
+
+                    if (onLapStartCB != NULL)
+                        onLapStartCB();
+                }
+            }
+            else if (hasPrev)
+            {
+                // [新增] 记录本圈轨迹，并与参考圈比较得到实时差值
+                lapRef.addFix(step, currentLapTime);
             }
         }
 
         // 更新历史记录
-        prevDistanceToStart = distToStart;
-        prevDistanceToEnd = distToEnd;
+        hasPrev = true;
+        prevX = x;
+        prevY = y;
         prevTimeMs = now; // [关键] 记录这一帧的时间
     }
 
-    String getFormattedTime(uint32_t ms)
+    // [修改] 写进调用者的缓冲 (至少 10 字节)，不再返回 String，主机端也能编译
+    static const char *formatTime(uint32_t ms, char *buf, size_t len)
     {
         if (ms == 0xFFFFFFFF || ms == 0)
-            return "--:--.---";
-        int minutes = ms / 60000;
-        int seconds = (ms % 60000) / 1000;
-        int millisec = ms % 1000;
-        char buf[16];
-        snprintf(buf, sizeof(buf), "%02d:%02d.%03d", minutes, seconds, millisec);
-        return String(buf);
+            snprintf(buf, len, "--:--.---");
+        else
+            snprintf(buf, len, "%02d:%02d.%03d", (int)(ms / 60000), (int)((ms % 60000) / 1000), (int)(ms % 1000));
+        return buf;
     }
 
     bool isTrackSetup() { return (abs(startPoint.lat) > 0.1); }//{return !(currentState == RACE_IDLE);}// 
     int getCurrentTrackType() { return (int)type; }
-    uint32_t getCurrentLapElapsed() { return (currentState == RACE_RUNNING) ? (millis() - startTimeMs) : 0; }
+    uint32_t getCurrentLapElapsed() { return (currentState == RACE_RUNNING) ? (halClock.millis() - startTimeMs) : 0; }
     void getStartPoint(double &lat, double &lon)
     {
         lat = startPoint.lat;
         lon = startPoint.lon;
     }
+    // [新增] 到起点的距离 (m)，使用预计算的局部坐标系 (给 UI 用，代替 haversine)
+    float getDistanceToStart(double lat, double lon)
+    {
+        float x, y;
+        frame.toLocal(lat, lon, x, y);
+        return sqrtf(startLine.dist2(x, y));
+    }
     bool isArmed() { return _isArmed; }
     float getTriggerRadius() { return triggerRadius; }
-    String getCurrentTimeStr() { return getFormattedTime(currentLapTime); }
-    String getLastLapStr() { return getFormattedTime(lastLapTime); }
-    String getBestLapStr() { return getFormattedTime(bestLapTime); }
+    uint32_t getLastLapTime() { return lastLapTime; }
+    uint32_t getBestLapTime() { return bestLapTime; }
     int getLapCount() { return lapCount; }
+
+    // [新增] 分段计时 (均为已计算好的缓存值，可在 UI/遥测中直接读取)
+    // idx 从 0 开始；没有成绩时返回 TRACK_NO_TIME
+    int getSectorCount() { return sectorGateCount + 1; }
+    int getCurrentSector() { return (currentState == RACE_RUNNING) ? nextGate : -1; }
+    uint32_t getLapSectorTime(int idx) { return (idx >= 0 && idx < TRACK_MAX_SECTORS) ? lapSectors[idx] : TRACK_NO_TIME; }
+    uint32_t getPrevLapSectorTime(int idx) { return (idx >= 0 && idx < TRACK_MAX_SECTORS) ? lastSectors[idx] : TRACK_NO_TIME; }
+    uint32_t getBestSectorTime(int idx) { return (idx >= 0 && idx < TRACK_MAX_SECTORS) ? bestSectors[idx] : TRACK_NO_TIME; }
+    int getLastSectorIndex() { return lastSectorIdx; }
+    uint32_t getLastSectorTime() { return lastSectorTime; }
+    int32_t getLastSectorDelta() { return lastSectorDelta; }
+    uint32_t getTheoreticalBest() { return theoreticalBest; }
+
+    // [新增] 实时圈速差 (与最佳参考圈在相同里程处比较，ms，负数为更快)
+    bool hasLiveDelta() { return currentState == RACE_RUNNING && lapRef.hasDelta(); }
+    int32_t getLiveDelta() { return lapRef.getDelta(); }
+    uint32_t getPredictedLap() { return lapRef.getPredictedLapMs(); }
+    uint32_t getReferenceLap() { return lapRef.getReferenceLapMs(); }
+    // [新增] 在 loop() 里调用：新的最佳参考圈写卡、切换赛道后读卡 (不在 FusionTask 里阻塞)
+    void pollStorage() { lapRef.poll(); }
     bool isRunning() { return currentState == RACE_RUNNING; }
 };
 
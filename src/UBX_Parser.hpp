@@ -0,0 +1,228 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// UBX 二进制协议解析器 (逐字节状态机)
+// ==========================================
+// 帧格式: 0xB5 0x62 | Class | ID | Len(LE 2B) | Payload | CK_A CK_B
+// 校验和从 Class 开始计算，不包含 0xB5 0x62 头部
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_ID_NAV_PVT 0x07
+
+// NAV-PVT 长度: u-blox 7 (协议 14) 为 84 字节，M8 及以后为 92 字节
+// 我们用到的字段都在前 84 字节内，所以两种长度都接受
+#define UBX_NAV_PVT_MIN_LEN 84
+// [修改] 只解码 NAV-PVT，负载最长 92 字节。长度字段超过它的帧 (MON-VER 之类，或者长度字节本身出错)
+// 直接丢弃并重新找同步头：以前按长度跳过整帧，长度错成 0xFFFF 时会吞掉后面 64KB 的数据 (约 60 秒的定位)
+#define UBX_MAX_PAYLOAD 92
+
+// 每个导航周期 (epoch) 填充一次的定长结构体
+struct UBXNavPvt
+{
+    uint32_t iTOW;     // GPS 周内时间 (ms)
+    double lat;        // 纬度 (度)
+    double lon;        // 经度 (度)
+    float alt_m;       // 海拔 (m, hMSL)
+    float speed_kmh;   // 地速 (km/h)
+    float heading_deg; // 运动航向 (度, 0-360)
+    float hAcc_m;      // 水平精度估计 (m)
+    float sAcc_kmh;    // 速度精度估计 (km/h)
+    uint8_t fixType;   // 0:无 2:2D 3:3D
+    uint8_t numSV;     // 参与解算的卫星数
+    bool valid;        // gnssFixOK 且 fixType >= 2
+    uint32_t rxMs;     // 本帧接收完成时刻 (millis)
+};
+
+enum UBXFeedResult
+{
+    UBX_NOT_MINE = 0, // 不属于 UBX 帧 (交给 NMEA 解析)
+    UBX_IN_FRAME,     // 属于 UBX 帧，帧未结束
+    UBX_FRAME_OK,     // 一帧接收完毕且校验通过
+    UBX_FRAME_BAD     // 一帧接收完毕但校验失败 / 长度超过 UBX_MAX_PAYLOAD 被丢弃
+};
+
+class UBXParser
+{
+private:
+    enum State
+    {
+        ST_SYNC1,
+        ST_SYNC2,
+        ST_CLASS,
+        ST_ID,
+        ST_LEN1,
+        ST_LEN2,
+        ST_PAYLOAD,
+        ST_CK_A,
+        ST_CK_B
+    };
+
+    State _state = ST_SYNC1;
+    uint8_t _class = 0, _id = 0;
+    uint16_t _len = 0, _pos = 0;
+    uint8_t _ckA = 0, _ckB = 0, _rxCkA = 0;
+    uint8_t _payload[UBX_MAX_PAYLOAD];
+
+    uint32_t _framesOk = 0;
+    uint32_t _framesBad = 0;
+
+    inline void checksum(uint8_t c)
+    {
+        _ckA += c;
+        _ckB += _ckA;
+    }
+
+    static inline uint32_t u32(const uint8_t *p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+    static inline int32_t i32(const uint8_t *p) { return (int32_t)u32(p); }
+
+public:
+    UBXFeedResult feed(uint8_t c)
+    {
+        switch (_state)
+        {
+        case ST_SYNC1:
+            if (c != 0xB5)
+                return UBX_NOT_MINE;
+            _state = ST_SYNC2;
+            return UBX_IN_FRAME;
+
+        case ST_SYNC2:
+            if (c != 0x62)
+            {
+                // 假同步头：这个字节重新按 "帧外" 处理
+                _state = ST_SYNC1;
+                return feed(c);
+            }
+            _ckA = _ckB = 0;
+            _state = ST_CLASS;
+            return UBX_IN_FRAME;
+
+        case ST_CLASS:
+            _class = c;
+            checksum(c);
+            _state = ST_ID;
+            return UBX_IN_FRAME;
+
+        case ST_ID:
+            _id = c;
+            checksum(c);
+            _state = ST_LEN1;
+            return UBX_IN_FRAME;
+
+        case ST_LEN1:
+            _len = c;
+            checksum(c);
+            _state = ST_LEN2;
+            return UBX_IN_FRAME;
+
+        case ST_LEN2:
+            _len |= (uint16_t)c << 8;
+            checksum(c);
+            _pos = 0;
+            if (_len > UBX_MAX_PAYLOAD)
+            {
+                // 后面的字节回到帧外处理 (NMEA 解析器会按校验和丢掉)
+                _state = ST_SYNC1;
+                _framesBad++;
+                return UBX_FRAME_BAD;
+            }
+            _state = (_len > 0) ? ST_PAYLOAD : ST_CK_A;
+            return UBX_IN_FRAME;
+
+        case ST_PAYLOAD:
+            _payload[_pos++] = c;
+            checksum(c);
+            if (_pos >= _len)
+                _state = ST_CK_A;
+            return UBX_IN_FRAME;
+
+        case ST_CK_A:
+            _rxCkA = c;
+            _state = ST_CK_B;
+            return UBX_IN_FRAME;
+
+        case ST_CK_B:
+            _state = ST_SYNC1;
+            if (_rxCkA == _ckA && c == _ckB)
+            {
+                _framesOk++;
+                return UBX_FRAME_OK;
+            }
+            _framesBad++;
+            return UBX_FRAME_BAD;
+        }
+        _state = ST_SYNC1;
+        return UBX_NOT_MINE;
+    }
+
+    bool isNavPvt() { return _class == UBX_CLASS_NAV && _id == UBX_ID_NAV_PVT && _len >= UBX_NAV_PVT_MIN_LEN; }
+
+    // 把刚收完的 NAV-PVT 负载解码到定长结构体 (只做整数移位和一次缩放)
+    bool decodeNavPvt(UBXNavPvt &out)
+    {
+        if (!isNavPvt())
+            return false;
+        const uint8_t *p = _payload;
+
+        out.iTOW = u32(p + 0);
+        out.fixType = p[20];
+        bool gnssFixOK = (p[21] & 0x01) != 0;
+        out.numSV = p[23];
+        out.lon = i32(p + 24) * 1e-7;
+        out.lat = i32(p + 28) * 1e-7;
+        out.alt_m = i32(p + 36) * 0.001f;
+        out.hAcc_m = u32(p + 40) * 0.001f;
+        out.speed_kmh = i32(p + 60) * 0.0036f; // mm/s -> km/h
+        out.heading_deg = i32(p + 64) * 1e-5f;
+        out.sAcc_kmh = u32(p + 68) * 0.0036f;
+        out.valid = gnssFixOK && out.fixType >= 2;
+        return true;
+    }
+
+    uint32_t getFramesOk() { return _framesOk; }
+    uint32_t getFramesBad() { return _framesBad; }
+};
+
+// [新增] decodeNavPvt() 的逆过程：生成一帧完整的 NAV-PVT (92 字节负载，含同步头和校验和)，返回帧长。
+// 给单元测试、主机端 bench 和设备上的解析器对比测试 (GPS_Driver::benchmark) 合成数据用
+#define UBX_NAV_PVT_FRAME_LEN (6 + 92 + 2)
+inline size_t ubxEncodeNavPvt(const UBXNavPvt &in, uint8_t *out)
+{
+    auto put32 = [](uint8_t *p, uint32_t v)
+    {
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+    };
+    uint8_t *p = out + 6;
+    memset(out, 0, UBX_NAV_PVT_FRAME_LEN);
+    out[0] = 0xB5;
+    out[1] = 0x62;
+    out[2] = UBX_CLASS_NAV;
+    out[3] = UBX_ID_NAV_PVT;
+    out[4] = 92;
+    out[5] = 0;
+    put32(p + 0, in.iTOW);
+    p[20] = in.fixType;
+    p[21] = in.valid ? 0x01 : 0x00;
+    p[23] = in.numSV;
+    put32(p + 24, (uint32_t)(int32_t)lround(in.lon * 1e7));
+    put32(p + 28, (uint32_t)(int32_t)lround(in.lat * 1e7));
+    put32(p + 36, (uint32_t)(int32_t)lroundf(in.alt_m * 1000));
+    put32(p + 40, (uint32_t)lroundf(in.hAcc_m * 1000));
+    put32(p + 60, (uint32_t)(int32_t)lroundf(in.speed_kmh / 0.0036f));
+    put32(p + 64, (uint32_t)(int32_t)lroundf(in.heading_deg * 1e5f));
+    put32(p + 68, (uint32_t)lroundf(in.sAcc_kmh / 0.0036f));
+
+    uint8_t ckA = 0, ckB = 0;
+    for (size_t i = 2; i < 6 + 92; i++)
+    {
+        ckA += out[i];
+        ckB += ckA;
+    }
+    out[6 + 92] = ckA;
+    out[6 + 92 + 1] = ckB;
+    return UBX_NAV_PVT_FRAME_LEN;
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <Arduino.h>
+#include <lvgl.h>
+#include <stdarg.h>
+
+// ==========================================
+// 变化驱动的控件更新 (绑定层)
+// ==========================================
+// lv_label_set_text / lv_arc_set_value / 设置样式即使值没变也会让 LVGL 重新排版并标记脏区，
+// 接着就是一次 SPI 刷屏。这里为每个控件缓存上一次写进去的值 (已量化，比如速度按 0.1km/h)，
+// 值不变就直接跳过，不碰 LVGL。
+// 注意: 其他代码直接改了控件 (比如开机扫表动画) 之后，要调用 invalidate() 让缓存失效。
+
+#define UI_BIND_TEXT_MAX 24
+
+struct UiBindStats
+{
+    uint32_t applied = 0;    // 真正写进 LVGL 的次数
+    uint32_t suppressed = 0; // 值没变被跳过的次数
+
+    void printStats()
+    {
+        uint32_t total = applied + suppressed;
+        Serial.printf("[BIND] applied=%lu suppressed=%lu (%.0f%% of widget updates skipped)\n",
+                      applied, suppressed, total ? 100.0 * suppressed / total : 0.0);
+    }
+    void resetStats() { applied = suppressed = 0; }
+};
+
+UiBindStats uiBind;
+
+// 单个缓存值。值与上次相同返回 false (计一次跳过)；否则记住新值并返回 true
+template <typename T>
+class Bound
+{
+private:
+    T _last{};
+    bool _valid = false;
+
+public:
+    bool changed(const T &v)
+    {
+        if (_valid && v == _last)
+        {
+            uiBind.suppressed++;
+            return false;
+        }
+        _last = v;
+        _valid = true;
+        uiBind.applied++;
+        return true;
+    }
+    void invalidate() { _valid = false; }
+};
+
+// 文本缓存 (超长文本截断后比较，只用于短标签)
+class BoundText
+{
+private:
+    char _last[UI_BIND_TEXT_MAX];
+    bool _valid = false;
+
+public:
+    bool changed(const char *text)
+    {
+        if (_valid && strncmp(_last, text, UI_BIND_TEXT_MAX - 1) == 0)
+        {
+            uiBind.suppressed++;
+            return false;
+        }
+        strlcpy(_last, text, sizeof(_last));
+        _valid = true;
+        uiBind.applied++;
+        return true;
+    }
+    void invalidate() { _valid = false; }
+};
+
+// 标签: 文本 + 文字颜色
+class BoundLabel
+{
+private:
+    Bound<int32_t> _value;
+    BoundText _text;
+    Bound<uint32_t> _color;
+
+public:
+    void setText(lv_obj_t *obj, const char *text)
+    {
+        _value.invalidate();
+        if (_text.changed(text))
+            lv_label_set_text(obj, text);
+    }
+
+    // 数值标签: 先比较量化后的值 q，变了才格式化 (fmt 的参数由调用方给出)
+    void setValue(lv_obj_t *obj, int32_t q, const char *fmt, ...)
+    {
+        if (!_value.changed(q))
+            return;
+        char buf[UI_BIND_TEXT_MAX];
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        _text.invalidate();
+        lv_label_set_text(obj, buf);
+    }
+
+    void setColor(lv_obj_t *obj, uint32_t hex)
+    {
+        if (_color.changed(hex))
+            lv_obj_set_style_text_color(obj, lv_color_hex(hex), LV_PART_MAIN);
+    }
+
+    void invalidate()
+    {
+        _value.invalidate();
+        _text.invalidate();
+        _color.invalidate();
+    }
+};
+
+// 圆弧: 数值 + 指示条颜色
+class BoundArc
+{
+private:
+    Bound<int16_t> _value;
+    Bound<uint32_t> _color;
+
+public:
+    void setValue(lv_obj_t *obj, int16_t v)
+    {
+        if (_value.changed(v))
+            lv_arc_set_value(obj, v);
+    }
+
+    void setColor(lv_obj_t *obj, uint32_t hex)
+    {
+        if (_color.changed(hex))
+            lv_obj_set_style_arc_color(obj, lv_color_hex(hex), LV_PART_INDICATOR);
+    }
+
+    void invalidate()
+    {
+        _value.invalidate();
+        _color.invalidate();
+    }
+};
+
+// 位置 (G 球): 按像素比较对齐偏移
+class BoundAlign
+{
+private:
+    Bound<int32_t> _pos;
+
+public:
+    void align(lv_obj_t *obj, lv_align_t align, lv_coord_t x, lv_coord_t y)
+    {
+        if (_pos.changed(((int32_t)x << 16) | (uint16_t)y))
+            lv_obj_align(obj, align, x, y);
+    }
+
+    void invalidate() { _pos.invalidate(); }
+};
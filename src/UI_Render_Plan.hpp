@@ -0,0 +1,97 @@
+#pragma once
+#include "Hal.hpp"
+
+// ==========================================
+// 刷屏规划: 脏区合并 + 缓冲策略选择 (UiTask 用)
+// ==========================================
+// 只依赖 HAL，不引用 LVGL 头文件: 面积类型用模板参数，设备上直接传 lv_area_t
+// (x1/y1/x2/y2 都是闭区间)，主机端用 UiRect，单元测试和 host bench 的帧缓冲替身都走同一份代码。
+
+#define UI_SCREEN_W 320
+#define UI_SCREEN_H 240
+#define UI_BAND_PX (240 * 40)    // 内部 RAM 条带缓冲的像素数 (APP_UI 里的 buf/buf2)
+#define UI_FULL_FRAME_PCT 50     // 脏区总面积超过屏幕的一半就改用整屏缓冲
+// [修改] 合并的代价是外接矩形多画的像素，收益是省掉一次 flush 的固定开销 (setAddrWindow + DMA 启动，约 15us)。
+// 按 80MHz SPI (10 B/us，RGB565 每像素 2B) 折算成像素: 多画的像素不超过一次 flush 的开销才合并，总线时间不会变长
+#define UI_SPI_BYTES_PER_US 10
+#define UI_FLUSH_OVERHEAD_US 15
+#define UI_FLUSH_OVERHEAD_PX (UI_FLUSH_OVERHEAD_US * UI_SPI_BYTES_PER_US / 2) // 75 像素
+
+enum UiBufferMode : uint8_t
+{
+    UI_BUF_BANDS = 0, // 只用内部 RAM 条带 (原来的行为)
+    UI_BUF_AUTO,      // 按脏区面积自动选择 (默认)
+    UI_BUF_FULL       // 总是用 PSRAM 整屏缓冲
+};
+
+// 与 lv_area_t 同样的布局 (主机端用)
+struct UiRect
+{
+    int16_t x1, y1, x2, y2;
+};
+
+template <typename Area>
+inline uint32_t uiAreaSize(const Area &a)
+{
+    return (uint32_t)(a.x2 - a.x1 + 1) * (uint32_t)(a.y2 - a.y1 + 1);
+}
+
+// 把 areas[0..n) 中未合并 (joined[i] == 0) 的脏区两两合并成外接矩形 (外接矩形面积不超过两块之和
+// 加 UI_FLUSH_OVERHEAD_PX 时)，反复进行直到没有可合并的。合并结果写在下标大的那块，下标小的标记为已合并:
+// LVGL 在调用 render_start_cb 之前就记下了最后一块未合并脏区的下标，这块必须一直保持未合并。
+// 返回最终要重绘的像素数；merged 加上被合并掉的脏区个数
+template <typename Area>
+inline uint32_t uiCoalesceAreas(Area *areas, uint8_t *joined, int16_t n, uint32_t &merged)
+{
+    for (bool again = true; again;)
+    {
+        again = false;
+        for (int16_t i = 0; i < n; i++)
+        {
+            if (joined[i])
+                continue;
+            for (int16_t j = i + 1; j < n; j++)
+            {
+                if (joined[j])
+                    continue;
+                const Area &a = areas[i], &b = areas[j];
+                Area box = a;
+                box.x1 = min(a.x1, b.x1);
+                box.y1 = min(a.y1, b.y1);
+                box.x2 = max(a.x2, b.x2);
+                box.y2 = max(a.y2, b.y2);
+                if (uiAreaSize(box) > uiAreaSize(a) + uiAreaSize(b) + UI_FLUSH_OVERHEAD_PX)
+                    continue;
+                areas[j] = box;
+                joined[i] = 1;
+                merged++;
+                again = true;
+                break;
+            }
+        }
+    }
+
+    uint32_t px = 0;
+    for (int16_t i = 0; i < n; i++)
+        if (!joined[i])
+            px += uiAreaSize(areas[i]);
+    return px;
+}
+
+// 这次重绘 (px 个像素) 是否改用整屏缓冲
+inline bool uiUseFullFrame(UiBufferMode mode, bool haveFull, uint32_t px)
+{
+    if (!haveFull)
+        return false;
+    return mode == UI_BUF_FULL ||
+           (mode == UI_BUF_AUTO && px * 100 >= (uint32_t)UI_SCREEN_W * UI_SCREEN_H * UI_FULL_FRAME_PCT);
+}
+
+// 一块宽 w 高 h 的区域在 bufPx 像素的缓冲里要分几次 flush (LVGL 按整行切条带)
+inline uint32_t uiFlushCount(uint32_t w, uint32_t h, uint32_t bufPx)
+{
+    uint32_t rows = bufPx / w;
+    if (rows == 0)
+        rows = 1;
+    return (h + rows - 1) / rows;
+}
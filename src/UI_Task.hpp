@@ -0,0 +1,271 @@
+#pragma once
+#include <Arduino.h>
+#include <lvgl.h>
+#include "LGFX_Driver.hpp"
+#include "Sensor_Task.hpp"
+#include "Task_Monitor.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
+#include "UI_Render_Plan.hpp"
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/cache.h"
+#endif
+
+extern LGFX tft;
+extern lv_obj_t *ui_ScreenMain;
+void update_ui_loop();
+void ui_refresh_data();
+
+// ==========================================
+// LVGL 渲染任务 + DMA 异步刷屏
+// ==========================================
+// LVGL 只在本任务里运行 (Core 0，优先级低于日志写卡任务)，loop() 只剩传感器/日志。
+// 其他任务 (BLE 指令回调等) 要操作 LVGL 对象时，必须先 uiTask.lock()，用完 unlock()。
+//
+// 刷屏: flush_cb 只把一条带 (240x40) 交给 SPI DMA 就返回，不调用 lv_disp_flush_ready()。
+// 两块绘制缓冲交替使用，LVGL 接着在另一块里渲染下一条带，与 DMA 传输重叠。
+// 真正需要这块缓冲时 LVGL 才会调用 wait_cb，这时再检查 DMA 是否完成并通知 LVGL。
+// (LovyanGFX 没有开放 DMA 完成中断的回调，所以完成信号在 wait_cb / 任务循环里查询总线状态)
+//
+// [新增] 缓冲策略 (每次重绘开始时在 render_start_cb 里决定):
+//   内部 RAM 条带缓冲: 局部小控件 (数字、状态字) 的刷新，延迟最低
+//   PSRAM 整屏缓冲:   切换页面等大面积重绘，一次 flush 完成整块区域，不再切成 8 条
+// 同时把紧挨着的小脏区两两合并成外接矩形 (多画的像素不超过一次 flush 的开销 UI_FLUSH_OVERHEAD_PX)，
+// 减少 setAddrWindow + DMA 启动的次数。合并和选择的规则在 UI_Render_Plan.hpp (主机端 bench 'render' 用同一份)。
+
+#define UI_TASK_PERIOD_MS 5      // lv_timer_handler() 调用间隔
+#define UI_DATA_REFRESH_MS 200   // 主界面数据刷新间隔
+
+#ifndef UI_BUFFER_MODE_DEFAULT
+#define UI_BUFFER_MODE_DEFAULT UI_BUF_AUTO
+#endif
+
+class UiTask
+{
+private:
+    TaskHandle_t _task = NULL;
+    SemaphoreHandle_t _mutex = NULL;
+
+    lv_disp_t *_disp = NULL;
+    lv_disp_draw_buf_t *_bandBuf = NULL;  // 内部 RAM 条带缓冲 (APP_UI 里的 buf/buf2)
+    lv_disp_draw_buf_t _fullBuf;          // PSRAM 整屏双缓冲
+    lv_color_t *_full1 = NULL, *_full2 = NULL;
+    UiBufferMode _mode = UI_BUFFER_MODE_DEFAULT;
+
+    lv_disp_drv_t *_pendingFlush = NULL; // DMA 传输中的那次 flush
+    uint32_t _flushStartUs = 0;
+    bool _refreshed = false;              // 本轮 lv_timer_handler() 是否真的重绘了屏幕
+    int8_t _monId = -1;
+
+    // 统计
+    uint32_t _frames = 0;
+    uint32_t _flushes = 0;
+    uint64_t _stallUs = 0; // CPU 等 DMA 的总时间 (渲染没能覆盖传输的部分)
+    uint64_t _busyUs = 0;  // DMA 传输总时间 (从 flush_cb 到确认完成)
+    uint64_t _bytes = 0;   // 推给屏幕的字节数
+    uint32_t _statsStartMs = 0;
+    uint32_t _fullFrames = 0; // 用整屏缓冲渲染的重绘次数
+    uint32_t _coalesced = 0;  // 被合并掉的脏区个数
+
+    bool isFullBuffer(const void *p)
+    {
+        const size_t bytes = UI_SCREEN_W * UI_SCREEN_H * sizeof(lv_color_t);
+        return _full1 && (((const uint8_t *)p >= (const uint8_t *)_full1 && (const uint8_t *)p < (const uint8_t *)_full1 + bytes) ||
+                          ((const uint8_t *)p >= (const uint8_t *)_full2 && (const uint8_t *)p < (const uint8_t *)_full2 + bytes));
+    }
+
+    void completeFlush()
+    {
+        tft.endWrite();
+        lv_disp_drv_t *disp = _pendingFlush;
+        _pendingFlush = NULL;
+        uint32_t dt = micros() - _flushStartUs;
+        _busyUs += dt;
+        flushTime.record(dt);
+        TRACE_END(TRACE_LVGL_FLUSH, 0);
+        lv_disp_flush_ready(disp);
+    }
+
+    static void taskLoop(void *param)
+    {
+        UiTask *self = (UiTask *)param;
+        uint32_t t_refresh = 0;
+
+        while (true)
+        {
+            self->lock();
+
+            uint32_t t0 = micros();
+            self->_refreshed = false;
+            update_ui_loop();
+            self->pollFlush(); // 最后一条带的 DMA 可能已经结束
+            if (self->_refreshed)
+                self->frameTime.record(micros() - t0);
+
+            // [修改] 原来 loop() 里的 task_ui_refresh()
+            if (millis() - t_refresh > UI_DATA_REFRESH_MS)
+            {
+                t_refresh = millis();
+                // 只有当前是主屏幕时，才运行常规的数据刷新
+                // 零百界面有自己的高速定时器，不需要这个低速的干扰
+                if (lv_scr_act() == ui_ScreenMain)
+                    ui_refresh_data();
+            }
+
+            self->unlock();
+            taskMon.addBusy(self->_monId, micros() - t0);
+            vTaskDelay(pdMS_TO_TICKS(UI_TASK_PERIOD_MS));
+        }
+    }
+
+public:
+    LatencyHistogram frameTime; // 一次重绘 (lv_timer_handler 内含渲染 + 刷屏) 的耗时
+    LatencyHistogram flushTime; // 一条带从交给 DMA 到传输完成的耗时
+
+    // init_ui() 之后调用
+    void begin()
+    {
+        if (!_mutex)
+            _mutex = xSemaphoreCreateRecursiveMutex();
+        // Core 0，优先级 1：低于 LogWriter (2) 和音频 (20)，渲染永远不会挡住写卡
+        xTaskCreatePinnedToCore(taskLoop, "UiTask", 8192, this, 1, &_task, 0);
+        _monId = taskMon.add("UiTask", &_task);
+        metrics.addHistogram("lvgl.frame", &frameTime);
+        Serial.println("[UI] LVGL task running on Core 0 (DMA flush)");
+    }
+
+    // 递归锁：同一任务里可以嵌套调用
+    void lock()
+    {
+        if (_mutex)
+            xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+    }
+
+    void unlock()
+    {
+        if (_mutex)
+            xSemaphoreGiveRecursive(_mutex);
+    }
+
+    // [新增] init_ui() 注册显示驱动后调用：记下条带缓冲，并在 PSRAM 里分配整屏双缓冲 (共 300KB)
+    void attachDisplay(lv_disp_t *disp, lv_disp_draw_buf_t *bands)
+    {
+        _disp = disp;
+        _bandBuf = bands;
+        const size_t px = UI_SCREEN_W * UI_SCREEN_H;
+        _full1 = (lv_color_t *)ps_malloc(px * sizeof(lv_color_t));
+        _full2 = (lv_color_t *)ps_malloc(px * sizeof(lv_color_t));
+        if (!_full1 || !_full2)
+        {
+            free(_full1);
+            free(_full2);
+            _full1 = _full2 = NULL;
+            _mode = UI_BUF_BANDS;
+            Serial.println("[UI] PSRAM alloc failed, band buffers only");
+            return;
+        }
+        lv_disp_draw_buf_init(&_fullBuf, _full1, _full2, px);
+        _statsStartMs = millis();
+    }
+
+    void setBufferMode(UiBufferMode mode)
+    {
+        lock();
+        _mode = _full1 ? mode : UI_BUF_BANDS;
+        unlock();
+    }
+    UiBufferMode getBufferMode() { return _mode; }
+
+    // --- 以下由 LVGL 显示驱动回调调用 (都在本任务里) ---
+
+    // render_start_cb：LVGL 合并完脏区、开始渲染之前调用
+    void renderStart(lv_disp_drv_t *drv)
+    {
+        if (!_disp || !_bandBuf)
+            return;
+        uint32_t px = uiCoalesceAreas(_disp->inv_areas, _disp->inv_area_joined, _disp->inv_p, _coalesced);
+
+        bool full = uiUseFullFrame(_mode, _full1 != NULL, px);
+        lv_disp_draw_buf_t *want = full ? &_fullBuf : _bandBuf;
+        if (full)
+            _fullFrames++;
+        if (drv->draw_buf != want)
+        {
+            waitFlush(); // 旧缓冲上的最后一次 DMA 必须先结束
+            drv->draw_buf = want;
+        }
+    }
+
+    // flush_cb：一块区域交给 DMA 后调用
+    void flushStarted(lv_disp_drv_t *disp, const lv_area_t *area)
+    {
+        _pendingFlush = disp;
+        _flushStartUs = micros();
+        _flushes++;
+        _bytes += lv_area_get_size(area) * sizeof(lv_color_t);
+        TRACE_BEGIN(TRACE_LVGL_FLUSH, lv_area_get_size(area));
+    }
+
+    // flush_cb：DMA 开始前调用。PSRAM 缓冲经过 CPU cache，要先写回，DMA 才能读到最新数据
+    void prepareDma(const void *p, size_t bytes)
+    {
+#if CONFIG_IDF_TARGET_ESP32S3
+        if (isFullBuffer(p))
+            Cache_WriteBack_Addr((uint32_t)p, bytes);
+#endif
+    }
+
+    // DMA 已结束就通知 LVGL，返回是否还有传输在进行
+    bool pollFlush()
+    {
+        if (_pendingFlush && !tft.dmaBusy())
+            completeFlush();
+        return _pendingFlush != NULL;
+    }
+
+    // wait_cb：LVGL 需要缓冲但上一次传输还没完成，只能在这里等
+    void waitFlush()
+    {
+        if (!_pendingFlush)
+            return;
+        uint32_t t0 = micros();
+        while (tft.dmaBusy())
+            ;
+        _stallUs += micros() - t0;
+        completeFlush();
+    }
+
+    // monitor_cb：一次重绘完成
+    void frameDone()
+    {
+        _refreshed = true;
+        _frames++;
+    }
+
+    void printStats()
+    {
+        frameTime.print("UI frame");
+        flushTime.print("UI flush");
+        Serial.printf("[UI] frames=%lu flushes=%lu dma=%lums stall=%lums (overlap %.0f%%)\n",
+                      _frames, _flushes, (uint32_t)(_busyUs / 1000), (uint32_t)(_stallUs / 1000),
+                      _busyUs ? 100.0 * (1.0 - (double)_stallUs / _busyUs) : 0.0);
+        static const char *MODE_NAMES[] = {"bands", "auto", "full"};
+        uint32_t secs = (millis() - _statsStartMs) / 1000;
+        Serial.printf("[UI] buffer=%s full-frame=%lu coalesced=%lu pushed=%luKB (%luKB/s)\n",
+                      MODE_NAMES[_mode], _fullFrames, _coalesced, (uint32_t)(_bytes / 1024),
+                      secs ? (uint32_t)(_bytes / 1024 / secs) : 0);
+    }
+
+    void resetStats()
+    {
+        lock();
+        frameTime.reset();
+        flushTime.reset();
+        _frames = _flushes = _fullFrames = _coalesced = 0;
+        _stallUs = _busyUs = _bytes = 0;
+        _statsStartMs = millis();
+        unlock();
+    }
+};
+
+UiTask uiTask;
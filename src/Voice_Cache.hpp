@@ -0,0 +1,167 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+
+// ==========================================
+// 报圈语音片段缓存 (PSRAM PCM)
+// ==========================================
+// 开机时把数字 0~10、"分"、"秒" 的语音一次性读进 PSRAM，报圈时直接把 PCM 拼接写进 I2S:
+// 播报过程不访问 SD 卡 (不和 DataLogger 抢总线)，片段之间也没有打开文件/解码的空档。
+// 片段文件是 16bit 单声道 PCM WAV，放在 SD 卡 /voice/ 下 (用 tools/make_voice_clips.py 从 /mp3/num/ 转换)，
+// 所有片段采样率必须相同。加载时去掉首尾静音，只留 VOICE_TRIM_KEEP_MS，拼起来语速更紧凑。
+// 缓存没加载成功时 (没有 /voice 目录等)，报圈退回原来逐个播放 MP3 的方式。
+
+#define VOICE_DIR "/voice"
+#define VOICE_TRIM_LEVEL 300  // 绝对值低于此值的采样算静音
+#define VOICE_TRIM_KEEP_MS 15 // 首尾各保留的静音
+
+// 片段编号: 0~10 就是数字本身
+static const char *const VOICE_CLIP_NAMES[] = {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "min", "sec"};
+#define VOICE_NUM_CLIPS (sizeof(VOICE_CLIP_NAMES) / sizeof(VOICE_CLIP_NAMES[0]))
+#define VOICE_CLIP_MIN 11
+#define VOICE_CLIP_SEC 12
+
+struct VoiceClip
+{
+    const char *name;
+    int16_t *pcm;     // PSRAM
+    uint32_t samples; // 去掉首尾静音之后的长度
+};
+
+class VoiceCache
+{
+private:
+    VoiceClip _clips[VOICE_NUM_CLIPS];
+    uint32_t _rate = 0;
+    uint32_t _bytes = 0;
+    uint32_t _loadMs = 0;
+    bool _ready = false;
+
+    static uint32_t rd32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+    static uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+    // 读一个 WAV 文件到 PSRAM。只接受 PCM 16bit 单声道
+    bool loadWav(fs::FS &fs, const char *path, VoiceClip &clip)
+    {
+        File f = fs.open(path, FILE_READ);
+        if (!f)
+            return false;
+
+        uint8_t hdr[12];
+        if (f.read(hdr, 12) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0)
+        {
+            Serial.printf("[VOICE] %s: not a WAV file\n", path);
+            f.close();
+            return false;
+        }
+
+        bool fmtOk = false;
+        uint8_t ck[8];
+        while (f.read(ck, 8) == 8)
+        {
+            uint32_t len = rd32(ck + 4);
+            if (memcmp(ck, "fmt ", 4) == 0)
+            {
+                uint8_t fmt[16];
+                if (len < 16 || f.read(fmt, 16) != 16)
+                    break;
+                uint32_t rate = rd32(fmt + 4);
+                if (rd16(fmt) != 1 || rd16(fmt + 2) != 1 || rd16(fmt + 14) != 16)
+                {
+                    Serial.printf("[VOICE] %s: need 16-bit mono PCM\n", path);
+                    break;
+                }
+                if (_rate != 0 && rate != _rate)
+                {
+                    Serial.printf("[VOICE] %s: sample rate %lu != %lu\n", path, rate, _rate);
+                    break;
+                }
+                _rate = rate;
+                fmtOk = true;
+                f.seek(f.position() + len - 16 + (len & 1));
+            }
+            else if (memcmp(ck, "data", 4) == 0 && fmtOk)
+            {
+                clip.pcm = (int16_t *)ps_malloc(len);
+                if (!clip.pcm || f.read((uint8_t *)clip.pcm, len) != len)
+                    break;
+                clip.samples = len / 2;
+                f.close();
+                trim(clip);
+                _bytes += len;
+                return true;
+            }
+            else
+            {
+                f.seek(f.position() + len + (len & 1)); // 跳过其他块 (LIST 等)
+            }
+        }
+        free(clip.pcm);
+        clip.pcm = NULL;
+        f.close();
+        return false;
+    }
+
+    // 去掉首尾静音 (只移动指针/长度，不重新分配)
+    void trim(VoiceClip &clip)
+    {
+        uint32_t keep = _rate * VOICE_TRIM_KEEP_MS / 1000;
+        uint32_t a = 0, b = clip.samples;
+        while (a < b && abs(clip.pcm[a]) < VOICE_TRIM_LEVEL)
+            a++;
+        while (b > a && abs(clip.pcm[b - 1]) < VOICE_TRIM_LEVEL)
+            b--;
+        a = (a > keep) ? a - keep : 0;
+        b = min(b + keep, clip.samples);
+        if (a > 0)
+            memmove(clip.pcm, clip.pcm + a, (b - a) * sizeof(int16_t));
+        clip.samples = b - a;
+    }
+
+public:
+    // setup() 里 SD 初始化之后调用。任何一个片段缺失/格式不对都放弃整个缓存
+    bool load(fs::FS &fs)
+    {
+        uint32_t t0 = millis();
+        _rate = 0;
+        _bytes = 0;
+        for (uint8_t i = 0; i < VOICE_NUM_CLIPS; i++)
+        {
+            _clips[i] = {VOICE_CLIP_NAMES[i], NULL, 0};
+            String path = String(VOICE_DIR) + "/" + VOICE_CLIP_NAMES[i] + ".wav";
+            if (!loadWav(fs, path.c_str(), _clips[i]))
+            {
+                Serial.printf("[VOICE] %s missing, lap announcements use MP3\n", path.c_str());
+                release();
+                return false;
+            }
+        }
+        _loadMs = millis() - t0;
+        _ready = true;
+        Serial.printf("[VOICE] %u clips cached, %luKB PSRAM, %luHz, load %lums\n",
+                      (unsigned)VOICE_NUM_CLIPS, _bytes / 1024, _rate, _loadMs);
+        return true;
+    }
+
+    void release()
+    {
+        _ready = false;
+        for (uint8_t i = 0; i < VOICE_NUM_CLIPS; i++)
+        {
+            free(_clips[i].pcm);
+            _clips[i].pcm = NULL;
+        }
+    }
+
+    const VoiceClip *get(uint8_t id)
+    {
+        return (_ready && id < VOICE_NUM_CLIPS) ? &_clips[id] : NULL;
+    }
+
+    static const char *name(uint8_t id) { return (id < VOICE_NUM_CLIPS) ? VOICE_CLIP_NAMES[id] : "0"; }
+
+    bool isReady() { return _ready; }
+    uint32_t sampleRate() { return _rate; }
+};
+
+VoiceCache voiceCache;
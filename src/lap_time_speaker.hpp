@@ -40,29 +40,20 @@ LapVoiceData getLapVoiceData(uint32_t total_ms)
 
     return data;
 }
-void playMp3(String filename)
-{
-    // 方法：创建一个新的 String 对象来存储完整路径
-    // "/mp3/num/" 会自动被转换成 String 并与 filename 拼接
-    String fullPath = "/mp3/num/" + filename;
-
-    // 然后将拼接好的结果转为 c_str() 传给驱动
-    audioDriver.play(fullPath.c_str());
-}
 
 // --- 辅助函数：用 0-9 和 10 拼读 0-99 的整数 ---
-void playNumberCN(uint8_t num)
+void playNumberCN(ClipList &clips, uint8_t num)
 {
     if (num <= 10)
     {
         // 情况 1: 0-10，直接播放
-        playMp3(String(num) + ".mp3");
+        clips.add(num);
     }
     else if (num < 20)
     {
         // 情况 2: 11-19 -> "十" + "X"
-        playMp3("10.mp3");                  // 播放 "十"
-        playMp3(String(num - 10) + ".mp3"); // 播放 "个位"
+        clips.add(10);       // 播放 "十"
+        clips.add(num - 10); // 播放 "个位"
     }
     else
     {
@@ -70,27 +61,30 @@ void playNumberCN(uint8_t num)
         uint8_t ten = num / 10;
         uint8_t unit = num % 10;
 
-        playMp3(String(ten) + ".mp3"); // 播放 "十位" (例如 35 的 3)
-        playMp3("10.mp3");             // 播放 "十"
+        clips.add(ten); // 播放 "十位" (例如 35 的 3)
+        clips.add(10);  // 播放 "十"
 
         if (unit > 0)
         {
-            playMp3(String(unit) + ".mp3"); // 播放 "个位" (例如 35 的 5)
+            clips.add(unit); // 播放 "个位" (例如 35 的 5)
         }
     }
 }
 
 // --- 主函数：播放圈速 ---
+// [修改] 不再逐个排队 MP3，先收集整串片段编号 (3、10、VOICE_CLIP_MIN...)，最后一次交给 audioDriver.playClips()
+// 语音缓存就绪时整串以 PCM 无缝播放，否则退回 /mp3/num/<name>.mp3。新的圈速会顶掉还没播的旧圈速
 void playLapRecord(uint32_t lap_ms)
 {
     // 1. 调用你 hpp 里的计算函数，获取结构体
     LapVoiceData voice = getLapVoiceData(lap_ms);
+    ClipList clips;
 
     // 2. 播报分钟 (如果有)
     if (voice.has_minutes)
     {
-        playNumberCN(voice.minutes); // 使用拼读函数 (例如 "1" 或 "12")
-        playMp3("min.mp3");          // 播放 "分"
+        playNumberCN(clips, voice.minutes); // 使用拼读函数 (例如 "1" 或 "12")
+        clips.add(VOICE_CLIP_MIN);          // 播放 "分"
     }
 
     // 3. 播报秒
@@ -102,19 +96,21 @@ void playLapRecord(uint32_t lap_ms)
     // 这里做一个简单的处理：如果前面有分钟，且秒数<10，补一个"0"的音
     if (voice.has_minutes && voice.seconds < 10)
     {
-        playMp3("0.mp3");                        // 播放 "零"
-        playMp3(String(voice.seconds) + ".mp3"); // 播放 "5"
+        clips.add(0);             // 播放 "零"
+        clips.add(voice.seconds); // 播放 "5"
     }
     else
     {
-        playNumberCN(voice.seconds); // 正常拼读 "32" -> "三" "十" "二"
+        playNumberCN(clips, voice.seconds); // 正常拼读 "32" -> "三" "十" "二"
     }
 
     // 播放单位 "秒" (赛场上为了快节奏，有时候会省略这个字，看你喜好)
-    playMp3("sec.mp3");
+    clips.add(VOICE_CLIP_SEC);
 
     // 4. 播报毫秒小数 (直接读数字，不拼读)
     // 例如 .45 读作 "四" "五"，而不是 "四十五"
-    playMp3(String(voice.ms_tenths) + ".mp3");     // 播放 "4"
-    playMp3(String(voice.ms_hundredths) + ".mp3"); // 播放 "5"
+    clips.add(voice.ms_tenths);     // 播放 "4"
+    clips.add(voice.ms_hundredths); // 播放 "5"
+
+    audioDriver.playClips(clips);
 }
\ No newline at end of file
@@ -12,7 +12,7 @@
 
 // 颜色深度 (16bit RGB565)
 #define LV_COLOR_DEPTH 16
-#define LV_COLOR_16_SWAP 0 // 如果颜色红蓝反了，改这里为 1
+#define LV_COLOR_16_SWAP 1 // [修改] 缓冲直接存大端 RGB565，刷屏时整块 DMA 发送 (不再逐像素交换字节)
 
 // 内存管理
 #define LV_MEM_CUSTOM 0
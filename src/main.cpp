@@ -12,8 +12,30 @@
 #include "CMD_Parser.hpp"
 #include "Track_Manager.hpp"
 #include "lap_time_speaker.hpp"
+#include "Sensor_Task.hpp"
+#include "Track_Database.hpp"
+#include "Fusion_Estimator.hpp"
+#include "Telemetry.hpp"
+#include "Task_Monitor.hpp"
+#include "Trace.hpp"
+#include "Metrics.hpp"
 TrackManager trackMgr;
 
+// [修改] FusionTask 每一轮 task_sensors() 的耗时，预算 1ms
+LatencyHistogram dataPassTime;
+// [新增] loop() 每一轮的耗时 (日志/赛道库/参考圈读写卡/BLE 指令)，预算同样是 1ms
+LatencyHistogram loopPassTime;
+
+// [新增] 任务布局 (都是固定核):
+//   Core 1: SensorTask (5, 串口解析) > FusionTask (4, 融合/赛道计时/发布遥测快照) > loop (1, 日志/BLE/串口指令)
+//   Core 0: AudioTask (20) > LogWriter (2, 写卡) > UiTask (1, LVGL)
+// 任务之间只通过 SensorTask 的帧队列、telemetry 快照 (seqlock) 和各自的无锁队列交换数据
+TaskHandle_t fusionTaskHandle = NULL;
+TaskHandle_t loopTaskHandle = NULL;
+int8_t fusionMonId = -1;
+int8_t loopMonId = -1;
+void task_fusion(void *param);
+
 LV_FONT_DECLARE(font_race);
 
 // 当赛道管理器检测到起跑时调用
@@ -22,6 +44,7 @@ void handleRaceStart()
   Serial.println("[MAIN] Auto-Start Logging Triggered by GPS!");
   // 修改全局状态，task_logging 里的状态机会在下一帧自动调用 logger.start()
   sys_cfg.is_running = true;
+  audioDriver.play("/mp3/race_start.mp3", AUDIO_PRIO_ALERT); // [修改] 从 TrackManager 移到这里 (同在 FusionTask)
 
   // 你甚至可以在这里加个蜂鸣器提示音
   // audioDriver.playBeep();
@@ -48,7 +71,7 @@ GPS_Driver gps(44, 43);
 IMU_Driver imu(14, 21);
 BLE_Driver ble;
 extern Audio_Driver audioDriver;
-String gps_log_buffer = "";
+ByteRing<GPS_LOG_RING_SIZE> gps_log_ring;
 // extern bool sd_connected;
 bool sd_connected = false;
 // DataLogger logger; // 已经在 DataLogger.hpp 实例化
@@ -76,6 +99,10 @@ void setup()
   tft.setBrightness(128);
 
   initSD();
+  trackDb.begin(); // [新增] 加载 SD 卡赛道库索引 (没有文件则跳过)
+  logger.begin();
+  if (sd_connected)
+    logger.recover(); // [新增] 上次记录中途掉电时，修复二进制日志文件
   if (sys_cfg.boot_into_usb)
   {
     run_usb_mode();
@@ -92,6 +119,8 @@ void setup()
 
   // 4. 初始化音频
   audioDriver.begin();
+  if (sd_connected)
+    voiceCache.load(SD_MMC); // [新增] 报圈语音片段读进 PSRAM (没有 /voice 目录则报圈继续用 MP3)
 
   delay(200);
   audioDriver.setVolume(sys_cfg.volume);
@@ -103,20 +132,27 @@ void setup()
 
 
   // 6. 初始化 IMU
+  // [修改] 5 个校准参数随 applyConfig() 一起从 sys_cfg 读取 (begin() 里调用)，不再单独注入
   imu.begin();
 
-  // --- [修复这里] 使用新的 API 注入 5 个校准参数 ---
-  imu.setAllOffsets(
-      sys_cfg.offset_heading,
-      sys_cfg.offset_roll,
-      sys_cfg.offset_pitch,
-      sys_cfg.offset_lon,
-      sys_cfg.offset_lat);
-
   Serial.printf("IMU Offsets Applied: Lon=%.2f, Lat=%.2f\n", sys_cfg.offset_lon, sys_cfg.offset_lat);
+
+  // 7. [新增] 启动传感器接收任务 (GPS/IMU 串口事件驱动)
+  sensorTask.begin();
+
   trackMgr.attachOnStart(handleRaceStart);
   trackMgr.attachOnFinish(handleRaceFinish);
+
+  // [新增] 传感器帧的消费 (融合 + 赛道计时) 从 loop() 移到独立任务
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  loopMonId = taskMon.add("loop", &loopTaskHandle);
+  xTaskCreatePinnedToCore(task_fusion, "FusionTask", 8192, NULL, 4, &fusionTaskHandle, 1);
+  fusionMonId = taskMon.add("FusionTask", &fusionTaskHandle);
   init_ui();
+  uiTask.begin(); // [新增] 之后所有 LVGL 调用都在 UiTask 里 (其他任务需先 uiTask.lock())
+  metrics.addHistogram("fusion.pass", &dataPassTime);
+  metrics.addHistogram("loop.pass", &loopPassTime);
+  metrics.begin(); // [新增] 各驱动已登记完指标，再加上堆 / PSRAM 余量
 
   Serial.println("--- System Started Successfully ---");
 
@@ -124,28 +160,109 @@ void setup()
 
 // ================= 任务调度区 =================
 
-void task_sensors()
+// [新增] 用一帧数据更新遥测快照 (只在 FusionTask 里调用)
+void update_snapshot(TelemetrySnapshot &snap, const SensorFrame &f)
 {
-  // 1. 更新 GPS 驱动获取最新数据
-  gps.update();
+  if (f.type == FRAME_GPS)
+  {
+    snap.fix = f.fix;
+    snap.sats = f.sats;
+    if (f.fix)
+    {
+      snap.lat = f.lat;
+      snap.lon = f.lon;
+      snap.speed_kmh = f.speed_kmh;
+      snap.course = f.course;
+    }
+    else
+    {
+      snap.speed_kmh = 0; // 丢星: 位置保留最后一次，速度不再可信
+    }
+  }
+  else
+  {
+    snap.heading = f.heading;
+    snap.roll = f.roll;
+    snap.pitch = f.pitch;
+    snap.lon_g = f.lon_g;
+    snap.lat_g = f.lat_g;
+    snap.vert_g = f.vert_g;
+  }
+
+  // 融合生效时，位置/速度/航向用融合结果 (两次定位之间也在更新)
+  snap.fused = fusion.isFused();
+  if (snap.fused)
+  {
+    const FusedState &fs = fusion.getState();
+    snap.lat = fs.lat;
+    snap.lon = fs.lon;
+    snap.speed_kmh = fs.speed_kmh;
+    snap.course = fs.heading;
+  }
+  snap.t_ms = f.arrival_ms;
+}
 
-  // 2. [核心修复] 将 GPS 数据喂给赛道管理器！！！
-  // 如果没有这一行，trackMgr 永远不知道你现在的坐标，也就永远不会触发 Start
-  if (gps.tgps.location.isValid())
+void task_sensors()
+{
+  // [修改] GPS/IMU 的串口读取已移到 SensorTask (事件驱动)
+  // 这里只从队列取出已打好时间戳的帧
+  static TelemetrySnapshot snap = {};
+  bool updated = false;
+  SensorFrame f;
+  fusion.setEnabled(sys_cfg.fusion_enabled); // [新增] 开关在 BLE / 设置页里改，这里同步给融合
+  trackMgr.applyRequests();                  // [新增] APP / 赛道库 / 模式页提交的赛道修改在这里套用
+  while (sensorTask.receive(f))
   {
-    trackMgr.update(
-        gps.tgps.location.lat(),
-        gps.tgps.location.lng(),
-        gps.tgps.course.deg(),
-        gps.getSpeed(),
-        millis());
+    // [核心修复] 将 GPS 数据喂给赛道管理器！！！
+    // 如果没有这一行，trackMgr 永远不知道你现在的坐标，也就永远不会触发 Start
+    // 时间戳使用 GPS 周期时间 (映射到 millis)，而不是被渲染拖延后的 millis()
+    if (f.type == FRAME_GPS && f.fix)
+    {
+      // [修改] 首次定位只记下位置，赛道库的查找 (读 SD) 在 loop() 里做
+      trackDb.noteFix(f.lat, f.lon);
+      // [修改] 先修正融合状态；融合生效时赛道管理器改由下面的 IMU 帧驱动 (100Hz)
+      fusion.correctGps(f);
+      if (!fusion.isFused())
+        trackMgr.update(f.lat, f.lon, f.course, f.speed_kmh, f.epoch_ms);
+    }
+    else if (f.type == FRAME_GPS)
+    {
+      fusion.correctGps(f); // 丢星
+    }
+    else if (f.type == FRAME_IMU)
+    {
+      // [新增] IMU 每一帧都进日志 (100Hz，二进制模式下与 GPS 块交错写入同一文件)
+      logger.logImu(f);
+      // [新增] 两次定位之间用 IMU 推算位置，计时线求交的时间分辨率从 100ms 提高到 10ms
+      if (fusion.predictImu(f))
+      {
+        const FusedState &fs = fusion.getState();
+        trackMgr.update(fs.lat, fs.lon, fs.heading, fs.speed_kmh, fs.t_ms);
+      }
+    }
+    update_snapshot(snap, f);
+    updated = true;
+    sensorTask.markConsumed(f);
   }
 
-  static uint32_t t_imu = 0;
-  if (millis() - t_imu > 20)
+  // [新增] 一批帧处理完发布一次快照
+  if (updated)
+    telemetry.write(snap);
+}
+
+// [新增] FusionTask: 有帧到达立即醒来处理
+void task_fusion(void *param)
+{
+  while (true)
   {
-    imu.update();
-    t_imu = millis();
+    sensorTask.waitForFrame(pdMS_TO_TICKS(20));
+    uint32_t t_pass = micros();
+    TRACE_BEGIN(TRACE_FUSION_PASS, 0);
+    task_sensors();
+    TRACE_END(TRACE_FUSION_PASS, 0);
+    uint32_t dt = micros() - t_pass;
+    dataPassTime.record(dt);
+    taskMon.addBusy(fusionMonId, dt);
   }
 }
 void task_logging()
@@ -172,6 +289,9 @@ void task_logging()
     last_running_state = sys_cfg.is_running;
   }
 
+  // [新增] FusionTask 交来的 IMU 记录 (每一圈都取，块缓冲池只在本任务里操作)
+  logger.pollImu();
+
   // 周期性记录 (10Hz)
   if (millis() - t_log >= 100)
   {
@@ -183,7 +303,13 @@ void task_logging()
     if (ble.getMode() == BLE_MODE_RACECHRONO && ble.isConnected())
     {
       // 直接传入 GPS 对象，驱动会自动打包成二进制发走
-      ble.sendRaceChronoBinary(gps.tgps);
+      // [修改] 有融合结果时，位置/速度/航向用融合值 (两次定位之间也在更新)，从遥测快照读 (经纬度不会错位)
+      TelemetrySnapshot t;
+      telemetry.read(t);
+      if (t.fused)
+        ble.sendRaceChronoBinary(gps.tgps, t.lat, t.lon, t.speed_kmh, t.course);
+      else
+        ble.sendRaceChronoBinary(gps.tgps);
     }
     // ========================================================
     // 📱 情况 B: APP 模式 (发送原来的遥测心跳)
@@ -205,35 +331,10 @@ void task_logging()
   }
 }
 
-void task_ui_engine()
-{
-  static uint32_t t_ui = 0;
-  if (millis() - t_ui > 5)
-  {
-    t_ui = millis();
-    update_ui_loop();
-  }
-}
-
-// main.cpp
-
-void task_ui_refresh()
-{
-  static uint32_t t_refresh = 0;
-  if (millis() - t_refresh > 200)
-  {
-    t_refresh = millis();
-
-    // [优化] 只有当前是主屏幕时，才运行常规的数据刷新
-    // 零百界面有自己的高速定时器，不需要这个低速的干扰
-    if (lv_scr_act() == ui_ScreenMain)
-    {
-      ui_refresh_data();
-    }
-  }
-}
+// [修改] task_ui_engine() / task_ui_refresh() 已移到 LVGL 渲染任务 (UI_Task.hpp)
 void loop()
 {
+  uint32_t t_loop = micros();
   if (Serial.available() > 0)
   {
     char cmd = Serial.read();
@@ -250,9 +351,95 @@ void loop()
       // 预期听到: "一分 五十二秒 二零"
       playLapRecord(112200);
     }
+    else if (cmd == 'a')
+    {
+      // [新增] 报圈延迟: 请求 -> 第一块采样进 I2S、整段播完；以及 MP3 方式每个片段开文件的耗时
+      audioDriver.printStats();
+    }
+    else if (cmd == 'h')
+    {
+      // [新增] 打印传感器帧等待时间直方图
+      sensorTask.printLatency();
+      imu.printStats();
+      dataPassTime.print("FUSION(pass)");
+      loopPassTime.print("LOOP(pass)");
+    }
+    else if (cmd == 'd')
+    {
+      // [新增] 赛道库查找耗时测试
+      trackDb.benchmark(1000);
+    }
+    else if (cmd == 'p')
+    {
+      // [新增] GPS 解析耗时对比: NMEA + TinyGPS++ vs UBX NAV-PVT (10Hz 下 1000 个周期 = 100 秒的数据)
+      gps.benchmark(1000);
+    }
+    else if (cmd == 'l')
+    {
+      // [新增] CSV / 二进制日志编码耗时对比
+      logger.benchmark(1000);
+    }
+    else if (cmd == 'u')
+    {
+      // [新增] LVGL 帧耗时 / DMA 刷屏耗时
+      uiTask.printStats();
+      uiBind.printStats();
+    }
+    else if (cmd == 'b')
+    {
+      // [新增] 轮换 UI 缓冲策略 (条带 / 自动 / 整屏) 并清零统计，用 'u' 对比每秒推送的字节数
+      uiTask.setBufferMode((UiBufferMode)((uiTask.getBufferMode() + 1) % 3));
+      uiTask.resetStats();
+      uiBind.resetStats();
+      Serial.printf("[UI] buffer mode -> %d\n", uiTask.getBufferMode());
+    }
+    else if (cmd == 'f')
+    {
+      // [新增] 融合推算误差 (RMS) 和每次更新耗时
+      fusion.printStats();
+    }
+    else if (cmd == 't')
+    {
+      // [新增] 各任务 CPU 占用 / 栈余量 (统计窗口从上次 't' 开始)
+      taskMon.print();
+      Serial.printf("[TASK] telemetry v%lu, reader retries=%lu\n", telemetry.version(), telemetry.getRetries());
+      taskMon.reset();
+    }
+    else if (cmd == 'x')
+    {
+      // [新增] 导出事件追踪 (TRC:<hex> 行)，用 tools/trace2chrome.py 转成 Chrome trace
+      tracer.dump([](const char *line)
+                  { Serial.println(line); });
+    }
+    else if (cmd == 'm')
+    {
+      // [新增] 运行指标 (与诊断页、CMD:STATS 相同的数据)
+      metrics.print();
+    }
+    else if (cmd == 'g')
+    {
+      // [新增] 导出 GPS 原始数据缓冲 (最近收到的 2KB)，读完即清空
+      const uint8_t *p;
+      size_t n, total = 0;
+      while (total < GPS_LOG_RING_SIZE && (n = gps_log_ring.readableSpan(&p)) > 0)
+      {
+        Serial.write(p, n);
+        total += n;
+        if (!gps_log_ring.consume(n))
+          Serial.println("\n[GPS] (overrun)");
+      }
+      Serial.printf("\n[GPS] raw log dropped=%lu B\n", gps_log_ring.getDropped());
+    }
   }
-  task_sensors();
+  uint32_t t_pass = micros();
   task_logging();
-  task_ui_engine();
-  task_ui_refresh();
+  trackDb.poll();              // [新增] 首次定位后从赛道库自动加载最近的赛道
+  sensorTask.pollDemoEvents(); // [新增] 演示播放结束通知 APP
+  imuCal.poll();               // [修改] IMU 校准: 汇报进度 (BLE)，采样完成后计算并保存配置，不占 FusionTask
+  trackMgr.pollStorage();      // [新增] 新的最佳参考圈写卡 / 切换赛道后读参考圈
+  metrics.poll();
+  taskMon.addBusy(loopMonId, micros() - t_pass);
+  loopPassTime.record(micros() - t_loop);
+  // [修改] 传感器/融合在 FusionTask，渲染在 UiTask，这里只剩日志和 BLE (10Hz)：让出 1 个 tick
+  vTaskDelay(1);
 }
\ No newline at end of file
@@ -0,0 +1,613 @@
+// ==========================================
+// 主机端入口 ([env:native]，pio run -e native 后运行 .pio/build/native/program)
+// ==========================================
+// 通过 HAL 在 PC 上直接跑纯逻辑模块，全速测耗时 (对应设备上串口 'd' / 'l' 之类的测试指令)。
+//   program bench    合成一段赛道/起步数据，测 TrackManager / DragRaceManager / 解析器 / CRC 的耗时，
+//                    局部平面坐标 vs haversine 的周期数和误差，UBX NAV-PVT 回放的吞吐 (TinyGPS++ 依赖 Arduino，对比在设备上用串口 'p')，
+//                    GPS 原始数据缓冲 (String 滚动窗口 vs ByteRing) 的周期数和堆分配次数，
+//                    以及刷屏缓冲策略 (条带 / 脏区合并 / 整屏) 在帧缓冲替身上推给屏幕的字节数和 flush 次数
+//   program replay <log.csv|log.rtl> [选项]
+//                    用 session 日志全速驱动 TrackManager / DragRaceManager (见 Session_Replay.hpp)
+//     --start lat,lon[,heading]    起点线 (不给则只跑直线加速)
+//     --finish lat,lon             冲刺赛终点线 (不给则为圈赛)
+//     --sector lat,lon[,heading]   分段线，可重复，按行驶顺序
+//     --gate m                     计时线半宽 (默认 3)
+//     --cooldown ms                两次过线的最短间隔 (默认 5000)
+//     --drag-g g / --drag-speed kmh / --drag-target kmh / --drag-stop kmh   直线加速阈值
+//     --save file                  结果存为基准文件
+//     --expect file [--tol ms]     与基准文件比较 (成绩差超过 tol 或事件数不同则返回 2)
+
+#include "Hal.hpp"
+#include "Track_Manager.hpp"
+#include "DragRace_Manager.hpp"
+#include "BNO_Parser.hpp"
+#include "UBX_Parser.hpp"
+#include "Log_Format.hpp"
+#include "Session_Replay.hpp"
+#include "Byte_Ring.hpp"
+#include "UI_Render_Plan.hpp"
+#include <new>
+
+TrackManager trackMgr;
+
+// 堆分配计数 (benchGpsLog 用)
+static uint64_t heapAllocs = 0;
+void *operator new(size_t n)
+{
+    heapAllocs++;
+    if (void *p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// 一次测量: 调用 n 次 fn，打印平均耗时
+template <typename F>
+static void timeIt(const char *name, uint32_t n, F fn)
+{
+    uint32_t t0 = hal_real_micros();
+    for (uint32_t i = 0; i < n; i++)
+        fn(i);
+    uint32_t dt = hal_real_micros() - t0;
+    Serial.printf("  %-28s n=%-8u total=%7.1fms  avg=%8.3fus\n", name, n, dt / 1000.0, (double)dt / n);
+}
+
+// 以 (lat0, lon0) 为圆心、半径 r 米的圆形赛道，10Hz、v km/h，返回第 i 帧的位置和航向
+static void circuitFix(uint32_t i, double lat0, double lon0, float r, float v, double &lat, double &lon, float &heading)
+{
+    float w = (v / 3.6f) / r;            // 角速度 rad/s
+    float a = -(float)M_PI / 2 + w * i * 0.1f; // 从圆的正南点出发，逆时针
+    float mPerDegLat = 6371000.0 * DEG_TO_RAD;
+    float mPerDegLon = mPerDegLat * cos(lat0 * DEG_TO_RAD);
+    lat = lat0 + r * sinf(a) / mPerDegLat;
+    lon = lon0 + r * cosf(a) / mPerDegLon;
+    heading = fmodf(90.0f - (a + (float)M_PI / 2) * RAD_TO_DEG + 360.0f, 360.0f); // 切线方向
+}
+
+static void benchTrack()
+{
+    const double lat0 = 31.0, lon0 = 121.0;
+    const float r = 300.0f, v = 120.0f;
+    double sLat, sLon;
+    float h;
+    circuitFix(0, lat0, lon0, r, v, sLat, sLon, h);
+
+    trackMgr.setupTrack(TRACK_TYPE_CIRCUIT, 6.0f, sLat, sLon, 0, 0);
+    trackMgr.enterStandbyMode();
+    halClock.setVirtual(0);
+
+    const uint32_t frames = 50000; // 10Hz 约 83 分钟
+    timeIt("TrackManager::update", frames, [&](uint32_t i)
+           {
+               double lat, lon;
+               float hd;
+               circuitFix(i + 5, lat0, lon0, r, v, lat, lon, hd);
+               halClock.setVirtual(i * 100);
+               trackMgr.update(lat, lon, hd, v, i * 100); });
+    char buf[16];
+    Serial.printf("    laps=%d best=%s\n", trackMgr.getLapCount(),
+                  TrackManager::formatTime(trackMgr.getBestLapTime(), buf, sizeof(buf)));
+    halClock.useRealTime();
+}
+
+static void benchDrag()
+{
+    DragRaceManager drag;
+    uint32_t runs = 0;
+    float last = 0;
+    halClock.setVirtual(0);
+    // 静止 3s -> 0.4g 起步匀加速到 110km/h -> 减速到 0，循环
+    timeIt("DragRaceManager::update", 200000, [&](uint32_t i)
+           {
+               uint32_t t = i * 10; // 100Hz
+               uint32_t cycle = t % 20000;
+               float spd, g;
+               if (cycle < 3000)
+                   spd = 0, g = 0;
+               else if (cycle < 11000)
+                   spd = min(110.0f, (cycle - 3000) * 0.0141f), g = 0.4f;
+               else
+                   spd = max(0.0f, 110.0f - (cycle - 11000) * 0.02f), g = -0.5f;
+               halClock.setVirtual(t);
+               DragState before = drag.getState();
+               drag.update(spd, g);
+               if (before != DRAG_FINISHED && drag.getState() == DRAG_FINISHED)
+                   runs++, last = drag.getResult(); });
+    Serial.printf("    runs=%u last=%.2fs\n", runs, last);
+    halClock.useRealTime();
+}
+
+// 到起点的距离: 原来每帧一次 haversine (double) 对比预计算的局部平面坐标 (LocalFrame::toLocal + sqrtf)
+static void benchGeo()
+{
+    const double lat0 = 31.17, lon0 = 121.51;
+    const uint32_t n = 1000000;
+    static double pts[1024][2];
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        pts[i][0] = lat0 + 0.018 * sin(i * 0.37); // 起点 2km 内
+        pts[i][1] = lon0 + 0.021 * cos(i * 0.53);
+    }
+    auto haversine = [](double lat1, double lon1, double lat2, double lon2)
+    {
+        double dLat = (lat2 - lat1) * DEG_TO_RAD;
+        double dLon = (lon2 - lon1) * DEG_TO_RAD;
+        double a = sin(dLat / 2) * sin(dLat / 2) +
+                   cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) * sin(dLon / 2) * sin(dLon / 2);
+        return 6371000.0 * 2 * atan2(sqrt(a), sqrt(1 - a));
+    };
+
+    volatile double sinkD = 0;
+    uint32_t c0 = hal_cycle_count();
+    for (uint32_t i = 0; i < n; i++)
+        sinkD = sinkD + haversine(lat0, lon0, pts[i & 1023][0], pts[i & 1023][1]);
+    uint32_t havCycles = hal_cycle_count() - c0;
+
+    LocalFrame f;
+    f.setup(lat0, lon0);
+    volatile float sinkF = 0;
+    c0 = hal_cycle_count();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float x, y;
+        f.toLocal(pts[i & 1023][0], pts[i & 1023][1], x, y);
+        sinkF = sinkF + sqrtf(x * x + y * y);
+    }
+    uint32_t localCycles = hal_cycle_count() - c0;
+
+    double maxErr = 0;
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        float x, y;
+        f.toLocal(pts[i][0], pts[i][1], x, y);
+        maxErr = max(maxErr, fabs(sqrtf(x * x + y * y) - haversine(lat0, lon0, pts[i][0], pts[i][1])));
+    }
+    Serial.printf("  %-28s %7.1f cycles/call\n", "distance haversine (double)", (double)havCycles / n);
+    Serial.printf("  %-28s %7.1f cycles/call  max err=%.3fm within 2km\n", "distance LocalFrame (float)",
+                  (double)localCycles / n, maxErr);
+}
+
+static void benchParsers()
+{
+    BNOParser bno(22);
+    uint8_t frame[24] = {BNO_RESP_READ, 22};
+    for (uint8_t i = 0; i < 22; i++)
+        frame[2 + i] = i * 7;
+    uint32_t ok = 0;
+    timeIt("BNOParser::feed (byte)", 24 * 200000, [&](uint32_t i)
+           { ok += (bno.feed(frame[i % 24]) == BNO_FRAME_OK); });
+    Serial.printf("    frames=%u resyncs=%u\n", ok, bno.getResyncs());
+
+    // UBX: 10Hz 下 10 分钟的 NAV-PVT (120km/h 向东)，逐字节回放
+    static uint8_t ubxStream[6000 * UBX_NAV_PVT_FRAME_LEN];
+    size_t ubxLen = 0;
+    for (uint32_t e = 0; e < 6000; e++)
+    {
+        UBXNavPvt p = {};
+        p.iTOW = 30959000 + e * 100;
+        p.lat = 31.1685575;
+        p.lon = 121.5090535 + e * 3.333 / 95300.0;
+        p.speed_kmh = 120.0f;
+        p.heading_deg = 90.0f;
+        p.fixType = 3;
+        p.numSV = 12;
+        p.valid = true;
+        ubxLen += ubxEncodeNavPvt(p, ubxStream + ubxLen);
+    }
+    UBXParser ubx;
+    UBXNavPvt pvt;
+    ok = 0;
+    uint32_t t0 = hal_real_micros();
+    timeIt("UBXParser::feed (byte)", ubxLen, [&](uint32_t i)
+           { ok += (ubx.feed(ubxStream[i]) == UBX_FRAME_OK && ubx.decodeNavPvt(pvt)); });
+    uint32_t dt = hal_real_micros() - t0;
+    Serial.printf("    epochs=%u  %.1f MB/s  %.3f us/epoch (%u B/epoch)\n", ok, ubxLen / (double)dt,
+                  (double)dt / ok, (unsigned)UBX_NAV_PVT_FRAME_LEN);
+
+    static RtlBlock b;
+    memset(&b, 0x5A, sizeof(b));
+    b.h.recordSize = sizeof(RtlImuRecord); // 满块: CRC 覆盖块头 + 整个记录区
+    b.h.count = RTL_BLOCK_PAYLOAD / sizeof(RtlImuRecord);
+    timeIt("rtlCrc32 (4KB block)", 2000, [&](uint32_t)
+           { rtlSealBlock(b); });
+}
+
+// GPS 原始数据缓冲: 原来的 String 滚动窗口 (逐字节追加，到 1024 字节截掉前一半) 对比 ByteRing (按 64 字节块写入)。
+// 原来的代码用 std::string 模拟：它按倍数扩容，分配次数比 Arduino String (每次追加都可能 realloc) 少，结果偏乐观
+static void benchGpsLog()
+{
+    static const char nmea[] =
+        "$GNRMC,083559.00,A,3110.12345,N,12130.54321,E,62.5,87.3,160626,,,A*6C\r\n"
+        "$GNGGA,083559.00,3110.12345,N,12130.54321,E,1,12,0.8,12.3,M,8.1,M,,*4F\r\n";
+    const size_t total = 256 * 1024;
+    const size_t chunk = 64; // GPS_Driver::RX_CHUNK
+    static uint8_t stream[total];
+    for (size_t i = 0; i < total; i++)
+        stream[i] = nmea[i % (sizeof(nmea) - 1)];
+
+    std::string window;
+    uint64_t a0 = heapAllocs;
+    uint32_t c0 = hal_cycle_count();
+    for (size_t i = 0; i < total; i++)
+    {
+        if (window.length() < 1024)
+            window += (char)stream[i];
+        else
+        {
+            window = window.substr(512);
+            window += (char)stream[i];
+        }
+    }
+    uint32_t strCycles = hal_cycle_count() - c0;
+    uint64_t strAllocs = heapAllocs - a0;
+
+    static ByteRing<2048> ring;
+    a0 = heapAllocs;
+    c0 = hal_cycle_count();
+    for (size_t i = 0; i < total; i += chunk)
+        ring.write(stream + i, chunk);
+    uint32_t ringCycles = hal_cycle_count() - c0;
+    uint64_t ringAllocs = heapAllocs - a0;
+
+    Serial.printf("  %-28s %7.2f cycles/B  %8.2f allocs/KB\n", "GPS log String window",
+                  (double)strCycles / total, strAllocs * 1024.0 / total);
+    Serial.printf("  %-28s %7.2f cycles/B  %8.2f allocs/KB  (window=%u B, overwritten=%u B)\n", "GPS log ByteRing",
+                  (double)ringCycles / total, ringAllocs * 1024.0 / total, (unsigned)ring.available(), ring.getDropped());
+}
+
+// 刷屏: 帧缓冲替身 (320x240 RGB565 内存) 上回放主界面的脏区序列，比较几种缓冲策略推给屏幕的字节数和 flush 次数。
+// 脏区登记和合并按 LVGL 8.3 的 lv_inv_area / refr_join_area 规则模拟，之后走与设备相同的 UI_Render_Plan.hpp。
+// 总线时间按 80MHz SPI + 每次 flush 固定开销 (与合并判定同一组常数，见 UI_Render_Plan.hpp) 估算，
+// 主机上的 memcpy 速度只作参考
+#define RENDER_INV_MAX 32 // LV_INV_BUF_SIZE
+
+struct RenderSim
+{
+    UiRect inv[RENDER_INV_MAX];
+    uint8_t joined[RENDER_INV_MAX];
+    int16_t invN = 0;
+
+    void invalidate(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+    {
+        UiRect a = {max<int16_t>(x1, 0), max<int16_t>(y1, 0),
+                    min<int16_t>(x2, UI_SCREEN_W - 1), min<int16_t>(y2, UI_SCREEN_H - 1)};
+        for (int16_t i = 0; i < invN; i++)
+            if (a.x1 >= inv[i].x1 && a.y1 >= inv[i].y1 && a.x2 <= inv[i].x2 && a.y2 <= inv[i].y2)
+                return;
+        if (invN == RENDER_INV_MAX || uiAreaSize(a) == (uint32_t)UI_SCREEN_W * UI_SCREEN_H)
+        {
+            invN = 0;
+            a = {0, 0, UI_SCREEN_W - 1, UI_SCREEN_H - 1};
+        }
+        joined[invN] = 0;
+        inv[invN++] = a;
+    }
+
+    // refr_join_area: 相交或相邻、且外接矩形比两块之和小的就合并
+    void joinAreas()
+    {
+        for (int16_t i = 0; i < invN; i++)
+        {
+            if (joined[i])
+                continue;
+            for (int16_t j = 0; j < invN; j++)
+            {
+                if (joined[j] || i == j)
+                    continue;
+                const UiRect &a = inv[i], &b = inv[j];
+                if (a.x1 > b.x2 + 1 || b.x1 > a.x2 + 1 || a.y1 > b.y2 + 1 || b.y1 > a.y2 + 1)
+                    continue;
+                UiRect u = {min(a.x1, b.x1), min(a.y1, b.y1), max(a.x2, b.x2), max(a.y2, b.y2)};
+                if (uiAreaSize(u) < uiAreaSize(a) + uiAreaSize(b))
+                {
+                    inv[i] = u;
+                    joined[j] = 1;
+                }
+            }
+        }
+    }
+};
+
+static void benchRender()
+{
+    static uint16_t fb[UI_SCREEN_W * UI_SCREEN_H]; // 屏幕 (帧缓冲替身)
+    static uint16_t band[UI_BAND_PX];
+    static uint16_t full[UI_SCREEN_W * UI_SCREEN_H];
+    const uint32_t durMs = 60000;
+    const uint32_t periodMs = 5, refreshMs = 200; // UI_Task.hpp: UI_TASK_PERIOD_MS / UI_DATA_REFRESH_MS
+
+    struct Strategy
+    {
+        const char *name;
+        UiBufferMode mode;
+        bool coalesce;
+    };
+    static const Strategy STRATEGIES[] = {
+        {"bands (before)", UI_BUF_BANDS, false},
+        {"bands+coalesce", UI_BUF_BANDS, true},
+        {"auto", UI_BUF_AUTO, true},
+        {"full", UI_BUF_FULL, true},
+    };
+
+    for (const Strategy &st : STRATEGIES)
+    {
+        RenderSim sim;
+        uint64_t bytes = 0;
+        uint32_t frames = 0, flushes = 0, fullFrames = 0, merged = 0;
+        uint32_t hostUs = 0;
+        uint16_t color = 0;
+
+        // UI 任务每 5ms 跑一次，数据刷新 200ms 一次，每 15 秒切一次页面 (整屏重绘)
+        for (uint32_t t = 0; t < durMs; t += periodMs)
+        {
+            if (t % 15000 == 0)
+                sim.invalidate(0, 0, UI_SCREEN_W - 1, UI_SCREEN_H - 1);
+            if (t % refreshMs == 0)
+            {
+                // 主界面控件的大致位置 (APP_UI.hpp)
+                uint32_t k = t / refreshMs;
+                int16_t a = (int16_t)(k * 7 % 120);
+                sim.invalidate(50, 95, 129, 134);                          // 速度数字
+                sim.invalidate(10 + a, 40, 69 + a, 99);                    // 速度弧的变化段
+                int16_t gx = 245 + (int16_t)(k * 13 % 30) - 15, gy = 55 + (int16_t)(k * 11 % 30) - 15;
+                sim.invalidate(gx - 5, gy - 5, gx + 4, gy + 4);            // G 球新位置
+                sim.invalidate(gx - 8, gy - 3, gx + 1, gy + 6);            // G 球旧位置
+                sim.invalidate(250, 143, 309, 166);                        // 计时
+                if (k % 5 == 0)
+                    sim.invalidate(280, 182, 309, 199);                    // 卫星数
+                if (k % 25 == 0)
+                    sim.invalidate(192, 206, 308, 228);                    // 状态栏
+            }
+            if (sim.invN == 0)
+                continue;
+
+            uint32_t t0 = hal_real_micros();
+            sim.joinAreas();
+            uint32_t px = 0;
+            if (st.coalesce)
+                px = uiCoalesceAreas(sim.inv, sim.joined, sim.invN, merged);
+            else
+                for (int16_t i = 0; i < sim.invN; i++)
+                    px += sim.joined[i] ? 0 : uiAreaSize(sim.inv[i]);
+            bool useFull = uiUseFullFrame(st.mode, true, px);
+            fullFrames += useFull;
+            uint16_t *buf = useFull ? full : band;
+            uint32_t bufPx = useFull ? UI_SCREEN_W * UI_SCREEN_H : UI_BAND_PX;
+
+            for (int16_t i = 0; i < sim.invN; i++)
+            {
+                if (sim.joined[i])
+                    continue;
+                const UiRect &r = sim.inv[i];
+                uint32_t w = r.x2 - r.x1 + 1;
+                uint32_t rows = max<uint32_t>(1, bufPx / w);
+                for (int32_t y = r.y1; y <= r.y2; y += rows)
+                {
+                    uint32_t h = min<uint32_t>(rows, r.y2 - y + 1);
+                    // "渲染": 填满这一条，再按行拷到帧缓冲 (flush)
+                    color += 0x0841;
+                    for (uint32_t p = 0; p < w * h; p++)
+                        buf[p] = color;
+                    for (uint32_t row = 0; row < h; row++)
+                        memcpy(fb + (y + row) * UI_SCREEN_W + r.x1, buf + row * w, w * sizeof(uint16_t));
+                    bytes += w * h * sizeof(uint16_t);
+                    flushes++;
+                }
+            }
+            hostUs += hal_real_micros() - t0;
+            sim.invN = 0;
+            frames++;
+        }
+
+        double secs = durMs / 1000.0;
+        double busMs = (bytes / (double)UI_SPI_BYTES_PER_US + flushes * (double)UI_FLUSH_OVERHEAD_US) / 1000.0;
+        Serial.printf("  render %-16s frames=%-5u flushes=%-6u full=%-4u merged=%-5u %7.1f KB/s %6.1f flush/s  bus=%5.1f ms/s  host=%6.0f MB/s\n",
+                      st.name, frames, flushes, fullFrames, merged, bytes / 1024.0 / secs, flushes / secs,
+                      busMs / secs, hostUs ? bytes / (double)hostUs : 0.0);
+    }
+}
+
+// "lat,lon[,heading]"，heading 省略时为 -1 (自动)
+static bool parseGate(const char *s, double &lat, double &lon, float &heading)
+{
+    heading = -1;
+    return sscanf(s, "%lf,%lf,%f", &lat, &lon, &heading) >= 2;
+}
+
+static bool saveReport(const char *path, ReplayReport &rep)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return false;
+    char line[256];
+    fprintf(f, "# racetrix replay\n");
+    for (uint16_t i = 0; i < rep.count; i++)
+    {
+        rep.format(i, line, sizeof(line));
+        fprintf(f, "%s\n", line);
+    }
+    fclose(f);
+    return true;
+}
+
+// 按顺序逐个比较事件；时间差 (成绩和各分段) 超过 tol 记为不同。返回不同的个数，读不到文件返回 -1
+static int compareReport(const char *path, ReplayReport &rep, uint32_t tol)
+{
+    static ReplayReport ref;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    ref.clear();
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+        ref.parseLine(line);
+    fclose(f);
+
+    auto off = [tol](uint32_t a, uint32_t b)
+    { return (a == TRACK_NO_TIME) != (b == TRACK_NO_TIME) || (a > b ? a - b : b - a) > tol; };
+
+    int diffs = 0;
+    uint16_t n = max(ref.count, rep.count);
+    for (uint16_t i = 0; i < n; i++)
+    {
+        char a[256] = "(none)", b[256] = "(none)";
+        if (i < ref.count)
+            ref.format(i, a, sizeof(a));
+        if (i < rep.count)
+            rep.format(i, b, sizeof(b));
+        bool same = i < ref.count && i < rep.count && ref.events[i].kind == rep.events[i].kind &&
+                    !off(ref.events[i].value_ms, rep.events[i].value_ms) &&
+                    ref.events[i].sectorCount == rep.events[i].sectorCount;
+        for (uint8_t s = 0; same && s < rep.events[i].sectorCount; s++)
+            same = !off(ref.events[i].sectors[s], rep.events[i].sectors[s]);
+        if (!same)
+        {
+            diffs++;
+            Serial.printf("  - %s\n  + %s\n", a, b);
+        }
+    }
+    return diffs;
+}
+
+static int runReplay(int argc, char **argv)
+{
+    if (argc < 3)
+        return 1;
+    const char *logPath = argv[2];
+    const char *savePath = NULL, *expectPath = NULL;
+    bool hasStart = false, hasFinish = false;
+    double sLat = 0, sLon = 0, eLat = 0, eLon = 0;
+    float sHeading = -1, gate = 3.0f;
+    uint32_t cooldown = 5000, tol = 0;
+    double secLat[TRACK_MAX_SECTORS - 1], secLon[TRACK_MAX_SECTORS - 1];
+    float secHeading[TRACK_MAX_SECTORS - 1];
+    int sectors = 0;
+    DragTuning tuning;
+
+    for (int i = 3; i < argc; i++)
+    {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!val)
+        {
+            Serial.printf("missing value for %s\n", opt);
+            return 1;
+        }
+        i++;
+        float h;
+        if (strcmp(opt, "--start") == 0)
+            hasStart = parseGate(val, sLat, sLon, sHeading);
+        else if (strcmp(opt, "--finish") == 0)
+            hasFinish = parseGate(val, eLat, eLon, h);
+        else if (strcmp(opt, "--sector") == 0 && sectors < TRACK_MAX_SECTORS - 1)
+            sectors += parseGate(val, secLat[sectors], secLon[sectors], secHeading[sectors]);
+        else if (strcmp(opt, "--gate") == 0)
+            gate = atof(val);
+        else if (strcmp(opt, "--cooldown") == 0)
+            cooldown = strtoul(val, NULL, 10);
+        else if (strcmp(opt, "--drag-g") == 0)
+            tuning.triggerG = atof(val);
+        else if (strcmp(opt, "--drag-speed") == 0)
+            tuning.triggerKmh = atof(val);
+        else if (strcmp(opt, "--drag-target") == 0)
+            tuning.targetKmh = atof(val);
+        else if (strcmp(opt, "--drag-stop") == 0)
+            tuning.stopKmh = atof(val);
+        else if (strcmp(opt, "--save") == 0)
+            savePath = val;
+        else if (strcmp(opt, "--expect") == 0)
+            expectPath = val;
+        else if (strcmp(opt, "--tol") == 0)
+            tol = strtoul(val, NULL, 10);
+        else
+        {
+            Serial.printf("unknown option %s\n", opt);
+            return 1;
+        }
+    }
+
+    static SessionReader reader;
+    if (!reader.open(HalFile(fopen(logPath, "rb"))))
+    {
+        Serial.printf("cannot open %s\n", logPath);
+        return 1;
+    }
+
+    if (hasStart)
+    {
+        trackMgr.setupTrack(hasFinish ? TRACK_TYPE_SPRINT : TRACK_TYPE_CIRCUIT, gate, sLat, sLon, eLat, eLon, sHeading);
+        for (int s = 0; s < sectors; s++)
+            trackMgr.addSector(secLat[s], secLon[s], secHeading[s]);
+        trackMgr.setLapCooldown(cooldown);
+        trackMgr.enterStandbyMode();
+        trackMgr.pollStorage(); // 读入这条赛道已有的参考圈 (第一帧 update() 时换上)
+    }
+    DragRaceManager drag;
+    drag.setTuning(tuning);
+
+    static ReplayReport report;
+    SessionReplay replay;
+    replay.run(reader, trackMgr, drag, report);
+
+    Serial.printf("[REPLAY] %s: %s%s, %u frames, %.1fs of log in %.1fms (x%.0f)",
+                  logPath, reader.isBinary() ? "rtl" : "csv", reader.hasImuStream() ? "+imu" : "",
+                  replay.frames, replay.durationMs / 1000.0, replay.wallUs / 1000.0,
+                  replay.wallUs ? replay.durationMs * 1000.0 / replay.wallUs : 0.0);
+    if (reader.getBadBlocks())
+        Serial.printf(", %u bad blocks skipped", reader.getBadBlocks());
+    Serial.println();
+
+    char line[256];
+    for (uint16_t i = 0; i < report.count; i++)
+    {
+        report.format(i, line, sizeof(line));
+        Serial.printf("  %s\n", line);
+    }
+    if (report.laps)
+    {
+        char best[16], theo[16];
+        Serial.printf("  laps=%u best=%s theoretical=%s\n", report.laps,
+                      TrackManager::formatTime(trackMgr.getBestLapTime(), best, sizeof(best)),
+                      TrackManager::formatTime(trackMgr.getTheoreticalBest(), theo, sizeof(theo)));
+    }
+    reader.close();
+
+    if (savePath && !saveReport(savePath, report))
+    {
+        Serial.printf("cannot write %s\n", savePath);
+        return 1;
+    }
+    if (expectPath)
+    {
+        int diffs = compareReport(expectPath, report, tol);
+        if (diffs < 0)
+        {
+            Serial.printf("cannot read %s\n", expectPath);
+            return 1;
+        }
+        Serial.printf("[REPLAY] %s: %d difference(s) (tol %ums)\n", diffs ? "FAIL" : "PASS", diffs, tol);
+        return diffs ? 2 : 0;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *cmd = (argc > 1) ? argv[1] : "bench";
+    if (strcmp(cmd, "bench") == 0)
+    {
+        Serial.println("[HOST] bench");
+        benchTrack();
+        benchDrag();
+        benchGeo();
+        benchParsers();
+        benchGpsLog();
+        benchRender();
+        return 0;
+    }
+    if (strcmp(cmd, "replay") == 0 && argc >= 3)
+        return runReplay(argc, argv);
+    Serial.printf("usage: %s bench\n       %s replay <log.csv|log.rtl> [--start lat,lon[,heading]] [...]\n", argv[0], argv[0]);
+    return 1;
+}
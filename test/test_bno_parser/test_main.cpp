@@ -0,0 +1,206 @@
+// BNO055 应答解析器: 任意位置拆包、帧间噪声、假同步头、状态应答、随机字节流 (BNO_Parser.hpp)
+#include <unity.h>
+#include <vector>
+#include "BNO_Parser.hpp"
+
+#define LEN 22 // IMU_Driver 每次读 0x1A 起 22 字节
+
+static BNOParser *bno;
+
+void setUp(void) { bno = new BNOParser(LEN); }
+void tearDown(void) { delete bno; }
+
+// 简单的确定性随机数 (xorshift32)，失败时可以复现
+static uint32_t rng = 1;
+static uint32_t rnd()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// 第 k 帧: 数据里带上帧号，并且故意含有 0xBB / 0xEE / 长度字节，检查不会被当成帧头
+static void appendFrame(std::vector<uint8_t> &s, uint8_t k)
+{
+    s.push_back(BNO_RESP_READ);
+    s.push_back(LEN);
+    for (uint8_t i = 0; i < LEN; i++)
+        s.push_back(i == 0 ? k : (i == 1 ? BNO_RESP_READ : (i == 2 ? BNO_RESP_STATUS : (i == 3 ? LEN : (uint8_t)(k * 31 + i)))));
+}
+
+static bool frameIs(const uint8_t *p, uint8_t k)
+{
+    for (uint8_t i = 4; i < LEN; i++)
+        if (p[i] != (uint8_t)(k * 31 + i))
+            return false;
+    return p[0] == k && p[1] == BNO_RESP_READ && p[2] == BNO_RESP_STATUS && p[3] == LEN;
+}
+
+#define GARBAGE 0xFF // 收到的帧不是 appendFrame() 生成的 (半帧被后面的字节补齐；协议没有校验和，只能靠 IMU_Driver 的量程检查)
+
+// 按 chunk 字节一段喂入 (模拟每次唤醒时串口里已有的字节)，返回按顺序收到的帧号
+static std::vector<uint8_t> feedChunks(BNOParser &p, const std::vector<uint8_t> &s, size_t chunk, uint32_t *status = NULL)
+{
+    std::vector<uint8_t> got;
+    for (size_t pos = 0; pos < s.size(); pos += chunk)
+        for (size_t i = pos; i < s.size() && i < pos + chunk; i++)
+        {
+            BNOFeedResult r = p.feed(s[i]);
+            if (r == BNO_FRAME_OK)
+                got.push_back(frameIs(p.payload(), p.payload()[0]) ? p.payload()[0] : GARBAGE);
+            else if (r == BNO_STATUS && status)
+                (*status)++;
+        }
+    return got;
+}
+
+// 连续的好帧拆成任意大小的块，结果都一样
+void test_split_at_every_chunk_size(void)
+{
+    std::vector<uint8_t> s;
+    for (uint8_t k = 0; k < 8; k++)
+        appendFrame(s, k);
+    for (size_t chunk = 1; chunk <= s.size(); chunk++)
+    {
+        BNOParser p(LEN);
+        std::vector<uint8_t> got = feedChunks(p, s, chunk);
+        TEST_ASSERT_EQUAL(8, got.size());
+        for (uint8_t k = 0; k < 8; k++)
+            TEST_ASSERT_EQUAL_UINT8(k, got[k]);
+        TEST_ASSERT_EQUAL_UINT32(0, p.getResyncs());
+    }
+}
+
+// 帧之间夹着噪声 (开机残留、波特率切换的乱码)：每一帧都能找回来，每段噪声只计一次重同步
+void test_noise_between_frames(void)
+{
+    std::vector<uint8_t> s;
+    rng = 12345;
+    for (uint8_t k = 0; k < 50; k++)
+    {
+        size_t noise = 1 + rnd() % 10;
+        for (size_t i = 0; i < noise; i++)
+        {
+            uint8_t c = rnd();
+            if (c == BNO_RESP_READ || c == BNO_RESP_STATUS)
+                c = 0x55; // 噪声里的同步头另有测试
+            s.push_back(c);
+        }
+        appendFrame(s, k);
+    }
+    std::vector<uint8_t> got = feedChunks(*bno, s, 7);
+    TEST_ASSERT_EQUAL(50, got.size());
+    for (uint8_t k = 0; k < 50; k++)
+        TEST_ASSERT_EQUAL_UINT8(k, got[k]);
+    TEST_ASSERT_EQUAL_UINT32(50, bno->getResyncs());
+}
+
+// 假同步头: 0xBB 后面的长度不对 (比如噪声里的 0xBB、或紧跟着真正的帧头)，这个字节重新当帧头检查
+void test_false_sync_rechecks_byte(void)
+{
+    std::vector<uint8_t> s = {BNO_RESP_READ, 5, BNO_RESP_READ}; // 0xBB 0x05: 长度不对；然后 0xBB 0xBB 0x16...
+    appendFrame(s, 9);
+    std::vector<uint8_t> got = feedChunks(*bno, s, 1);
+    TEST_ASSERT_EQUAL(1, got.size());
+    TEST_ASSERT_EQUAL_UINT8(9, got[0]);
+}
+
+// 0xEE 状态应答 (读请求出错，比如总线忙) 单独报告，不影响后面的帧
+void test_status_response(void)
+{
+    std::vector<uint8_t> s = {BNO_RESP_STATUS, 0x07};
+    appendFrame(s, 3);
+    s.push_back(BNO_RESP_STATUS);
+    s.push_back(BNO_STATUS_WRITE_OK);
+    appendFrame(s, 4);
+    uint32_t status = 0;
+    std::vector<uint8_t> got = feedChunks(*bno, s, 5, &status);
+    TEST_ASSERT_EQUAL(2, status);
+    TEST_ASSERT_EQUAL(2, got.size());
+    TEST_ASSERT_EQUAL_UINT32(0, bno->getResyncs());
+}
+
+// 请求超时: IMU_Driver 调 reset() 丢掉半帧，下一帧照常解析
+void test_reset_drops_half_frame(void)
+{
+    std::vector<uint8_t> s;
+    appendFrame(s, 1);
+    s.resize(10); // 只到了前 10 字节
+    appendFrame(s, 2);
+    size_t i = 0;
+    for (; i < 10; i++)
+        bno->feed(s[i]);
+    TEST_ASSERT_TRUE(bno->inFrame());
+    bno->reset();
+    std::vector<uint8_t> rest(s.begin() + 10, s.end());
+    std::vector<uint8_t> got = feedChunks(*bno, rest, 24);
+    TEST_ASSERT_EQUAL(1, got.size());
+    TEST_ASSERT_EQUAL_UINT8(2, got[0]);
+}
+
+// 随机字节流: 不崩溃、不越界 (用 -fsanitize=address 跑过)；
+// 接着喂一帧干净数据 (前面加 LEN+1 个非帧头字节把残留的半帧冲掉) 必须能解析出来
+void test_fuzz_random_streams(void)
+{
+    static const uint8_t special[4] = {BNO_RESP_READ, BNO_RESP_STATUS, LEN, 0};
+    rng = 0xBADC0DE;
+    for (int run = 0; run < 2000; run++)
+    {
+        BNOParser p(LEN);
+        size_t n = rnd() % 300;
+        for (size_t i = 0; i < n; i++)
+        {
+            uint32_t r = rnd();
+            // 一半的字节取自协议里的特殊值，提高撞到各个状态的概率
+            uint8_t c = (r & 0x100) ? (uint8_t)r : special[r & 3];
+            p.feed(c);
+        }
+        std::vector<uint8_t> s(LEN + 1, 0x00);
+        appendFrame(s, 77);
+        std::vector<uint8_t> got = feedChunks(p, s, 1 + rnd() % 24);
+        TEST_ASSERT_TRUE(got.size() >= 1 && got.size() <= 2); // 可能先补齐一个残留的半帧
+        TEST_ASSERT_EQUAL_UINT8(77, got.back());
+        if (got.size() == 2)
+            TEST_ASSERT_EQUAL_UINT8(GARBAGE, got[0]);
+    }
+}
+
+// 好帧里随机位置的字节被破坏或丢失：解析器之后一定能重新同步，后面的好帧全部收到
+void test_corrupted_frames_then_recovery(void)
+{
+    rng = 777;
+    for (int run = 0; run < 500; run++)
+    {
+        std::vector<uint8_t> s;
+        appendFrame(s, 0);
+        size_t at = rnd() % s.size();
+        if (rnd() & 1)
+            s.erase(s.begin() + at); // 丢一个字节
+        else
+            s[at] = rnd();           // 改一个字节
+        s.insert(s.end(), LEN + 1, 0x00);
+        for (uint8_t k = 1; k <= 5; k++)
+            appendFrame(s, k);
+
+        BNOParser p(LEN);
+        std::vector<uint8_t> got = feedChunks(p, s, 1 + rnd() % 30);
+        // 坏掉的第 0 帧可能收到、可能变成垃圾帧、也可能收不到，后面 5 帧必须全部收到
+        TEST_ASSERT_TRUE(got.size() >= 5 && got.size() <= 6);
+        for (uint8_t k = 1; k <= 5; k++)
+            TEST_ASSERT_EQUAL_UINT8(k, got[got.size() - 6 + k]);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_split_at_every_chunk_size);
+    RUN_TEST(test_noise_between_frames);
+    RUN_TEST(test_false_sync_rechecks_byte);
+    RUN_TEST(test_status_response);
+    RUN_TEST(test_reset_drops_half_frame);
+    RUN_TEST(test_fuzz_random_streams);
+    RUN_TEST(test_corrupted_frames_then_recovery);
+    return UNITY_END();
+}
@@ -0,0 +1,99 @@
+// GPS 原始数据环形缓冲 (Byte_Ring.hpp): 满了覆盖最旧的数据
+#include <unity.h>
+#include "Byte_Ring.hpp"
+
+static ByteRing<16> *rp;
+#define ring (*rp)
+
+void setUp(void) { rp = new ByteRing<16>(); }
+void tearDown(void) { delete rp; }
+
+static size_t readAll(uint8_t *out)
+{
+    size_t total = 0;
+    const uint8_t *p;
+    size_t n;
+    while ((n = ring.readableSpan(&p)) > 0)
+    {
+        memcpy(out + total, p, n);
+        total += n;
+        TEST_ASSERT_TRUE(ring.consume(n));
+    }
+    return total;
+}
+
+void test_write_and_read_back(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(5, ring.write((const uint8_t *)"hello", 5));
+    uint8_t out[16];
+    TEST_ASSERT_EQUAL_UINT32(5, readAll(out));
+    TEST_ASSERT_EQUAL_MEMORY("hello", out, 5);
+    TEST_ASSERT_EQUAL_UINT32(0, ring.available());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDropped());
+}
+
+void test_full_ring_keeps_latest_bytes(void)
+{
+    for (uint8_t i = 0; i < 40; i++)
+        ring.push(i);
+    TEST_ASSERT_EQUAL_UINT32(16, ring.available());
+    TEST_ASSERT_EQUAL_UINT32(24, ring.getDropped());
+    uint8_t out[16];
+    TEST_ASSERT_EQUAL_UINT32(16, readAll(out));
+    for (uint8_t i = 0; i < 16; i++)
+        TEST_ASSERT_EQUAL_UINT8(24 + i, out[i]);
+}
+
+void test_write_longer_than_capacity(void)
+{
+    uint8_t in[50];
+    for (uint8_t i = 0; i < sizeof(in); i++)
+        in[i] = i;
+    ring.push(0xAA);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(in), ring.write(in, sizeof(in)));
+    TEST_ASSERT_EQUAL_UINT32(35, ring.getDropped()); // 34 字节直接跳过 + 覆盖 1 字节旧数据
+    uint8_t out[16];
+    TEST_ASSERT_EQUAL_UINT32(16, readAll(out));
+    TEST_ASSERT_EQUAL_MEMORY(in + 34, out, 16);
+}
+
+void test_span_splits_at_wrap(void)
+{
+    uint8_t in[12] = {0};
+    ring.write(in, 12);
+    const uint8_t *p;
+    TEST_ASSERT_EQUAL_UINT32(12, ring.readableSpan(&p));
+    TEST_ASSERT_TRUE(ring.consume(12));
+    ring.write((const uint8_t *)"abcdefgh", 8); // 4 字节到数组末尾，4 字节绕回开头
+    TEST_ASSERT_EQUAL_UINT32(4, ring.readableSpan(&p));
+    TEST_ASSERT_EQUAL_MEMORY("abcd", p, 4);
+    TEST_ASSERT_TRUE(ring.consume(4));
+    TEST_ASSERT_EQUAL_UINT32(4, ring.readableSpan(&p));
+    TEST_ASSERT_EQUAL_MEMORY("efgh", p, 4);
+}
+
+void test_consume_reports_overrun(void)
+{
+    ring.write((const uint8_t *)"0123456789", 10);
+    const uint8_t *p;
+    size_t n = ring.readableSpan(&p);
+    TEST_ASSERT_EQUAL_UINT32(10, n);
+    // 读的过程中生产者写满并覆盖了这段的开头
+    ring.write((const uint8_t *)"ABCDEFGHIJ", 10);
+    TEST_ASSERT_FALSE(ring.consume(n));
+    // 重新取到的是覆盖后的最新 16 字节
+    uint8_t out[16];
+    TEST_ASSERT_EQUAL_UINT32(16, readAll(out));
+    TEST_ASSERT_EQUAL_MEMORY("456789ABCDEFGHIJ", out, 16);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_write_and_read_back);
+    RUN_TEST(test_full_ring_keeps_latest_bytes);
+    RUN_TEST(test_write_longer_than_capacity);
+    RUN_TEST(test_span_splits_at_wrap);
+    RUN_TEST(test_consume_reports_overrun);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+// APP 文本指令的拆分和 TRACK: 指令 (Cmd_Protocol.hpp)
+#include <unity.h>
+#include "Cmd_Protocol.hpp"
+
+static TrackManager trk;
+static char sdRoot[64];
+
+void setUp(void)
+{
+    halBle.quiet = true;
+    halBle.last[0] = 0;
+}
+
+void tearDown(void) {}
+
+void test_split_set_with_whitespace(void)
+{
+    CmdMessage m;
+    TEST_ASSERT_TRUE(cmdParseLine("  SET:VOL=50\r\n", m));
+    TEST_ASSERT_EQUAL(CMD_GROUP_SET, m.group);
+    TEST_ASSERT_EQUAL_STRING("VOL", m.name);
+    TEST_ASSERT_TRUE(m.hasArg);
+    TEST_ASSERT_EQUAL_INT(50, m.argInt());
+}
+
+void test_split_without_arg(void)
+{
+    CmdMessage m;
+    TEST_ASSERT_TRUE(cmdParseLine("RM:START", m));
+    TEST_ASSERT_EQUAL(CMD_GROUP_RM, m.group);
+    TEST_ASSERT_TRUE(m.is("START"));
+    TEST_ASSERT_FALSE(m.hasArg);
+    TEST_ASSERT_EQUAL_STRING("", m.arg);
+}
+
+void test_arg_keeps_everything_after_first_equals(void)
+{
+    CmdMessage m;
+    TEST_ASSERT_TRUE(cmdParseLine("CMD:DEMO=/session/a=b.rtl", m));
+    TEST_ASSERT_EQUAL(CMD_GROUP_CMD, m.group);
+    TEST_ASSERT_TRUE(m.is("DEMO"));
+    TEST_ASSERT_EQUAL_STRING("/session/a=b.rtl", m.arg);
+}
+
+void test_rejects_empty_and_unknown(void)
+{
+    CmdMessage m;
+    TEST_ASSERT_FALSE(cmdParseLine("   \n", m));
+    TEST_ASSERT_FALSE(cmdParseLine("FOO:BAR=1", m));
+    TEST_ASSERT_FALSE(cmdParseLine("SET", m));
+    TEST_ASSERT_EQUAL(CMD_GROUP_NONE, m.group);
+}
+
+void test_overlong_fields_are_truncated(void)
+{
+    char line[400];
+    strcpy(line, "TRACK:");
+    memset(line + 6, 'N', 40);
+    line[46] = '=';
+    memset(line + 47, '1', 300);
+    line[347] = 0;
+    CmdMessage m;
+    TEST_ASSERT_TRUE(cmdParseLine(line, m));
+    TEST_ASSERT_EQUAL_UINT32(CMD_MAX_NAME - 1, strlen(m.name));
+    TEST_ASSERT_EQUAL_UINT32(CMD_MAX_ARG - 1, strlen(m.arg));
+}
+
+void test_numbers_keep_double_precision(void)
+{
+    double p[4] = {9, 9, 9, 9};
+    TEST_ASSERT_EQUAL_INT(4, cmdParseNumbers("0,6.5,,121.12345678", p, 4));
+    TEST_ASSERT_TRUE(p[0] == 0.0 && p[1] == 6.5 && p[2] == 0.0);
+    TEST_ASSERT_TRUE(fabs(p[3] - 121.12345678) < 1e-9);
+
+    double q[2];
+    TEST_ASSERT_EQUAL_INT(2, cmdParseNumbers("1,2,3,4", q, 2));
+}
+
+void test_track_setup_and_sectors(void)
+{
+    CmdMessage m;
+    cmdParseLine("TRACK:SETUP=0,6,31.0,121.0", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("OK:TRACK_UPDATED", halBle.last);
+    TEST_ASSERT_FALSE(trk.isTrackSetup()); // 只是提交请求，FusionTask 套用之后才生效
+    trk.applyRequests();
+    TEST_ASSERT_TRUE(trk.isTrackSetup());
+    TEST_ASSERT_EQUAL(TRACK_TYPE_CIRCUIT, trk.getCurrentTrackType());
+
+    cmdParseLine("TRACK:SECTOR=31.001,121.001,90", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("OK:SECTORS=2", halBle.last);
+    trk.applyRequests();
+    TEST_ASSERT_EQUAL_INT(2, trk.getSectorCount());
+
+    cmdParseLine("TRACK:SECTORS_CLEAR", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("OK:SECTORS=1", halBle.last);
+    trk.applyRequests();
+    TEST_ASSERT_EQUAL_INT(1, trk.getSectorCount());
+}
+
+// 模式页 (UiTask) 的预备 / 退出请求也在 FusionTask 里套用；SETUP 会清掉预备状态
+void test_arm_request_applied_by_fusion(void)
+{
+    trk.requestSetup(TRACK_TYPE_CIRCUIT, 6, 31.0, 121.0, 0, 0);
+    trk.requestArm(true);
+    TEST_ASSERT_FALSE(trk.isArmed());
+    trk.applyRequests();
+    TEST_ASSERT_TRUE(trk.isArmed());
+
+    trk.requestArm(false);
+    trk.applyRequests();
+    TEST_ASSERT_FALSE(trk.isArmed());
+
+    // 分段线已满时不改配置，也不会让 FusionTask 重新套用 (重新套用会清空成绩)
+    for (int i = 0; i < TRACK_MAX_SECTORS - 1; i++)
+        TEST_ASSERT_EQUAL_INT(i + 2, trk.requestAddSector(31.0 + i * 1e-3, 121.0));
+    trk.applyRequests();
+    trk.requestArm(true);
+    trk.applyRequests();
+    TEST_ASSERT_EQUAL_INT(-1, trk.requestAddSector(31.1, 121.0));
+    trk.applyRequests();
+    TEST_ASSERT_TRUE(trk.isArmed());
+    TEST_ASSERT_EQUAL_INT(TRACK_MAX_SECTORS, trk.getSectorCount());
+}
+
+void test_track_errors(void)
+{
+    CmdMessage m;
+    cmdParseLine("TRACK:SETUP=0,6,31.0", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("ERR:TRACK_ARGS", halBle.last);
+
+    cmdParseLine("TRACK:SECTOR=31.0", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("ERR:SECTOR_ARGS", halBle.last);
+
+    cmdParseLine("TRACK:WHAT", m);
+    cmdHandleTrack(m, trk);
+    TEST_ASSERT_EQUAL_STRING("ERR:UNKNOWN_TRACK_CMD", halBle.last);
+}
+
+int main(int, char **)
+{
+    strcpy(sdRoot, "/tmp/rtx_cmd_XXXXXX");
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_split_set_with_whitespace);
+    RUN_TEST(test_split_without_arg);
+    RUN_TEST(test_arg_keeps_everything_after_first_equals);
+    RUN_TEST(test_rejects_empty_and_unknown);
+    RUN_TEST(test_overlong_fields_are_truncated);
+    RUN_TEST(test_numbers_keep_double_precision);
+    RUN_TEST(test_track_setup_and_sectors);
+    RUN_TEST(test_arm_request_applied_by_fusion);
+    RUN_TEST(test_track_errors);
+    return UNITY_END();
+}
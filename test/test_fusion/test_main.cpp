@@ -0,0 +1,231 @@
+// GPS / IMU 融合 (Fusion_Estimator.hpp): 合成行驶数据回放，比较融合输出与真实轨迹的误差 (RMS)
+// GPS 10Hz、定位到达比定位时刻晚 60ms；IMU 100Hz，航向有 7 度安装偏差，纵向 G 有 0.03g 零偏
+#include <unity.h>
+#include "Fusion_Estimator.hpp"
+
+static const double LAT0 = 31.0, LON0 = 121.0;
+static const double M_PER_DEG_LAT = 6371000.0 * DEG_TO_RAD;
+
+#define GPS_LATENCY_MS 60
+#define IMU_HEADING_OFFSET 7.0f
+#define IMU_BIAS_G 0.03f
+#define WARMUP_MS 20000 // 前 20 秒让航向偏差和零偏收敛，不计入误差
+
+// 真实轨迹 (局部平面坐标，东 x / 北 y)，每 1ms 积分一步
+struct Truth
+{
+    double x, y, v, heading, a;
+};
+
+// 30 秒一个循环: 加速 -> 左弯 -> 刹车 -> 右弯，速度在 8~26 m/s 之间
+static void profile(uint32_t ms, double &a, double &turnDegS)
+{
+    uint32_t c = ms % 32000;
+    a = turnDegS = 0;
+    if (c < 6000)
+        a = 3.0;
+    else if (c < 16000)
+        turnDegS = -15.0;
+    else if (c < 22000)
+        a = -3.0;
+    else
+        turnDegS = 12.0;
+}
+
+static void step(Truth &s, uint32_t ms)
+{
+    double turn;
+    profile(ms, s.a, turn);
+    s.v += s.a * 0.001;
+    s.heading = fmod(s.heading + turn * 0.001 + 360.0, 360.0);
+    s.x += s.v * 0.001 * sin(s.heading * DEG_TO_RAD);
+    s.y += s.v * 0.001 * cos(s.heading * DEG_TO_RAD);
+}
+
+static void toGeo(double x, double y, double &lat, double &lon)
+{
+    lat = LAT0 + y / M_PER_DEG_LAT;
+    lon = LON0 + x / (M_PER_DEG_LAT * cos(LAT0 * DEG_TO_RAD));
+}
+
+static double distTo(const Truth &s, double lat, double lon)
+{
+    double dx = (lon - LON0) * M_PER_DEG_LAT * cos(LAT0 * DEG_TO_RAD) - s.x;
+    double dy = (lat - LAT0) * M_PER_DEG_LAT - s.y;
+    return sqrt(dx * dx + dy * dy);
+}
+
+// 固定种子的 GPS 噪声 (+-0.3m)
+static uint32_t rng = 1;
+static double noise()
+{
+    rng = rng * 1103515245 + 12345;
+    return ((rng >> 16) & 0x7FFF) / 32767.0 * 0.6 - 0.3;
+}
+
+static SensorFrame gpsFrame(const Truth &s, uint32_t epoch, uint32_t arrival)
+{
+    SensorFrame f;
+    memset(&f, 0, sizeof(f));
+    f.type = FRAME_GPS;
+    f.arrival_ms = arrival;
+    f.arrival_us = arrival * 1000;
+    f.epoch_ms = epoch;
+    f.fix = true;
+    f.sats = 12;
+    toGeo(s.x + noise(), s.y + noise(), f.lat, f.lon);
+    f.course = (float)s.heading;
+    f.speed_kmh = (float)(s.v * 3.6);
+    return f;
+}
+
+static SensorFrame imuFrame(const Truth &s, uint32_t ms)
+{
+    SensorFrame f;
+    memset(&f, 0, sizeof(f));
+    f.type = FRAME_IMU;
+    f.arrival_ms = ms;
+    f.arrival_us = ms * 1000;
+    f.heading = fmodf((float)s.heading + IMU_HEADING_OFFSET, 360.0f);
+    f.lon_g_raw = (float)(s.a / FUSION_GRAVITY) + IMU_BIAS_G;
+    f.lon_g = f.lon_g_raw;
+    return f;
+}
+
+struct ReplayResult
+{
+    double fusedRms; // 融合输出 vs 真实位置
+    double heldRms;  // 只用 GPS (保持最近一次定位) vs 真实位置
+    uint32_t samples;
+    uint32_t fusedSamples;
+};
+
+// 回放 durMs 毫秒；imuStopMs 之后不再发 IMU 帧
+static ReplayResult replay(FusionEstimator &fe, uint32_t durMs, uint32_t imuStopMs = 0xFFFFFFFF)
+{
+    const uint32_t T0 = 10000; // millis 时间轴起点 (融合用 0 表示"还没有 IMU")
+    Truth s = {0, 0, 8.0, 30.0, 0};
+    // 定位在 epoch 时刻的真实位置要晚 60ms 才送达，先存起来
+    Truth pending[2];
+    uint32_t pendingEpoch[2] = {0, 0};
+    int pendingN = 0;
+    double heldLat = 0, heldLon = 0;
+    bool held = false;
+    double sumF = 0, sumH = 0;
+    ReplayResult r = {0, 0, 0, 0};
+
+    for (uint32_t ms = 0; ms < durMs; ms++)
+    {
+        step(s, ms);
+        uint32_t now = T0 + ms;
+
+        if (ms % 100 == 0 && pendingN < 2)
+        {
+            pending[pendingN] = s;
+            pendingEpoch[pendingN++] = now;
+        }
+        if (pendingN && now - pendingEpoch[0] == GPS_LATENCY_MS)
+        {
+            SensorFrame g = gpsFrame(pending[0], pendingEpoch[0], now);
+            fe.correctGps(g);
+            heldLat = g.lat;
+            heldLon = g.lon;
+            held = true;
+            pending[0] = pending[1];
+            pendingEpoch[0] = pendingEpoch[1];
+            pendingN--;
+        }
+        if (ms % 10 == 0 && ms < imuStopMs)
+            fe.predictImu(imuFrame(s, now));
+
+        if (ms % 10 == 0 && ms >= WARMUP_MS && held && fe.getState().valid)
+        {
+            const FusedState &o = fe.getState();
+            // 输出对应 o.t_ms 时刻；融合输出都在当前时刻，原始 GPS 输出则是定位时刻
+            double ef = distTo(s, o.lat, o.lon);
+            double eh = distTo(s, heldLat, heldLon);
+            sumF += ef * ef;
+            sumH += eh * eh;
+            r.samples++;
+            if (o.fused)
+                r.fusedSamples++;
+        }
+    }
+    if (r.samples)
+    {
+        r.fusedRms = sqrt(sumF / r.samples);
+        r.heldRms = sqrt(sumH / r.samples);
+    }
+    return r;
+}
+
+void setUp(void) { rng = 1; }
+
+void tearDown(void) {}
+
+// 融合输出的位置误差明显小于只用 GPS (定位延迟 + 两次定位之间保持不动)
+void test_replay_rms_beats_raw_gps(void)
+{
+    FusionEstimator fe;
+    ReplayResult r = replay(fe, 180000);
+    char msg[128];
+    snprintf(msg, sizeof(msg), "fused %.3fm, gps-only %.3fm, predict %.3fm / %.3fm/s",
+             r.fusedRms, r.heldRms, fe.getPosRms(), fe.getSpdRms());
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_TRUE(r.samples > 10000);
+    TEST_ASSERT_EQUAL_UINT32(r.samples, r.fusedSamples);
+    TEST_ASSERT_TRUE_MESSAGE(r.fusedRms < r.heldRms * 0.5, msg);
+    TEST_ASSERT_TRUE_MESSAGE(r.fusedRms < 1.0, msg);
+}
+
+// 每次定位时的推算误差 (printStats 里的 posRMS / spdRMS)
+void test_prediction_rms(void)
+{
+    FusionEstimator fe;
+    replay(fe, 180000);
+    TEST_ASSERT_TRUE(fe.getCorrections() > 1700);
+    TEST_ASSERT_TRUE(fe.getPosRms() < 1.0);
+    TEST_ASSERT_TRUE(fe.getSpdRms() < 0.5);
+}
+
+// 航向偏差和纵向 G 零偏收敛到注入值
+void test_offset_and_bias_converge(void)
+{
+    FusionEstimator fe;
+    replay(fe, 180000);
+    TEST_ASSERT_FLOAT_WITHIN(1.5f, IMU_HEADING_OFFSET, fe.getHeadingOffset());
+    TEST_ASSERT_FLOAT_WITHIN(0.015f, IMU_BIAS_G, fe.getBiasG());
+}
+
+// 关闭融合: 输出就是原始 GPS
+void test_disabled_falls_back_to_gps(void)
+{
+    FusionEstimator fe;
+    fe.setEnabled(false);
+    ReplayResult r = replay(fe, 30000);
+    TEST_ASSERT_TRUE(r.samples > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, r.fusedSamples);
+    TEST_ASSERT_EQUAL_UINT32(0, fe.getCorrections());
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, r.heldRms, r.fusedRms);
+}
+
+// IMU 停止后，下一次定位起退回原始 GPS
+void test_imu_timeout_falls_back_to_gps(void)
+{
+    FusionEstimator fe;
+    replay(fe, 25000, 22000);
+    TEST_ASSERT_TRUE(fe.getState().valid);
+    TEST_ASSERT_FALSE(fe.isFused());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_rms_beats_raw_gps);
+    RUN_TEST(test_prediction_rms);
+    RUN_TEST(test_offset_and_bias_converge);
+    RUN_TEST(test_disabled_falls_back_to_gps);
+    RUN_TEST(test_imu_timeout_falls_back_to_gps);
+    return UNITY_END();
+}
@@ -0,0 +1,135 @@
+// 最佳圈参考轨迹 (Lap_Reference.hpp): 点间距 / 实时差值 / 延迟写卡
+#include <unity.h>
+#include "Lap_Reference.hpp"
+
+static LapReference *ref;
+static char sdRoot[64];
+static const uint32_t TRACK = 0x00C0FFEE;
+
+void setUp(void)
+{
+    ref = new LapReference();
+    ref->selectTrack(TRACK);
+}
+
+void tearDown(void)
+{
+    halFs.remove(LAP_REF_DIR "/00C0FFEE.bin");
+    delete ref;
+}
+
+// 匀速跑一圈: 100Hz 更新 (融合后的速率)，返回圈速
+static uint32_t driveLap(LapReference &r, float lengthM, float kmh)
+{
+    float step = kmh / 3.6f * 0.01f;
+    uint32_t ms = 0;
+    float d = 0;
+    r.beginLap();
+    while (d + step < lengthM)
+    {
+        ms += 10;
+        d += step;
+        r.addFix(step, ms);
+    }
+    uint32_t lapMs = ms + (uint32_t)((lengthM - d) / step * 10);
+    r.finishLap(lengthM - d, lapMs);
+    return lapMs;
+}
+
+void test_long_lap_fits_at_100hz(void)
+{
+    // 纽北北环约 20.8km；0.5m 间距时 8192 点只够 4km
+    uint32_t lapMs = driveLap(*ref, 20800, 160);
+    TEST_ASSERT_TRUE(ref->hasReference());
+    TEST_ASSERT_EQUAL_UINT32(lapMs, ref->getReferenceLapMs());
+}
+
+void test_live_delta_against_reference(void)
+{
+    driveLap(*ref, 3000, 120);
+    // 第二圈慢 10%: 跑到一半时应落后约半圈时间的 10%
+    float step = 108.0f / 3.6f * 0.01f;
+    uint32_t ms = 0;
+    ref->beginLap();
+    for (float d = 0; d + step < 1500; d += step)
+    {
+        ms += 10;
+        ref->addFix(step, ms);
+    }
+    TEST_ASSERT_TRUE(ref->hasDelta());
+    int32_t expected = (int32_t)(1500 / (120 / 3.6f) * 1000 * (120.0f / 108.0f - 1));
+    TEST_ASSERT_INT_WITHIN(15, expected, ref->getDelta());
+}
+
+void test_save_is_deferred_to_poll(void)
+{
+    driveLap(*ref, 2000, 100);
+    TEST_ASSERT_FALSE(halFs.exists(LAP_REF_DIR "/00C0FFEE.bin")); // 过线时不写卡
+    ref->poll();
+    TEST_ASSERT_TRUE(halFs.exists(LAP_REF_DIR "/00C0FFEE.bin"));
+
+    uint32_t lapMs = ref->getReferenceLapMs();
+    LapReference other;
+    other.selectTrack(TRACK);
+    TEST_ASSERT_FALSE(other.hasReference()); // 切换赛道时不读卡
+    other.poll();                            // loop() 读卡
+    TEST_ASSERT_FALSE(other.hasReference());
+    other.adopt();                           // FusionTask 换上
+    TEST_ASSERT_TRUE(other.hasReference());
+    TEST_ASSERT_EQUAL_UINT32(lapMs, other.getReferenceLapMs());
+}
+
+// 读卡之后、换上之前又切换了赛道：读到的旧赛道参考圈丢弃，新赛道的在下一次 poll() 读
+void test_stale_load_dropped_after_track_switch(void)
+{
+    driveLap(*ref, 2000, 100);
+    ref->poll();
+    uint32_t lapMs = ref->getReferenceLapMs();
+
+    LapReference other;
+    other.selectTrack(TRACK);
+    other.poll();
+    other.selectTrack(TRACK + 1);
+    other.adopt();
+    TEST_ASSERT_FALSE(other.hasReference());
+
+    other.selectTrack(TRACK);
+    other.poll();
+    other.adopt();
+    TEST_ASSERT_TRUE(other.hasReference());
+    TEST_ASSERT_EQUAL_UINT32(lapMs, other.getReferenceLapMs());
+}
+
+void test_pending_save_dropped_after_track_switch(void)
+{
+    driveLap(*ref, 2000, 100);
+    ref->selectTrack(TRACK + 1); // 写卡前切换了赛道：旧参考圈不能存成新赛道的
+    ref->poll();
+    TEST_ASSERT_FALSE(halFs.exists(LAP_REF_DIR "/00C0FFEE.bin"));
+    TEST_ASSERT_FALSE(halFs.exists(LAP_REF_DIR "/00C0FFEF.bin"));
+}
+
+void test_slower_lap_does_not_replace_reference(void)
+{
+    uint32_t best = driveLap(*ref, 2000, 100);
+    ref->poll();
+    driveLap(*ref, 2000, 90);
+    TEST_ASSERT_EQUAL_UINT32(best, ref->getReferenceLapMs());
+}
+
+int main(int, char **)
+{
+    strcpy(sdRoot, "/tmp/rtx_ref_XXXXXX");
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_long_lap_fits_at_100hz);
+    RUN_TEST(test_live_delta_against_reference);
+    RUN_TEST(test_save_is_deferred_to_poll);
+    RUN_TEST(test_stale_load_dropped_after_track_switch);
+    RUN_TEST(test_pending_save_dropped_after_track_switch);
+    RUN_TEST(test_slower_lap_does_not_replace_reference);
+    return UNITY_END();
+}
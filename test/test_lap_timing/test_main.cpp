@@ -0,0 +1,152 @@
+// 计时精度: 合成赛道上每一圈的成绩与真实圈速相差不超过 1ms (Track_Manager.hpp)
+#include <unity.h>
+#include "Track_Manager.hpp"
+#include "GPS_Epoch_Clock.hpp"
+
+TrackManager trackMgr;
+static char sdRoot[64];
+
+#define LAP_TOL_MS 1
+
+static const double LAT0 = 31.0, LON0 = 121.0;
+static const double M_PER_DEG_LAT = 6371000.0 * DEG_TO_RAD;
+
+static uint32_t laps[64];
+static int lapN = 0;
+static void onLap() { laps[lapN++] = trackMgr.getLastLapTime(); }
+
+void setUp(void)
+{
+    lapN = 0;
+    trackMgr.attachOnLapFinish(onLap);
+}
+
+void tearDown(void) {}
+
+// 半径 r 的圆形赛道上第 t 秒的位置 (从正南点出发，逆时针)
+static void circlePos(double t, double r, double v, double &lat, double &lon, float &heading)
+{
+    double a = -M_PI / 2 + (v / r) * t;
+    lat = LAT0 + r * sin(a) / M_PER_DEG_LAT;
+    lon = LON0 + r * cos(a) / (M_PER_DEG_LAT * cos(LAT0 * DEG_TO_RAD));
+    heading = (float)fmod(90.0 - (a + M_PI / 2) * RAD_TO_DEG + 720.0, 360.0);
+}
+
+// 以 hz 的频率跑 n 圈，phaseMs 为第一个采样点相对过线时刻的偏移 (让过线落在两帧之间)
+static void runCircuit(double r, double kmh, uint32_t hz, uint32_t phaseMs, int n)
+{
+    double v = kmh / 3.6;
+    double sLat, sLon;
+    float h;
+    circlePos(0, r, v, sLat, sLon, h);
+    trackMgr.setupTrack(TRACK_TYPE_CIRCUIT, 6.0f, sLat, sLon, 0, 0);
+    trackMgr.enterStandbyMode();
+
+    double lapS = 2 * M_PI * r / v;
+    uint32_t periodMs = 1000 / hz;
+    uint32_t boot = 60000; // 冷却计时从 0 开始，让第一次过线不被挡住
+    for (uint32_t ms = 0; ms < (uint32_t)((n + 1.2) * lapS * 1000); ms += periodMs)
+    {
+        double t = (ms - 500.0 + phaseMs) / 1000.0; // 起跑前 0.5s 开始采样
+        double lat, lon;
+        circlePos(t, r, v, lat, lon, h);
+        halClock.setVirtual(boot + ms);
+        trackMgr.update(lat, lon, h, (float)kmh, boot + ms);
+    }
+}
+
+static void assertLaps(double trueMs, int expectN)
+{
+    char msg[96];
+    TEST_ASSERT_GREATER_OR_EQUAL(expectN, lapN);
+    for (int i = 0; i < lapN; i++)
+    {
+        snprintf(msg, sizeof(msg), "lap %d: %u ms, true %.3f ms", i + 1, laps[i], trueMs);
+        TEST_ASSERT_TRUE_MESSAGE(fabs(laps[i] - trueMs) <= LAP_TOL_MS, msg);
+    }
+}
+
+// 与 host bench 相同的赛道: r=300m, 120km/h, 真实圈速 56.549s
+void test_circuit_10hz(void)
+{
+    for (uint32_t phase = 0; phase < 100; phase += 23)
+    {
+        lapN = 0;
+        runCircuit(300, 120, 10, phase, 8);
+        assertLaps(2 * M_PI * 300 / (120 / 3.6) * 1000, 8);
+    }
+}
+
+// 融合后 100Hz 更新
+void test_circuit_100hz(void)
+{
+    runCircuit(300, 120, 100, 7, 8);
+    assertLaps(2 * M_PI * 300 / (120 / 3.6) * 1000, 8);
+}
+
+// 小半径慢速弯 (每帧转过的角度更大，弦与弧的差更明显)
+void test_tight_circuit_10hz(void)
+{
+    runCircuit(60, 50, 10, 41, 10);
+    assertLaps(2 * M_PI * 60 / (50 / 3.6) * 1000, 10);
+}
+
+// 冲刺赛: 正东方向直线 1000m, 100km/h -> 36.000s
+void test_sprint_10hz(void)
+{
+    double mPerDegLon = M_PER_DEG_LAT * cos(LAT0 * DEG_TO_RAD);
+    trackMgr.setupTrack(TRACK_TYPE_SPRINT, 6.0f, LAT0, LON0, LAT0, LON0 + 1000 / mPerDegLon);
+    trackMgr.enterStandbyMode();
+    double v = 100 / 3.6;
+    for (uint32_t ms = 0; ms < 40000; ms += 100)
+    {
+        double x = -20 + v * (ms + 37) / 1000.0;
+        halClock.setVirtual(60000 + ms);
+        trackMgr.update(LAT0, LON0 + x / mPerDegLon, 90, 100, 60000 + ms);
+    }
+    assertLaps(36000, 1);
+}
+
+// GPS 周期时间映射 (GPS_Epoch_Clock.hpp): 10Hz、GPS 时钟与 millis 有 ppm 级频率误差、到达时刻有 0~40ms 抖动，
+// 映射后的周期时间要一直跟着真实的 "定位时刻 + 最小传输延迟" (误差只来自最小值滤波的爬升，<= 10ms)，不能越漂越远
+static void runEpochClock(double ppm)
+{
+    GpsEpochClock clk;
+    uint32_t rng = 12345;
+    const uint32_t gps0 = 30959000, boot = 5000, minLatency = 25;
+    double maxErr = 0;
+    for (uint32_t k = 0; k < 36000; k++) // 1 小时
+    {
+        uint32_t gpsMs = gps0 + k * 100;
+        double trueMs = boot + k * 100 * (1.0 + ppm * 1e-6); // 这个周期在 millis 时间轴上的真实时刻
+        rng = rng * 1103515245 + 12345;
+        uint32_t rx = (uint32_t)(trueMs + minLatency + ((rng >> 16) % 41));
+        uint32_t mapped = clk.map(gpsMs, rx);
+        if (k >= 600) // 前 1 分钟收敛
+            maxErr = max(maxErr, fabs(mapped - (trueMs + minLatency)));
+    }
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%+.0f ppm: max err %.1f ms", ppm, maxErr);
+    TEST_ASSERT_TRUE_MESSAGE(maxErr <= 10.0, msg);
+}
+
+void test_epoch_clock_tracks_slow_gps(void) { runEpochClock(50); }
+
+void test_epoch_clock_tracks_fast_gps(void) { runEpochClock(-50); }
+
+int main(int, char **)
+{
+    strcpy(sdRoot, "/tmp/rtx_lap_XXXXXX");
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_circuit_10hz);
+    RUN_TEST(test_circuit_100hz);
+    RUN_TEST(test_tight_circuit_10hz);
+    RUN_TEST(test_sprint_10hz);
+    RUN_TEST(test_epoch_clock_tracks_slow_gps);
+    RUN_TEST(test_epoch_clock_tracks_fast_gps);
+    return UNITY_END();
+}
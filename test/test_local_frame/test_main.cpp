@@ -0,0 +1,110 @@
+// 赛道局部平面坐标系 (LocalFrame) 与 haversine 大圆距离的误差 (Track_Manager.hpp)
+#include <unity.h>
+#include "Track_Manager.hpp"
+
+TrackManager trackMgr;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// double 精度的 haversine，作为基准 (与 LocalFrame 同样取地球半径 6371km)
+static double haversineM(double lat1, double lon1, double lat2, double lon2)
+{
+    double dLat = (lat2 - lat1) * DEG_TO_RAD;
+    double dLon = (lon2 - lon1) * DEG_TO_RAD;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) * sin(dLon / 2) * sin(dLon / 2);
+    return 6371000.0 * 2 * atan2(sqrt(a), sqrt(1 - a));
+}
+
+// 以 (lat0, lon0) 为原点、半径 r 内 16 个方向上的点，返回局部坐标距离与 haversine 的最大差 (m)
+static double maxError(double lat0, double lon0, double r)
+{
+    LocalFrame f;
+    f.setup(lat0, lon0);
+    double worst = 0;
+    for (int k = 0; k < 16; k++)
+    {
+        double a = k * M_PI / 8;
+        double lat = lat0 + r * cos(a) / (6371000.0 * DEG_TO_RAD);
+        double lon = lon0 + r * sin(a) / (6371000.0 * DEG_TO_RAD * cos(lat0 * DEG_TO_RAD));
+        float x, y;
+        f.toLocal(lat, lon, x, y);
+        double err = fabs(sqrt((double)x * x + (double)y * y) - haversineM(lat0, lon0, lat, lon));
+        worst = max(worst, err);
+    }
+    return worst;
+}
+
+static void assertWithin(double maxM, double lat0, double lon0, double r)
+{
+    char msg[96];
+    double e = maxError(lat0, lon0, r);
+    snprintf(msg, sizeof(msg), "lat=%.1f r=%.0fm err=%.4fm (limit %.4fm)", lat0, r, e, maxM);
+    TEST_ASSERT_TRUE_MESSAGE(e <= maxM, msg);
+}
+
+// 计时线附近 (起点 100m 内): 误差在毫米级，不影响过线插值
+void test_near_start_line(void)
+{
+    assertWithin(0.002, 31.17, 121.51, 100);
+    assertWithin(0.002, 48.0, 11.6, 100);
+    assertWithin(0.002, -33.9, 151.2, 100);
+}
+
+// 整条赛道 (起点 2km 内)
+void test_track_scale(void)
+{
+    assertWithin(0.3, 31.17, 121.51, 2000);
+    assertWithin(0.3, 52.07, -1.02, 2000);  // 银石
+    assertWithin(0.3, 60.17, 24.94, 2000);  // 高纬度
+}
+
+// 10km (注释里承诺的适用范围): 误差仍在 GPS 精度量级
+void test_ten_km(void)
+{
+    assertWithin(5.0, 31.17, 121.51, 10000);
+    assertWithin(5.0, 52.07, -1.02, 10000);
+}
+
+// 往返: toLocal -> toGeo 回到原来的位置 (融合推算用 toGeo 出经纬度)
+void test_round_trip(void)
+{
+    LocalFrame f;
+    f.setup(31.17, 121.51);
+    for (int k = 0; k < 16; k++)
+    {
+        double lat = 31.17 + 0.01 * sin(k), lon = 121.51 + 0.01 * cos(k);
+        float x, y;
+        double lat2, lon2;
+        f.toLocal(lat, lon, x, y);
+        f.toGeo(x, y, lat2, lon2);
+        // float 的相对精度约 6e-8，1km 处约 0.1mm；这里要求 1cm
+        TEST_ASSERT_TRUE(haversineM(lat, lon, lat2, lon2) < 0.01);
+    }
+}
+
+// UI 用的 getDistanceToStart() 与 haversine 一致
+void test_distance_to_start(void)
+{
+    trackMgr.setupTrack(TRACK_TYPE_CIRCUIT, 6.0f, 31.17, 121.51, 0, 0);
+    double lat = 31.17 + 0.004, lon = 121.51 + 0.003;
+    float d = trackMgr.getDistanceToStart(lat, lon);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, (float)haversineM(31.17, 121.51, lat, lon), d);
+}
+
+int main(int, char **)
+{
+    char sdRoot[] = "/tmp/rtx_frame_XXXXXX";
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_near_start_line);
+    RUN_TEST(test_track_scale);
+    RUN_TEST(test_ten_km);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_distance_to_start);
+    return UNITY_END();
+}
@@ -0,0 +1,370 @@
+// 断电恢复: 在日志文件和 journal 上注入各种故障，检查 rtlRecoverSession() 的结果 (Log_Writer.hpp)
+// 文件放在主机上的临时目录 (HAL 的 SD 根目录)，按块写入的行为与设备相同；FAT 表本身不模拟
+#include <unity.h>
+#include <vector>
+#include "Log_Writer.hpp"
+
+#define JOURNAL "/journal.bin"
+#define LOG_PATH "/s.rtl"
+#define SESSION 0xC0FFEE01
+#define PREALLOC (16 * RTL_BLOCK_SIZE)
+
+static char sdRoot[64];
+
+// 测试用的块队列: 提交后立即"写卡"
+struct FilePort
+{
+    uint8_t freeIdx[4] = {0, 1, 2, 3};
+    uint8_t freeN = 4;
+    std::vector<uint8_t> submitted;
+
+    bool takeFree(uint8_t &idx)
+    {
+        if (!freeN)
+            return false;
+        idx = freeIdx[--freeN];
+        return true;
+    }
+    uint32_t freeCount() { return freeN; }
+    void submit(uint8_t idx) { submitted.push_back(idx); }
+};
+
+static RtlBlock pool[4];
+
+// 写一个 session: 100Hz IMU 记录，每写完一块立即"写卡"，写完第 committed 块时记一次 journal (模拟同步)。
+// 只有一个数据流，块按顺序号依次落盘；withGps 时再交错 10Hz 的 GPS 记录，最后做一次同步 (封口未写满的块)。
+// 返回已写出的块的最大顺序号 + 1
+static uint32_t writeSession(uint32_t sessionId, uint32_t blocks, uint32_t committed, bool withGps = false)
+{
+    FilePort port;
+    RtlBlockBuilder<FilePort> b;
+    b.begin(pool, &port);
+    b.reset(sessionId);
+
+    HalFile f = halFs.open(LOG_PATH, FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)f);
+    TEST_ASSERT_TRUE(rtlWriteFileHeader(f, sessionId, 0));
+    HalFile jf = halFs.open(JOURNAL, FILE_WRITE);
+    rtlWriteJournal(jf, RTL_JOURNAL_OPEN, sessionId, 0, LOG_PATH);
+
+    uint32_t allocated = 0, written = 0, end = 0;
+    auto drain = [&]()
+    {
+        for (uint8_t idx : port.submitted)
+        {
+            TEST_ASSERT_EQUAL(RTL_BLOCK_SIZE, rtlWriteBlock(f, pool[idx], allocated, PREALLOC));
+            end = max(end, pool[idx].h.seq + 1);
+            if (++written == committed)
+                rtlWriteJournal(jf, RTL_JOURNAL_OPEN, sessionId, committed, LOG_PATH);
+            port.freeIdx[port.freeN++] = idx;
+        }
+        port.submitted.clear();
+    };
+    for (uint32_t t = 0; written < blocks; t += 10)
+    {
+        RtlImuRecord r;
+        rtlEncodeImu(t, 0.1f, -0.2f, 1.0f, 2.0f, 3.0f, r);
+        b.append(RTL_BLOCK_IMU, &r, sizeof(r));
+        if (withGps && t % 100 == 0)
+        {
+            LogSample s = {31.1, 121.5, 10, 100, 12, true, true, 90, 0, 0, 0, 0};
+            RtlGpsRecord g;
+            rtlEncodeGps(s, t, g);
+            b.append(RTL_BLOCK_GPS, &g, sizeof(g));
+        }
+        drain();
+    }
+    if (withGps)
+    {
+        b.submitAll();
+        drain();
+    }
+    return end;
+}
+
+static uint32_t fileSize(const char *path)
+{
+    HalFile f = halFs.open(path, FILE_READ);
+    return f ? (uint32_t)f.size() : 0;
+}
+
+// 在文件里 pos 处改写 len 字节
+static void poke(uint32_t pos, const void *data, size_t len)
+{
+    HalFile f = halFs.open(LOG_PATH, "r+");
+    TEST_ASSERT_TRUE(f.seek(pos));
+    TEST_ASSERT_EQUAL(len, f.write((const uint8_t *)data, len));
+    f.close();
+}
+
+static uint32_t recover()
+{
+    RtlJournal j;
+    uint32_t valid = 0xFFFFFFFF;
+    TEST_ASSERT_TRUE(rtlRecoverSession(JOURNAL, j, valid));
+    TEST_ASSERT_EQUAL_UINT32(SESSION, j.sessionId);
+    TEST_ASSERT_EQUAL_UINT32((valid + 1) * RTL_BLOCK_SIZE, fileSize(LOG_PATH)); // 预分配的尾巴被截掉
+    return valid;
+}
+
+// 恢复后 journal 变为已关闭，再次开机不会重复恢复
+static void assertJournalClosed(uint32_t valid)
+{
+    HalFile jf = halFs.open(JOURNAL, FILE_READ);
+    RtlJournal j;
+    TEST_ASSERT_TRUE(rtlReadJournal(jf, j));
+    jf.close();
+    TEST_ASSERT_EQUAL(RTL_JOURNAL_CLOSED, j.state);
+    TEST_ASSERT_EQUAL_UINT32(valid, j.committedBlocks);
+    uint32_t again;
+    TEST_ASSERT_FALSE(rtlRecoverSession(JOURNAL, j, again));
+}
+
+void setUp(void)
+{
+    halFs.remove(LOG_PATH);
+    halFs.remove(JOURNAL);
+}
+
+void tearDown(void) {}
+
+// 提交点之后写完的块也能找回来
+void test_power_loss_after_commit(void)
+{
+    writeSession(SESSION, 9, 4);
+    uint32_t valid = recover();
+    TEST_ASSERT_EQUAL_UINT32(9, valid);
+    assertJournalClosed(9);
+}
+
+// 最后一块只写了一半 (撕裂写)：这一块不要，前面的都保留
+void test_torn_last_block(void)
+{
+    writeSession(SESSION, 6, 2);
+    static uint8_t zero[RTL_BLOCK_SIZE];
+    poke(6 * RTL_BLOCK_SIZE + 1000, zero, RTL_BLOCK_SIZE - 1000); // 第 6 个数据块 (seq 5) 后半段没写上
+    TEST_ASSERT_EQUAL_UINT32(5, recover());
+}
+
+// 提交点之后某块里翻了一位：CRC 不对，从这块开始丢弃
+void test_bit_flip_after_commit(void)
+{
+    writeSession(SESSION, 8, 3);
+    uint8_t c;
+    HalFile f = halFs.open(LOG_PATH, FILE_READ);
+    f.seek(6 * RTL_BLOCK_SIZE + 300);
+    f.read(&c, 1);
+    f.close();
+    c ^= 0x04;
+    poke(6 * RTL_BLOCK_SIZE + 300, &c, 1); // seq 5
+    TEST_ASSERT_EQUAL_UINT32(5, recover());
+}
+
+// 预分配区域里残留着上一个 session 的合法块 (簇被重复使用)：session 不同，不能当成本次的数据
+void test_stale_block_from_previous_session(void)
+{
+    writeSession(SESSION - 1, 8, 8);
+    static RtlBlock old[8];
+    HalFile f = halFs.open(LOG_PATH, FILE_READ);
+    f.seek(RTL_BLOCK_SIZE);
+    f.read((uint8_t *)old, sizeof(old));
+    f.close();
+
+    writeSession(SESSION, 3, 1);
+    poke(4 * RTL_BLOCK_SIZE, &old[3], sizeof(RtlBlock)); // 紧接在本次最后一块后面
+    TEST_ASSERT_EQUAL_UINT32(3, recover());
+}
+
+// 顺序号不对的块 (比如同一 session 里更早的副本落在了错误的位置)
+void test_out_of_order_block(void)
+{
+    writeSession(SESSION, 6, 1);
+    static RtlBlock blk;
+    HalFile f = halFs.open(LOG_PATH, FILE_READ);
+    f.seek(2 * RTL_BLOCK_SIZE);
+    f.read((uint8_t *)&blk, sizeof(blk)); // seq 1
+    f.close();
+    poke(4 * RTL_BLOCK_SIZE, &blk, sizeof(blk)); // 放到 seq 3 的位置
+    TEST_ASSERT_EQUAL_UINT32(3, recover());
+}
+
+// journal 指向的文件不存在 (比如被删了)：恢复 0 块，journal 照样关闭
+void test_journal_without_data_file(void)
+{
+    HalFile jf = halFs.open(JOURNAL, FILE_WRITE);
+    rtlWriteJournal(jf, RTL_JOURNAL_OPEN, SESSION, 5, LOG_PATH);
+    jf.close();
+    RtlJournal j;
+    uint32_t valid = 0xFFFFFFFF;
+    TEST_ASSERT_TRUE(rtlRecoverSession(JOURNAL, j, valid));
+    TEST_ASSERT_EQUAL_UINT32(0, valid);
+    assertJournalClosed(0);
+}
+
+// journal 本身损坏 (写 journal 时断电)：不动数据文件
+void test_corrupt_journal_is_ignored(void)
+{
+    writeSession(SESSION, 4, 2);
+    uint32_t before = fileSize(LOG_PATH);
+    HalFile jf = halFs.open(JOURNAL, "r+");
+    jf.seek(8);
+    uint8_t junk = 0xAA;
+    jf.write(&junk, 1);
+    jf.close();
+    RtlJournal j;
+    uint32_t valid;
+    TEST_ASSERT_FALSE(rtlRecoverSession(JOURNAL, j, valid));
+    TEST_ASSERT_EQUAL_UINT32(before, fileSize(LOG_PATH));
+}
+
+// GPS 块比 IMU 块填得慢，顺序号更小的 GPS 块还没写时后面已经有 IMU 块落盘；
+// 同步把未写满的块也封口写卡，之后断电时全部能找回
+void test_interleaved_streams_after_sync(void)
+{
+    uint32_t end = writeSession(SESSION, 7, 0, true);
+    TEST_ASSERT_GREATER_THAN(7, end);
+    TEST_ASSERT_EQUAL_UINT32(end, recover());
+}
+
+// 没有同步时，顺序号更小的块 (比如没写满的 GPS 块) 可能还在内存里：恢复在这个空洞处停下，之后的块不要
+void test_interleaved_streams_hole_before_sync(void)
+{
+    writeSession(SESSION, 7, 0);
+    // 顺序号 2 的块换成全 0，模拟它还在内存里没写卡
+    static RtlBlock zero;
+    poke(3 * RTL_BLOCK_SIZE, &zero, sizeof(zero));
+    TEST_ASSERT_EQUAL_UINT32(2, recover());
+}
+
+// 在写入过程中的每一个 256 字节边界上"断电" (之后的字节都没写上)：
+// 恢复出的块数必须正好等于断电前完整写完的块数
+void test_power_loss_at_every_offset(void)
+{
+    const uint32_t blocks = 6;
+    writeSession(SESSION, blocks, 0);
+    static uint8_t image[(blocks + 1) * RTL_BLOCK_SIZE];
+    HalFile f = halFs.open(LOG_PATH, FILE_READ);
+    TEST_ASSERT_EQUAL(sizeof(image), f.read(image, sizeof(image)));
+    f.close();
+
+    static uint8_t zero[PREALLOC];
+    for (uint32_t cut = RTL_BLOCK_SIZE; cut <= sizeof(image); cut += 256)
+    {
+        halFs.remove(LOG_PATH);
+        HalFile w = halFs.open(LOG_PATH, FILE_WRITE);
+        w.write(image, cut);
+        w.write(zero, PREALLOC - cut); // 预分配时填的 0
+        w.close();
+        HalFile jf = halFs.open(JOURNAL, FILE_WRITE);
+        rtlWriteJournal(jf, RTL_JOURNAL_OPEN, SESSION, 0, LOG_PATH);
+        jf.close();
+
+        char msg[48];
+        snprintf(msg, sizeof(msg), "cut at %u", cut);
+        TEST_ASSERT_EQUAL_UINT32_MESSAGE(cut / RTL_BLOCK_SIZE - 1, recover(), msg);
+    }
+}
+
+// 同步提交过的块 (包括当时没写满的 GPS / IMU 块) 之后再也不会被写：
+// 提交后继续记录，最后一块写到一半断电，同步前的每一条记录都还在
+void test_sync_then_torn_write_keeps_synced_records(void)
+{
+    FilePort port;
+    RtlBlockBuilder<FilePort> b;
+    b.begin(pool, &port);
+    b.reset(SESSION);
+    HalFile f = halFs.open(LOG_PATH, FILE_WRITE);
+    TEST_ASSERT_TRUE(rtlWriteFileHeader(f, SESSION, 0));
+    HalFile jf = halFs.open(JOURNAL, FILE_WRITE);
+    rtlWriteJournal(jf, RTL_JOURNAL_OPEN, SESSION, 0, LOG_PATH);
+
+    const uint32_t syncMs = 3000, endMs = 9000;
+    uint32_t allocated = 0, committed = 0, lastSeq = 0;
+    bool synced = false;
+    auto drain = [&]()
+    {
+        for (uint8_t idx : port.submitted)
+        {
+            if (synced)
+                TEST_ASSERT_GREATER_OR_EQUAL(committed, pool[idx].h.seq); // 不碰已提交的块
+            TEST_ASSERT_EQUAL(RTL_BLOCK_SIZE, rtlWriteBlock(f, pool[idx], allocated, PREALLOC));
+            lastSeq = pool[idx].h.seq;
+            port.freeIdx[port.freeN++] = idx;
+        }
+        port.submitted.clear();
+    };
+    for (uint32_t t = 0; t < endMs; t += 10)
+    {
+        if (t == syncMs)
+        {
+            b.submitAll();
+            drain();
+            committed = b.blockCount();
+            rtlWriteJournal(jf, RTL_JOURNAL_OPEN, SESSION, committed, LOG_PATH);
+            synced = true;
+        }
+        RtlImuRecord r;
+        rtlEncodeImu(t, 0.1f, -0.2f, 1.0f, 2.0f, 3.0f, r);
+        b.append(RTL_BLOCK_IMU, &r, sizeof(r));
+        if (t % 100 == 0)
+        {
+            LogSample s = {31.1, 121.5, 10, 100, 12, true, true, 90, 0, 0, 0, 0};
+            RtlGpsRecord g;
+            rtlEncodeGps(s, t, g);
+            b.append(RTL_BLOCK_GPS, &g, sizeof(g));
+        }
+        drain();
+    }
+    f.close();
+    jf.close();
+    TEST_ASSERT_GREATER_THAN(committed, lastSeq);
+
+    // 提交后最后写的那一块只写上了前半段
+    static uint8_t zero[RTL_BLOCK_SIZE / 2];
+    poke((lastSeq + 1) * RTL_BLOCK_SIZE + sizeof(zero), zero, sizeof(zero));
+    uint32_t valid = recover();
+    TEST_ASSERT_GREATER_OR_EQUAL(committed, valid);
+
+    // 同步前的记录: 300 条 IMU + 30 条 GPS
+    uint32_t imu = 0, gps = 0;
+    static RtlBlock blk;
+    HalFile rf = halFs.open(LOG_PATH, FILE_READ);
+    for (uint32_t seq = 0; seq < valid; seq++)
+    {
+        TEST_ASSERT_TRUE(rf.seek((seq + 1) * RTL_BLOCK_SIZE));
+        TEST_ASSERT_EQUAL(sizeof(blk), rf.read((uint8_t *)&blk, sizeof(blk)));
+        TEST_ASSERT_TRUE(rtlCheckBlock(blk, SESSION));
+        for (uint16_t i = 0; i < blk.h.count; i++)
+        {
+            uint32_t t;
+            memcpy(&t, blk.payload + i * blk.h.recordSize, sizeof(t));
+            if (t < syncMs)
+                (blk.h.type == RTL_BLOCK_GPS ? gps : imu)++;
+        }
+    }
+    rf.close();
+    TEST_ASSERT_EQUAL_UINT32(syncMs / 10, imu);
+    TEST_ASSERT_EQUAL_UINT32(syncMs / 100, gps);
+}
+
+int main(int, char **)
+{
+    strcpy(sdRoot, "/tmp/rtx_recov_XXXXXX");
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_power_loss_after_commit);
+    RUN_TEST(test_torn_last_block);
+    RUN_TEST(test_bit_flip_after_commit);
+    RUN_TEST(test_stale_block_from_previous_session);
+    RUN_TEST(test_out_of_order_block);
+    RUN_TEST(test_journal_without_data_file);
+    RUN_TEST(test_corrupt_journal_is_ignored);
+    RUN_TEST(test_interleaved_streams_after_sync);
+    RUN_TEST(test_interleaved_streams_hole_before_sync);
+    RUN_TEST(test_power_loss_at_every_offset);
+    RUN_TEST(test_sync_then_torn_write_keeps_synced_records);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// 日志编码 / 块缓冲池 / 写卡与恢复 (Log_Writer.hpp)
+#include <unity.h>
+#include "Log_Writer.hpp"
+
+#define POOL 4
+
+// 测试用的块队列：空闲块是一个栈，提交的块按顺序记下来，由测试决定何时"写完"放回
+struct ArrayPort
+{
+    uint8_t freeList[POOL];
+    uint8_t freeN = 0;
+    uint8_t submitted[64];
+    uint8_t submittedN = 0;
+
+    bool takeFree(uint8_t &idx)
+    {
+        if (freeN == 0)
+            return false;
+        idx = freeList[--freeN];
+        return true;
+    }
+    uint32_t freeCount() { return freeN; }
+    void submit(uint8_t idx) { submitted[submittedN++] = idx; }
+    void release(uint8_t idx) { freeList[freeN++] = idx; }
+};
+
+static RtlBlock pool[POOL];
+static ArrayPort port;
+static RtlBlockBuilder<ArrayPort> builder;
+static char sdRoot[64];
+
+void setUp(void)
+{
+    port = ArrayPort();
+    for (uint8_t i = 0; i < POOL; i++)
+        port.release(i);
+    builder.begin(pool, &port);
+    builder.reset(0x1234);
+}
+
+void tearDown(void) {}
+
+static RtlGpsRecord gpsRec(uint32_t t)
+{
+    RtlGpsRecord r;
+    memset(&r, 0, sizeof(r));
+    r.t_ms = t;
+    return r;
+}
+
+void test_encode_gps_scales_and_clamps(void)
+{
+    LogSample s = {31.1234567, 121.7654321, 12.34f, 700.0f, 9, true, false, 123.4f, -5.6f, 7.8f, 40.0f, -0.25f};
+    RtlGpsRecord r;
+    rtlEncodeGps(s, 1500, r);
+    TEST_ASSERT_EQUAL_UINT32(1500, r.t_ms);
+    TEST_ASSERT_EQUAL_INT32(311234567, r.lat);
+    TEST_ASSERT_EQUAL_INT32(1217654321, r.lon);
+    TEST_ASSERT_EQUAL_INT32(1234, r.alt_cm);
+    TEST_ASSERT_EQUAL_UINT16(65535, r.speed_c); // 700 km/h 超出 0.01 km/h 的 16 位范围
+    TEST_ASSERT_EQUAL_UINT8(RTL_FLAG_FIX, r.flags);
+    TEST_ASSERT_EQUAL_UINT16(1234, r.heading_d);
+    TEST_ASSERT_EQUAL_INT(-56, r.roll_d);
+    TEST_ASSERT_EQUAL_INT(32767, r.lon_mg); // 40g 超出 int16 mg
+    TEST_ASSERT_EQUAL_INT(-250, r.lat_mg);
+}
+
+void test_encode_imu(void)
+{
+    RtlImuRecord r;
+    rtlEncodeImu(42, 0.5f, -1.25f, -40.0f, 10.05f, -3.0f, r);
+    TEST_ASSERT_EQUAL_UINT32(42, r.t_ms);
+    TEST_ASSERT_EQUAL_INT(500, r.lat_mg);
+    TEST_ASSERT_EQUAL_INT(-1250, r.lon_mg);
+    TEST_ASSERT_EQUAL_INT(-32768, r.vert_mg);
+    TEST_ASSERT_EQUAL_INT(-30, r.pitch_d);
+}
+
+void test_csv_row_matches_header_order(void)
+{
+    LogSample s = {31.5, 121.25, 10.0f, 88.8f, 12, true, true, 90.0f, 1.5f, -2.5f, 0.31f, -0.42f};
+    char line[256];
+    int n = logFormatCsv(line, sizeof(line), "2024-01-02 03:04:05.678", s);
+    TEST_ASSERT_EQUAL_INT((int)strlen(line), n);
+    TEST_ASSERT_EQUAL_STRING("2024-01-02 03:04:05.678,31.50000000,121.25000000,10.00,88.80,12,1,90.0,1.5,-2.5,0.31,-0.42\n", line);
+}
+
+void test_full_block_is_sealed_and_submitted(void)
+{
+    const uint32_t perBlock = RTL_BLOCK_PAYLOAD / sizeof(RtlGpsRecord);
+    for (uint32_t i = 0; i <= perBlock; i++)
+    {
+        RtlGpsRecord r = gpsRec(i);
+        builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+    }
+    TEST_ASSERT_EQUAL_UINT8(1, port.submittedN);
+    const RtlBlock &b = pool[port.submitted[0]];
+    TEST_ASSERT_EQUAL_UINT32(0, b.h.seq);
+    TEST_ASSERT_EQUAL_UINT16(perBlock, b.h.count);
+    TEST_ASSERT_TRUE(rtlCheckBlock(b, 0x1234));
+    TEST_ASSERT_FALSE(rtlCheckBlock(b, 0x9999));
+    TEST_ASSERT_EQUAL_UINT32(2, builder.blockCount()); // 第二块已开始填
+}
+
+void test_streams_fill_separate_blocks(void)
+{
+    RtlGpsRecord g = gpsRec(1);
+    RtlImuRecord m;
+    rtlEncodeImu(1, 0, 0, 0, 0, 0, m);
+    builder.append(RTL_BLOCK_GPS, &g, sizeof(g));
+    builder.append(RTL_BLOCK_IMU, &m, sizeof(m));
+    builder.append(RTL_BLOCK_IMU, &m, sizeof(m));
+    builder.submitAll();
+    TEST_ASSERT_EQUAL_UINT8(2, port.submittedN);
+    const RtlBlock &b0 = pool[port.submitted[0]];
+    const RtlBlock &b1 = pool[port.submitted[1]];
+    TEST_ASSERT_EQUAL_UINT8(RTL_BLOCK_GPS, b0.h.type);
+    TEST_ASSERT_EQUAL_UINT16(1, b0.h.count);
+    TEST_ASSERT_EQUAL_UINT8(RTL_BLOCK_IMU, b1.h.type);
+    TEST_ASSERT_EQUAL_UINT16(2, b1.h.count);
+    TEST_ASSERT_EQUAL_UINT32(1, b1.h.seq);
+}
+
+void test_records_dropped_when_pool_exhausted(void)
+{
+    port.freeN = 0; // 写卡方一块都没还回来
+    RtlGpsRecord r = gpsRec(0);
+    builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+    builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+    TEST_ASSERT_EQUAL_UINT32(2, builder.getDropped());
+    TEST_ASSERT_EQUAL_UINT32(0, builder.blockCount());
+}
+
+// 同步时未写满的块直接封口，之后的记录开新块 (已交出去的块不会再以同一顺序号出现)
+void test_sync_seals_open_blocks(void)
+{
+    RtlGpsRecord r = gpsRec(7);
+    builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+    builder.submitAll();
+    TEST_ASSERT_EQUAL_UINT8(1, port.submittedN);
+    const RtlBlock &first = pool[port.submitted[0]];
+    TEST_ASSERT_TRUE(rtlCheckBlock(first, 0x1234));
+    TEST_ASSERT_EQUAL_UINT32(0, first.h.seq);
+    TEST_ASSERT_EQUAL_UINT16(1, first.h.count);
+    port.release(port.submitted[0]);
+
+    builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+    builder.submitAll();
+    TEST_ASSERT_EQUAL_UINT8(2, port.submittedN);
+    const RtlBlock &next = pool[port.submitted[1]];
+    TEST_ASSERT_EQUAL_UINT32(1, next.h.seq);
+    TEST_ASSERT_EQUAL_UINT16(1, next.h.count);
+    TEST_ASSERT_EQUAL_UINT32(2, builder.blockCount());
+
+    // 没有正在填充的块时什么都不交
+    builder.submitAll();
+    TEST_ASSERT_EQUAL_UINT8(2, port.submittedN);
+}
+
+void test_write_scan_and_journal_roundtrip(void)
+{
+    const uint32_t prealloc = 8 * RTL_BLOCK_SIZE;
+    uint32_t allocated = 0;
+    HalFile f = halFs.open("/s.rtl", FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)f);
+    TEST_ASSERT_TRUE(rtlWriteFileHeader(f, 0x1234, 1000));
+
+    RtlGpsRecord r = gpsRec(0);
+    for (uint32_t i = 0; i < 3 * (RTL_BLOCK_PAYLOAD / sizeof(r)) + 1; i++)
+    {
+        builder.append(RTL_BLOCK_GPS, &r, sizeof(r));
+        while (port.submittedN) // 立即"写卡"并还回空闲块
+        {
+            uint8_t idx = port.submitted[--port.submittedN];
+            TEST_ASSERT_EQUAL_UINT32(RTL_BLOCK_SIZE, rtlWriteBlock(f, pool[idx], allocated, prealloc));
+            port.release(idx);
+        }
+    }
+    builder.submitAll();
+    uint8_t idx = port.submitted[--port.submittedN];
+    rtlWriteBlock(f, pool[idx], allocated, prealloc);
+    TEST_ASSERT_EQUAL_UINT32(prealloc, allocated);
+    TEST_ASSERT_EQUAL_UINT32(prealloc, f.size()); // 预分配后文件长度不随每块变化
+    f.close();
+
+    HalFile jf = halFs.open("/j.bin", FILE_WRITE);
+    rtlWriteJournal(jf, RTL_JOURNAL_OPEN, 0x1234, 2, "/s.rtl");
+    jf.close();
+    HalFile jr = halFs.open("/j.bin", FILE_READ);
+    RtlJournal j;
+    TEST_ASSERT_TRUE(rtlReadJournal(jr, j));
+    jr.close();
+    TEST_ASSERT_EQUAL_UINT32(2, j.committedBlocks);
+    TEST_ASSERT_EQUAL_STRING("/s.rtl", j.path);
+
+    // 提交点之后还能读到 2 块，预分配的零填充部分不算
+    HalFile scan = halFs.open("/s.rtl", FILE_READ);
+    TEST_ASSERT_EQUAL_UINT32(4, rtlScanBlocks(scan, j.sessionId, j.committedBlocks));
+    scan.close();
+    TEST_ASSERT_TRUE(halFs.truncate("/s.rtl", 5 * RTL_BLOCK_SIZE));
+    HalFile cut = halFs.open("/s.rtl", FILE_READ);
+    TEST_ASSERT_EQUAL_UINT32(5 * RTL_BLOCK_SIZE, cut.size());
+}
+
+int main(int, char **)
+{
+    strcpy(sdRoot, "/tmp/rtx_logw_XXXXXX");
+    if (!mkdtemp(sdRoot))
+        return 1;
+    setenv("RACETRIX_SD_ROOT", sdRoot, 1);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_encode_gps_scales_and_clamps);
+    RUN_TEST(test_encode_imu);
+    RUN_TEST(test_csv_row_matches_header_order);
+    RUN_TEST(test_full_block_is_sealed_and_submitted);
+    RUN_TEST(test_streams_fill_separate_blocks);
+    RUN_TEST(test_records_dropped_when_pool_exhausted);
+    RUN_TEST(test_sync_seals_open_blocks);
+    RUN_TEST(test_write_scan_and_journal_roundtrip);
+    return UNITY_END();
+}
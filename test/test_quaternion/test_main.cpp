@@ -0,0 +1,204 @@
+// 四元数工具与安装姿态换算 (Quaternion.hpp，IMU_Driver 四元数模式用)
+#include <unity.h>
+#include "Hal.hpp"
+#include "Quaternion.hpp"
+
+#define EPS 1e-5f
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const Vec3 X = {1, 0, 0}, Y = {0, 1, 0}, Z = {0, 0, 1};
+static const float D2R = 0.0174532925f;
+
+static void assertVec(const Vec3 &e, const Vec3 &a, float tol = EPS)
+{
+    TEST_ASSERT_FLOAT_WITHIN(tol, e.x, a.x);
+    TEST_ASSERT_FLOAT_WITHIN(tol, e.y, a.y);
+    TEST_ASSERT_FLOAT_WITHIN(tol, e.z, a.z);
+}
+
+// 角度差 (考虑 ±180 回绕)
+static float angleDiff(float a, float b)
+{
+    float d = fmodf(a - b + 540.0f, 360.0f) - 180.0f;
+    return fabsf(d);
+}
+
+static uint32_t rng = 42;
+static float rndf() // [-1, 1)
+{
+    rng = rng * 1664525u + 1013904223u;
+    return (rng >> 8) / 8388608.0f - 1.0f;
+}
+
+static Quat randomQuat()
+{
+    return Quat{rndf(), rndf(), rndf(), rndf()}.normalized();
+}
+
+// 车身姿态: 先绕 Z 转到航向 (顺时针为正 => 绕 Z 转 -h)，再抬头 (绕车身 X)，再右倾 (绕车身 Y)
+static Quat attitude(float headingDeg, float pitchDeg, float rollDeg)
+{
+    return Quat::fromAxisAngle(Z, -headingDeg * D2R) * Quat::fromAxisAngle(X, pitchDeg * D2R) *
+           Quat::fromAxisAngle(Y, rollDeg * D2R);
+}
+
+// 绕 Z 转 90 度 (右手): X -> Y, Y -> -X
+void test_rotate_right_hand_rule(void)
+{
+    Quat q = Quat::fromAxisAngle(Z, (float)M_PI / 2);
+    assertVec(Y, q.rotate(X));
+    assertVec(Vec3{-1, 0, 0}, q.rotate(Y));
+    assertVec(Z, q.rotate(Z));
+    assertVec(X, Quat::identity().rotate(X));
+}
+
+// q * q^-1 = 1，旋转保持长度，rotate() 与 q v q^-1 的定义一致
+void test_conjugate_and_norm(void)
+{
+    for (int i = 0; i < 200; i++)
+    {
+        Quat q = randomQuat();
+        Vec3 v = {rndf() * 5, rndf() * 5, rndf() * 5};
+        Quat id = q * q.conj();
+        TEST_ASSERT_FLOAT_WITHIN(EPS, 1, id.w);
+        TEST_ASSERT_FLOAT_WITHIN(EPS, 0, fabsf(id.x) + fabsf(id.y) + fabsf(id.z));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, v.norm(), q.rotate(v).norm());
+        Quat p = q * Quat{0, v.x, v.y, v.z} * q.conj();
+        assertVec(Vec3{p.x, p.y, p.z}, q.rotate(v), 1e-4f);
+        assertVec(v, q.conj().rotate(q.rotate(v)), 1e-4f);
+    }
+}
+
+// 复合顺序: q_CA = q_CB * q_BA (先 A->B，再 B->C)
+void test_composition_order(void)
+{
+    for (int i = 0; i < 200; i++)
+    {
+        Quat qBA = randomQuat(), qCB = randomQuat();
+        Vec3 v = {rndf(), rndf(), rndf()};
+        assertVec(qCB.rotate(qBA.rotate(v)), (qCB * qBA).rotate(v), 1e-4f);
+    }
+}
+
+// fromTwoVectors: from 转到 to，包括同向和反向的退化情况
+void test_from_two_vectors(void)
+{
+    for (int i = 0; i < 200; i++)
+    {
+        Vec3 a = Vec3{rndf(), rndf(), rndf()}.normalized();
+        Vec3 b = Vec3{rndf(), rndf(), rndf()}.normalized();
+        assertVec(b, Quat::fromTwoVectors(a, b).rotate(a), 1e-4f);
+    }
+    assertVec(X, Quat::fromTwoVectors(X, X).rotate(X));
+    assertVec(Vec3{-1, 0, 0}, Quat::fromTwoVectors(X, Vec3{-1, 0, 0}).rotate(X));
+    assertVec(Vec3{0, 0, -1}, Quat::fromTwoVectors(Z, Vec3{0, 0, -1}).rotate(Z));
+}
+
+// fromRows: 目标坐标系的三个轴 (源坐标下表示) 分别转到 X / Y / Z；覆盖四个分支
+void test_from_rows(void)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        Quat q = randomQuat();
+        // q 把源坐标转到目标坐标，目标轴在源坐标下 = q^-1 作用在目标基上
+        Vec3 r0 = q.conj().rotate(X), r1 = q.conj().rotate(Y), r2 = q.conj().rotate(Z);
+        Quat m = Quat::fromRows(r0, r1, r2);
+        assertVec(X, m.rotate(r0), 1e-4f);
+        assertVec(Y, m.rotate(r1), 1e-4f);
+        assertVec(Z, m.rotate(r2), 1e-4f);
+    }
+}
+
+// 姿态 -> 航向/俯仰/横滚: 与构造时的角度一致 (俯仰 ±80 度以内)
+void test_heading_pitch_roll_round_trip(void)
+{
+    for (int h = -175; h <= 180; h += 35)
+        for (int p = -80; p <= 80; p += 20)
+            for (int r = -170; r <= 170; r += 34)
+            {
+                float hh, pp, rr;
+                quatToHeadingPitchRoll(attitude(h, p, r), hh, pp, rr);
+                char msg[64];
+                snprintf(msg, sizeof(msg), "h=%d p=%d r=%d -> %.3f %.3f %.3f", h, p, r, hh, pp, rr);
+                TEST_ASSERT_TRUE_MESSAGE(angleDiff(h, hh) < 0.01f, msg);
+                TEST_ASSERT_TRUE_MESSAGE(fabsf(p - pp) < 0.01f, msg);
+                TEST_ASSERT_TRUE_MESSAGE(angleDiff(r, rr) < 0.01f, msg);
+            }
+}
+
+// 航向约定: 车头朝东为 +90 (顺时针)，抬头为正，右侧下沉为正
+void test_sign_conventions(void)
+{
+    float h, p, r;
+    quatToHeadingPitchRoll(Quat::fromAxisAngle(Z, -(float)M_PI / 2), h, p, r);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 90, h);
+    quatToHeadingPitchRoll(Quat::fromAxisAngle(X, 10 * D2R), h, p, r);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10, p);
+    quatToHeadingPitchRoll(Quat::fromAxisAngle(Y, 5 * D2R), h, p, r);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 5, r);
+}
+
+// 安装姿态: 传感器随便怎么装 (mount = 传感器 -> 车身)，BNO 输出 qs = qv * mount，
+// IMU_Driver 用 qs * mount^-1 还原车身姿态，用 mount 把传感器坐标的加速度转回车身坐标
+void test_mount_is_removed(void)
+{
+    const Quat mounts[] = {
+        Quat::identity(),
+        Quat::fromAxisAngle(X, (float)M_PI / 2),                                    // 竖装 (屏幕朝后)
+        Quat::fromAxisAngle(Y, (float)M_PI),                                        // 倒装
+        Quat::fromAxisAngle(Z, (float)M_PI / 2),                                    // 转 90 度
+        Quat::fromAxisAngle(Vec3{1, 1, 1}.normalized(), 1.0f),                      // 斜装
+        Quat::fromAxisAngle(Z, 0.3f) * Quat::fromAxisAngle(X, -1.2f)};
+    for (const Quat &mount : mounts)
+        for (int i = 0; i < 50; i++)
+        {
+            float h0 = rndf() * 180, p0 = rndf() * 30, r0 = rndf() * 45;
+            Quat qv = attitude(h0, p0, r0);
+            Quat qs = qv * mount;
+            float h, p, r;
+            quatToHeadingPitchRoll(qs * mount.conj(), h, p, r);
+            TEST_ASSERT_TRUE(angleDiff(h0, h) < 0.02f);
+            TEST_ASSERT_TRUE(fabsf(p0 - p) < 0.02f);
+            TEST_ASSERT_TRUE(angleDiff(r0, r) < 0.02f);
+
+            // 车身坐标下 0.5g 制动、0.3g 右转；传感器看到的是 mount^-1 转过的
+            Vec3 av = {0.3f, -0.5f, 0.0f};
+            Vec3 as = mount.conj().rotate(av);
+            assertVec(av, mount.rotate(as), 1e-5f);
+        }
+}
+
+// BNO 四元数是 1/2^14 的整数：量化后 (IMU_Driver 再归一化) 航向/俯仰/横滚误差在 0.05 度以内
+void test_quantized_sensor_quaternion(void)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        float h0 = rndf() * 180, p0 = rndf() * 60, r0 = rndf() * 60;
+        Quat q = attitude(h0, p0, r0);
+        Quat qq = Quat{roundf(q.w * 16384) / 16384, roundf(q.x * 16384) / 16384,
+                       roundf(q.y * 16384) / 16384, roundf(q.z * 16384) / 16384}
+                      .normalized();
+        float h, p, r;
+        quatToHeadingPitchRoll(qq, h, p, r);
+        TEST_ASSERT_TRUE(angleDiff(h0, h) < 0.05f);
+        TEST_ASSERT_TRUE(fabsf(p0 - p) < 0.05f);
+        TEST_ASSERT_TRUE(angleDiff(r0, r) < 0.05f);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rotate_right_hand_rule);
+    RUN_TEST(test_conjugate_and_norm);
+    RUN_TEST(test_composition_order);
+    RUN_TEST(test_from_two_vectors);
+    RUN_TEST(test_from_rows);
+    RUN_TEST(test_heading_pitch_roll_round_trip);
+    RUN_TEST(test_sign_conventions);
+    RUN_TEST(test_mount_is_removed);
+    RUN_TEST(test_quantized_sensor_quaternion);
+    return UNITY_END();
+}
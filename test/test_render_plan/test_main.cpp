@@ -0,0 +1,137 @@
+// 刷屏规划 (UI_Render_Plan.hpp): 脏区合并、整屏缓冲选择、条带切分
+#include <unity.h>
+#include "UI_Render_Plan.hpp"
+
+static UiRect areas[8];
+static uint8_t joined[8];
+static uint32_t merged;
+
+void setUp(void)
+{
+    memset(areas, 0, sizeof(areas));
+    memset(joined, 0, sizeof(joined));
+    merged = 0;
+}
+
+void tearDown(void) {}
+
+static int16_t lastLive(int16_t n)
+{
+    for (int16_t i = n - 1; i >= 0; i--)
+        if (!joined[i])
+            return i;
+    return -1;
+}
+
+// 相邻的两个标签 (外接矩形多出的像素不到一次 flush 的开销) 合并成一块
+void test_adjacent_labels_merge(void)
+{
+    areas[0] = {250, 143, 309, 166}; // 60x24
+    areas[1] = {250, 168, 309, 188}; // 60x21，中间隔 1 行 (多画 60 像素)
+    uint32_t px = uiCoalesceAreas(areas, joined, 2, merged);
+    TEST_ASSERT_EQUAL_UINT32(1, merged);
+    TEST_ASSERT_EQUAL_UINT8(1, joined[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, joined[1]);
+    TEST_ASSERT_EQUAL_INT(143, areas[1].y1);
+    TEST_ASSERT_EQUAL_INT(188, areas[1].y2);
+    TEST_ASSERT_EQUAL_UINT32(60 * 46, px);
+}
+
+// 多画的像素超过一次 flush 的开销 (UI_FLUSH_OVERHEAD_PX) 时不合并，推给屏幕的字节数不会变多
+void test_gap_costlier_than_flush_stays_separate(void)
+{
+    areas[0] = {250, 143, 309, 166}; // 60x24
+    areas[1] = {250, 170, 309, 190}; // 60x21，中间隔 3 行 (多画 180 像素)
+    uint32_t px = uiCoalesceAreas(areas, joined, 2, merged);
+    TEST_ASSERT_EQUAL_UINT32(0, merged);
+    TEST_ASSERT_EQUAL_UINT32(60 * 24 + 60 * 21, px);
+}
+
+// 相距很远的小区域不合并 (外接矩形会多画很多像素)
+void test_far_areas_stay_separate(void)
+{
+    areas[0] = {0, 0, 9, 9};
+    areas[1] = {300, 200, 309, 209};
+    uint32_t px = uiCoalesceAreas(areas, joined, 2, merged);
+    TEST_ASSERT_EQUAL_UINT32(0, merged);
+    TEST_ASSERT_EQUAL_UINT32(200, px);
+    TEST_ASSERT_EQUAL_INT(0, areas[0].x1);
+    TEST_ASSERT_EQUAL_INT(300, areas[1].x1);
+}
+
+// 只有部分区域彼此靠近时，合并这几块，其余保持不变
+void test_partial_merge_among_scattered(void)
+{
+    areas[0] = {50, 95, 129, 134};   // 速度数字
+    areas[1] = {250, 143, 309, 166}; // 计时
+    areas[2] = {0, 230, 9, 239};     // 远处的小块
+    areas[3] = {250, 168, 309, 188}; // 紧挨计时
+    uint32_t px = uiCoalesceAreas(areas, joined, 4, merged);
+    TEST_ASSERT_EQUAL_UINT32(1, merged);
+    TEST_ASSERT_EQUAL_UINT8(0, joined[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, joined[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, joined[2]);
+    TEST_ASSERT_EQUAL_UINT8(0, joined[3]);
+    TEST_ASSERT_EQUAL_UINT32(80 * 40 + 60 * 46 + 100, px);
+}
+
+// LVGL 已经合并掉的区域不参与；最后一块未合并区域的下标不变
+void test_skips_joined_and_keeps_last_index(void)
+{
+    areas[0] = {0, 0, 39, 19};
+    areas[1] = {0, 0, 319, 239}; // 已被 LVGL 合并掉
+    areas[2] = {0, 20, 39, 39};
+    areas[3] = {200, 200, 209, 209};
+    areas[4] = {0, 40, 39, 59};
+    joined[1] = 1;
+    int16_t before = lastLive(5);
+    uint32_t px = uiCoalesceAreas(areas, joined, 5, merged);
+    TEST_ASSERT_EQUAL_INT(before, lastLive(5));
+    TEST_ASSERT_EQUAL_UINT32(2, merged);
+    TEST_ASSERT_EQUAL_INT(0, areas[4].y1);
+    TEST_ASSERT_EQUAL_INT(59, areas[4].y2);
+    TEST_ASSERT_EQUAL_UINT32(40 * 60 + 100, px);
+}
+
+void test_single_area_unchanged(void)
+{
+    areas[0] = {10, 10, 19, 29};
+    TEST_ASSERT_EQUAL_UINT32(200, uiCoalesceAreas(areas, joined, 1, merged));
+    TEST_ASSERT_EQUAL_UINT32(0, merged);
+    TEST_ASSERT_EQUAL_UINT8(0, joined[0]);
+}
+
+// 缓冲策略: AUTO 在脏区达到半屏时用整屏缓冲；没有 PSRAM 缓冲时总是条带
+void test_full_frame_decision(void)
+{
+    const uint32_t screen = UI_SCREEN_W * UI_SCREEN_H;
+    TEST_ASSERT_FALSE(uiUseFullFrame(UI_BUF_BANDS, true, screen));
+    TEST_ASSERT_TRUE(uiUseFullFrame(UI_BUF_FULL, true, 100));
+    TEST_ASSERT_FALSE(uiUseFullFrame(UI_BUF_FULL, false, screen));
+    TEST_ASSERT_FALSE(uiUseFullFrame(UI_BUF_AUTO, true, screen / 2 - 1));
+    TEST_ASSERT_TRUE(uiUseFullFrame(UI_BUF_AUTO, true, screen / 2));
+    TEST_ASSERT_FALSE(uiUseFullFrame(UI_BUF_AUTO, false, screen));
+}
+
+// 整屏在条带缓冲里要 8 次 flush，在整屏缓冲里 1 次
+void test_flush_count(void)
+{
+    TEST_ASSERT_EQUAL_UINT32(8, uiFlushCount(UI_SCREEN_W, UI_SCREEN_H, UI_BAND_PX));
+    TEST_ASSERT_EQUAL_UINT32(1, uiFlushCount(UI_SCREEN_W, UI_SCREEN_H, UI_SCREEN_W * UI_SCREEN_H));
+    TEST_ASSERT_EQUAL_UINT32(1, uiFlushCount(80, 40, UI_BAND_PX));
+    TEST_ASSERT_EQUAL_UINT32(2, uiFlushCount(240, 41, UI_BAND_PX));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_adjacent_labels_merge);
+    RUN_TEST(test_gap_costlier_than_flush_stays_separate);
+    RUN_TEST(test_far_areas_stay_separate);
+    RUN_TEST(test_partial_merge_among_scattered);
+    RUN_TEST(test_skips_joined_and_keeps_last_index);
+    RUN_TEST(test_single_area_unchanged);
+    RUN_TEST(test_full_frame_decision);
+    RUN_TEST(test_flush_count);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// UBX 解析器: NAV-PVT 解码、与 NMEA 混在一起的字节流、任意位置拆包、坏帧/超长帧/长度出错后的重新同步 (UBX_Parser.hpp)
+#include <unity.h>
+#include "UBX_Parser.hpp"
+
+static UBXParser *ubx;
+
+void setUp(void) { ubx = new UBXParser(); }
+void tearDown(void) { delete ubx; }
+
+static UBXNavPvt samplePvt(uint32_t iTOW)
+{
+    UBXNavPvt p = {};
+    p.iTOW = iTOW;
+    p.lat = 31.1685575;
+    p.lon = 121.5090535;
+    p.alt_m = 12.345f;
+    p.speed_kmh = 115.2f;
+    p.heading_deg = 87.25f;
+    p.hAcc_m = 0.8f;
+    p.sAcc_kmh = 0.36f;
+    p.fixType = 3;
+    p.numSV = 14;
+    p.valid = true;
+    return p;
+}
+
+// 逐字节喂入，返回校验通过的 NAV-PVT 帧数；NMEA 字节 (UBX_NOT_MINE) 计入 *foreign
+static int feedAll(const uint8_t *data, size_t len, UBXNavPvt *last, size_t *foreign = NULL)
+{
+    int frames = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        UBXFeedResult r = ubx->feed(data[i]);
+        if (r == UBX_NOT_MINE && foreign)
+            (*foreign)++;
+        if (r == UBX_FRAME_OK && ubx->decodeNavPvt(*last))
+            frames++;
+    }
+    return frames;
+}
+
+void test_decode_nav_pvt(void)
+{
+    uint8_t frame[UBX_NAV_PVT_FRAME_LEN];
+    UBXNavPvt in = samplePvt(345600100), out = {};
+    TEST_ASSERT_EQUAL(UBX_NAV_PVT_FRAME_LEN, ubxEncodeNavPvt(in, frame));
+    TEST_ASSERT_EQUAL(1, feedAll(frame, sizeof(frame), &out));
+
+    TEST_ASSERT_EQUAL_UINT32(345600100, out.iTOW);
+    TEST_ASSERT_EQUAL_INT32(311685575, lround(out.lat * 1e7));
+    TEST_ASSERT_EQUAL_INT32(1215090535, lround(out.lon * 1e7));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.345f, out.alt_m);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 115.2f, out.speed_kmh);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 87.25f, out.heading_deg);
+    TEST_ASSERT_EQUAL_UINT8(3, out.fixType);
+    TEST_ASSERT_EQUAL_UINT8(14, out.numSV);
+    TEST_ASSERT_TRUE(out.valid);
+}
+
+// gnssFixOK 没置位时不算有效定位
+void test_no_fix_is_invalid(void)
+{
+    uint8_t frame[UBX_NAV_PVT_FRAME_LEN];
+    UBXNavPvt in = samplePvt(1000), out = {};
+    in.valid = false;
+    ubxEncodeNavPvt(in, frame);
+    TEST_ASSERT_EQUAL(1, feedAll(frame, sizeof(frame), &out));
+    TEST_ASSERT_FALSE(out.valid);
+}
+
+// UBX 帧与 NMEA 文本交错 (UBX 模式下 GGA/RMC 仍然输出)：NMEA 字节一个不少地交回去
+void test_interleaved_with_nmea(void)
+{
+    static const char nmea[] = "$GNGGA,083559.00,3110.12345,N,12130.54321,E,1,12,0.8,12.3,M,8.1,M,,*4F\r\n";
+    uint8_t stream[10 * (UBX_NAV_PVT_FRAME_LEN + sizeof(nmea))];
+    size_t len = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        len += ubxEncodeNavPvt(samplePvt(1000 + i * 100), stream + len);
+        memcpy(stream + len, nmea, sizeof(nmea) - 1);
+        len += sizeof(nmea) - 1;
+    }
+    UBXNavPvt out = {};
+    size_t foreign = 0;
+    TEST_ASSERT_EQUAL(10, feedAll(stream, len, &out, &foreign));
+    TEST_ASSERT_EQUAL(10 * (sizeof(nmea) - 1), foreign);
+    TEST_ASSERT_EQUAL_UINT32(1900, out.iTOW);
+    TEST_ASSERT_EQUAL_UINT32(0, ubx->getFramesBad());
+}
+
+// 串口一次读到的块可能在帧内任意位置断开：解析器是逐字节状态机，拆成任意小块结果都一样
+void test_split_at_every_offset(void)
+{
+    uint8_t stream[3 * UBX_NAV_PVT_FRAME_LEN];
+    size_t len = 0;
+    for (int i = 0; i < 3; i++)
+        len += ubxEncodeNavPvt(samplePvt(5000 + i * 100), stream + len);
+
+    for (size_t cut = 1; cut < len; cut++)
+    {
+        UBXParser p;
+        UBXNavPvt out = {};
+        int frames = 0;
+        size_t pos = 0;
+        while (pos < len)
+        {
+            size_t n = min(cut, len - pos);
+            for (size_t i = 0; i < n; i++)
+                if (p.feed(stream[pos + i]) == UBX_FRAME_OK && p.decodeNavPvt(out))
+                    frames++;
+            pos += n;
+        }
+        TEST_ASSERT_EQUAL(3, frames);
+        TEST_ASSERT_EQUAL_UINT32(5200, out.iTOW);
+    }
+}
+
+// 校验和错的帧丢弃并计数，下一帧照常解析
+void test_bad_checksum_then_resync(void)
+{
+    uint8_t stream[2 * UBX_NAV_PVT_FRAME_LEN];
+    ubxEncodeNavPvt(samplePvt(100), stream);
+    ubxEncodeNavPvt(samplePvt(200), stream + UBX_NAV_PVT_FRAME_LEN);
+    stream[40] ^= 0x10; // 第一帧负载里翻一位
+    UBXNavPvt out = {};
+    TEST_ASSERT_EQUAL(1, feedAll(stream, sizeof(stream), &out));
+    TEST_ASSERT_EQUAL_UINT32(200, out.iTOW);
+    TEST_ASSERT_EQUAL_UINT32(1, ubx->getFramesBad());
+}
+
+// 比 NAV-PVT 还长的消息 (MON-VER 之类) 在长度字段处就丢弃，负载当作帧外字节交回去，之后照常同步；
+// 假同步头 0xB5 后面不是 0x62 时这个字节交回去
+void test_oversize_and_false_sync(void)
+{
+    uint8_t stream[512];
+    size_t len = 0;
+    // 0xB5 'X': 假同步头
+    stream[len++] = 0xB5;
+    stream[len++] = 'X';
+    // 200 字节负载的 MON-VER
+    uint8_t *f = stream + len;
+    f[0] = 0xB5, f[1] = 0x62, f[2] = 0x0A, f[3] = 0x04, f[4] = 200, f[5] = 0;
+    for (int i = 0; i < 200; i++)
+        f[6 + i] = (uint8_t)i;
+    uint8_t ckA = 0, ckB = 0;
+    for (int i = 2; i < 206; i++)
+        ckA += f[i], ckB += ckA;
+    f[206] = ckA, f[207] = ckB;
+    len += 208;
+    len += ubxEncodeNavPvt(samplePvt(700), stream + len);
+
+    UBXNavPvt out = {};
+    size_t foreign = 0;
+    TEST_ASSERT_EQUAL(1, feedAll(stream, len, &out, &foreign));
+    // 'X' + MON-VER 的负载和校验和，负载里的 0xB5 (第 181 字节) 按假同步头吃掉
+    TEST_ASSERT_EQUAL(1 + 200 + 2 - 1, foreign);
+    TEST_ASSERT_EQUAL_UINT32(700, out.iTOW);
+    TEST_ASSERT_EQUAL_UINT32(1, ubx->getFramesBad()); // 超长帧按坏帧计数
+}
+
+// 长度字段坏掉 (0xFFFF) 的帧不能吞掉后面的定位
+void test_corrupt_length_does_not_swallow_frames(void)
+{
+    uint8_t stream[6 + 3 * UBX_NAV_PVT_FRAME_LEN];
+    const uint8_t hdr[6] = {0xB5, 0x62, UBX_CLASS_NAV, UBX_ID_NAV_PVT, 0xFF, 0xFF};
+    memcpy(stream, hdr, sizeof(hdr));
+    for (int i = 0; i < 3; i++)
+        ubxEncodeNavPvt(samplePvt(100 * (i + 1)), stream + 6 + i * UBX_NAV_PVT_FRAME_LEN);
+
+    UBXNavPvt out = {};
+    TEST_ASSERT_EQUAL(3, feedAll(stream, sizeof(stream), &out));
+    TEST_ASSERT_EQUAL_UINT32(300, out.iTOW);
+    TEST_ASSERT_EQUAL_UINT32(1, ubx->getFramesBad());
+}
+
+// u-blox 7 (协议 14) 的 NAV-PVT 只有 84 字节负载，也要接受
+void test_short_nav_pvt(void)
+{
+    uint8_t frame[UBX_NAV_PVT_FRAME_LEN];
+    ubxEncodeNavPvt(samplePvt(4242), frame);
+    uint8_t shortFrame[6 + 84 + 2];
+    memcpy(shortFrame, frame, 6 + 84);
+    shortFrame[4] = 84;
+    uint8_t ckA = 0, ckB = 0;
+    for (int i = 2; i < 6 + 84; i++)
+        ckA += shortFrame[i], ckB += ckA;
+    shortFrame[6 + 84] = ckA;
+    shortFrame[6 + 84 + 1] = ckB;
+    UBXNavPvt out = {};
+    TEST_ASSERT_EQUAL(1, feedAll(shortFrame, sizeof(shortFrame), &out));
+    TEST_ASSERT_EQUAL_UINT32(4242, out.iTOW);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_nav_pvt);
+    RUN_TEST(test_no_fix_is_invalid);
+    RUN_TEST(test_interleaved_with_nmea);
+    RUN_TEST(test_split_at_every_offset);
+    RUN_TEST(test_bad_checksum_then_resync);
+    RUN_TEST(test_oversize_and_false_sync);
+    RUN_TEST(test_corrupt_length_does_not_swallow_frames);
+    RUN_TEST(test_short_nav_pvt);
+    return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Build the SD-card track catalogue (tracks.rtdb) used by src/Track_Database.hpp.
+
+Input is a JSON list of tracks:
+
+    [
+      {
+        "name": "Shanghai Tianma",
+        "type": "circuit",            # or "sprint"
+        "half_width": 6.0,            # timing line half width (m)
+        "start":  [31.0712, 121.1384, 275.0],   # lat, lon[, heading deg]
+        "finish": [31.0712, 121.1384],          # sprint only
+        "sectors": [[31.0725, 121.1402], [31.0698, 121.1411, 90.0]]
+      }
+    ]
+
+Usage:
+    build_track_db.py tracks.json -o tracks.rtdb
+    build_track_db.py --synthetic 10000 -o tracks.rtdb   # random catalogue for testing
+    build_track_db.py --bench tracks.rtdb                 # host-side lookup benchmark
+
+Copy the output to the root of the SD card.
+"""
+
+import argparse
+import bisect
+import json
+import math
+import random
+import struct
+import sys
+import time
+
+MAGIC = 0x42445452  # "RTDB"
+VERSION = 1
+MAX_GATES = 15  # TRACK_MAX_SECTORS - 1
+DEFAULT_CELL_DEG = 0.1
+
+HEADER = struct.Struct("<IHHIi16x")
+GATE = struct.Struct("<iihh")
+RECORD = struct.Struct("<32sBBH" + "iihh" * (2 + MAX_GATES))
+assert HEADER.size == 32 and RECORD.size == 240
+
+
+def cell_key(lat, lon, cell_e7):
+    lon_cells = -(-3600000000 // cell_e7)
+    row = math.floor((lat + 90.0) * 1e7 / cell_e7)
+    col = math.floor((lon + 180.0) * 1e7 / cell_e7)
+    return row * lon_cells + col
+
+
+def gate_fields(g):
+    lat, lon = g[0], g[1]
+    heading = g[2] if len(g) > 2 and g[2] is not None else -1
+    h10 = -1 if heading < 0 else int(round(heading * 10)) % 3600
+    return [int(round(lat * 1e7)), int(round(lon * 1e7)), h10, 0]
+
+
+def pack_track(t):
+    ttype = t.get("type", "circuit")
+    ttype = {"circuit": 0, "sprint": 1}.get(ttype, ttype)
+    sectors = t.get("sectors", [])
+    if len(sectors) > MAX_GATES:
+        raise ValueError("%s: at most %d sector gates" % (t["name"], MAX_GATES))
+    start = t["start"]
+    finish = t.get("finish", start)
+
+    fields = [t["name"].encode("utf-8")[:31], int(ttype), len(sectors),
+              int(round(t.get("half_width", 3.0) * 100))]
+    fields += gate_fields(start) + gate_fields(finish)
+    for i in range(MAX_GATES):
+        fields += gate_fields(sectors[i]) if i < len(sectors) else [0, 0, 0, 0]
+    return RECORD.pack(*fields)
+
+
+def build(tracks, out_path, cell_deg):
+    cell_e7 = int(round(cell_deg * 1e7))
+    entries = sorted((cell_key(t["start"][0], t["start"][1], cell_e7), pack_track(t)) for t in tracks)
+    with open(out_path, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, RECORD.size, len(entries), cell_e7))
+        f.write(b"".join(struct.pack("<I", k) for k, _ in entries))
+        f.write(b"".join(r for _, r in entries))
+    print("wrote %s: %d tracks, cell %.3f deg" % (out_path, len(entries), cell_deg))
+
+
+def synthetic(n, seed=1):
+    rng = random.Random(seed)
+    tracks = []
+    for i in range(n):
+        lat = rng.uniform(-55.0, 65.0)
+        lon = rng.uniform(-179.0, 179.0)
+        sectors = []
+        for _ in range(rng.randint(0, 3)):
+            sectors.append([lat + rng.uniform(-0.01, 0.01), lon + rng.uniform(-0.01, 0.01)])
+        tracks.append({"name": "Track %05d" % i, "type": "circuit", "half_width": 6.0,
+                       "start": [lat, lon, rng.uniform(0, 360)], "sectors": sectors})
+    return tracks
+
+
+def bench(path, n=10000):
+    """Same lookup as TrackDatabase::findNearest(): binary search on the key array, 3x3 cells."""
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, rec_size, count, cell_e7 = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or rec_size != RECORD.size:
+        sys.exit("not a track database: " + path)
+    keys = list(struct.unpack_from("<%dI" % count, data, HEADER.size))
+    base = HEADER.size + 4 * count
+    lon_cells = -(-3600000000 // cell_e7)
+
+    def find(lat, lon):
+        row = math.floor((lat + 90.0) * 1e7 / cell_e7)
+        col = math.floor((lon + 180.0) * 1e7 / cell_e7)
+        best = None
+        for r in (row - 1, row, row + 1):
+            k0, k1 = r * lon_cells + max(col - 1, 0), r * lon_cells + min(col + 1, lon_cells - 1)
+            i = bisect.bisect_left(keys, k0)
+            while i < count and keys[i] <= k1:
+                rec = RECORD.unpack_from(data, base + i * RECORD.size)
+                dy = (rec[4] * 1e-7 - lat) * 111195.0
+                dx = (rec[5] * 1e-7 - lon) * 111195.0 * math.cos(math.radians(lat))
+                d = math.hypot(dx, dy)
+                if best is None or d < best[0]:
+                    best = (d, rec[0].rstrip(b"\0").decode("utf-8", "replace"))
+                i += 1
+        return best
+
+    rng = random.Random(2)
+    queries = []
+    for _ in range(n):
+        rec = RECORD.unpack_from(data, base + rng.randrange(count) * RECORD.size)
+        queries.append((rec[4] * 1e-7 + rng.uniform(-0.01, 0.01), rec[5] * 1e-7 + rng.uniform(-0.01, 0.01)))
+
+    t0 = time.perf_counter()
+    hits = sum(1 for q in queries if find(*q))
+    dt = time.perf_counter() - t0
+    print("%d lookups over %d tracks: %.1f us/lookup, hits=%d" % (n, count, dt / n * 1e6, hits))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input", nargs="?", help="tracks JSON file")
+    ap.add_argument("-o", "--output", default="tracks.rtdb")
+    ap.add_argument("--cell", type=float, default=DEFAULT_CELL_DEG, help="grid cell size in degrees")
+    ap.add_argument("--synthetic", type=int, metavar="N", help="generate N random tracks instead of reading input")
+    ap.add_argument("--bench", metavar="DB", help="run the lookup benchmark on an existing database")
+    args = ap.parse_args()
+
+    if args.bench:
+        bench(args.bench)
+        return
+    if args.synthetic:
+        tracks = synthetic(args.synthetic)
+    elif args.input:
+        with open(args.input, encoding="utf-8") as f:
+            tracks = json.load(f)
+    else:
+        ap.error("need an input file, --synthetic or --bench")
+    build(tracks, args.output, args.cell)
+
+
+if __name__ == "__main__":
+    main()
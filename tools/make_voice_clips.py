@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Convert the lap-time voice clips to the PCM WAV files cached by src/Voice_Cache.hpp.
+
+The firmware loads /voice/<name>.wav (16-bit mono PCM, one common sample rate)
+into PSRAM at boot, for the clips 0..10, min and sec. This script decodes the
+existing /mp3/num/*.mp3 files with ffmpeg and writes them in that format.
+
+Usage:
+    make_voice_clips.py SD_ROOT/mp3/num -o SD_ROOT/voice
+    make_voice_clips.py SD_ROOT/mp3/num -o SD_ROOT/voice --rate 22050
+
+Leading/trailing silence is trimmed on the device, so the clips can be used as-is.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import wave
+
+CLIPS = [str(i) for i in range(11)] + ["min", "sec"]
+
+
+def convert(src, dst, rate):
+    subprocess.run(
+        ["ffmpeg", "-v", "error", "-y", "-i", src, "-ac", "1", "-ar", str(rate),
+         "-sample_fmt", "s16", "-map_metadata", "-1", dst],
+        check=True)
+    with wave.open(dst, "rb") as w:
+        return w.getnframes() / float(w.getframerate())
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("src", help="directory containing 0.mp3 .. 10.mp3, min.mp3, sec.mp3")
+    ap.add_argument("-o", "--out", required=True, help="output directory (copy to /voice on the SD card)")
+    ap.add_argument("--rate", type=int, default=44100, help="sample rate in Hz (default 44100)")
+    args = ap.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    total = 0
+    for name in CLIPS:
+        src = os.path.join(args.src, name + ".mp3")
+        if not os.path.exists(src):
+            sys.exit("missing %s" % src)
+        dst = os.path.join(args.out, name + ".wav")
+        secs = convert(src, dst, args.rate)
+        size = os.path.getsize(dst)
+        total += size
+        print("%-4s %5.2fs %7d bytes" % (name, secs, size))
+    print("total %d KB of PSRAM (before silence trimming)" % (total // 1024))
+
+
+if __name__ == "__main__":
+    main()
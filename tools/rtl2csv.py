@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Convert a binary session log (.rtl, see src/Log_Format.hpp) back to the CSV
+columns written by DataLogger in CSV mode.
+
+Usage:
+    rtl2csv.py session_20250101_1200.rtl [-o out.csv] [--imu out_imu.csv]
+
+The 100 Hz IMU stream (if present) goes to a second file, <input>_imu.csv by default.
+
+Blocks with a bad magic, a foreign session id or a CRC mismatch are skipped
+(and counted on stderr); the remaining blocks are emitted in sequence order.
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+import zlib
+
+RTL_MAGIC = 0x314C5452
+RTL_BLOCK_MAGIC = 0x4B4C4252
+RTL_VERSION = 1
+
+BLOCK_GPS = 1
+BLOCK_IMU = 2
+
+FILE_HEADER = struct.Struct("<IHHIIQHHI")
+BLOCK_HEADER = struct.Struct("<IIIBBHI")
+GPS_RECORD = struct.Struct("<IiiiHBBHhhhhH")
+IMU_RECORD = struct.Struct("<IhhhhhH")
+assert FILE_HEADER.size == 32 and BLOCK_HEADER.size == 20 and GPS_RECORD.size == 32 and IMU_RECORD.size == 16
+
+FLAG_FIX = 0x01
+FLAG_DATE_VALID = 0x02
+
+CSV_HEADER = "Time,Lat,Lon,Alt,Speed_kmh,Sats,Fix,Heading,Roll,Pitch,Lon_G,Lat_G"
+IMU_HEADER = "Time,Lat_G,Lon_G,Vert_G,Roll,Pitch"
+
+
+def read_header(data):
+    if len(data) < FILE_HEADER.size:
+        raise ValueError("file too short")
+    magic, version, hdr_size, block_size, session, start_ms, gps_size, _, crc = FILE_HEADER.unpack_from(data, 0)
+    if magic != RTL_MAGIC:
+        raise ValueError("not an .rtl file")
+    if version != RTL_VERSION:
+        raise ValueError("unsupported version %d" % version)
+    if zlib.crc32(data[:FILE_HEADER.size - 4]) != crc:
+        raise ValueError("file header CRC mismatch")
+    return {"block_size": block_size, "session": session, "start_ms": start_ms, "gps_size": gps_size}
+
+
+def iter_blocks(data, hdr, stats):
+    """Yield (seq, type, record_size, payload) for every valid block of this session."""
+    bs = hdr["block_size"]
+    blocks = []
+    for off in range(bs, len(data) - BLOCK_HEADER.size + 1, bs):
+        magic, session, seq, btype, rsize, count, crc = BLOCK_HEADER.unpack_from(data, off)
+        if magic != RTL_BLOCK_MAGIC or session != hdr["session"]:
+            stats["foreign"] += 1
+            continue
+        end = off + BLOCK_HEADER.size + rsize * count
+        if rsize == 0 or end > min(off + bs, len(data)):
+            stats["bad"] += 1
+            continue
+        if zlib.crc32(data[off:off + 16] + data[off + BLOCK_HEADER.size:end]) != crc:
+            stats["bad"] += 1
+            continue
+        blocks.append((seq, btype, rsize, data[off + BLOCK_HEADER.size:end]))
+    blocks.sort(key=lambda b: b[0])
+    return blocks
+
+
+def format_time(start_ms, t_ms, flags):
+    if not flags & FLAG_DATE_VALID:
+        return "2000-01-01 00:00:00.000"
+    ms = start_ms + t_ms
+    t = datetime.datetime(1970, 1, 1) + datetime.timedelta(milliseconds=ms)
+    return t.strftime("%Y-%m-%d %H:%M:%S.") + "%03d" % (ms % 1000)
+
+
+def gps_rows(hdr, payload, rsize):
+    for off in range(0, len(payload), rsize):
+        (t_ms, lat, lon, alt_cm, speed_c, sats, flags, heading_d, roll_d, pitch_d,
+         lon_mg, lat_mg, _) = GPS_RECORD.unpack_from(payload, off)
+        yield "%s,%.8f,%.8f,%.2f,%.2f,%d,%d,%.1f,%.1f,%.1f,%.2f,%.2f" % (
+            format_time(hdr["start_ms"], t_ms, flags),
+            lat * 1e-7, lon * 1e-7, alt_cm / 100.0, speed_c / 100.0, sats,
+            1 if flags & FLAG_FIX else 0,
+            heading_d / 10.0, roll_d / 10.0, pitch_d / 10.0, lon_mg / 1000.0, lat_mg / 1000.0)
+
+
+def imu_rows(hdr, payload, rsize, date_valid):
+    flags = FLAG_DATE_VALID if date_valid else 0
+    for off in range(0, len(payload), rsize):
+        t_ms, lat_mg, lon_mg, vert_mg, roll_d, pitch_d, _ = IMU_RECORD.unpack_from(payload, off)
+        yield "%s,%.3f,%.3f,%.3f,%.1f,%.1f" % (
+            format_time(hdr["start_ms"], t_ms, flags),
+            lat_mg / 1000.0, lon_mg / 1000.0, vert_mg / 1000.0, roll_d / 10.0, pitch_d / 10.0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("input")
+    ap.add_argument("-o", "--output", help="output CSV (default: input name with .csv)")
+    ap.add_argument("--imu", help="output CSV for the 100 Hz IMU stream (default: input name with _imu.csv)")
+    args = ap.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+    try:
+        hdr = read_header(data)
+    except ValueError as e:
+        sys.exit("%s: %s" % (args.input, e))
+
+    base = args.input.rsplit(".", 1)[0]
+    out_path = args.output or base + ".csv"
+    imu_path = args.imu or base + "_imu.csv"
+    stats = {"foreign": 0, "bad": 0}
+    blocks = iter_blocks(data, hdr, stats)
+
+    # IMU 记录没有自己的日期标志，跟随 GPS 记录 (任一条有效即有效)
+    date_valid = False
+    rows = 0
+    with open(out_path, "w", newline="\n") as out:
+        out.write(CSV_HEADER + "\r\n")
+        for seq, btype, rsize, payload in blocks:
+            if btype == BLOCK_GPS:
+                for line in gps_rows(hdr, payload, rsize):
+                    out.write(line + "\n")
+                    rows += 1
+                    date_valid = date_valid or not line.startswith("2000-01-01")
+
+    imu_blocks = [b for b in blocks if b[1] == BLOCK_IMU]
+    imu_count = 0
+    if imu_blocks:
+        with open(imu_path, "w", newline="\n") as out:
+            out.write(IMU_HEADER + "\n")
+            for seq, btype, rsize, payload in imu_blocks:
+                for line in imu_rows(hdr, payload, rsize, date_valid):
+                    out.write(line + "\n")
+                    imu_count += 1
+
+    print("%s: %d rows, %d IMU rows, %d bad blocks, %d foreign/empty blocks"
+          % (out_path, rows, imu_count, stats["bad"], stats["foreign"]), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Convert an event trace dumped by the firmware (src/Trace.hpp) to Chrome trace JSON.
+
+The dump is a run of "TRC:<hex>" lines, sent over serial (command 'x') or over
+BLE in answer to CMD:TRACE. Any other lines in the capture are ignored, so a raw
+serial log or a BLE log can be passed directly. Open the result in
+chrome://tracing or https://ui.perfetto.dev.
+
+Usage:
+    trace2chrome.py serial.log -o trace.json
+
+Each core's cycle counter gives sub-microsecond spacing within that core. The
+cores are aligned with each other through the micros() stamp in every event.
+Begin/end pairs become complete ("X") events. Each core/event kind gets its own
+row.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x31435254  # "TRC1"
+EVENT = struct.Struct("<IIHBBI")  # cycles, us, id, phase, core, arg
+
+# Same table as TraceId in src/Trace.hpp
+NAMES = {
+    1: "GPS epoch",
+    2: "IMU frame",
+    3: "Fusion pass",
+    4: "Log write",
+    5: "LVGL flush",
+    6: "BLE notify",
+    7: "Audio clip",
+}
+PH_INSTANT, PH_BEGIN, PH_END = 0, 1, 2
+
+
+def read_dump(path):
+    data = bytearray()
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            i = line.find("TRC:")
+            if i >= 0:
+                data += bytes.fromhex(line[i + 4:].strip())
+    return bytes(data)
+
+
+def parse(data):
+    magic, mhz_cores, ring_len = struct.unpack_from("<III", data, 0)
+    if magic != MAGIC:
+        sys.exit("not a trace dump (bad magic)")
+    mhz, cores = mhz_cores & 0xFFFF, mhz_cores >> 16
+    pos = 12
+    per_core = []
+    for _ in range(cores):
+        head, n = struct.unpack_from("<II", data, pos)
+        pos += 8
+        events = [EVENT.unpack_from(data, pos + k * EVENT.size) for k in range(n)]
+        pos += n * EVENT.size
+        dropped = head - n
+        if dropped:
+            print("core %d: %d older events overwritten" % (len(per_core), dropped), file=sys.stderr)
+        per_core.append(events)
+    return mhz, per_core
+
+
+def timestamps(events, mhz):
+    """Microsecond timestamps for one core, from the unwrapped cycle counter.
+
+    micros() (wraps every 71 min) picks the number of cycle-counter wraps
+    (every ~18 s at 240 MHz) between consecutive events.
+    """
+    out = []
+    t = None
+    prev_cyc = prev_us = 0
+    for cyc, us, *_ in events:
+        if t is None:
+            t = float(us)
+        else:
+            dus = (us - prev_us) & 0xFFFFFFFF
+            dcyc = (cyc - prev_cyc) & 0xFFFFFFFF
+            wraps = round((dus * mhz - dcyc) / 2.0 ** 32)
+            t += (dcyc + wraps * 2 ** 32) / float(mhz)
+        prev_cyc, prev_us = cyc, us
+        out.append(t)
+    return out
+
+
+def convert(mhz, per_core):
+    rows = {}
+    out = []
+    for core, events in enumerate(per_core):
+        ts = timestamps(events, mhz)
+        open_ = {}
+        for t, (_, _, eid, phase, _, arg) in zip(ts, events):
+            name = NAMES.get(eid, "event %d" % eid)
+            tid = core * 100 + eid
+            rows[tid] = "core%d %s" % (core, name)
+            if phase == PH_BEGIN:
+                open_[eid] = (t, arg)
+            elif phase == PH_END:
+                if eid in open_:  # the begin may have been overwritten
+                    t0, a0 = open_.pop(eid)
+                    out.append({"name": name, "ph": "X", "pid": 0, "tid": tid,
+                                "ts": t0, "dur": t - t0, "args": {"arg": a0}})
+            else:
+                out.append({"name": name, "ph": "i", "s": "t", "pid": 0, "tid": tid,
+                            "ts": t, "args": {"arg": arg}})
+
+    if out:
+        t0 = min(e["ts"] for e in out)
+        for e in out:
+            e["ts"] -= t0
+    for tid, label in rows.items():
+        out.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid, "args": {"name": label}})
+    out.append({"name": "process_name", "ph": "M", "pid": 0, "args": {"name": "ESP32 (%d MHz)" % mhz}})
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log", help="serial/BLE capture containing TRC: lines")
+    ap.add_argument("-o", "--output", default="trace.json")
+    args = ap.parse_args()
+
+    data = read_dump(args.log)
+    if not data:
+        sys.exit("no TRC: lines found")
+    mhz, per_core = parse(data)
+    events = convert(mhz, per_core)
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, f)
+    print("%s: %d events from %d cores" % (args.output, sum(len(e) for e in per_core), len(per_core)))
+
+
+if __name__ == "__main__":
+    main()